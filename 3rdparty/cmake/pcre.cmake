@@ -69,7 +69,11 @@ SET(SUPPORT_PCRE16 1)
 SET(SUPPORT_UTF 1)
 SET(SUPPORT_UCP 1)
 SET(PCRE_SUPPORT_UTF ON)
-SET(SUPPORT_JIT 1)
+# JIT needs a platform supported by sljit, turn off for anything else
+option(PCRE_SUPPORT_JIT "Enable support for Just-in-time compiling." ON)
+IF(PCRE_SUPPORT_JIT)
+        SET(SUPPORT_JIT 1)
+ENDIF(PCRE_SUPPORT_JIT)
 SET(NEWLINE "10") # LF
 
 # Output files
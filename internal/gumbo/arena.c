@@ -0,0 +1,203 @@
+// Copyright 2020 Kevin B. Hendricks, Stratford Ontario  All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "arena.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+#ifdef _MSC_VER
+#define GUMBO_THREAD_LOCAL __declspec(thread)
+#else
+#define GUMBO_THREAD_LOCAL __thread
+#endif
+
+// Precedes every block returned by gumbo_malloc.  Its size is also the
+// alignment of the blocks, 16 bytes on 64 bit systems.
+typedef struct {
+  GumboArena* arena;
+  size_t size;
+} GumboBlockHeader;
+
+#define BLOCK_HEADER_SIZE sizeof(GumboBlockHeader)
+
+typedef struct GumboInternalArenaChunk {
+  struct GumboInternalArenaChunk* next;
+  size_t size;
+  size_t used;
+} GumboArenaChunk;
+
+struct GumboInternalArena {
+  // The chunk being allocated from comes first.
+  GumboArenaChunk* chunks;
+
+  // The most recent block allocated from the first chunk; it can
+  // be grown in place.
+  char* last_block;
+
+  size_t next_chunk_size;
+
+  bool has_heap_nodes;
+};
+
+static const size_t kMinChunkSize = 16 * 1024;
+static const size_t kMaxChunkSize = 1024 * 1024;
+
+static GUMBO_THREAD_LOCAL GumboArena* current_arena = NULL;
+
+static size_t round_up(size_t size) {
+  return (size + BLOCK_HEADER_SIZE - 1) & ~(BLOCK_HEADER_SIZE - 1);
+}
+
+static char* chunk_data(GumboArenaChunk* chunk) {
+  return (char*) chunk + round_up(sizeof(GumboArenaChunk));
+}
+
+static GumboBlockHeader* header_of(const void* ptr) {
+  return (GumboBlockHeader*) ((char*) ptr - BLOCK_HEADER_SIZE);
+}
+
+GumboArena* gumbo_arena_create(size_t size_hint) {
+  GumboArena* arena = gumbo_user_allocator(NULL, sizeof(GumboArena));
+  arena->chunks = NULL;
+  arena->last_block = NULL;
+  // parse trees usually take about twice the size of their source
+  size_t first_size = size_hint * 2;
+  if (first_size < kMinChunkSize) first_size = kMinChunkSize;
+  if (first_size > kMaxChunkSize) first_size = kMaxChunkSize;
+  arena->next_chunk_size = first_size;
+  arena->has_heap_nodes = false;
+  return arena;
+}
+
+void gumbo_arena_destroy(GumboArena* arena) {
+  GumboArenaChunk* chunk = arena->chunks;
+  while (chunk) {
+    GumboArenaChunk* next = chunk->next;
+    gumbo_user_free(chunk);
+    chunk = next;
+  }
+  gumbo_user_free(arena);
+}
+
+GumboArena* gumbo_arena_set_current(GumboArena* arena) {
+  GumboArena* previous = current_arena;
+  current_arena = arena;
+  return previous;
+}
+
+GumboArena* gumbo_arena_of(const void* ptr) {
+  return ptr ? header_of(ptr)->arena : NULL;
+}
+
+void gumbo_arena_add_heap_node(GumboArena* arena) {
+  arena->has_heap_nodes = true;
+}
+
+bool gumbo_arena_has_heap_nodes(const GumboArena* arena) {
+  return arena->has_heap_nodes;
+}
+
+static void* arena_allocate(GumboArena* arena, size_t size) {
+  size_t needed = BLOCK_HEADER_SIZE + round_up(size);
+  GumboArenaChunk* chunk = arena->chunks;
+
+  if (!chunk || chunk->used + needed > chunk->size) {
+    size_t chunk_size = arena->next_chunk_size;
+    if (chunk_size < needed) chunk_size = needed;
+    chunk = gumbo_user_allocator(NULL, round_up(sizeof(GumboArenaChunk)) + chunk_size);
+    if (!chunk) return NULL;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    if (arena->next_chunk_size < kMaxChunkSize) {
+      arena->next_chunk_size *= 2;
+    }
+  }
+
+  GumboBlockHeader* header = (GumboBlockHeader*) (chunk_data(chunk) + chunk->used);
+  chunk->used += needed;
+  header->arena = arena;
+  header->size = size;
+  arena->last_block = (char*) (header + 1);
+  return header + 1;
+}
+
+static void* arena_reallocate(GumboArena* arena, void* ptr, size_t size) {
+  GumboBlockHeader* header = header_of(ptr);
+  size_t old_size = header->size;
+
+  if (size <= old_size) {
+    return ptr;
+  }
+
+  // Vectors and string buffers being filled are usually the most
+  // recent block, so most growth happens in place.
+  GumboArenaChunk* chunk = arena->chunks;
+  if ((char*) ptr == arena->last_block &&
+      chunk->used - round_up(old_size) + round_up(size) <= chunk->size) {
+    chunk->used = chunk->used - round_up(old_size) + round_up(size);
+    header->size = size;
+    return ptr;
+  }
+
+  void* new_ptr = arena_allocate(arena, size);
+  if (new_ptr) {
+    memcpy(new_ptr, ptr, old_size);
+  }
+  return new_ptr;
+}
+
+static void* heap_allocate(size_t size) {
+  GumboBlockHeader* header = gumbo_user_allocator(NULL, BLOCK_HEADER_SIZE + size);
+  if (!header) return NULL;
+  header->arena = NULL;
+  header->size = size;
+  return header + 1;
+}
+
+void* gumbo_malloc(size_t size) {
+  if (current_arena) {
+    return arena_allocate(current_arena, size);
+  }
+  return heap_allocate(size);
+}
+
+void* gumbo_realloc(void* ptr, size_t size) {
+  if (!ptr) {
+    return gumbo_malloc(size);
+  }
+
+  GumboBlockHeader* header = header_of(ptr);
+  if (header->arena) {
+    return arena_reallocate(header->arena, ptr, size);
+  }
+
+  header = gumbo_user_allocator(header, BLOCK_HEADER_SIZE + size);
+  if (!header) return NULL;
+  header->size = size;
+  return header + 1;
+}
+
+void gumbo_free(void* ptr) {
+  // arena blocks are released along with their arena
+  if (ptr && !header_of(ptr)->arena) {
+    gumbo_user_free(header_of(ptr));
+  }
+}
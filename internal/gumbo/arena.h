@@ -0,0 +1,66 @@
+// Copyright 2020 Kevin B. Hendricks, Stratford Ontario  All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Per-parse arena allocator.
+//
+// Everything a parse allocates (nodes, attributes, strings, vectors and
+// errors) is carved out of a few large chunks owned by an arena created for
+// that parse, so destroying the output releases the whole tree at once
+// instead of freeing it node by node.  Each parse has its own arena and the
+// arena gumbo_malloc uses is tracked per thread, so concurrent parses never
+// share allocator state.
+//
+// Every block handed out by gumbo_malloc, from an arena or not, starts with
+// a small header recording its size and owning arena.  That lets gumbo_free
+// ignore arena blocks and gumbo_realloc keep a block in the arena it came
+// from, so a parsed tree can still be edited freely afterwards.
+
+#ifndef GUMBO_ARENA_H_
+#define GUMBO_ARENA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct GumboInternalArena GumboArena;
+
+// Creates an empty arena; size_hint is the length of the input to be parsed
+// and is used to size the first chunk.
+GumboArena* gumbo_arena_create(size_t size_hint);
+
+// Releases every block allocated from the arena.
+void gumbo_arena_destroy(GumboArena* arena);
+
+// Makes gumbo_malloc allocate from the arena on the calling thread, or from
+// the heap if arena is NULL.  Returns the arena that was current before so
+// it can be restored.
+GumboArena* gumbo_arena_set_current(GumboArena* arena);
+
+// The arena a block was allocated from, or NULL if it is a heap block.
+GumboArena* gumbo_arena_of(const void* ptr);
+
+// Records that a heap allocated node was added to a tree living in the
+// arena; such a tree must be walked to free those nodes when destroyed.
+void gumbo_arena_add_heap_node(GumboArena* arena);
+
+bool gumbo_arena_has_heap_nodes(const GumboArena* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // GUMBO_ARENA_H_
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <strings.h>
 
+#include "arena.h"
 #include "util.h"
 #include "vector.h"
 
@@ -40,7 +41,10 @@ GumboAttribute* gumbo_get_attribute(
 void gumbo_attribute_set_value(GumboAttribute *attr, const char *value)
 {
   gumbo_free((void *)attr->value);
+  // keep the value with its attribute
+  GumboArena *previous_arena = gumbo_arena_set_current(gumbo_arena_of(attr));
   attr->value = gumbo_strdup(value);
+  gumbo_arena_set_current(previous_arena);
   attr->original_value = kGumboEmptyString;
   attr->value_start = kGumboEmptySourcePosition;
   attr->value_end = kGumboEmptySourcePosition;
@@ -59,6 +63,9 @@ void gumbo_element_set_attribute(
   GumboAttribute *attr = gumbo_get_attribute(attributes, name);
 
   if (!attr) {
+    // a new attribute lives with its element's node
+    GumboNode *node = (GumboNode *)((char *)element - offsetof(GumboNode, v.element));
+    GumboArena *previous_arena = gumbo_arena_set_current(gumbo_arena_of(node));
     attr = gumbo_malloc(sizeof(GumboAttribute));
     attr->value = NULL;
     attr->attr_namespace = GUMBO_ATTR_NAMESPACE_NONE;
@@ -69,6 +76,7 @@ void gumbo_element_set_attribute(
     attr->name_end = kGumboEmptySourcePosition;
 
     gumbo_vector_add(attr, attributes);
+    gumbo_arena_set_current(previous_arena);
   }
 
   gumbo_attribute_set_value(attr, value);
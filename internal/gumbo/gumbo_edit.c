@@ -19,6 +19,7 @@
 #include <string.h>
 #include <strings.h>
 
+#include "arena.h"
 #include "attribute.h"
 #include "vector.h"
 #include "gumbo.h"
@@ -129,6 +130,18 @@ GumboNode* gumbo_create_template_node() {
 }
 
 
+// Grows the parent's children within the parent's arena, and lets a parsed
+// tree know when it gets a node it must free itself.
+// Returns the arena to restore once the node is added.
+static GumboArena* adopt_node(GumboNode* parent, GumboNode* node) {
+  GumboArena* arena = gumbo_arena_of(parent);
+  if (arena && !gumbo_arena_of(node)) {
+    gumbo_arena_add_heap_node(arena);
+  }
+  return gumbo_arena_set_current(arena);
+}
+
+
 // Appends a node to the end of its parent, setting the "parent" and
 // "index_within_parent" fields appropriately.
 void gumbo_append_node(GumboNode* parent, GumboNode* node) {
@@ -143,7 +156,9 @@ void gumbo_append_node(GumboNode* parent, GumboNode* node) {
   }
   node->parent = parent;
   node->index_within_parent = children->length;
+  GumboArena* previous_arena = adopt_node(parent, node);
   gumbo_vector_add((void*) node, children);
+  gumbo_arena_set_current(previous_arena);
   assert(node->index_within_parent < children->length);
 }
 
@@ -170,7 +185,9 @@ void gumbo_insert_node(GumboNode* node, GumboNode* target_parent, int target_ind
     assert(index < children->length);
     node->parent = parent;
     node->index_within_parent = index;
+    GumboArena* previous_arena = adopt_node(parent, node);
     gumbo_vector_insert_at((void*) node, index, children);
+    gumbo_arena_set_current(previous_arena);
     assert(node->index_within_parent < children->length);
     for (unsigned int i = index + 1; i < children->length; ++i) {
       GumboNode* sibling = children->data[i];
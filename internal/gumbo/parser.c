@@ -20,6 +20,7 @@
 #include <string.h>
 #include <strings.h>
 
+#include "arena.h"
 #include "attribute.h"
 #include "error.h"
 #include "gumbo.h"
@@ -4506,6 +4507,8 @@ GumboOutput* gumbo_parse_fragment(
     const GumboTag fragment_ctx, const GumboNamespaceEnum fragment_namespace) {
   GumboParser parser;
   parser._options = options;
+  parser._arena = gumbo_arena_create(length);
+  GumboArena* previous_arena = gumbo_arena_set_current(parser._arena);
   parser_state_init(&parser);
   // Must come after parser_state_init, since creating the document node must
   // reference parser_state->_current_node.
@@ -4653,6 +4656,7 @@ GumboOutput* gumbo_parse_fragment(
 
   parser_state_destroy(&parser);
   gumbo_tokenizer_state_destroy(&parser);
+  gumbo_arena_set_current(previous_arena);
   return parser._output;
 }
 
@@ -4671,6 +4675,16 @@ const char* gumbo_status_to_string(GumboOutputStatus status) {
 
 
 void gumbo_destroy_output(GumboOutput* output) {
+  GumboArena* arena = gumbo_arena_of(output);
+  if (arena) {
+    // Only nodes added by editing the tree after the parse
+    // live outside the arena and need freeing one by one
+    if (gumbo_arena_has_heap_nodes(arena)) {
+      free_node(output->document);
+    }
+    gumbo_arena_destroy(arena);
+    return;
+  }
   free_node(output->document);
   for (unsigned int i = 0; i < output->errors.length; ++i) {
     gumbo_error_destroy(output->errors.data[i]);
@@ -48,6 +48,10 @@ typedef struct GumboInternalParser {
   // The internal parser state.  Initialized on parse start and destroyed on
   // parse end; end-users will never see a non-garbage value in this pointer.
   struct GumboInternalParserState* _parser_state;
+
+  // Everything allocated during the parse, the output included, comes from
+  // this arena; it is released by gumbo_destroy_output.
+  struct GumboInternalArena* _arena;
 } GumboParser;
 
 #ifdef __cplusplus
@@ -28,6 +28,7 @@
 #include <QtWidgets/QProgressDialog>
 
 #include "BookManipulation/Book.h"
+#include "BookManipulation/BookIndex.h"
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/FolderKeeper.h"
 #include "Misc/GumboInterface.h"
@@ -221,12 +222,14 @@ const QString HTML5_COVER_SOURCE =
 Book::Book()
     :
     m_Mainfolder(new FolderKeeper(this)),
+    m_Index(new BookIndex(m_Mainfolder)),
     m_IsModified(false)
 {
 }
 
 Book::~Book()
 {
+    delete m_Index;
     delete m_Mainfolder;
 }
 
@@ -243,7 +246,6 @@ const FolderKeeper *Book::GetFolderKeeper() const
 }
 
 
-
 OPFResource *Book::GetOPF()
 {
     return m_Mainfolder->GetOPF();
@@ -574,18 +576,18 @@ HTMLResource *Book::CreateSectionBreakOriginalResource(const QString &content, H
     QList<HTMLResource *> new_files;
     new_files.append(originating_resource);
     new_files.append(new_resource);
-    AnchorUpdates::UpdateAllAnchorsWithIDs(new_files);
+    AnchorUpdates::UpdateAllAnchorsWithIDs(new_files, m_Index);
     // Remove the original and new files from the list of html resources as we want to scan all
     // the other files for external references to the original file.
     html_resources.removeOne(originating_resource);
     html_resources.removeOne(new_resource);
     // Now, update references to the original file that are made in other files.
     // We can't assume that ids are unique in this case, and so need to use a different mechanism.
-    AnchorUpdates::UpdateExternalAnchors(html_resources, originating_bookpath, new_files);
+    AnchorUpdates::UpdateExternalAnchors(html_resources, originating_bookpath, new_files, m_Index);
     // Update TOC entries as well if an NCX exists:
     NCXResource * ncx_resource = GetNCX();
     if (ncx_resource) {
-        AnchorUpdates::UpdateTOCEntries(ncx_resource, originating_bookpath, new_files);
+        AnchorUpdates::UpdateTOCEntries(ncx_resource, originating_bookpath, new_files, m_Index);
     }
     SetModified(true);
     return new_resource;
@@ -672,14 +674,14 @@ void Book::CreateNewSections(const QStringList &new_sections, HTMLResource *orig
 
     // Update anchor references between fragment ids in the new files. Since these all came from one single
     // file it's safe to assume that the fragment ids are all unique (since otherwise the references would be broken).
-    AnchorUpdates::UpdateAllAnchorsWithIDs(new_files);
+    AnchorUpdates::UpdateAllAnchorsWithIDs(new_files, m_Index);
     // Now, update references to the original file that are made in other files.
     // We can't assume that ids are unique in this case, and so need to use a different mechanism.
-    AnchorUpdates::UpdateExternalAnchors(other_files, original_resource->GetRelativePath(), new_files);
+    AnchorUpdates::UpdateExternalAnchors(other_files, original_resource->GetRelativePath(), new_files, m_Index);
     // Update TOC entries as well if an NCX exists, they are optional on epub3
     NCXResource * ncx_resource = GetNCX();
     if (ncx_resource) {
-        AnchorUpdates::UpdateTOCEntries(ncx_resource, originating_bookpath, new_files);
+        AnchorUpdates::UpdateTOCEntries(ncx_resource, originating_bookpath, new_files, m_Index);
     }
     GetOPF()->UpdateSpineOrder(html_resources);
     SetModified(true);
@@ -748,8 +750,10 @@ QHash <QString, QList<XhtmlDoc::XMLElement>> Book::GetLinkElements()
 
 std::tuple<QString, QList<XhtmlDoc::XMLElement>> Book::GetLinkElementsInHTMLFileMapped(HTMLResource *html_resource)
 {
+    QReadLocker locker(&html_resource->GetLock());
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
     return std::make_tuple(html_resource->GetRelativePath(),
-                      XhtmlDoc::GetTagsInDocument(html_resource->GetText(), "a"));
+                           XhtmlDoc::GetTagsInDocument(*gi, GUMBO_TAG_A));
 }
 
 QStringList Book::GetStyleUrlsInHTMLFiles()
@@ -773,7 +777,9 @@ std::tuple<QString, QStringList> Book::GetStyleUrlsInHTMLFileMapped(HTMLResource
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
     // we need to convert this hreflist to bookpaths if possible
-    QStringList urllist = XhtmlDoc::GetAllDescendantStyleUrls(html_resource->GetText());
+    QReadLocker locker(&html_resource->GetLock());
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+    QStringList urllist = XhtmlDoc::GetAllDescendantStyleUrls(*gi);
     QStringList bookpaths;
     QRegularExpression url_file_search("url\\s*\\(\\s*['\"]?([^\\(\\)'\"]*)[\"']?\\)");
     foreach (QString url, urllist) {
@@ -790,30 +796,12 @@ std::tuple<QString, QStringList> Book::GetStyleUrlsInHTMLFileMapped(HTMLResource
 
 QHash<QString, QStringList> Book::GetIdsInHTMLFiles()
 {
-    QHash<QString, QStringList> ids_in_html;
-    const QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
-    QFuture<std::tuple<QString, QStringList>> future = QtConcurrent::mapped(html_resources, GetIdsInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString bookpath;
-        QStringList ids;
-        std::tie(bookpath, ids) = future.resultAt(i);
-        // Each target entry has a list of filenames that contain it
-        ids_in_html[bookpath] = ids;
-    }
-
-    return ids_in_html;
-}
-
-std::tuple<QString, QStringList> Book::GetIdsInHTMLFileMapped(HTMLResource *html_resource)
-{
-    return std::make_tuple(html_resource->GetRelativePath(),
-                           XhtmlDoc::GetAllDescendantIDs(html_resource->GetText()));
+    return m_Index->GetIdsInHTMLFiles();
 }
 
 QStringList Book::GetIdsInHTMLFile(HTMLResource *html_resource)
 {
-    return XhtmlDoc::GetAllDescendantIDs(html_resource->GetText());
+    return m_Index->GetIdsInHTMLFile(html_resource);
 }
 
 
@@ -843,45 +831,19 @@ QStringList Book::GetIdsInHrefs()
 
 QHash<QString, QStringList> Book::GetHrefsInHTMLFiles()
 {
-    QHash<QString, QStringList> hrefs_in_html;
-    const QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
-    QFuture<std::tuple<QString, QStringList>> future = QtConcurrent::mapped(html_resources, GetHrefsInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString bookpath;
-        QStringList hrefs;
-        std::tie(bookpath, hrefs) = future.resultAt(i);
-        // Each target entry has a list of filenames that contain it
-        hrefs_in_html[bookpath] = hrefs;
-    }
-
-    return hrefs_in_html;
-}
-
-std::tuple<QString, QStringList> Book::GetHrefsInHTMLFileMapped(HTMLResource *html_resource)
-{
-    return std::make_tuple(html_resource->GetRelativePath(),
-                           XhtmlDoc::GetAllDescendantHrefs(html_resource->GetText()));
+    return m_Index->GetHrefsInHTMLFiles();
 }
 
 QStringList Book::GetClassesInHTMLFile(HTMLResource *html_resource)
 {
-    return XhtmlDoc::GetAllDescendantClasses(html_resource->GetText());
+    QReadLocker locker(&html_resource->GetLock());
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+    return XhtmlDoc::GetAllDescendantClasses(*gi);
 }
 
 QHash<QString, QStringList> Book::GetImagesInHTMLFiles()
 {
-    QHash<QString, QStringList> images_in_html;
-    const QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
-    QFuture<std::tuple<QString, QStringList>> future = QtConcurrent::mapped(html_resources, GetImagesInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString bookpath;
-        QStringList image_files;
-        std::tie(bookpath, image_files) = future.resultAt(i);
-        images_in_html[bookpath] = image_files;
-    }
-    return images_in_html;
+    return m_Index->GetImagesInHTMLFiles();
 }
 
 QHash< QString, std::pair<int,int> > Book::GetSpellWordCountsInHTMLFiles()
@@ -941,77 +903,32 @@ QHash<QString, QStringList> Book::GetAudioInHTMLFiles()
 
 QHash<QString, QStringList> Book::GetHTMLFilesUsingMedia()
 {
-    QHash<QString, QStringList> html_files;
-    const QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
-
-    QFuture<std::tuple<QString, QStringList>> future = QtConcurrent::mapped(html_resources, GetMediaInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString html_bookpath;
-        QStringList media_bookpaths;
-        std::tie(html_bookpath, media_bookpaths) = future.resultAt(i);
-        foreach(QString media_bookpath, media_bookpaths) {
-            html_files[media_bookpath].append(html_bookpath);
-        }
-    }
-
-    return html_files;
+    return m_Index->GetHTMLFilesUsingMedia();
 }
 
 QHash<QString, QStringList> Book::GetHTMLFilesUsingImages()
 {
-    QHash<QString, QStringList> html_files;
-    const QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
-
-    QFuture<std::tuple<QString, QStringList>> future = QtConcurrent::mapped(html_resources, GetImagesInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString html_bookpath;
-        QStringList image_bookpaths;
-        std::tie(html_bookpath, image_bookpaths) = future.resultAt(i);
-        foreach(QString bookpath, image_bookpaths) {
+    QHash<QString, QStringList> html_files = m_Index->GetHTMLFilesUsingImages();
+    // callers want the short path names of the html files
+    QHash<QString, QStringList>::iterator it;
+    for (it = html_files.begin(); it != html_files.end(); ++it) {
+        QStringList shortnames;
+        foreach(QString html_bookpath, it.value()) {
             Resource * resource = m_Mainfolder->GetResourceByBookPath(html_bookpath);
-            html_files[bookpath].append(resource->ShortPathName());
+            shortnames.append(resource->ShortPathName());
         }
+        it.value() = shortnames;
     }
-
     return html_files;
 }
 
-std::tuple<QString, QStringList> Book::GetMediaInHTMLFileMapped(HTMLResource *html_resource)
-{
-    QString html_bookpath = html_resource->GetRelativePath();
-    QString startdir = html_resource->GetFolder();
-    QStringList media_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), 
-                                                                       GIMAGE_TAGS + GVIDEO_TAGS + GAUDIO_TAGS);
-    QStringList media_bookpaths;
-    foreach(QString ahref, media_hrefs) {
-        if (ahref.indexOf(":") == -1) {
-            media_bookpaths << Utility::buildBookPath(ahref, startdir);
-	}
-    }
-    return std::make_tuple(html_bookpath, media_bookpaths);
-}
-
-std::tuple<QString, QStringList> Book::GetImagesInHTMLFileMapped(HTMLResource *html_resource)
-{
-    QString html_bookpath = html_resource->GetRelativePath();
-    QString startdir = html_resource->GetFolder();
-    QStringList image_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), GIMAGE_TAGS);
-    QStringList image_bookpaths;
-    foreach(QString ahref, image_hrefs) {
-        if (ahref.indexOf(":") == -1) {
-	    image_bookpaths << Utility::buildBookPath(ahref, startdir);
-        }
-    }
-    return std::make_tuple(html_bookpath, image_bookpaths);
-}
-
 std::tuple<QString, QStringList> Book::GetVideoInHTMLFileMapped(HTMLResource *html_resource)
 {
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
-    QStringList video_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), GVIDEO_TAGS);
+    QReadLocker locker(&html_resource->GetLock());
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+    QStringList video_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*gi, GVIDEO_TAGS);
     QStringList video_bookpaths;
     foreach(QString ahref, video_hrefs) {
         if (ahref.indexOf(":") == -1) {
@@ -1025,7 +942,9 @@ std::tuple<QString, QStringList> Book::GetAudioInHTMLFileMapped(HTMLResource *ht
 {
     QString html_bookpath = html_resource->GetRelativePath();
     QString startdir = html_resource->GetFolder();
-    QStringList audio_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(html_resource->GetText(), GAUDIO_TAGS);
+    QReadLocker locker(&html_resource->GetLock());
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+    QStringList audio_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*gi, GAUDIO_TAGS);
     QStringList audio_bookpaths;
     foreach(QString ahref, audio_hrefs) {
         if (ahref.indexOf(":") == -1) {
@@ -1109,38 +1028,15 @@ QHash<QString, int> Book::GetUniqueWordsInHTMLFiles()
 
 QHash<QString, QStringList> Book::GetStylesheetsInHTMLFiles()
 {
-    QHash<QString, QStringList> links_in_html;
-    const QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
-    QFuture<std::tuple<QString, QStringList>> future = QtConcurrent::mapped(html_resources, GetStylesheetsInHTMLFileMapped);
-
-    for (int i = 0; i < future.results().count(); i++) {
-        QString bookpath;
-        QStringList links;
-        std::tie(bookpath, links) = future.resultAt(i);
-        links_in_html[bookpath] = links;
-    }
-    return links_in_html;
-}
-
-std::tuple<QString, QStringList> Book::GetStylesheetsInHTMLFileMapped(HTMLResource *html_resource)
-{
-    QString html_bookpath = html_resource->GetRelativePath();
-    QString startdir = html_resource->GetFolder();
-    QStringList link_hrefs = XhtmlDoc::GetLinkedStylesheets(html_resource->GetText());
-    QStringList link_bookpaths;
-    foreach(QString ahref, link_hrefs) {
-        if (ahref.indexOf(":") == -1) {
-            std::pair<QString, QString> parts = Utility::parseRelativeHREF(ahref);
-            link_bookpaths << Utility::buildBookPath(parts.first, startdir);
-        }
-    }
-    return std::make_tuple(html_bookpath, link_bookpaths);
+    return m_Index->GetStylesheetsInHTMLFiles();
 }
 
 QStringList Book::GetStylesheetsInHTMLFile(HTMLResource *html_resource)
 {
     // convert encoded links relative to a html resource to their book paths
-    QStringList stylelinks = XhtmlDoc::GetLinkedStylesheets(html_resource->GetText());
+    QReadLocker locker(&html_resource->GetLock());
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+    QStringList stylelinks = XhtmlDoc::GetLinkedStylesheets(*gi);
     QStringList results;
     QString html_folder = html_resource->GetFolder();
     foreach(QString stylelink, stylelinks) {
@@ -1220,7 +1116,7 @@ Resource *Book::MergeResources(QList<Resource *> resources)
     // It is the user's responsibility to ensure that all ids used across the two merged files are unique.
     // Reconcile all references to the files that were merged.
     QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(true);
-    AnchorUpdates::UpdateAllAnchors(html_resources, merged_bookpaths, sink_html_resource);
+    AnchorUpdates::UpdateAllAnchors(html_resources, merged_bookpaths, sink_html_resource, m_Index);
     NCXResource * ncx_resource = GetNCX();
     if (ncx_resource) {
         AnchorUpdates::UpdateTOCEntriesAfterMerge(ncx_resource, 
@@ -1289,14 +1185,14 @@ std::tuple<bool, QString, QString> Book::HasUndefinedURLFragments()
     bool hasUndefinedUrlFrags = false;
     Q_UNUSED(hasUndefinedUrlFrags);
     
-    QStringList html_bookpaths;
+    QSet<QString> html_bookpaths;
     foreach(HTMLResource *html_resource, html_resources) {
-        html_bookpaths.append(html_resource->GetRelativePath());
+        html_bookpaths.insert(html_resource->GetRelativePath());
     }
 
     // The key to both here is now a bookpath
-    QHash<QString, QStringList> links = GetRelLinksInAllFiles(html_resources);
-    QHash<QString, QStringList> all_ids = GetIDsInAllFiles(html_resources);
+    QHash<QString, QStringList> links = m_Index->GetRelLinksInHTMLFiles();
+    QHash<QString, QStringList> all_ids = m_Index->GetIdAttributesInHTMLFiles();
 
     foreach(HTMLResource *html_resource, html_resources) {
         QString bookpath = html_resource->GetRelativePath();
@@ -1325,30 +1221,6 @@ std::tuple<bool, QString, QString> Book::HasUndefinedURLFragments()
     return std::make_tuple(false, QString(), QString());
 }
 
-QHash<QString, QStringList> Book::GetRelLinksInAllFiles(const QList<HTMLResource *> &html_resources)
-{
-    const QList<QPair<QString, QStringList>> &links_in_files = QtConcurrent::blockingMapped(html_resources, GetRelLinksInOneFile);
-    QHash<QString, QStringList> links_in_files_map;
-    for (int i = 0; i < links_in_files.count(); ++i) {
-        QPair<QString, QStringList> entry = links_in_files.at(i);
-        links_in_files_map.insert(entry.first, entry.second);
-    }
-    return links_in_files_map;
-}
-
-
-QHash<QString, QStringList> Book::GetIDsInAllFiles(const QList<HTMLResource *> &html_resources)
-{
-    const QList<QPair<QString, QStringList>> &IDs_in_files = QtConcurrent::blockingMapped(html_resources, GetOneFileIDs);
-    QHash<QString, QStringList> ID_map;
-
-    for (int i = 0; i < IDs_in_files.count(); ++i) {
-        QPair<QString, QStringList> entry = IDs_in_files.at(i);
-        ID_map.insert(entry.first, entry.second);
-    }
-    return ID_map;
-}
-
 void Book::SaveOneResourceToDisk(Resource *resource)
 {
     resource->SaveToDisk(true);
@@ -1394,42 +1266,3 @@ Book::NewSectionResult Book::CreateOneNewSection(NewSection section_info,
     return section;
 }
 
-// Links hrefs are raw (untouched) 
-QPair<QString, QStringList> Book::GetRelLinksInOneFile(HTMLResource *html_resource)
-{
-    Q_ASSERT(html_resource);
-    QReadLocker locker(&html_resource->GetLock());
-    QString htmldir = html_resource->GetFolder();
-    GumboInterface gi = GumboInterface(html_resource->GetText(), html_resource->GetEpubVersion());
-    gi.parse();
-    QPair<QString, QStringList> link_pair;
-    QStringList hreflist;
-    const QList<GumboNode*> anchor_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_A);
-    for (int i = 0; i < anchor_nodes.length(); ++i) {
-        GumboNode* node = anchor_nodes.at(i);
-        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "href");
-        // We find the hrefs that are relative and contain an href.
-        if (attr && QUrl(QString::fromUtf8(attr->value)).isRelative()) {
-            hreflist.append(QString::fromStdString(attr->value));
-        }
-    }
-    link_pair.first = html_resource->GetRelativePath();
-    link_pair.second = hreflist;
-    return link_pair;
-}
-
-
-QPair<QString, QStringList> Book::GetOneFileIDs(HTMLResource *html_resource)
-{
-    Q_ASSERT(html_resource);
-    QReadLocker locker(&html_resource->GetLock());
-    QString newsource = html_resource->GetText();
-    QString version = html_resource->GetEpubVersion();
-    GumboInterface gi = GumboInterface(newsource, version);
-    gi.parse();
-    QPair<QString, QStringList> id_pair;
-    QStringList ids = gi.get_all_values_for_attribute(QString("id"));
-    id_pair.first = html_resource->GetRelativePath();
-    id_pair.second = ids;
-    return id_pair;
-}
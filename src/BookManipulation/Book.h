@@ -31,6 +31,7 @@
 #include "BookManipulation/XhtmlDoc.h"
 #include "ResourceObjects/Resource.h"
 
+class BookIndex;
 class CSSResource;
 class SVGResource;
 class FolderKeeper;
@@ -214,12 +215,10 @@ public:
     QStringList GetStyleUrlsInHTMLFiles();
     static std::tuple<QString, QStringList> GetStyleUrlsInHTMLFileMapped(HTMLResource *html_resource);
     QHash<QString, QStringList> GetIdsInHTMLFiles();
-    static std::tuple<QString, QStringList> GetIdsInHTMLFileMapped(HTMLResource *html_resource);
     QStringList GetIdsInHTMLFile(HTMLResource *html_resource);
 
     QStringList GetIdsInHrefs();
     QHash<QString, QStringList> GetHrefsInHTMLFiles();
-    static std::tuple<QString, QStringList> GetHrefsInHTMLFileMapped(HTMLResource *html_resource);
 
     QStringList GetClassesInHTMLFile(HTMLResource* html_resource);
 
@@ -229,7 +228,6 @@ public:
     QHash<QString, int> GetUniqueWordsInHTMLFiles();
 
     QHash<QString, QStringList> GetStylesheetsInHTMLFiles();
-    static std::tuple<QString, QStringList> GetStylesheetsInHTMLFileMapped(HTMLResource *html_resource);
     QStringList GetStylesheetsInHTMLFile(HTMLResource *html_resource);
 
     QHash<QString, QStringList> GetImagesInHTMLFiles();
@@ -239,8 +237,6 @@ public:
     QHash<QString, QStringList> GetHTMLFilesUsingMedia();
     QHash<QString, QStringList> GetHTMLFilesUsingImages();
 
-    static std::tuple<QString, QStringList> GetMediaInHTMLFileMapped(HTMLResource *html_resource);
-    static std::tuple<QString, QStringList> GetImagesInHTMLFileMapped(HTMLResource *html_resource);
     static std::tuple<QString, QStringList> GetVideoInHTMLFileMapped(HTMLResource *html_resource);
     static std::tuple<QString, QStringList> GetAudioInHTMLFileMapped(HTMLResource *html_resource);
     static std::tuple<QString, std::pair<int,int> > GetWordCountsInHTMLFileMapped(HTMLResource *html_resource);
@@ -309,18 +305,6 @@ public:
      */
     std::tuple<bool, QString, QString> HasUndefinedURLFragments();
 
-    /**
-     * Get all href values in all relative links from supplied HTMLResources
-     * using QtConcurrent. Return hash of hrefs keyed on filename.
-     */
-    static QHash<QString, QStringList> GetRelLinksInAllFiles(const QList<HTMLResource *> &html_resources);
-
-    /**
-     * Get all id values from supplied HTMLResources using QtConcurrent.
-     * Return hash of ids keyed on filename.
-     */
-    static QHash<QString, QStringList> GetIDsInAllFiles(const QList<HTMLResource *> &html_resources);
-
 public slots:
 
     /**
@@ -410,17 +394,6 @@ private:
     NewSectionResult CreateOneNewSection(NewSection section_info,
                                          const QHash<QString, QString> &html_updates);
 
-    /**
-     * Get all href values in all relative links from one HTMLResource
-     * Return QPair(filename, hrefs).
-     */
-    static QPair<QString, QStringList> GetRelLinksInOneFile(HTMLResource *html_resource);
-
-    /**
-     * Get all id values from one HTMLResource. Return QPair(filename, ids).
-     */
-    static QPair<QString, QStringList> GetOneFileIDs(HTMLResource *html_resource);
-
 
     ////////////////////////////
     // PRIVATE MEMBER VARIABLES
@@ -432,6 +405,12 @@ private:
      */
     FolderKeeper *m_Mainfolder;
 
+    /**
+     * The incrementally updated index of ids, links and
+     * resource references in the html files.
+     */
+    BookIndex *m_Index;
+
     /**
      * Stores the modified state of the book.
      */
@@ -0,0 +1,322 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#include <algorithm>
+#include <memory>
+
+#include <QtCore/QtCore>
+#include <QtCore/QUrl>
+#include <QtConcurrent/QtConcurrent>
+
+#include "BookManipulation/BookIndex.h"
+#include "BookManipulation/FolderKeeper.h"
+#include "BookManipulation/XhtmlDoc.h"
+#include "Misc/GumboInterface.h"
+#include "Misc/Utility.h"
+#include "ResourceObjects/HTMLResource.h"
+
+BookIndex::BookIndex(FolderKeeper *folder_keeper)
+    :
+    m_Mainfolder(folder_keeper)
+{
+}
+
+
+QHash<QString, QStringList> BookIndex::GetIdsInHTMLFiles()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = GetHTMLResources();
+    RefreshInternal(html_resources, true);
+    QHash<QString, QStringList> ids_in_html;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        ids_in_html[entry.bookpath] = entry.all_ids;
+    }
+    return ids_in_html;
+}
+
+
+QStringList BookIndex::GetIdsInHTMLFile(HTMLResource *html_resource)
+{
+    QMutexLocker locker(&m_AccessMutex);
+    RefreshInternal(QList<HTMLResource *>() << html_resource, false);
+    return m_Entries.value(html_resource->GetIdentifier()).all_ids;
+}
+
+
+QHash<QString, QStringList> BookIndex::GetIdAttributesInHTMLFiles()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = GetHTMLResources();
+    RefreshInternal(html_resources, true);
+    QHash<QString, QStringList> ids_in_html;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        ids_in_html[entry.bookpath] = entry.ids;
+    }
+    return ids_in_html;
+}
+
+
+QHash<QString, QStringList> BookIndex::GetHrefsInHTMLFiles()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = GetHTMLResources();
+    RefreshInternal(html_resources, true);
+    QHash<QString, QStringList> hrefs_in_html;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        hrefs_in_html[entry.bookpath] = entry.hrefs;
+    }
+    return hrefs_in_html;
+}
+
+
+QHash<QString, QStringList> BookIndex::GetRelLinksInHTMLFiles()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = GetHTMLResources();
+    RefreshInternal(html_resources, true);
+    QHash<QString, QStringList> links_in_html;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        links_in_html[entry.bookpath] = entry.rel_links;
+    }
+    return links_in_html;
+}
+
+
+QHash<QString, QStringList> BookIndex::GetImagesInHTMLFiles()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = GetHTMLResources();
+    RefreshInternal(html_resources, true);
+    QHash<QString, QStringList> images_in_html;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        images_in_html[entry.bookpath] = entry.image_bookpaths;
+    }
+    return images_in_html;
+}
+
+
+QHash<QString, QStringList> BookIndex::GetStylesheetsInHTMLFiles()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = GetHTMLResources();
+    RefreshInternal(html_resources, true);
+    QHash<QString, QStringList> links_in_html;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        links_in_html[entry.bookpath] = entry.stylesheet_bookpaths;
+    }
+    return links_in_html;
+}
+
+
+QHash<QString, QStringList> BookIndex::GetHTMLFilesUsingMedia()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(true);
+    RefreshInternal(html_resources, true);
+    return InResourceOrder(m_MediaToFiles, html_resources);
+}
+
+
+QHash<QString, QStringList> BookIndex::GetHTMLFilesUsingImages()
+{
+    QMutexLocker locker(&m_AccessMutex);
+    QList<HTMLResource *> html_resources = m_Mainfolder->GetResourceTypeList<HTMLResource>(true);
+    RefreshInternal(html_resources, true);
+    return InResourceOrder(m_ImagesToFiles, html_resources);
+}
+
+
+QHash<QString, QString> BookIndex::GetIDLocations(const QList<HTMLResource *> &html_resources)
+{
+    QMutexLocker locker(&m_AccessMutex);
+    RefreshInternal(html_resources, false);
+    QHash<QString, QString> ID_locations;
+    foreach(HTMLResource * html_resource, html_resources) {
+        const FileEntry &entry = m_Entries[html_resource->GetIdentifier()];
+        foreach(QString id, entry.ids) {
+            ID_locations[id] = entry.bookpath;
+        }
+    }
+    return ID_locations;
+}
+
+
+// Must be called with m_AccessMutex held
+void BookIndex::RefreshInternal(const QList<HTMLResource *> &html_resources, bool drop_missing)
+{
+    QList<HTMLResource *> stale_resources;
+    QSet<QString> current_identifiers;
+    foreach(HTMLResource * html_resource, html_resources) {
+        QString identifier = html_resource->GetIdentifier();
+        current_identifiers.insert(identifier);
+        QHash<QString, FileEntry>::const_iterator it = m_Entries.constFind(identifier);
+        // a change of bookpath changes how relative links resolve so reindex those as well
+        if ((it == m_Entries.constEnd()) ||
+            (it->revision != html_resource->GetTextRevision()) ||
+            (it->bookpath != html_resource->GetRelativePath())) {
+            stale_resources.append(html_resource);
+        }
+    }
+
+    if (drop_missing) {
+        foreach(QString identifier, m_Entries.keys()) {
+            if (!current_identifiers.contains(identifier)) {
+                RemoveFromReverseMaps(m_Entries.value(identifier));
+                m_Entries.remove(identifier);
+            }
+        }
+    }
+
+    if (stale_resources.isEmpty()) {
+        return;
+    }
+
+    const QList<std::pair<QString, FileEntry>> &new_entries = QtConcurrent::blockingMapped(stale_resources, IndexOneFile);
+    for (int i = 0; i < new_entries.count(); ++i) {
+        const std::pair<QString, FileEntry> &new_entry = new_entries.at(i);
+        QHash<QString, FileEntry>::const_iterator it = m_Entries.constFind(new_entry.first);
+        if (it != m_Entries.constEnd()) {
+            RemoveFromReverseMaps(it.value());
+        }
+        m_Entries.insert(new_entry.first, new_entry.second);
+        AddToReverseMaps(new_entry.second);
+    }
+}
+
+
+// Must be called with m_AccessMutex held
+void BookIndex::AddToReverseMaps(const FileEntry &entry)
+{
+    AddToReverseMap(m_MediaToFiles, entry.media_bookpaths, entry.bookpath);
+    AddToReverseMap(m_ImagesToFiles, entry.image_bookpaths, entry.bookpath);
+}
+
+
+// Must be called with m_AccessMutex held
+void BookIndex::RemoveFromReverseMaps(const FileEntry &entry)
+{
+    RemoveFromReverseMap(m_MediaToFiles, entry.media_bookpaths, entry.bookpath);
+    RemoveFromReverseMap(m_ImagesToFiles, entry.image_bookpaths, entry.bookpath);
+}
+
+
+void BookIndex::AddToReverseMap(QHash<QString, QStringList> &reverse_map, const QStringList &keys, const QString &bookpath)
+{
+    foreach(QString key, keys) {
+        reverse_map[key].append(bookpath);
+    }
+}
+
+
+void BookIndex::RemoveFromReverseMap(QHash<QString, QStringList> &reverse_map, const QStringList &keys, const QString &bookpath)
+{
+    foreach(QString key, keys) {
+        QHash<QString, QStringList>::iterator it = reverse_map.find(key);
+        if (it == reverse_map.end()) {
+            continue;
+        }
+        it.value().removeOne(bookpath);
+        // drop emptied keys so the maps only hold what is still referenced
+        if (it.value().isEmpty()) {
+            reverse_map.erase(it);
+        }
+    }
+}
+
+
+std::pair<QString, BookIndex::FileEntry> BookIndex::IndexOneFile(HTMLResource *html_resource)
+{
+    Q_ASSERT(html_resource);
+    QReadLocker locker(&html_resource->GetLock());
+    FileEntry entry;
+    // grab the revision before the text so that a concurrent change leaves the entry stale
+    entry.revision = html_resource->GetTextRevision();
+    entry.bookpath = html_resource->GetRelativePath();
+    QString startdir = html_resource->GetFolder();
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+
+    entry.ids = gi->get_all_values_for_attribute(QString("id"));
+    entry.all_ids = XhtmlDoc::GetAllDescendantIDs(*gi);
+    entry.hrefs = XhtmlDoc::GetAllDescendantHrefs(*gi);
+
+    const QList<GumboNode*> anchor_nodes = gi->get_all_nodes_with_tag(GUMBO_TAG_A);
+    foreach(GumboNode * node, anchor_nodes) {
+        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "href");
+        if (attr && QUrl(QString::fromUtf8(attr->value)).isRelative()) {
+            entry.rel_links.append(QString::fromUtf8(attr->value));
+        }
+    }
+
+    QStringList image_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*gi, GIMAGE_TAGS);
+    foreach(QString ahref, image_hrefs) {
+        if (ahref.indexOf(":") == -1) {
+            entry.image_bookpaths << Utility::buildBookPath(ahref, startdir);
+        }
+    }
+
+    QStringList media_hrefs = XhtmlDoc::GetAllMediaPathsFromMediaChildren(*gi, GIMAGE_TAGS + GVIDEO_TAGS + GAUDIO_TAGS);
+    foreach(QString ahref, media_hrefs) {
+        if (ahref.indexOf(":") == -1) {
+            entry.media_bookpaths << Utility::buildBookPath(ahref, startdir);
+        }
+    }
+
+    QStringList link_hrefs = XhtmlDoc::GetLinkedStylesheets(*gi);
+    foreach(QString ahref, link_hrefs) {
+        if (ahref.indexOf(":") == -1) {
+            std::pair<QString, QString> parts = Utility::parseRelativeHREF(ahref);
+            entry.stylesheet_bookpaths << Utility::buildBookPath(parts.first, startdir);
+        }
+    }
+
+    return std::make_pair(html_resource->GetIdentifier(), entry);
+}
+
+
+QHash<QString, QStringList> BookIndex::InResourceOrder(const QHash<QString, QStringList> &reverse_map,
+                                                       const QList<HTMLResource *> &html_resources)
+{
+    // reindexed files are appended to the reverse lists so put them back in order
+    QHash<QString, int> positions;
+    for (int i = 0; i < html_resources.count(); ++i) {
+        positions.insert(html_resources.at(i)->GetRelativePath(), i);
+    }
+    QHash<QString, QStringList> ordered = reverse_map;
+    QHash<QString, QStringList>::iterator it;
+    for (it = ordered.begin(); it != ordered.end(); ++it) {
+        std::stable_sort(it.value().begin(), it.value().end(), [&positions](const QString &a, const QString &b) {
+            return positions.value(a) < positions.value(b);
+        });
+    }
+    return ordered;
+}
+
+
+QList<HTMLResource *> BookIndex::GetHTMLResources() const
+{
+    return m_Mainfolder->GetResourceTypeList<HTMLResource>(false);
+}
@@ -0,0 +1,155 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+#pragma once
+#ifndef BOOKINDEX_H
+#define BOOKINDEX_H
+
+#include <utility>
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
+class FolderKeeper;
+class HTMLResource;
+
+/**
+ * Keeps a per-book index of the ids, links, media references and
+ * stylesheet links found in every html file of the book.
+ *
+ * Each file is indexed against the text revision of its HTMLResource
+ * and its book path. Every query first compares the revision and book path
+ * of each html file with its entry and reparses only the files that changed,
+ * so link checks and anchor fixups no longer reparse the whole book.
+ * That comparison still visits every html file, and reindexing runs while
+ * the index is locked, so a query waits for any reindex already running.
+ * The reverse maps from media to the html files using them are updated
+ * as each file is reindexed.
+ *
+ * All public members are thread safe.
+ */
+class BookIndex
+{
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param folder_keeper The FolderKeeper holding the book's resources.
+     */
+    BookIndex(FolderKeeper *folder_keeper);
+
+    // all ids (including legacy <a name="">) in each file keyed on bookpath
+    QHash<QString, QStringList> GetIdsInHTMLFiles();
+
+    // all ids (including legacy <a name="">) in one file
+    QStringList GetIdsInHTMLFile(HTMLResource *html_resource);
+
+    // only the id attribute values in each file keyed on bookpath
+    QHash<QString, QStringList> GetIdAttributesInHTMLFiles();
+
+    // all raw href attribute values in each file keyed on bookpath
+    QHash<QString, QStringList> GetHrefsInHTMLFiles();
+
+    // all raw relative anchor hrefs in each file keyed on bookpath
+    QHash<QString, QStringList> GetRelLinksInHTMLFiles();
+
+    // bookpaths of the images used in each file keyed on bookpath
+    QHash<QString, QStringList> GetImagesInHTMLFiles();
+
+    // bookpaths of the stylesheets linked from each file keyed on bookpath
+    QHash<QString, QStringList> GetStylesheetsInHTMLFiles();
+
+    // html bookpaths, in reading order, using each image/video/audio bookpath
+    QHash<QString, QStringList> GetHTMLFilesUsingMedia();
+
+    // html bookpaths, in reading order, using each image bookpath
+    QHash<QString, QStringList> GetHTMLFilesUsingImages();
+
+    /**
+     * Maps each id attribute value found in the given files to the
+     * bookpath of the file that defines it (the last one wins when
+     * an id is duplicated, as before).
+     */
+    QHash<QString, QString> GetIDLocations(const QList<HTMLResource *> &html_resources);
+
+private:
+
+    struct FileEntry {
+        int revision;
+        QString bookpath;
+
+        // id attribute values only
+        QStringList ids;
+
+        // id attributes plus the legacy <a name=""> values
+        QStringList all_ids;
+
+        QStringList hrefs;
+        QStringList rel_links;
+        QStringList image_bookpaths;
+        QStringList media_bookpaths;
+        QStringList stylesheet_bookpaths;
+
+        FileEntry() : revision(-1) {}
+    };
+
+    /**
+     * Builds the entry for one file from its shared parsed document.
+     * Safe to run on a worker thread.
+     */
+    static std::pair<QString, FileEntry> IndexOneFile(HTMLResource *html_resource);
+
+    void RefreshInternal(const QList<HTMLResource *> &html_resources, bool drop_missing);
+
+    void AddToReverseMaps(const FileEntry &entry);
+
+    void RemoveFromReverseMaps(const FileEntry &entry);
+
+    static void AddToReverseMap(QHash<QString, QStringList> &reverse_map, const QStringList &keys, const QString &bookpath);
+
+    static void RemoveFromReverseMap(QHash<QString, QStringList> &reverse_map, const QStringList &keys, const QString &bookpath);
+
+    /**
+     * Returns a copy of the reverse map with each list of html
+     * bookpaths sorted into the order of the given resources.
+     */
+    static QHash<QString, QStringList> InResourceOrder(const QHash<QString, QStringList> &reverse_map,
+                                                       const QList<HTMLResource *> &html_resources);
+
+    QList<HTMLResource *> GetHTMLResources() const;
+
+    FolderKeeper *m_Mainfolder;
+
+    // FileEntry keyed on resource identifier
+    QHash<QString, FileEntry> m_Entries;
+
+    // html bookpaths keyed on the media and image bookpaths they
+    // reference, one bookpath per reference as the reports count them
+    QHash<QString, QStringList> m_MediaToFiles;
+    QHash<QString, QStringList> m_ImagesToFiles;
+
+    mutable QMutex m_AccessMutex;
+};
+
+#endif // BOOKINDEX_H
@@ -48,12 +48,12 @@ QList<BookReports::StyleData *> BookReports::GetHTMLClassUsage(QSharedPointer<Bo
     QList<HTMLResource *> html_resources = book->GetFolderKeeper()->GetResourceTypeList<HTMLResource>(false);
     QList<CSSResource *> css_resources = book->GetFolderKeeper()->GetResourceTypeList<CSSResource>(false);
 
-    // Save each CSS file's text so we don't have to reload it when checking each HTML file
-    QHash<QString, QString> css_text;
+    // Parse each CSS file once up front so that checking the HTML files only queries the parses
+    QHash<QString, std::shared_ptr<CSSInfo>> css_infos;
     foreach(CSSResource * css_resource, css_resources) {
         QString css_filename = css_resource->GetRelativePath();
-        if (!css_text.contains(css_filename)) {
-            css_text[css_filename] = css_resource->GetText();
+        if (!css_infos.contains(css_filename)) {
+            css_infos[css_filename] = css_resource->GetCSSInfo();
         }
     }
 
@@ -62,7 +62,7 @@ QList<BookReports::StyleData *> BookReports::GetHTMLClassUsage(QSharedPointer<Bo
     QFuture< QList<BookReports::StyleData*> > usage_future;
     usage_future = QtConcurrent::mapped(html_resources, 
 					std::bind(ClassesUsedInHTMLFileMapped, 
-						  std::placeholders::_1, css_text));
+						  std::placeholders::_1, css_infos));
 
     for (int i = 0; i < usage_future.results().count(); i++) {
         html_classes_usage.append(usage_future.resultAt(i));
@@ -72,27 +72,18 @@ QList<BookReports::StyleData *> BookReports::GetHTMLClassUsage(QSharedPointer<Bo
 }
 
 
-QList<BookReports::StyleData *> BookReports::ClassesUsedInHTMLFileMapped(HTMLResource* html_resource, const QHash<QString, QString> &css_text)
+QList<BookReports::StyleData *> BookReports::ClassesUsedInHTMLFileMapped(HTMLResource* html_resource, const QHash<QString, std::shared_ptr<CSSInfo>> &css_infos)
 {
     QList<BookReports::StyleData *> html_classes_usage;
 
     // Get the unique list of classes in this file
     // list of element_name.class_name
-    QStringList classes_in_file = XhtmlDoc::GetAllDescendantClasses(html_resource->GetText());
+    QStringList classes_in_file = XhtmlDoc::GetAllDescendantClasses(*html_resource->GetParsedDocument());
     classes_in_file.removeDuplicates();
 
     // Get the linked stylesheets for this file
     // returned as list of bookpaths to the stylesheets
-    QStringList linked_stylesheets;
-    QStringList stylelinks = XhtmlDoc::GetLinkedStylesheets(html_resource->GetText());
-    QString html_folder = html_resource->GetFolder();
-    // convert links relative to a html resource to their book paths
-    foreach(QString stylelink, stylelinks) {
-        if (stylelink.indexOf(":") == -1) {
-            std::pair<QString, QString> parts = Utility::parseRelativeHREF(stylelink);
-	    linked_stylesheets.append(Utility::buildBookPath(parts.first, html_folder));
-        }
-    }
+    QStringList linked_stylesheets = html_resource->GetLinkedStylesheets();
 
     // Look at each class from the HTML file
     foreach(QString class_name, classes_in_file) {
@@ -108,9 +99,8 @@ QList<BookReports::StyleData *> BookReports::ClassesUsedInHTMLFileMapped(HTMLRes
 	// Look in each stylesheet
 	// css_filename here is a bookpath as used above
         foreach(QString css_filename, linked_stylesheets) {
-            if (css_text.contains(css_filename)) {
-                CSSInfo css_info(css_text[css_filename], true);
-		CSSInfo::CSSSelector *selector = css_info.getCSSSelectorForElementClass(element_part, class_part);
+            if (css_infos.contains(css_filename)) {
+		CSSInfo::CSSSelector *selector = css_infos[css_filename]->getCSSSelectorForElementClass(element_part, class_part);
                 // If class matched a selector in a linked stylesheet, we're done
                 if (selector && (selector->classNames.count() > 0)) {
 		    // css_filename is a book path
@@ -135,13 +125,13 @@ QList<BookReports::StyleData *> BookReports::GetAllHTMLClassUsage(QSharedPointer
     QList<HTMLResource *> html_resources = book->GetFolderKeeper()->GetResourceTypeList<HTMLResource>(false);
     QList<CSSResource *> css_resources = book->GetFolderKeeper()->GetResourceTypeList<CSSResource>(false);
 
-    // Save each CSS file's text so we don't have to reload it when checking each HTML file
-    QHash<QString, QString> css_text;
+    // Parse each CSS file once up front so that checking the HTML files only queries the parses
+    QHash<QString, std::shared_ptr<CSSInfo>> css_infos;
     foreach(CSSResource * css_resource, css_resources) {
         QString css_filename = css_resource->GetRelativePath();
 
-        if (!css_text.contains(css_filename)) {
-            css_text[css_filename] = css_resource->GetText();
+        if (!css_infos.contains(css_filename)) {
+            css_infos[css_filename] = css_resource->GetCSSInfo();
         }
     }
 
@@ -150,7 +140,7 @@ QList<BookReports::StyleData *> BookReports::GetAllHTMLClassUsage(QSharedPointer
     QFuture< QList<BookReports::StyleData*> > usage_future;
     usage_future = QtConcurrent::mapped(html_resources, 
 					std::bind(AllClassesUsedInHTMLFileMapped, 
-						  std::placeholders::_1, css_text));
+						  std::placeholders::_1, css_infos));
 
     for (int i = 0; i < usage_future.results().count(); i++) {
         html_classes_usage.append(usage_future.resultAt(i));
@@ -160,27 +150,18 @@ QList<BookReports::StyleData *> BookReports::GetAllHTMLClassUsage(QSharedPointer
 }
 
 
-QList<BookReports::StyleData *> BookReports::AllClassesUsedInHTMLFileMapped(HTMLResource* html_resource, const QHash<QString, QString> &css_text)
+QList<BookReports::StyleData *> BookReports::AllClassesUsedInHTMLFileMapped(HTMLResource* html_resource, const QHash<QString, std::shared_ptr<CSSInfo>> &css_infos)
 {
     QList<BookReports::StyleData *> html_classes_usage;
 
     // Get the unique list of classes in this file
     // list of element_name.class_name
-    QStringList classes_in_file = XhtmlDoc::GetAllDescendantClasses(html_resource->GetText());
+    QStringList classes_in_file = XhtmlDoc::GetAllDescendantClasses(*html_resource->GetParsedDocument());
     classes_in_file.removeDuplicates();
 
     // Get the linked stylesheets for this file
     // returned as list of bookpaths to the stylesheets
-    QStringList linked_stylesheets;
-    QStringList stylelinks = XhtmlDoc::GetLinkedStylesheets(html_resource->GetText());
-    QString html_folder = html_resource->GetFolder();
-    // convert links relative to a html resource to their book paths
-    foreach(QString stylelink, stylelinks) {
-        if (stylelink.indexOf(":") == -1) {
-            std::pair<QString, QString> parts = Utility::parseRelativeHREF(stylelink);
-            linked_stylesheets.append(Utility::buildBookPath(parts.first, html_folder));
-        }
-    }
+    QStringList linked_stylesheets = html_resource->GetLinkedStylesheets();
 
     // Look at each class from the HTML file
     foreach(QString class_name, classes_in_file) {
@@ -191,9 +172,8 @@ QList<BookReports::StyleData *> BookReports::AllClassesUsedInHTMLFileMapped(HTML
         // Look in each stylesheet
 	// css_filename here is a bookpath as used above
         foreach(QString css_filename, linked_stylesheets) {
-            if (css_text.contains(css_filename)) {
-                CSSInfo css_info(css_text[css_filename], true);
-                QList<CSSInfo::CSSSelector *> selectors = css_info.getAllCSSSelectorsForElementClass(element_part, class_part);
+            if (css_infos.contains(css_filename)) {
+                QList<CSSInfo::CSSSelector *> selectors = css_infos[css_filename]->getAllCSSSelectorsForElementClass(element_part, class_part);
                 foreach(CSSInfo::CSSSelector * selector, selectors) {
                     // If class matched a selector in a linked stylesheet, we're done
                     if (selector && (selector->classNames.count() > 0)) {
@@ -223,11 +203,22 @@ QList<BookReports::StyleData *> BookReports::GetCSSSelectorUsage(QSharedPointer<
 {
     QList<CSSResource *> css_resources = book->GetFolderKeeper()->GetResourceTypeList<CSSResource>(false);
     QList<BookReports::StyleData *> css_selectors_usage;
+
+    // The first html file found using each selector, keyed on
+    // stylesheet, selector position and selector text
+    QHash<QString, QString> html_using_selector;
+    foreach(BookReports::StyleData *html_class, html_classes_usage) {
+        QString key = html_class->css_filename % QChar(0) % QString::number(html_class->css_selector_position) %
+                      QChar(0) % html_class->css_selector_text;
+        if (!html_using_selector.contains(key)) {
+            html_using_selector[key] = html_class->html_filename;
+        }
+    }
+
     // Now check the CSS files to see if their classes appear in an HTML file
     foreach(CSSResource *css_resource, css_resources) {
-        QString text = css_resource->GetText();
-        CSSInfo css_info(text, true);
-        QList<CSSInfo::CSSSelector *> selectors = css_info.getClassSelectors();
+        std::shared_ptr<CSSInfo> css_info = css_resource->GetCSSInfo();
+        QList<CSSInfo::CSSSelector *> selectors = css_info->getClassSelectors();
         foreach(CSSInfo::CSSSelector * selector, selectors) {
             QString css_filename = css_resource->GetRelativePath();
             // Save the details for found or not found classes
@@ -236,14 +227,8 @@ QList<BookReports::StyleData *> BookReports::GetCSSSelectorUsage(QSharedPointer<
             selector_usage->css_selector_text = selector->groupText;
             selector_usage->css_selector_position = selector->position;
             selector_usage->css_selector_line = selector->line;
-            foreach(BookReports::StyleData *html_class, html_classes_usage) {
-                if (css_filename == html_class->css_filename && 
-                    selector->position == html_class->css_selector_position &&
-                    selector->groupText == html_class->css_selector_text) {
-                    selector_usage->html_filename = html_class->html_filename;
-                    break;
-                }
-            }
+            QString key = css_filename % QChar(0) % QString::number(selector->position) % QChar(0) % selector->groupText;
+            selector_usage->html_filename = html_using_selector.value(key);
             css_selectors_usage.append(selector_usage);
         }
     }
@@ -23,6 +23,8 @@
 #ifndef BOOKREPORTS_H
 #define BOOKREPORTS_H
 
+#include <memory>
+
 #include "ResourceObjects/HTMLResource.h"
 #include "ResourceObjects/CSSResource.h"
 #include "BookManipulation/Book.h"
@@ -50,13 +52,13 @@ public:
 							     bool show_progress = false);
 
     static QList<BookReports::StyleData *> ClassesUsedInHTMLFileMapped(HTMLResource* html_resource, 
-								       const QHash<QString,QString> &css_text);
+								       const QHash<QString, std::shared_ptr<CSSInfo>> &css_infos);
 
     static QList<BookReports::StyleData *> GetAllHTMLClassUsage(QSharedPointer<Book> book, 
 								bool show_progress = false);
 
     static QList<BookReports::StyleData *> AllClassesUsedInHTMLFileMapped(HTMLResource* html_resource, 
-									  const QHash<QString, QString> &css_text);
+									  const QHash<QString, std::shared_ptr<CSSInfo>> &css_infos);
 
 
     static QList<BookReports::StyleData *> GetCSSSelectorUsage(QSharedPointer<Book> book, 
@@ -33,7 +33,7 @@
 #include "BookManipulation/CleanSource.h"
 #include "BookManipulation/XhtmlDoc.h"
 #include "Misc/GumboInterface.h"
-#include "Misc/SettingsStore.h"
+#include "Misc/SettingsSnapshot.h"
 #include "sigil_constants.h"
 #include "sigil_exception.h"
 #include "Misc/Utility.h"
@@ -49,7 +49,6 @@ static const QStringList NUMERIC_NBSP = QStringList() << "&#160;" << "&#xa0;" <<
 // of provided book XHTML source code
 QString CleanSource::Mend(const QString &source, const QString &version)
 {
-    SettingsStore settings;
     QString newsource = PreprocessSpecialCases(source);
 
     // This hack should not be needed anymore as the epub version is known
@@ -278,9 +277,8 @@ QString CleanSource::PrettifyDOCTYPEHeader(const QString &source)
 
 QString CleanSource::CharToEntity(const QString &source, const QString &version)
 {
-    SettingsStore settings;
     QString new_source = source;
-    QList<std::pair <ushort, QString>> codenames = settings.preserveEntityCodeNames();
+    QList<std::pair <ushort, QString>> codenames = SettingsSnapshot::current()->preserveEntityCodeNames;
     std::pair <ushort, QString> epair;
     bool has_numeric_nbsp = false;
     foreach(epair, codenames) {
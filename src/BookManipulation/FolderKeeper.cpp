@@ -68,6 +68,7 @@ FolderKeeper::FolderKeeper(QObject *parent)
     m_OPF(NULL),
     m_NCX(NULL),
     m_FSWatcher(new QFileSystemWatcher()),
+    m_PathUpdatesSuspended(false),
     m_FullPathToMainFolder(m_TempFolder.GetPath())
 {
     CreateGroupToFoldersMap();
@@ -526,6 +527,13 @@ void FolderKeeper::ResourceRenamed(const Resource *resource, const QString &old_
     Resource * res = m_Path2Resource[book_path];
     m_Path2Resource.remove(book_path);
     m_Path2Resource[resource->GetRelativePath()] = res;
+    if (m_PathUpdatesSuspended) {
+        if (resource != m_OPF) {
+            OPFResource::PathChange change = { resource, old_full_path, false };
+            m_SuspendedPathChanges.append(change);
+        }
+        return;
+    }
     if (resource != m_OPF) {
         m_OPF->ResourceRenamed(resource, old_full_path);
     }
@@ -540,6 +548,17 @@ void FolderKeeper::ResourceMoved(const Resource *resource, const QString &old_fu
     Resource * res = m_Path2Resource[book_path];
     m_Path2Resource.remove(book_path);
     m_Path2Resource[resource->GetRelativePath()] = res;
+    if (m_PathUpdatesSuspended) {
+        if (resource != m_OPF) {
+            OPFResource::PathChange change = { resource, old_full_path, true };
+            m_SuspendedPathChanges.append(change);
+            return;
+        }
+        // manifest hrefs are relative to the OPF, so the changes
+        // made before it moved are resolved against where it was
+        QString old_opf_bookpath = old_full_path.right(old_full_path.length() - m_FullPathToMainFolder.length() - 1);
+        ApplySuspendedPathUpdates(old_opf_bookpath);
+    }
     m_OPF->ResourceMoved(resource, old_full_path);
     updateShortPathNames();
 }
@@ -606,6 +625,28 @@ void FolderKeeper::ResumeWatchingResources()
     }
 }
 
+void FolderKeeper::SuspendPathUpdates()
+{
+    m_PathUpdatesSuspended = true;
+}
+
+void FolderKeeper::ResumePathUpdates()
+{
+    if (m_PathUpdatesSuspended) {
+        ApplySuspendedPathUpdates(m_OPF->GetRelativePath());
+        updateShortPathNames();
+        m_PathUpdatesSuspended = false;
+    }
+}
+
+void FolderKeeper::ApplySuspendedPathUpdates(const QString &opf_bookpath)
+{
+    if (!m_SuspendedPathChanges.isEmpty()) {
+        m_OPF->ResourcePathsChanged(m_SuspendedPathChanges, opf_bookpath);
+        m_SuspendedPathChanges.clear();
+    }
+}
+
 
 // Note all paths do NOT end with "/"
 void FolderKeeper::CreateStdGroupToFoldersMap()
@@ -225,6 +225,14 @@ public:
     void SuspendWatchingResources();
     void ResumeWatchingResources();
 
+    /**
+     * While suspended, the OPF changes for renamed and moved resources
+     * are collected and then applied together on resume, so renaming
+     * or moving many files rewrites the OPF only once.
+     */
+    void SuspendPathUpdates();
+    void ResumePathUpdates();
+
 signals:
 
     /**
@@ -271,6 +279,9 @@ private:
 
     void CreateGroupToFoldersMap();
 
+    // opf_bookpath is the book path the manifest hrefs are still relative to
+    void ApplySuspendedPathUpdates(const QString &opf_bookpath);
+
     void CreateStdGroupToFoldersMap();
 
     QString buildShortName(const QString &bookpath, int lvl);
@@ -330,6 +341,9 @@ private:
     QFileSystemWatcher *m_FSWatcher;
     QStringList m_SuspendedWatchedFiles;
 
+    bool m_PathUpdatesSuspended;
+    QList<OPFResource::PathChange> m_SuspendedPathChanges;
+
     QString m_FullPathToMainFolder;
 
     QHash<QString, QStringList> m_GrpToFold;
@@ -72,10 +72,9 @@ QList<Headings::Heading> Headings::GetHeadingListForOneFile(HTMLResource *html_r
         bool include_unwanted_headings)
 {
     Q_ASSERT(html_resource);
-    QString source = html_resource->GetText();
-    QString version = html_resource->GetEpubVersion();
-    GumboInterface gi = GumboInterface(source, version);
-    gi.parse();
+    // the parsed tree is shared with other readers of this resource
+    std::shared_ptr<GumboInterface> shared_gi = html_resource->GetParsedDocument();
+    GumboInterface &gi = *shared_gi;
 
     // get original source line number of body element
     unsigned int body_line = 0;
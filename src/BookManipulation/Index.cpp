@@ -25,8 +25,6 @@
 
 #include <QtCore/QtCore>
 #include <QtConcurrent/QtConcurrent>
-#include <QtWidgets/QApplication>
-#include <QtWidgets/QProgressDialog>
 #include <QRegularExpression>
 #include <QDebug>
 
@@ -35,7 +33,9 @@
 #include "BookManipulation/XhtmlDoc.h"
 #include "MiscEditors/IndexEditorModel.h"
 #include "BookManipulation/Index.h"
+#include "BookManipulation/IndexMatcher.h"
 #include "MiscEditors/IndexEntries.h"
+#include "Misc/SearchOperations.h"
 #include "sigil_constants.h"
 
 const QString SIGIL_INDEX_CLASS = "sigil_index_marker";
@@ -44,29 +44,61 @@ const QString SIGIL_INDEX_ID_PREFIX = "sigil_index_id_";
 bool Index::BuildIndex(QList<HTMLResource *> html_resources)
 {
     IndexEntries::instance()->Clear();
-    // Display progress dialog
-    QProgressDialog progress(QObject::tr("Creating Index..."), QObject::tr("Cancel"), 0, html_resources.count(), QApplication::activeWindow());
-    progress.setMinimumDuration(0);
-    int progress_value = 0;
-    progress.setValue(progress_value);
-    qApp->processEvents();
-    // Must do sequentially in order to keep sections in order
-    foreach(HTMLResource * html_resource, html_resources) {
-        // Set progress value and ensure dialog has time to display when doing extensive updates
-        if (progress.wasCanceled()) {
-            return false;
+
+    // Compile the Index Editor patterns once for the whole book
+    QStringList patterns;
+    QStringList index_entries;
+    // GetEntries creates each entry with new
+    QList<IndexEditorModel::indexEntry *> entries = IndexEditorModel::instance()->GetEntries();
+    foreach(IndexEditorModel::indexEntry * entry, entries) {
+        patterns.append(entry->pattern);
+        index_entries.append(entry->index_entry);
+    }
+    qDeleteAll(entries);
+    const IndexMatcher matcher(patterns);
+
+    QFuture<IndexedFile> future = QtConcurrent::mapped(html_resources,
+                                                       std::bind(AddIndexIDsOneFile, std::placeholders::_1,
+                                                                 std::cref(matcher), std::cref(patterns), std::cref(index_entries)));
+
+    if (!SearchOperations::WaitForFiles(QFuture<void>(future), QObject::tr("Creating Index..."), html_resources.count())) {
+        // Nothing has been changed yet
+        return false;
+    }
+
+    // Results are in the same order as the resources so
+    // sections are added to the index in reading order.
+    for (int i = 0; i < html_resources.count(); ++i) {
+        HTMLResource *html_resource = html_resources.at(i);
+        IndexedFile result = future.resultAt(i);
+
+        // only this thread edits text, so nothing can change it between here and the write
+        if (html_resource->GetTextRevision() != result.revision) {
+            // changed while the workers ran so redo this file from its current text
+            result = AddIndexIDsOneFile(html_resource, matcher, patterns, index_entries);
         }
 
-        progress.setValue(progress_value++);
-        qApp->processEvents();
-        AddIndexIDsOneFile(html_resource);
+        if (!result.new_source.isEmpty()) {
+            QWriteLocker locker(&html_resource->GetLock());
+            html_resource->SetText(result.new_source);
+        }
+
+        QString bookpath = html_resource->GetRelativePath();
+        foreach(const FoundEntry &found, result.entries) {
+            IndexEntries::instance()->AddOneEntry(found.first, bookpath, found.second);
+        }
     }
     return true;
 }
 
-void Index::AddIndexIDsOneFile(HTMLResource *html_resource)
+Index::IndexedFile Index::AddIndexIDsOneFile(HTMLResource *html_resource,
+                                             const IndexMatcher &matcher,
+                                             const QStringList &patterns,
+                                             const QStringList &index_entries)
 {
-    QWriteLocker locker(&html_resource->GetLock());
+    IndexedFile result;
+    QReadLocker locker(&html_resource->GetLock());
+    result.revision = html_resource->GetTextRevision();
     QString source = html_resource->GetText();
     QString version = html_resource->GetEpubVersion();
     GumboInterface gi = GumboInterface(source, version);
@@ -113,66 +145,56 @@ void Index::AddIndexIDsOneFile(HTMLResource *html_resource)
 
         }
 
-        // Use the existing id if there is one, else add one if node contains index item
-        attr = gumbo_get_attribute(&node->v.element.attributes, "id");
-        if (attr) {
-            CreateIndexEntry(text_node_text, html_resource, index_id_value, is_custom_index_entry, custom_index_value);
+        // A custom entry always matches its own text so only the
+        // Index Editor patterns need to be searched for
+        QStringList node_entries;
+        if (is_custom_index_entry) {
+            if (!text_node_text.isEmpty()) {
+                // need to escape text to prevent it being interpreted 
+                // as a QRegularExpression special character
+                node_entries.append(IndexText(QRegularExpression::escape(text_node_text), custom_index_value));
+            }
         } else {
+            foreach(int i, matcher.Match(text_node_text)) {
+                node_entries.append(IndexText(patterns.at(i), index_entries.at(i)));
+            }
+        }
+
+        if (node_entries.isEmpty()) {
+            continue;
+        }
+
+        // Use the existing id if there is one, else add one since node contains index item
+        attr = gumbo_get_attribute(&node->v.element.attributes, "id");
+        if (!attr) {
             index_id_value = SIGIL_INDEX_ID_PREFIX + QString::number(index_id_number);
+            GumboElement* element = &node->v.element;
+            gumbo_element_set_attribute(element, "id", index_id_value.toUtf8().constData()); 
+            resource_updated = true;
+            index_id_number++;
+        }
 
-            if (CreateIndexEntry(text_node_text, html_resource, index_id_value, is_custom_index_entry, custom_index_value)) {
-                GumboElement* element = &node->v.element;
-                gumbo_element_set_attribute(element, "id", index_id_value.toUtf8().constData()); 
-                resource_updated = true;
-                index_id_number++;
-            }
+        foreach(QString entry_text, node_entries) {
+            result.entries.append(FoundEntry(entry_text, index_id_value));
         }
     }
 
     if (resource_updated) {
-        html_resource->SetText(gi.getxhtml());
+        result.new_source = gi.getxhtml();
     }
+    return result;
 }
 
 
-bool Index::CreateIndexEntry(const QString text, HTMLResource *html_resource, QString index_id_value, bool is_custom_index_entry, QString custom_index_value)
+QString Index::IndexText(const QString &pattern, const QString &index_entry)
 {
-    bool created_index = false;
-    QList<IndexEditorModel::indexEntry *> entries;
-
-    if (is_custom_index_entry) {
-        IndexEditorModel::indexEntry *custom_entry = new IndexEditorModel::indexEntry();
-        // need to escape text to prevent it being interpreted 
-        // as a QRegularExpression special character
-        custom_entry->pattern = QRegularExpression::escape(text);
-        custom_entry->index_entry = custom_index_value;
-        entries.append(custom_entry);
-    } else {
-        entries = IndexEditorModel::instance()->GetEntries();
-    }
-
-    foreach(IndexEditorModel::indexEntry * entry, entries) {
-        QString index_pattern = entry->pattern;
-        if (index_pattern.isEmpty()) {
-            continue;
-        }
-
-        QRegularExpression index_regex(index_pattern);
-
-        if (text.contains(index_regex)) {
-            created_index = true;
-            QString index_entry = entry->index_entry;
-            if (index_entry.isEmpty()) {
-                // If no index text, use the pattern
-	        IndexEntries::instance()->AddOneEntry(index_pattern, html_resource->GetRelativePath(), index_id_value);
-            } else if (entry->index_entry.endsWith("/")) {
-                // If index text is a category then append the pattern
-	        IndexEntries::instance()->AddOneEntry(index_entry + index_pattern, html_resource->GetRelativePath(), index_id_value);
-            } else {
-                // Use the given index text
-	        IndexEntries::instance()->AddOneEntry(index_entry, html_resource->GetRelativePath(), index_id_value);
-            }
-        }
+    if (index_entry.isEmpty()) {
+        // If no index text, use the pattern
+        return pattern;
+    } else if (index_entry.endsWith("/")) {
+        // If index text is a category then append the pattern
+        return index_entry + pattern;
     }
-    return created_index;
+    // Use the given index text
+    return index_entry;
 }
@@ -25,12 +25,18 @@
 #ifndef INDEX_H
 #define INDEX_H
 
+#include <utility>
+
+#include <QtCore/QStringList>
+
 class HTMLResource;
+class IndexMatcher;
 
 /**
  * Houses the Index process.
  * Ids are added via static routines to all files if text matches Index settings.
  * Patterns are read from the Index dialog model and written to the Index Entry storage.
+ * Files are scanned in parallel and their entries stored in reading order.
  */
 class Index
 {
@@ -39,9 +45,23 @@ public:
     static bool BuildIndex(QList<HTMLResource *> html_resources);
 
 private:
-    static void AddIndexIDsOneFile(HTMLResource *html_resource);
+    // an index entry text and the id of the element it points to
+    typedef std::pair<QString, QString> FoundEntry;
+
+    struct IndexedFile {
+        // the text revision the result was built from
+        int revision;
+        // empty if no ids changed
+        QString new_source;
+        QList<FoundEntry> entries;
+    };
+
+    static IndexedFile AddIndexIDsOneFile(HTMLResource *html_resource,
+                                          const IndexMatcher &matcher,
+                                          const QStringList &patterns,
+                                          const QStringList &index_entries);
 
-    static bool CreateIndexEntry(const QString text, HTMLResource *html_resource, QString index_id_name, bool is_custom_index_entry, QString custom_index_name);
+    static QString IndexText(const QString &pattern, const QString &index_entry);
 };
 
 #endif // INDEX_H
@@ -0,0 +1,155 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <algorithm>
+#include <utility>
+
+#include <QtCore/QQueue>
+
+#include "BookManipulation/IndexMatcher.h"
+
+static const QString REGEX_SPECIAL_CHARS = "\\^$.|?*+()[]{}";
+
+IndexMatcher::IndexMatcher(const QStringList &patterns)
+{
+    // the root state
+    m_States.append(State());
+    m_States[0].failure = 0;
+
+    for (int i = 0; i < patterns.count(); ++i) {
+        const QString &pattern = patterns.at(i);
+        if (pattern.isEmpty()) {
+            continue;
+        }
+
+        if (IsLiteral(pattern)) {
+            AddLiteral(pattern, i);
+        } else {
+            QRegularExpression regex(pattern);
+            // compile now rather than on first use in the worker threads
+            regex.optimize();
+            m_Regexes.append(regex);
+            m_RegexPatternIndexes.append(i);
+        }
+    }
+
+    BuildFailureLinks();
+}
+
+
+QList<int> IndexMatcher::Match(const QString &text) const
+{
+    QList<int> found;
+
+    int state = 0;
+    const ushort *c = text.utf16();
+    const ushort *end = c + text.length();
+    for (; c != end; ++c) {
+        state = Transition(state, *c);
+        foreach(int pattern_index, m_States.at(state).patterns) {
+            found.append(pattern_index);
+        }
+    }
+
+    for (int i = 0; i < m_Regexes.count(); ++i) {
+        if (text.contains(m_Regexes.at(i))) {
+            found.append(m_RegexPatternIndexes.at(i));
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+
+bool IndexMatcher::IsLiteral(const QString &pattern)
+{
+    foreach(QChar c, pattern) {
+        if (REGEX_SPECIAL_CHARS.contains(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void IndexMatcher::AddLiteral(const QString &literal, int pattern_index)
+{
+    int state = 0;
+    foreach(QChar c, literal) {
+        quint64 key = (quint64(state) << 16) | c.unicode();
+        int next = m_Transitions.value(key, -1);
+        if (next == -1) {
+            next = m_States.count();
+            m_States.append(State());
+            m_Transitions.insert(key, next);
+        }
+        state = next;
+    }
+    m_States[state].patterns.append(pattern_index);
+}
+
+
+// Breadth first so the failure state of every state is complete
+// before any deeper state uses it.
+void IndexMatcher::BuildFailureLinks()
+{
+    QVector<QList<std::pair<ushort, int>>> children(m_States.count());
+    QHash<quint64, int>::const_iterator it = m_Transitions.constBegin();
+    for (; it != m_Transitions.constEnd(); ++it) {
+        children[int(it.key() >> 16)].append(std::make_pair(ushort(it.key() & 0xFFFF), it.value()));
+    }
+
+    QQueue<int> queue;
+    typedef std::pair<ushort, int> Edge;
+    foreach(const Edge &edge, children.at(0)) {
+        m_States[edge.second].failure = 0;
+        queue.enqueue(edge.second);
+    }
+
+    while (!queue.isEmpty()) {
+        int state = queue.dequeue();
+        foreach(const Edge &edge, children.at(state)) {
+            int child = edge.second;
+            int failure = Transition(m_States.at(state).failure, edge.first);
+            m_States[child].failure = failure;
+            m_States[child].patterns += m_States.at(failure).patterns;
+            queue.enqueue(child);
+        }
+    }
+}
+
+
+int IndexMatcher::Transition(int state, ushort c) const
+{
+    while (true) {
+        int next = m_Transitions.value((quint64(state) << 16) | c, -1);
+        if (next != -1) {
+            return next;
+        }
+        if (state == 0) {
+            return 0;
+        }
+        state = m_States.at(state).failure;
+    }
+}
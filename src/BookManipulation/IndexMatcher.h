@@ -0,0 +1,91 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef INDEXMATCHER_H
+#define INDEXMATCHER_H
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QRegularExpression>
+
+/**
+ * Matches text against all of the Index Editor patterns at once.
+ *
+ * The patterns are compiled a single time when the matcher is built.
+ * Patterns without any regex special characters are plain words and
+ * phrases and are all found in one pass over the text with an
+ * Aho-Corasick automaton. The remaining patterns are kept as a list
+ * of precompiled regular expressions.
+ *
+ * Match() is const and safe to call from several threads at once.
+ */
+class IndexMatcher
+{
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param patterns The patterns of the index entries in index order.
+     *                 Empty patterns never match.
+     */
+    IndexMatcher(const QStringList &patterns);
+
+    /**
+     * The positions in the pattern list of every pattern
+     * found in the text, in ascending order.
+     */
+    QList<int> Match(const QString &text) const;
+
+private:
+
+    static bool IsLiteral(const QString &pattern);
+
+    void AddLiteral(const QString &literal, int pattern_index);
+
+    void BuildFailureLinks();
+
+    int Transition(int state, ushort c) const;
+
+    struct State {
+        // longest proper suffix of this state that is also a state
+        int failure;
+
+        // patterns ending at this state or at any of its suffixes
+        QVector<int> patterns;
+    };
+
+    QVector<State> m_States;
+
+    // the goto function keyed on (state << 16) | utf-16 code unit
+    QHash<quint64, int> m_Transitions;
+
+    QList<QRegularExpression> m_Regexes;
+
+    QList<int> m_RegexPatternIndexes;
+};
+
+#endif // INDEXMATCHER_H
@@ -179,10 +179,40 @@ QList<XhtmlDoc::XMLElement> XhtmlDoc::GetTagsInDocument(const QString &source, c
 }
 
 
+QList<XhtmlDoc::XMLElement> XhtmlDoc::GetTagsInDocument(GumboInterface &gi, GumboTag tag)
+{
+    QList<XMLElement> matching_elements;
+    QList<GumboNode*> nodes = gi.get_all_nodes_with_tag(tag);
+    foreach(GumboNode * node, nodes) {
+        XMLElement element;
+        element.lineno = node->v.element.start_pos.line;
+        QHash<QString, QString> atts = gi.get_attributes_of_node(node);
+        foreach(QString attribute_name, atts.keys()) {
+            QString value = atts.value(attribute_name);
+            // keep the same attribute name rules as CreateXMLElement
+            if (!Utility::IsMixedCase(attribute_name)) {
+                attribute_name = attribute_name.toLower();
+            }
+            element.attributes[ attribute_name ] = value;
+        }
+        element.name = QString::fromStdString(gi.get_tag_name(node));
+        element.text = gi.get_local_text_of_node(node);
+        matching_elements.append(element);
+    }
+    return matching_elements;
+}
+
+
 QList<QString> XhtmlDoc::GetAllDescendantClasses(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantClasses(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantClasses(GumboInterface &gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("class"));
     QStringList classes;
     foreach(GumboNode * node, nodes) {
@@ -203,13 +233,19 @@ QList<QString> XhtmlDoc::GetAllDescendantStyleUrls(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantStyleUrls(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantStyleUrls(GumboInterface &gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("style"));
     QStringList styles;
+    QRegularExpression url_search(URL_ATTRIBUTE_SEARCH);
     foreach(GumboNode * node, nodes) {
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "style");
         if (attr) {
             QString style_value = QString::fromUtf8(attr->value);
-            QRegularExpression url_search(URL_ATTRIBUTE_SEARCH);
             QRegularExpressionMatch match = url_search.match(style_value);
             if (match.hasMatch()) {
                 styles.append(match.captured(1));
@@ -224,6 +260,12 @@ QList<QString> XhtmlDoc::GetAllDescendantIDs(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantIDs(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantIDs(GumboInterface &gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("id"));
     nodes.append(gi.get_all_nodes_with_attribute(QString("name")));
     QStringList IDs;
@@ -246,14 +288,20 @@ QList<QString> XhtmlDoc::GetAllDescendantIDs(const QString & source)
     return IDs;
 }
 
+
 QList<QString> XhtmlDoc::GetAllDescendantHrefs(const QString & source)
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllDescendantHrefs(gi);
+}
+
+
+QList<QString> XhtmlDoc::GetAllDescendantHrefs(GumboInterface &gi)
+{
     QList<GumboNode*> nodes = gi.get_all_nodes_with_attribute(QString("href"));
     QStringList hrefs;
     foreach(GumboNode * node, nodes) {
-        QString element_name = QString::fromStdString(gi.get_tag_name(node));
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "href");
         if (attr) {
             hrefs.append(QString::fromUtf8(attr->value));
@@ -415,6 +463,33 @@ QStringList XhtmlDoc::GetLinkedStylesheets(const QString &source)
 }
 
 
+// Same as above but using the gumbo tree, so the cached parse of an
+// HTMLResource can be used instead of a separate xml stream read
+QStringList XhtmlDoc::GetLinkedStylesheets(GumboInterface &gi)
+{
+    QStringList linked_css_paths;
+    QList<GumboNode*> heads = gi.get_all_nodes_with_tag(GUMBO_TAG_HEAD);
+    if (heads.isEmpty()) {
+        return linked_css_paths;
+    }
+    QList<GumboNode*> link_nodes = gi.get_nodes_with_tags(heads.at(0), QList<GumboTag>() << GUMBO_TAG_LINK);
+    foreach(GumboNode * node, link_nodes) {
+        GumboAttribute* type_attr = gumbo_get_attribute(&node->v.element.attributes, "type");
+        GumboAttribute* rel_attr  = gumbo_get_attribute(&node->v.element.attributes, "rel");
+        GumboAttribute* href_attr = gumbo_get_attribute(&node->v.element.attributes, "href");
+        if (!type_attr || !rel_attr || !href_attr) {
+            continue;
+        }
+        QString type = QString::fromUtf8(type_attr->value).toLower();
+        QString rel  = QString::fromUtf8(rel_attr->value).toLower();
+        if (((type == "text/css") || (type == "text/x-oeb1-css")) && (rel == "stylesheet")) {
+            linked_css_paths.append(QString::fromUtf8(href_attr->value));
+        }
+    }
+    return linked_css_paths;
+}
+
+
 // Returns a list of all the "visible" text nodes that are descendants
 // of the specified node. "Visible" means we ignore style tags, script tags etc...
 QList<GumboNode *> XhtmlDoc::GetVisibleTextNodes(GumboInterface &gi, GumboNode *node)
@@ -631,6 +706,12 @@ QStringList XhtmlDoc::GetAllMediaPathsFromMediaChildren(const QString & source,
 {
     QString version = "any_version";
     GumboInterface gi = GumboInterface(source, version);
+    return GetAllMediaPathsFromMediaChildren(gi, tags);
+}
+
+
+QStringList XhtmlDoc::GetAllMediaPathsFromMediaChildren(GumboInterface &gi, QList<GumboTag> tags)
+{
     QStringList media_paths;
     QList<GumboNode*> nodes = gi.get_all_nodes_with_tags(tags);
     for (int i = 0; i < nodes.count(); ++i) {
@@ -71,6 +71,9 @@ public:
     // in the entire document of the provided XHTML source code
     static QList<XMLElement> GetTagsInDocument(const QString &source, const QString &tag_name);
 
+    // Same as above but built from an already parsed gumbo tree
+    static QList<XMLElement> GetTagsInDocument(GumboInterface &gi, GumboTag tag);
+
     // static QList<xc::DOMNode *> GetNodeChildren(const xc::DOMNode &node);
 
     static QList<QString> GetAllDescendantStyleUrls(const QString & source);
@@ -78,6 +81,13 @@ public:
     static QList<QString> GetAllDescendantIDs(const QString & );
     static QList<QString> GetAllDescendantClasses(const QString & source);
 
+    // Same as above but working from an already parsed document
+    // (see HTMLResource::GetParsedDocument()) to avoid reparsing
+    static QList<QString> GetAllDescendantStyleUrls(GumboInterface &gi);
+    static QList<QString> GetAllDescendantHrefs(GumboInterface &gi);
+    static QList<QString> GetAllDescendantIDs(GumboInterface &gi);
+    static QList<QString> GetAllDescendantClasses(GumboInterface &gi);
+
     struct WellFormedError {
         int line;
         int column;
@@ -121,6 +131,7 @@ public:
 
     // Return a list of all linked CSS stylesheets
     static QStringList GetLinkedStylesheets(const QString &source);
+    static QStringList GetLinkedStylesheets(GumboInterface &gi);
 
     // Returns a list of all the "visible" text nodes that are descendants
     // of the specified node. "Visible" means we ignore style tags, script tags etc...
@@ -146,6 +157,7 @@ public:
     static QStringList GetAllURLPathsFromStylesheet(const QString & source, const QString & csspath);
 
     static QStringList GetAllMediaPathsFromMediaChildren(const QString &source, QList<GumboTag> tags);
+    static QStringList GetAllMediaPathsFromMediaChildren(GumboInterface &gi, QList<GumboTag> tags);
 
 
 private:
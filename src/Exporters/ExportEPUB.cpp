@@ -28,42 +28,243 @@
 #include <string.h>
 
 #include <zip.h>
+#include <unzip.h>
 #ifdef _WIN32
 #include <iowin32.h>
 #endif
 
+#include <QtConcurrent/QtConcurrent>
+#include <QtCore/QBuffer>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QDirIterator>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
 #include <QtCore/QTemporaryFile>
-#include <QtCore/QTextStream>
 
-#include "BookManipulation/CleanSource.h"
 #include "BookManipulation/FolderKeeper.h"
-#include "BookManipulation/XhtmlDoc.h"
 #include "Exporters/EncryptionXmlWriter.h"
 #include "Exporters/ExportEPUB.h"
 #include "Misc/Utility.h"
-#include "Misc/TempFolder.h"
 #include "Misc/FontObfuscation.h"
 #include "ResourceObjects/FontResource.h"
 #include "sigil_constants.h"
 #include "sigil_exception.h"
 
+#ifndef MAX_PATH
+// Set Max length to 256 because that's the max path size on many systems.
+#define MAX_PATH 256
+#endif
 #define BUFF_SIZE 8192
 
-const QString BODY_START = "<\\s*body[^>]*>";
-const QString BODY_END   = "</\\s*body\\s*>";
-
 const QString CONTAINER_XML_FILE_NAME  = "container.xml";
 const QString ENCRYPTION_XML_FILE_NAME = "encryption.xml";
 
-static const QString METAINF_FOLDER_SUFFIX = "/META-INF";
+static const QString METAINF_FOLDER = "META-INF";
 
 static const char * EPUB_MIME_DATA = "application/epub+zip";
 
+// Formats that are already compressed gain nothing from
+// deflate so they are stored in the epub as they are
+static const QStringList STORED_EXTENSIONS = QStringList() << "jpg" << "jpeg" << "png" << "gif" << "webp"
+                                                           << "mp3" << "mp4" << "m4a" << "m4v" << "ogg"
+                                                           << "oga" << "ogv" << "webm" << "woff" << "woff2";
+
+// The most uncompressed data we prepare in memory at one time
+static const qint64 MAX_BATCH_SIZE = 64 * 1024 * 1024;
+
+// Zip entries larger than this need zip64 extensions
+static const qint64 ZIP64_LIMIT = 0xffffffffLL;
+
+
+// Stored files that need no changes are copied straight from
+// disk into the epub when written and are not prepared in memory
+static bool IsStreamed(const QString &fullfilepath, bool store, const QString &obfuscation_algorithm)
+{
+    return store && !fullfilepath.isEmpty() && obfuscation_algorithm.isEmpty();
+}
+
+
+// What the last save wrote to an epub, so the next save to the
+// same path can copy the entries that did not change from it
+struct ArchivedEntry {
+    // the source file as it was when written
+    qint64 size;
+    qint64 mtime;
+    quint32 source_crc;
+    QString obfuscation_algorithm;
+    QString obfuscation_key;
+
+    // position of the entry in the epub's central directory
+    ZPOS64_T offset;
+
+    ArchivedEntry() : size(0), mtime(0), source_crc(0), offset(0) {}
+};
+
+struct ArchiveRecord {
+    QString mainfolder;
+
+    // the epub as it was left by the save,
+    // if it changed since then it is not used
+    qint64 size;
+    qint64 mtime;
+
+    // ArchivedEntry keyed on bookpath
+    QHash<QString, ArchivedEntry> entries;
+
+    ArchiveRecord() : size(0), mtime(0) {}
+};
+
+// ArchiveRecord keyed on the absolute path of the epub
+static QHash<QString, ArchiveRecord> s_ArchiveRecords;
+static QMutex s_ArchiveRecordsMutex;
+
+enum CopyResult {
+    CopyDone,
+    CopyNotPossible,
+    CopyFailed
+};
+
+
+static unzFile OpenArchive(const QString &zippath)
+{
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    return unzOpen2_64(Utility::QStringToStdWString(QDir::toNativeSeparators(zippath)).c_str(), &ffunc);
+#else
+    return unzOpen64(QDir::toNativeSeparators(zippath).toUtf8().constData());
+#endif
+}
+
+
+static quint32 FileCrc(const QString &fullfilepath, bool &ok)
+{
+    QFile file(fullfilepath);
+    ok = file.open(QIODevice::ReadOnly);
+
+    if (!ok) {
+        return 0;
+    }
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    char buff[BUFF_SIZE];
+    qint64 read = 0;
+
+    while ((read = file.read(buff, BUFF_SIZE)) > 0) {
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(buff), read);
+    }
+
+    ok = (read == 0);
+    return crc;
+}
+
+
+// Copies the still compressed entry at offset in ufile into zfile.
+// CopyNotPossible means nothing was written to zfile and the entry
+// can be compressed afresh instead.
+static CopyResult CopyArchivedEntry(unzFile ufile, ZPOS64_T offset, zipFile zfile,
+                                    const QByteArray &relpath, const zip_fileinfo *fileInfo)
+{
+    unz_file_info64 file_info;
+    int method = 0;
+    int level = 0;
+
+    if ((unzSetOffset64(ufile, offset) != UNZ_OK) ||
+        (unzGetCurrentFileInfo64(ufile, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) ||
+        (unzOpenCurrentFile2(ufile, &method, &level, 1) != UNZ_OK)) {
+        return CopyNotPossible;
+    }
+
+    int zip64 = file_info.uncompressed_size >= ZIP64_LIMIT ? 1 : 0;
+
+    if (zipOpenNewFileInZip4_64(zfile, relpath.constData(), fileInfo, NULL, 0, NULL, 0, NULL, method, level, 1, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, zip64) != ZIP_OK) {
+        unzCloseCurrentFile(ufile);
+        return CopyFailed;
+    }
+
+    char buff[BUFF_SIZE];
+    int read = 0;
+
+    while ((read = unzReadCurrentFile(ufile, buff, BUFF_SIZE)) > 0) {
+        if (zipWriteInFileInZip(zfile, buff, read) != ZIP_OK) {
+            break;
+        }
+    }
+
+    unzCloseCurrentFile(ufile);
+
+    if (zipCloseFileInZipRaw64(zfile, file_info.uncompressed_size, file_info.crc) != ZIP_OK || read != 0) {
+        return CopyFailed;
+    }
+
+    return CopyDone;
+}
+
+
+static void AbortZip(zipFile zfile, unzFile ufile, const QString &tempFile, bool entry_open)
+{
+    if (entry_open) {
+        zipCloseFileInZip(zfile);
+    }
+
+    if (ufile != NULL) {
+        unzClose(ufile);
+    }
+
+    zipClose(zfile, NULL);
+    QFile::remove(tempFile);
+}
+
+
+// Notes where each entry ended up in the epub just written
+// so the next save to it can reuse them
+static void RecordArchive(const QString &fullfilepath, const QString &mainfolder,
+                          QHash<QString, ArchivedEntry> entries)
+{
+    unzFile ufile = OpenArchive(fullfilepath);
+
+    if (ufile == NULL) {
+        return;
+    }
+
+    ArchiveRecord record;
+    record.mainfolder = mainfolder;
+    int res = unzGoToFirstFile(ufile);
+
+    while (res == UNZ_OK) {
+        char file_name[MAX_PATH] = {0};
+        unz_file_info64 file_info;
+
+        if (unzGetCurrentFileInfo64(ufile, &file_info, file_name, MAX_PATH, NULL, 0, NULL, 0) != UNZ_OK) {
+            break;
+        }
+
+        QString bookpath = QString::fromUtf8(file_name);
+
+        if (entries.contains(bookpath)) {
+            ArchivedEntry entry = entries.take(bookpath);
+            entry.offset = unzGetOffset64(ufile);
+            record.entries.insert(bookpath, entry);
+        }
+
+        res = unzGoToNextFile(ufile);
+    }
+
+    unzClose(ufile);
+
+    if (res != UNZ_END_OF_LIST_OF_FILE) {
+        return;
+    }
+
+    QFileInfo epub_info(fullfilepath);
+    record.size = epub_info.size();
+    record.mtime = epub_info.lastModified().toMSecsSinceEpoch();
+    QMutexLocker locker(&s_ArchiveRecordsMutex);
+    s_ArchiveRecords.insert(epub_info.absoluteFilePath(), record);
+}
+
 
 // Constructor;
 // the first parameter is the location where the book
@@ -94,31 +295,227 @@ void ExportEPUB::WriteBook()
     m_Book->GetOPF()->AddSigilVersionMeta();
     m_Book->GetOPF()->AddModificationDateMeta();
     m_Book->SaveAllResourcesToDisk();
-    TempFolder tempfolder;
-    CreatePublication(tempfolder.GetPath());
 
-    if (m_Book->HasObfuscatedFonts()) {
-        ObfuscateFonts(tempfolder.GetPath());
+    // The epub is zipped straight from the book folder, fonts
+    // are obfuscated and encryption.xml created as they are written
+    WriteEpubToLocation(GetZipEntries(), m_FullFilePath);
+}
+
+
+QList<ExportEPUB::ZipEntry> ExportEPUB::GetZipEntries()
+{
+    QList<ZipEntry> entries;
+    QString mainfolder = m_Book->GetFolderKeeper()->GetFullPathToMainFolder();
+    QString encryption_bookpath = METAINF_FOLDER + "/" + ENCRYPTION_XML_FILE_NAME;
+    bool obfuscated_fonts = m_Book->HasObfuscatedFonts();
+
+    // font bookpath to obfuscation algorithm
+    QHash<QString, QString> font_algorithms;
+    QString uuid_id;
+    QString main_id;
+
+    if (obfuscated_fonts) {
+        uuid_id = m_Book->GetOPF()->GetUUIDIdentifierValue();
+        main_id = m_Book->GetPublicationIdentifier();
+        QList<FontResource *> font_resources = m_Book->GetFolderKeeper()->GetResourceTypeList<FontResource>();
+        foreach(FontResource *font_resource, font_resources) {
+            QString algorithm = font_resource->GetObfuscationAlgorithm();
+
+            if (!algorithm.isEmpty()) {
+                font_algorithms[font_resource->GetRelativePath()] = algorithm;
+            }
+        }
     }
 
-    SaveFolderAsEpubToLocation(tempfolder.GetPath(), m_FullFilePath);
+    QDirIterator it(mainfolder, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable | QDir::Hidden, QDirIterator::Subdirectories);
+
+    while (it.hasNext()) {
+        it.next();
+        QString relpath = it.filePath().remove(mainfolder);
+
+        while (relpath.startsWith("/")) {
+            relpath = relpath.remove(0, 1);
+        }
+
+        // a fresh one is created below
+        if (obfuscated_fonts && (relpath == encryption_bookpath)) {
+            continue;
+        }
+
+        ZipEntry entry;
+        entry.bookpath = relpath;
+        entry.fullfilepath = it.filePath();
+        entry.size = it.fileInfo().size();
+        entry.mtime = it.fileInfo().lastModified().toMSecsSinceEpoch();
+        entry.store = STORED_EXTENSIONS.contains(it.fileInfo().suffix().toLower());
+
+        if (font_algorithms.contains(relpath)) {
+            entry.obfuscation_algorithm = font_algorithms.value(relpath);
+            entry.obfuscation_key = entry.obfuscation_algorithm == ADOBE_FONT_ALGO_ID ? uuid_id : main_id;
+        }
+
+        entries.append(entry);
+    }
+
+    if (obfuscated_fonts) {
+        ZipEntry entry;
+        entry.bookpath = encryption_bookpath;
+        entry.data = CreateEncryptionXML();
+        entry.size = entry.data.size();
+        entries.append(entry);
+    }
+
+    return entries;
 }
 
 
-// Creates the publication from the Book
-// (creates XHTML, CSS, OPF, NCX files etc.)
-void ExportEPUB::CreatePublication(const QString &fullfolderpath)
+ExportEPUB::PreparedEntry ExportEPUB::PrepareEntry(const ZipEntry &entry)
 {
-    Utility::CopyFiles(m_Book->GetFolderKeeper()->GetFullPathToMainFolder(), fullfolderpath);
+    PreparedEntry prepared;
+    bool streamed = IsStreamed(entry.fullfilepath, entry.store, entry.obfuscation_algorithm);
+    bool same_size = entry.has_previous && (entry.size == entry.previous_size);
+
+    // An untouched file can be reused without reading it
+    if (same_size && !entry.fullfilepath.isEmpty() && (entry.mtime == entry.previous_mtime)) {
+        prepared.reuse = true;
+        prepared.source_crc = entry.previous_source_crc;
+        return prepared;
+    }
 
-    if (m_Book->HasObfuscatedFonts()) {
-        CreateEncryptionXML(fullfolderpath + METAINF_FOLDER_SUFFIX);
+    if (streamed) {
+        if (same_size) {
+            bool crc_ok = false;
+            quint32 source_crc = FileCrc(entry.fullfilepath, crc_ok);
+
+            if (crc_ok && (source_crc == entry.previous_source_crc)) {
+                prepared.reuse = true;
+                prepared.source_crc = source_crc;
+            }
+        }
+
+        return prepared;
+    }
+
+    QByteArray content = entry.data;
+
+    if (!entry.fullfilepath.isEmpty()) {
+        QFile file(entry.fullfilepath);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            prepared.ok = false;
+            return prepared;
+        }
+
+        content = file.readAll();
+    }
+
+    prepared.source_crc = crc32(0L, reinterpret_cast<const Bytef *>(content.constData()), content.size());
+
+    // Text files are rewritten on every save so compare the content
+    if (entry.has_previous && (content.size() == entry.previous_size) &&
+        (prepared.source_crc == entry.previous_source_crc)) {
+        prepared.reuse = true;
+        return prepared;
+    }
+
+    if (!entry.obfuscation_algorithm.isEmpty()) {
+        try {
+            FontObfuscation::ObfuscateData(content, entry.obfuscation_algorithm, entry.obfuscation_key);
+        } catch (FontObfuscationError&) {
+            prepared.ok = false;
+            return prepared;
+        }
+
+        prepared.crc = crc32(0L, reinterpret_cast<const Bytef *>(content.constData()), content.size());
+    } else {
+        prepared.crc = prepared.source_crc;
+    }
+
+    prepared.uncompressed_size = content.size();
+
+    if (entry.store) {
+        prepared.data = content;
+        return prepared;
+    }
+
+    // Raw deflate, the zip entry headers are written by minizip
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (deflateInit2(&stream, 8, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        prepared.ok = false;
+        return prepared;
     }
+
+    prepared.data.resize(deflateBound(&stream, content.size()));
+    stream.next_in = reinterpret_cast<Bytef *>(content.data());
+    stream.avail_in = content.size();
+    stream.next_out = reinterpret_cast<Bytef *>(prepared.data.data());
+    stream.avail_out = prepared.data.size();
+    int rc = deflate(&stream, Z_FINISH);
+    prepared.data.resize(stream.total_out);
+    deflateEnd(&stream);
+    prepared.deflated = true;
+    prepared.ok = (rc == Z_STREAM_END);
+    return prepared;
 }
 
-void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const QString &fullfilepath)
+
+void ExportEPUB::WriteEpubToLocation(const QList<ZipEntry> &entries, const QString &fullfilepath)
 {
-    QString tempFile = fullfolderpath + "-tmp.epub";
+    // Write next to the destination so the finished epub can
+    // be moved over it in one step. A failed or interrupted save
+    // never leaves a half written epub behind.
+    QFileInfo target_info(fullfilepath);
+    QTemporaryFile temp_epub(target_info.absolutePath() + "/" + target_info.completeBaseName() + "-XXXXXX.tmp");
+    temp_epub.setAutoRemove(false);
+
+    if (!temp_epub.open()) {
+        throw (CannotOpenFile(temp_epub.fileTemplate().toStdString()));
+    }
+
+    QString tempFile = temp_epub.fileName();
+    temp_epub.close();
+    QString mainfolder = m_Book->GetFolderKeeper()->GetFullPathToMainFolder();
+
+    // If the epub being replaced is the one our last save of this book
+    // wrote, entries whose files have not changed since are copied from
+    // it as they are instead of being compressed again. The record is
+    // taken out so a failed save leaves none behind.
+    ArchiveRecord previous;
+    {
+        QMutexLocker locker(&s_ArchiveRecordsMutex);
+        previous = s_ArchiveRecords.take(target_info.absoluteFilePath());
+    }
+    unzFile ufile = NULL;
+
+    if (!previous.entries.isEmpty() && (previous.mainfolder == mainfolder) && target_info.exists() &&
+        (target_info.size() == previous.size) && (target_info.lastModified().toMSecsSinceEpoch() == previous.mtime)) {
+        ufile = OpenArchive(fullfilepath);
+    }
+
+    QList<ZipEntry> entries_to_write = entries;
+
+    if (ufile != NULL) {
+        for (int i = 0; i < entries_to_write.count(); ++i) {
+            ZipEntry &entry = entries_to_write[i];
+
+            if (!previous.entries.contains(entry.bookpath)) {
+                continue;
+            }
+
+            const ArchivedEntry &archived = previous.entries[entry.bookpath];
+
+            if ((archived.obfuscation_algorithm == entry.obfuscation_algorithm) &&
+                (archived.obfuscation_key == entry.obfuscation_key)) {
+                entry.has_previous = true;
+                entry.previous_size = archived.size;
+                entry.previous_mtime = archived.mtime;
+                entry.previous_source_crc = archived.source_crc;
+            }
+        }
+    }
+
     QDateTime timeNow = QDateTime::currentDateTime();
     zip_fileinfo fileInfo;
 #ifdef Q_OS_WIN32
@@ -130,6 +527,11 @@ void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const
 #endif
 
     if (zfile == NULL) {
+        if (ufile != NULL) {
+            unzClose(ufile);
+        }
+
+        QFile::remove(tempFile);
         throw (CannotOpenFile(tempFile.toStdString()));
     }
 
@@ -143,161 +545,192 @@ void ExportEPUB::SaveFolderAsEpubToLocation(const QString &fullfolderpath, const
 
     // Write the mimetype. This must be uncompressed and the first entry in the archive.
     if (zipOpenNewFileInZip64(zfile, "mimetype", &fileInfo, NULL, 0, NULL, 0, NULL, Z_NO_COMPRESSION, 0, 0) != ZIP_OK) {
-        zipClose(zfile, NULL);
-        QFile::remove(tempFile);
+        AbortZip(zfile, ufile, tempFile, false);
         throw(CannotStoreFile("mimetype"));
     }
 
     if (zipWriteInFileInZip(zfile, EPUB_MIME_DATA, (unsigned int)strlen(EPUB_MIME_DATA)) != ZIP_OK) {
-        zipCloseFileInZip(zfile);
-        zipClose(zfile, NULL);
-        QFile::remove(tempFile);
+        AbortZip(zfile, ufile, tempFile, true);
         throw(CannotStoreFile("mimetype"));
     }
 
     zipCloseFileInZip(zfile);
-    // Write all the files in our directory path to the archive.
-    QDirIterator it(fullfolderpath, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable | QDir::Hidden, QDirIterator::Subdirectories);
 
-    while (it.hasNext()) {
-        it.next();
-        QString relpath = it.filePath().remove(fullfolderpath);
+    // what went into this epub, for the next save
+    QHash<QString, ArchivedEntry> written;
 
-        while (relpath.startsWith("/")) {
-            relpath = relpath.remove(0, 1);
-        }
+    // Entries are prepared in parallel a batch at a time to bound
+    // memory use and then written in order.
+    int next = 0;
 
-        // Add the file entry to the archive.
-        // We should check the uncompressed file size. If it's over >= 0xffffffff the last parameter (zip64) should be 1.
-        if (zipOpenNewFileInZip4_64(zfile, relpath.toUtf8().constData(), &fileInfo, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 8, 0, 15, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, 0) != ZIP_OK) {
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotStoreFile(relpath.toStdString()));
-        }
+    while (next < entries_to_write.count()) {
+        QList<ZipEntry> batch;
+        qint64 batch_size = 0;
+
+        while (next < entries_to_write.count()) {
+            const ZipEntry &entry = entries_to_write.at(next);
+            qint64 entry_size = entry.size;
+
+            if (IsStreamed(entry.fullfilepath, entry.store, entry.obfuscation_algorithm) ||
+                (entry.has_previous && (entry.size == entry.previous_size) && (entry.mtime == entry.previous_mtime))) {
+                entry_size = 0;
+            }
 
-        // Open the file on disk. We will read this and write what we read into
-        // the archive.
-        QFile dfile(it.filePath());
+            if (!batch.isEmpty() && (batch_size + entry_size > MAX_BATCH_SIZE)) {
+                break;
+            }
 
-        if (!dfile.open(QIODevice::ReadOnly)) {
-            zipCloseFileInZip(zfile);
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotOpenFile(it.fileName().toStdString()));
+            batch.append(entry);
+            batch_size += entry_size;
+            next++;
         }
 
-        // Write the data from the file on disk into the archive.
-        char buff[BUFF_SIZE] = {0};
-        qint64 read = 0;
+        const QList<PreparedEntry> prepared_entries = QtConcurrent::blockingMapped(batch, PrepareEntry);
 
-        while ((read = dfile.read(buff, BUFF_SIZE)) > 0) {
-            if (zipWriteInFileInZip(zfile, buff, read) != ZIP_OK) {
-                dfile.close();
-                zipCloseFileInZip(zfile);
-                zipClose(zfile, NULL);
-                QFile::remove(tempFile);
-                throw(CannotStoreFile(relpath.toStdString()));
+        for (int i = 0; i < batch.count(); ++i) {
+            const ZipEntry &entry = batch.at(i);
+            PreparedEntry prepared = prepared_entries.at(i);
+            QByteArray relpath = entry.bookpath.toUtf8();
+
+            if (prepared.reuse) {
+                CopyResult result = CopyArchivedEntry(ufile, previous.entries.value(entry.bookpath).offset, zfile, relpath, &fileInfo);
+
+                if (result == CopyFailed) {
+                    AbortZip(zfile, ufile, tempFile, false);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
+
+                if (result == CopyNotPossible) {
+                    // The old entry could not be read, compress the file again
+                    ZipEntry fresh = entry;
+                    fresh.has_previous = false;
+                    prepared = PrepareEntry(fresh);
+                }
             }
-        }
 
-        dfile.close();
+            if (!prepared.ok) {
+                AbortZip(zfile, ufile, tempFile, false);
+                throw(CannotStoreFile(entry.bookpath.toStdString()));
+            }
 
-        // There was an error reading the file on disk.
-        if (read < 0) {
-            zipCloseFileInZip(zfile);
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotStoreFile(relpath.toStdString()));
-        }
+            if (!prepared.reuse && IsStreamed(entry.fullfilepath, entry.store, entry.obfuscation_algorithm)) {
+                // Let minizip work out the crc as the file is copied in
+                int zip64 = entry.size >= ZIP64_LIMIT ? 1 : 0;
 
-        if (zipCloseFileInZip(zfile) != ZIP_OK) {
-            zipClose(zfile, NULL);
-            QFile::remove(tempFile);
-            throw(CannotStoreFile(relpath.toStdString()));
-        }
-    }
+                if (zipOpenNewFileInZip4_64(zfile, relpath.constData(), &fileInfo, NULL, 0, NULL, 0, NULL, 0, 0, 0, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, zip64) != ZIP_OK) {
+                    AbortZip(zfile, ufile, tempFile, false);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
 
-    zipClose(zfile, NULL);
-    // Overwrite the contents of the real file with the contents from the temp
-    // file we saved the data do. We do this instead of simply copying the file
-    // because a file copy will lose extended attributes such as labels on OS X.
-    QFile temp_epub(tempFile);
+                QFile dfile(entry.fullfilepath);
 
-    if (!temp_epub.open(QFile::ReadOnly)) {
-        throw(CannotOpenFile(tempFile.toStdString()));
-    }
+                if (!dfile.open(QIODevice::ReadOnly)) {
+                    AbortZip(zfile, ufile, tempFile, true);
+                    throw(CannotOpenFile(entry.fullfilepath.toStdString()));
+                }
 
-    QFile real_epub(fullfilepath);
+                char buff[BUFF_SIZE] = {0};
+                qint64 read = 0;
+                uLong source_crc = crc32(0L, Z_NULL, 0);
 
-    if (!real_epub.open(QFile::WriteOnly | QFile::Truncate)) {
-        temp_epub.close();
-        throw(CannotWriteFile(fullfilepath.toStdString()));
-    }
+                while ((read = dfile.read(buff, BUFF_SIZE)) > 0) {
+                    source_crc = crc32(source_crc, reinterpret_cast<const Bytef *>(buff), read);
 
-    // Copy the contents from the temp file to the real file.
-    char buff[BUFF_SIZE] = {0};
-    qint64 read = 0;
-    qint64 written = 0;
+                    if (zipWriteInFileInZip(zfile, buff, read) != ZIP_OK) {
+                        break;
+                    }
+                }
 
-    while ((read = temp_epub.read(buff, BUFF_SIZE)) > 0) {
-        written = real_epub.write(buff, read);
+                dfile.close();
+
+                // There was an error reading the file on disk or writing the zip.
+                if (read != 0) {
+                    AbortZip(zfile, ufile, tempFile, true);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
+
+                if (zipCloseFileInZip(zfile) != ZIP_OK) {
+                    AbortZip(zfile, ufile, tempFile, false);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
+
+                prepared.source_crc = source_crc;
+            } else if (!prepared.reuse) {
+                // The data is already in its final form, write it raw
+                int method = prepared.deflated ? Z_DEFLATED : 0;
+                int level = prepared.deflated ? 8 : 0;
+                int zip64 = prepared.uncompressed_size >= ZIP64_LIMIT ? 1 : 0;
+
+                if (zipOpenNewFileInZip4_64(zfile, relpath.constData(), &fileInfo, NULL, 0, NULL, 0, NULL, method, level, 1, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY, NULL, 0, 0x0b00, 1<<11, zip64) != ZIP_OK) {
+                    AbortZip(zfile, ufile, tempFile, false);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
+
+                if (!prepared.data.isEmpty() &&
+                    (zipWriteInFileInZip(zfile, prepared.data.constData(), prepared.data.size()) != ZIP_OK)) {
+                    AbortZip(zfile, ufile, tempFile, true);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
+
+                if (zipCloseFileInZipRaw64(zfile, prepared.uncompressed_size, prepared.crc) != ZIP_OK) {
+                    AbortZip(zfile, ufile, tempFile, false);
+                    throw(CannotStoreFile(entry.bookpath.toStdString()));
+                }
+            }
+
+            ArchivedEntry archived;
+            archived.size = entry.size;
+            archived.mtime = entry.mtime;
 
-        if (written != read) {
-            temp_epub.close();
-            real_epub.close();
-            QFile::remove(tempFile);
-            throw(CannotCopyFile(fullfilepath.toStdString()));
+            // A file modified just before the save may be modified again within
+            // the timestamp resolution of the filesystem without its mtime
+            // changing, so its content has to be compared next time
+            if (entry.mtime > timeNow.toMSecsSinceEpoch() - 2000) {
+                archived.mtime = -1;
+            }
+
+            archived.source_crc = prepared.source_crc;
+            archived.obfuscation_algorithm = entry.obfuscation_algorithm;
+            archived.obfuscation_key = entry.obfuscation_key;
+            written.insert(entry.bookpath, archived);
         }
     }
 
-    if (read == -1) {
-        temp_epub.close();
-        real_epub.close();
-        QFile::remove(tempFile);
-        throw(CannotCopyFile(fullfilepath.toStdString()));
+    // The old epub must be closed before it can be replaced
+    if (ufile != NULL) {
+        unzClose(ufile);
     }
 
-    temp_epub.close();
-    real_epub.close();
-    QFile::remove(tempFile);
-}
-
+    if (zipClose(zfile, NULL) != ZIP_OK) {
+        QFile::remove(tempFile);
+        throw(CannotStoreFile(tempFile.toStdString()));
+    }
 
-void ExportEPUB::CreateEncryptionXML(const QString &fullfolderpath)
-{
-    QTemporaryFile file;
+    // QTemporaryFile creates the file readable by the owner only,
+    // give the epub the permissions of the one it replaces
+    if (target_info.exists()) {
+        QFile::setPermissions(tempFile, QFile::permissions(fullfilepath));
+    } else {
+        QFile::setPermissions(tempFile, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser | QFile::WriteUser |
+                                        QFile::ReadGroup | QFile::ReadOther);
+    }
 
-    if (!file.open()) {
-    std::string msg = file.fileName().toStdString() + ": " + file.errorString().toStdString();
-        throw (CannotOpenFile(msg));
+    if (!Utility::AtomicReplaceFile(tempFile, fullfilepath)) {
+        QFile::remove(tempFile);
+        throw(CannotWriteFile(fullfilepath.toStdString()));
     }
 
-    EncryptionXmlWriter enc(m_Book.data(), file);
-    enc.WriteXML();
-    // Write to disk immediately
-    file.flush();
-    QFile::copy(file.fileName(), fullfolderpath + "/" + ENCRYPTION_XML_FILE_NAME);
+    RecordArchive(fullfilepath, mainfolder, written);
 }
 
 
-void ExportEPUB::ObfuscateFonts(const QString &fullfolderpath)
+QByteArray ExportEPUB::CreateEncryptionXML()
 {
-    QString uuid_id = m_Book->GetOPF()->GetUUIDIdentifierValue();
-    QString main_id = m_Book->GetPublicationIdentifier();
-    QList<FontResource *> font_resources = m_Book->GetFolderKeeper()->GetResourceTypeList<FontResource>();
-    foreach(FontResource *font_resource, font_resources) {
-        QString algorithm = font_resource->GetObfuscationAlgorithm();
-
-        if (algorithm.isEmpty()) {
-            continue;
-        }
-
-        QString font_path = fullfolderpath + "/" + font_resource->GetRelativePath();
-
-        if (algorithm == ADOBE_FONT_ALGO_ID) {
-            FontObfuscation::ObfuscateFile(font_path, algorithm, uuid_id);
-        } else {
-            FontObfuscation::ObfuscateFile(font_path, algorithm, main_id);
-        }
-    }
+    QByteArray xml;
+    QBuffer buffer(&xml);
+    buffer.open(QIODevice::WriteOnly);
+    EncryptionXmlWriter enc(m_Book.data(), buffer);
+    enc.WriteXML();
+    buffer.close();
+    return xml;
 }
@@ -24,6 +24,10 @@
 #ifndef EXPORTEPUB_H
 #define EXPORTEPUB_H
 
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
 #include "BookManipulation/FolderKeeper.h"
 #include "BookManipulation/Book.h"
 #include "Exporters/Exporter.h"
@@ -47,22 +51,73 @@ public:
 
 private:
 
-    // Creates the publication from the Book
-    // (creates XHTML, CSS, OPF, NCX files etc.)
-    void virtual CreatePublication(const QString &fullfolderpath);
-
-    // Saves the publication in the specified folder
-    // to the specified file path as an epub;
-    // the second optional parameter specifies the
-    // mimetype to write to the special "mimetype" file
-    void SaveFolderAsEpubToLocation(const QString &fullfolderpath, const QString &fullfilepath);
-
-    // Creates the publication's encryption.xml file,
+    // One file to be written to the epub
+    struct ZipEntry {
+        // path of the entry inside the epub
+        QString bookpath;
+
+        // file to read the content from, empty if
+        // the content is generated and held in data
+        QString fullfilepath;
+        QByteArray data;
+
+        // font obfuscation to apply while writing
+        QString obfuscation_algorithm;
+        QString obfuscation_key;
+
+        // write the content as is, used for formats that are already compressed
+        bool store;
+
+        // size of the content, used to batch the compression work
+        qint64 size;
+
+        // last modified time of the file in msecs since the epoch
+        qint64 mtime;
+
+        // what the file looked like when it was last written to the epub
+        // being replaced, if it was, so its compressed entry can be reused
+        bool has_previous;
+        qint64 previous_size;
+        qint64 previous_mtime;
+        quint32 previous_source_crc;
+
+        ZipEntry() : store(false), size(0), mtime(0), has_previous(false),
+            previous_size(0), previous_mtime(0), previous_source_crc(0) {}
+    };
+
+    // An entry ready to be written. If data is empty for a
+    // stored entry its content is streamed from its file instead.
+    // If reuse is set the entry is unchanged and is copied
+    // still compressed from the epub being replaced.
+    struct PreparedEntry {
+        QByteArray data;
+        bool deflated;
+        bool reuse;
+        quint32 crc;
+
+        // crc of the content before obfuscation, 0 if not yet known
+        quint32 source_crc;
+        qint64 uncompressed_size;
+        bool ok;
+
+        PreparedEntry() : deflated(false), reuse(false), crc(0), source_crc(0), uncompressed_size(0), ok(true) {}
+    };
+
+    // Lists the files of the book folder plus the generated
+    // encryption.xml in the order they are to be zipped
+    QList<ZipEntry> GetZipEntries();
+
+    // Reads, obfuscates and compresses one entry in memory.
+    // Safe to run on a worker thread.
+    static PreparedEntry PrepareEntry(const ZipEntry &entry);
+
+    // Writes the epub to a temporary file next to fullfilepath
+    // and then moves it over fullfilepath in one step
+    void WriteEpubToLocation(const QList<ZipEntry> &entries, const QString &fullfilepath);
+
+    // Creates the publication's encryption.xml file content,
     // if there are any fonts to obfuscate
-    void CreateEncryptionXML(const QString &fullfolderpath);
-
-    // Obfuscates the fonts marked for obfuscation
-    void ObfuscateFonts(const QString &fullfolderpath);
+    QByteArray CreateEncryptionXML();
 
 
     ///////////////////////////////
@@ -79,4 +134,3 @@ private:
 };
 
 #endif // EXPORTEPUB_H
-
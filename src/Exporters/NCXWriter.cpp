@@ -50,10 +50,12 @@ NCXWriter::NCXWriter(const Book *book, QIODevice &device)
 }
 
 
-NCXWriter::NCXWriter(const Book *book, QIODevice &device, TOCModel::TOCEntry toc_root_entry)
+NCXWriter::NCXWriter(const Book *book, QIODevice &device, TOCModel::TOCEntry toc_root_entry,
+                     const QList<TOCModel::TOCEntry> &page_list)
     :
     XMLWriter(book, device),
     m_TOCRootEntry(toc_root_entry),
+    m_PageList(page_list),
     m_version(book->GetConstOPF()->GetEpubVersion()),
     m_ncxresource(book->GetConstNCX())
 
@@ -80,7 +82,9 @@ void NCXWriter::WriteXML()
     m_Writer->writeAttribute("version", "2005-1");
     WriteHead();
     WriteDocTitle();
-    WriteNavMap();
+    int play_order = 1;
+    WriteNavMap(play_order);
+    WritePageList(play_order);
     m_Writer->writeEndElement();
     m_Writer->writeEndDocument();
 }
@@ -97,10 +101,10 @@ void NCXWriter::WriteHead()
     m_Writer->writeAttribute("content", QString::number(GetTOCDepth()));
     m_Writer->writeEmptyElement("meta");
     m_Writer->writeAttribute("name", "dtb:totalPageCount");
-    m_Writer->writeAttribute("content", "0");
+    m_Writer->writeAttribute("content", QString::number(m_PageList.count()));
     m_Writer->writeEmptyElement("meta");
     m_Writer->writeAttribute("name", "dtb:maxPageNumber");
-    m_Writer->writeAttribute("content", "0");
+    m_Writer->writeAttribute("content", QString::number(m_PageList.count()));
     m_Writer->writeEndElement();
 }
 
@@ -122,9 +126,8 @@ void NCXWriter::WriteDocTitle()
 }
 
 
-void NCXWriter::WriteNavMap()
+void NCXWriter::WriteNavMap(int &play_order)
 {
-    int play_order = 1;
     m_Writer->writeStartElement("navMap");
 
     if (!m_TOCRootEntry.children.isEmpty()) {
@@ -138,8 +141,33 @@ void NCXWriter::WriteNavMap()
         // with a NavMap with at least one NavPoint, so we
         // write a dummy one.
         WriteFallbackNavPoint();
+        play_order++;
+    }
+
+    m_Writer->writeEndElement();
+}
+
+
+void NCXWriter::WritePageList(int &play_order)
+{
+    if (m_PageList.isEmpty()) {
+        return;
     }
 
+    // the ids carry on from the navPoints
+    m_Writer->writeStartElement("pageList");
+    foreach(const TOCModel::TOCEntry &page, m_PageList) {
+        m_Writer->writeStartElement("pageTarget");
+        m_Writer->writeAttribute("id", QString("navPoint-%1").arg(play_order++));
+        m_Writer->writeAttribute("type", "normal");
+        m_Writer->writeAttribute("value", page.text.simplified());
+        m_Writer->writeStartElement("navLabel");
+        m_Writer->writeTextElement("text", page.text.simplified());
+        m_Writer->writeEndElement();
+        m_Writer->writeEmptyElement("content");
+        m_Writer->writeAttribute("src", ConvertBookPathToNCXRelative(page.target));
+        m_Writer->writeEndElement();
+    }
     m_Writer->writeEndElement();
 }
 
@@ -248,6 +276,8 @@ void NCXWriter::TOCDepthWalker(const TOCModel::TOCEntry &entry , int &current_de
 
 QString NCXWriter::ConvertBookPathToNCXRelative(const QString & bookpath) 
 {
+    // links outside the book are kept as they are
+    if (bookpath.indexOf(":") != -1) return bookpath;
     QString ncx_bkpath = m_ncxresource->GetRelativePath();
     // split off any fragment added to bookpath destination
     QStringList pieces = bookpath.split('#', QString::KeepEmptyParts);
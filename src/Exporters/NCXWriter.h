@@ -46,7 +46,16 @@ public:
      */
     NCXWriter(const Book *book, QIODevice &device);
 
-    NCXWriter(const Book *book, QIODevice &device, TOCModel::TOCEntry toc_root_entry);
+    /**
+     * Constructor.
+     *
+     * @param book The book for which we're writing the NCX.
+     * @param device The IODevice into which we should write the XML.
+     * @param toc_root_entry The root of the TOC written to the <navMap>.
+     * @param page_list The pages written to the <pageList>, if any.
+     */
+    NCXWriter(const Book *book, QIODevice &device, TOCModel::TOCEntry toc_root_entry,
+              const QList<TOCModel::TOCEntry> &page_list = QList<TOCModel::TOCEntry>());
 
     void WriteXML();
 
@@ -67,7 +76,12 @@ private:
     /**
      * Writes the <navMap> element.
      */
-    void WriteNavMap();
+    void WriteNavMap(int &play_order);
+
+    /**
+     * Writes the <pageList> element if there are pages.
+     */
+    void WritePageList(int &play_order);
 
     /**
      * Writes a fallback <navPoint> for when the book has no headings.
@@ -116,6 +130,8 @@ private:
 
     TOCModel::TOCEntry m_TOCRootEntry;
 
+    QList<TOCModel::TOCEntry> m_PageList;
+
     QString m_version;
     const Resource * m_ncxresource;
 };
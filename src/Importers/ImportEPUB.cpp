@@ -89,6 +89,11 @@ static const QString CONTAINER_XML       = "<?xml version=\"1.0\" encoding=\"UTF
 
 static QCodePage437Codec *cp437 = 0;
 
+static const QStringList HTML_EXTENSIONS = QStringList() << "htm" << "html" << "xhtml";
+
+// The most html we keep in memory from extraction until it is loaded
+static const qint64 MAX_KEPT_HTML_SIZE = 256 * 1024 * 1024;
+
 // Constructor;
 // The parameter is the file to be imported
 ImportEPUB::ImportEPUB(const QString &fullfilepath)
@@ -158,40 +163,36 @@ QSharedPointer<Book> ImportEPUB::GetBook(bool extract_metadata)
     // If we have non-well formed content and they shouldn't be auto fixed we'll pass that on to
     // the universal update function so it knows to skip them. Otherwise we won't include them and
     // let it modify the file.
-    for (int i=0; i<resources.count(); ++i) {
-        if (resources.at(i)->Type() == Resource::HTMLResourceType) {
-            HTMLResource *hresource = qobject_cast<HTMLResource *>(resources.at(i));
-            if (!hresource) {
-                continue;
-            }
-            // Load the content into the HTMLResource so we can perform a well formed check.
-            try {
-                hresource->SetText(HTMLEncodingResolver::ReadHTMLFile(hresource->GetFullPath()));
-            } catch (...) {
-                if (ss.cleanOn() & CLEANON_OPEN) {
-                    non_well_formed << hresource;
-                    continue;
-                }
-            }
-            if (ss.cleanOn() & CLEANON_OPEN) {
-                if (!XhtmlDoc::IsDataWellFormed(hresource->GetText(),hresource->GetEpubVersion())) {
-                    non_well_formed << hresource;
-                } else {
-		    QString txt = hresource->GetText();
-		    // had cases of large files with no line breaks
-		    if (txt.size() > 307200) {
-			int lines = 0;
-			QChar *uc = txt.data();
-			QChar *e = uc + txt.size();
-			for (; uc != e; ++uc) {
-			    if (uc->unicode() == 0x000A) lines++;
-			}
-			if (lines < 5) non_well_formed << hresource;
-		    }
-		}
+    QList<HTMLResource *> html_resources;
+    foreach(Resource *resource, resources) {
+        if (resource->Type() == Resource::HTMLResourceType) {
+            HTMLResource *hresource = qobject_cast<HTMLResource *>(resource);
+            if (hresource) {
+                html_resources << hresource;
             }
         }
     }
+
+    // Decoding and the well formed checks run in parallel,
+    // the text is then handed to the resources in order
+    bool check_well_formed = ss.cleanOn() & CLEANON_OPEN;
+    QList<HTMLLoadResult> load_results = QtConcurrent::blockingMapped(html_resources,
+                                             std::bind(LoadOneHTMLFile, std::placeholders::_1, m_ExtractedHTMLData, check_well_formed));
+    m_ExtractedHTMLData.clear();
+
+    for (int i = 0; i < html_resources.count(); ++i) {
+        HTMLResource *hresource = html_resources.at(i);
+        const HTMLLoadResult &result = load_results.at(i);
+
+        if (result.loaded) {
+            hresource->SetText(result.text);
+        }
+
+        if (check_well_formed && (!result.loaded || result.needs_fix)) {
+            non_well_formed << hresource;
+        }
+    }
+
     if (!non_well_formed.isEmpty()) {
         QApplication::restoreOverrideCursor();
         if (QMessageBox::Yes == QMessageBox::warning(QApplication::activeWindow(),
@@ -404,6 +405,8 @@ void ImportEPUB::ProcessFontFiles(const QList<Resource *> &resources,
 void ImportEPUB::ExtractContainer()
 {
     int res = 0;
+    QList<Utility::ZipExtraction> extractions;
+    qint64 kept_size = 0;
     if (!cp437) {
         cp437 = new QCodePage437Codec();
     }
@@ -496,49 +499,23 @@ void ImportEPUB::ExtractContainer()
 		    }
                 }
 
-                // Open the file entry in the archive for reading.
-                if (unzOpenCurrentFile(zfile) != UNZ_OK) {
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
-                }
-
-                // Open the file on disk to write the entry in the archive to.
-                QFile entry(file_path);
-
-                if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
-                }
+                // The entries are inflated once the whole directory is checked
+                Utility::ZipExtraction extraction;
+                extraction.offset = unzGetOffset64(zfile);
+                extraction.filepath = file_path;
 
-                // Buffered reading and writing.
-                char buff[BUFF_SIZE] = {0};
-                int read = 0;
-
-                while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
-                    entry.write(buff, read);
+                if (!cp437_file_name.isEmpty() && cp437_file_name != qfile_name) {
+                    extraction.copypath = m_ExtractedFolderPath + "/" + cp437_file_name;
                 }
 
-                entry.close();
-
-                // Read errors are marked by a negative read amount.
-                if (read < 0) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
+                // Keep the html files in memory for loading and checking
+                if (HTML_EXTENSIONS.contains(qfile_info.suffix().toLower()) &&
+                    (kept_size + (qint64)file_info.uncompressed_size <= MAX_KEPT_HTML_SIZE)) {
+                    extraction.keep_data = true;
+                    kept_size += file_info.uncompressed_size;
                 }
 
-                // The file was read but the CRC did not match.
-                // We don't check the read file size vs the uncompressed file size
-                // because if they're different there should be a CRC error.
-                if (unzCloseCurrentFile(zfile) == UNZ_CRCERROR) {
-                    unzClose(zfile);
-                    throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(qfile_name).toStdString()));
-                }
-                if (!cp437_file_name.isEmpty() && cp437_file_name != qfile_name) {
-                    QString cp437_file_path = m_ExtractedFolderPath + "/" + cp437_file_name;
-                    QFile::copy(file_path, cp437_file_path);
-                }
+                extractions.append(extraction);
             }
         } while ((res = unzGoToNextFile(zfile)) == UNZ_OK);
     }
@@ -549,6 +526,69 @@ void ImportEPUB::ExtractContainer()
     }
 
     unzClose(zfile);
+
+    bool success = Utility::UnZipEntries(m_FullFilePath, extractions);
+
+    foreach(Utility::ZipExtraction extraction, extractions) {
+        QString bookpath = extraction.filepath.mid(m_ExtractedFolderPath.length() + 1);
+
+        if (!extraction.ok) {
+            throw (EPUBLoadParseError(QString(QObject::tr("Cannot extract file: %1")).arg(bookpath).toStdString()));
+        }
+
+        if (extraction.keep_data) {
+            m_ExtractedHTMLData[bookpath] = extraction.data;
+
+            if (!extraction.copypath.isEmpty()) {
+                m_ExtractedHTMLData[extraction.copypath.mid(m_ExtractedFolderPath.length() + 1)] = extraction.data;
+            }
+        }
+    }
+
+    if (!success) {
+        throw (EPUBLoadParseError(QString(QObject::tr("Cannot open EPUB: %1")).arg(QDir::toNativeSeparators(m_FullFilePath)).toStdString()));
+    }
+}
+
+
+ImportEPUB::HTMLLoadResult ImportEPUB::LoadOneHTMLFile(HTMLResource *html_resource,
+                                                       const QHash<QString, QByteArray> &html_data,
+                                                       bool check_well_formed)
+{
+    HTMLLoadResult result;
+
+    try {
+        QString bookpath = html_resource->GetRelativePath();
+
+        if (html_data.contains(bookpath)) {
+            result.text = HTMLEncodingResolver::ReadHTMLData(html_data.value(bookpath));
+        } else {
+            result.text = HTMLEncodingResolver::ReadHTMLFile(html_resource->GetFullPath());
+        }
+
+        result.loaded = true;
+    } catch (...) {
+        return result;
+    }
+
+    if (!check_well_formed) {
+        return result;
+    }
+
+    if (!XhtmlDoc::IsDataWellFormed(result.text, html_resource->GetEpubVersion())) {
+        result.needs_fix = true;
+    } else if (result.text.size() > 307200) {
+        // had cases of large files with no line breaks
+        int lines = 0;
+        const QChar *uc = result.text.constData();
+        const QChar *e = uc + result.text.size();
+        for (; uc != e; ++uc) {
+            if (uc->unicode() == 0x000A) lines++;
+        }
+        if (lines < 5) result.needs_fix = true;
+    }
+
+    return result;
 }
 
 void ImportEPUB::LocateOPF()
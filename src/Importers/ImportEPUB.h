@@ -50,13 +50,40 @@ public:
     virtual QSharedPointer<Book> GetBook(bool extract_metaata=true);
 
 private:
+    // The outcome of loading one html file
+    struct HTMLLoadResult {
+        QString text;
+        bool loaded;
+
+        // the file is not well formed or has
+        // too few lines and should be mended
+        bool needs_fix;
+
+        HTMLLoadResult() : loaded(false), needs_fix(false) {}
+    };
+
     /**
      * Extracts the EPUB file to a temporary folder.
      * The path to the the temp folder with the extracted files
      * is stored in m_ExtractedFolderPath.
+     * The entries are inflated in parallel and the html files
+     * are also kept in memory in m_ExtractedHTMLData.
      */
     void ExtractContainer();
 
+    /**
+     * Decodes the text of one html file and checks it is well formed.
+     * Safe to run on a worker thread.
+     *
+     * @param html_resource The resource to load the text for.
+     * @param html_data The extracted html files keyed on book path,
+     *                  files not in it are read from disk.
+     * @param check_well_formed Whether to check the text.
+     */
+    static HTMLLoadResult LoadOneHTMLFile(HTMLResource *html_resource,
+                                          const QHash<QString, QByteArray> &html_data,
+                                          bool check_well_formed);
+
     /**
      * Locates the OPF file in the extracted folder.
      * The path to the OPF is then stored in m_OPFFilePath.
@@ -173,6 +200,12 @@ private:
      */
     QString m_ExtractedFolderPath;
 
+    /**
+     * The content of the extracted html files keyed on their
+     * path in the epub, until they are loaded into their resources.
+     */
+    QHash<QString, QByteArray> m_ExtractedHTMLData;
+
     /**
      * The full path to the OPF file
      * of the publication.
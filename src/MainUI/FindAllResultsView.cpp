@@ -0,0 +1,174 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QTableWidget>
+
+#include "BookManipulation/Book.h"
+#include "BookManipulation/FolderKeeper.h"
+#include "MainUI/FindAllResultsView.h"
+#include "ResourceObjects/TextResource.h"
+#include "sigil_exception.h"
+
+FindAllResultsView::FindAllResultsView(QWidget *parent)
+    :
+    QDockWidget(tr("Find All Results"), parent),
+    m_ResultTable(new QTableWidget(this))
+{
+    setWidget(m_ResultTable);
+    setAllowedAreas(Qt::BottomDockWidgetArea | Qt::TopDockWidgetArea);
+    SetUpTable();
+    connect(m_ResultTable, SIGNAL(itemDoubleClicked(QTableWidgetItem *)),
+            this,           SLOT(ResultDoubleClicked(QTableWidgetItem *)));
+}
+
+
+void FindAllResultsView::showEvent(QShowEvent *event)
+{
+    QDockWidget::showEvent(event);
+    raise();
+}
+
+
+void FindAllResultsView::LoadResults(const QList<SearchOperations::SearchResult> &results)
+{
+    ClearResults();
+    m_ResultTable->setUpdatesEnabled(false);
+    m_ResultTable->setRowCount(results.count());
+
+    // Resolving the short name once per file keeps this fast for large result sets
+    QString last_bookpath;
+    QString shortname;
+    int rownum = 0;
+    foreach(SearchOperations::SearchResult result, results) {
+        if (result.bookpath != last_bookpath) {
+            last_bookpath = result.bookpath;
+            try {
+                shortname = m_Book->GetFolderKeeper()->GetResourceByBookPath(result.bookpath)->ShortPathName();
+            } catch (ResourceDoesNotExist&) {
+                shortname = result.bookpath;
+            }
+        }
+
+        QTableWidgetItem *item = new QTableWidgetItem(shortname);
+        item->setData(Qt::UserRole+1, result.bookpath);
+        item->setData(Qt::UserRole+2, result.revision);
+        m_ResultTable->setItem(rownum, 0, item);
+
+        item = new QTableWidgetItem(QString::number(result.offset));
+        m_ResultTable->setItem(rownum, 1, item);
+
+        item = new QTableWidgetItem(result.context);
+        m_ResultTable->setItem(rownum, 2, item);
+        rownum++;
+    }
+
+    m_ResultTable->resizeColumnToContents(0);
+    m_ResultTable->resizeColumnToContents(1);
+    m_ResultTable->setUpdatesEnabled(true);
+    show();
+    raise();
+}
+
+
+void FindAllResultsView::ClearResults()
+{
+    m_ResultTable->clearContents();
+    m_ResultTable->setRowCount(0);
+}
+
+
+void FindAllResultsView::SetBook(QSharedPointer<Book> book)
+{
+    m_Book = book;
+    ClearResults();
+}
+
+
+void FindAllResultsView::ResultDoubleClicked(QTableWidgetItem *item)
+{
+    Q_ASSERT(item);
+    int row = item->row();
+    QTableWidgetItem *path_item = m_ResultTable->item(row, 0);
+    QTableWidgetItem *offset_item = m_ResultTable->item(row, 1);
+
+    if (!path_item || !offset_item) {
+        return;
+    }
+
+    QString bookpath = path_item->data(Qt::UserRole+1).toString();
+    int revision = path_item->data(Qt::UserRole+2).toInt();
+    int offset = offset_item->text().toInt();
+
+    try {
+        Resource *resource = m_Book->GetFolderKeeper()->GetResourceByBookPath(bookpath);
+        TextResource *text_resource = qobject_cast<TextResource *>(resource);
+
+        // The file was edited since the search so the offset
+        // may no longer point at the match; just open the file
+        if (text_resource && text_resource->GetTextRevision() != revision) {
+            MarkFileResultsStale(bookpath);
+            offset = -1;
+        }
+
+        emit OpenResourceRequest(resource, -1, offset, QString());
+    } catch (ResourceDoesNotExist&) {
+        return;
+    }
+}
+
+
+void FindAllResultsView::MarkFileResultsStale(const QString &bookpath)
+{
+    QString tooltip = tr("This file has changed since the search. Run Find All again to update the results.");
+
+    for (int row = 0; row < m_ResultTable->rowCount(); row++) {
+        QTableWidgetItem *path_item = m_ResultTable->item(row, 0);
+
+        if (!path_item || path_item->data(Qt::UserRole+1).toString() != bookpath) {
+            continue;
+        }
+
+        for (int col = 0; col < m_ResultTable->columnCount(); col++) {
+            QTableWidgetItem *item = m_ResultTable->item(row, col);
+
+            if (item) {
+                item->setForeground(palette().brush(QPalette::Disabled, QPalette::Text));
+                item->setToolTip(tooltip);
+            }
+        }
+    }
+}
+
+
+void FindAllResultsView::SetUpTable()
+{
+    m_ResultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_ResultTable->setTabKeyNavigation(false);
+    m_ResultTable->setDropIndicatorShown(false);
+    m_ResultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_ResultTable->horizontalHeader()->setStretchLastSection(true);
+    m_ResultTable->verticalHeader()->setVisible(false);
+    m_ResultTable->setColumnCount(3);
+    m_ResultTable->setHorizontalHeaderLabels(
+        QStringList() << tr("File") << tr("Offset") << tr("Match"));
+}
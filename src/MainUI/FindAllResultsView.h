@@ -0,0 +1,127 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef FINDALLRESULTSVIEW_H
+#define FINDALLRESULTSVIEW_H
+
+#include <QtCore/QSharedPointer>
+#include <QtWidgets/QDockWidget>
+
+#include "Misc/SearchOperations.h"
+
+class QTableWidget;
+class QTableWidgetItem;
+
+class Book;
+class Resource;
+
+/**
+ * Represents the pane in which the matches of a Find All are listed.
+ */
+class FindAllResultsView : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param parent The QObject's parent.
+     */
+    FindAllResultsView(QWidget *parent = 0);
+
+    /**
+     * Clears the result table.
+     */
+    void ClearResults();
+
+public slots:
+
+    /**
+     * Displays the given matches, replacing any shown before.
+     */
+    void LoadResults(const QList<SearchOperations::SearchResult> &results);
+
+    /**
+     * Sets the book the results refer to.
+     *
+     * @param book The book being searched.
+     */
+    void SetBook(QSharedPointer<Book> book);
+
+signals:
+
+    /**
+     * Emitted when the user clicks a result and thus wants
+     * a resource to be opened on that match.
+     */
+    void OpenResourceRequest(Resource *resource,
+                             int line_to_scroll_to = -1,
+                             int position_to_scroll_to = -1,
+                             const QString &caret_location_to_scroll_to = QString());
+
+private slots:
+
+    /**
+     * Handles double-clicking on a result in the table.
+     *
+     * @param item The item that was clicked.
+     */
+    void ResultDoubleClicked(QTableWidgetItem *item);
+
+protected:
+    virtual void showEvent(QShowEvent *event);
+
+private:
+
+    /**
+     * Sets up the table widget to our liking.
+     */
+    void SetUpTable();
+
+    /**
+     * Greys out the results of a file whose text changed
+     * since the search, as their offsets are no longer valid.
+     *
+     * @param bookpath The book path of the changed file.
+     */
+    void MarkFileResultsStale(const QString &bookpath);
+
+
+    ///////////////////////////////
+    // PRIVATE MEMBER VARIABLES
+    ///////////////////////////////
+
+    /**
+     * The table that holds all the matches.
+     */
+    QTableWidget *m_ResultTable;
+
+    /**
+     * The book that was searched.
+     */
+    QSharedPointer<Book> m_Book;
+};
+
+#endif // FINDALLRESULTSVIEW_H
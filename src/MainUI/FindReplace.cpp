@@ -320,7 +320,7 @@ int FindReplace::Count()
         // If wrap, all files are counted, otherwise only files before/after
         // the current file are counted, and then added to the count of current file.
         count = CountInFiles();
-        if (!m_OptionWrap) {
+        if (count >= 0 && !m_OptionWrap) {
             Searchable *searchable = GetAvailableSearchable();
             if (searchable) {
                 count += searchable->Count(GetSearchRegex(), GetSearchableDirection(), m_OptionWrap);
@@ -333,6 +333,8 @@ int FindReplace::Count()
     } else if (count > 0) {
         QString message = tr("Matches found: %n", "", count);
         ShowMessage(message);
+    } else {
+        ShowMessage(tr("Search cancelled"));
     }
 
     UpdatePreviousFindStrings();
@@ -340,6 +342,55 @@ int FindReplace::Count()
 }
 
 
+void FindReplace::FindAll()
+{
+    m_MainWindow->GetCurrentContentTab()->SaveTabContent();
+    clearMessage();
+
+    if (!IsValidFindText()) {
+        return;
+    }
+
+    // The scan matches the regex over whole files, it knows
+    // nothing of marked text or the spellchecker
+    if (m_SpellCheck || IsMarkedText()) {
+        ShowMessage(tr("Find All is not available for marked text or misspelled words"));
+        return;
+    }
+
+    SetCodeViewIfNeeded(true);
+    QList<Resource *> resources;
+
+    if (GetLookWhere() == FindReplace::LookWhere_CurrentFile || m_LookWhereCurrentFile) {
+        Resource *current_resource = GetCurrentResource();
+        if (current_resource) {
+            resources.append(current_resource);
+        }
+    } else if (GetLookWhere() == FindReplace::LookWhere_AllHTMLFiles) {
+        resources = m_MainWindow->GetAllHTMLResources();
+    } else {
+        resources = m_MainWindow->GetValidSelectedHTMLResources();
+    }
+
+    if (!m_FindAllResults.Update(GetSearchRegex(), resources)) {
+        ShowMessage(tr("Search cancelled"));
+        return;
+    }
+
+    int count = m_FindAllResults.Count();
+
+    if (count == 0) {
+        CannotFindSearchTerm();
+    } else {
+        QString message = tr("Matches found: %n", "", count);
+        ShowMessage(message);
+    }
+
+    emit ShowFindAllResultsRequest(m_FindAllResults.GetResults());
+    UpdatePreviousFindStrings();
+}
+
+
 bool FindReplace::Replace()
 {
     bool found = false;
@@ -406,7 +457,7 @@ int FindReplace::ReplaceAll()
         // If wrap, all files are replaced, otherwise only files before/after
         // the current file are updated, and then the current file is done.
         count = ReplaceInAllFiles();
-        if (!m_OptionWrap) {
+        if (count >= 0 && !m_OptionWrap) {
             Searchable *searchable = GetAvailableSearchable();
             if (searchable) {
                 count += searchable->ReplaceAll(GetSearchRegex(), ui.cbReplace->lineEdit()->text(), GetSearchableDirection(), m_OptionWrap);
@@ -419,6 +470,8 @@ int FindReplace::ReplaceAll()
     } else if (count > 0) {
         QString message = tr("Replacements made: %n", "", count);
         ShowMessage(message);
+    } else {
+        ShowMessage(tr("Replace cancelled, no replacements made"));
     }
 
     if (count > 0) {
@@ -831,21 +884,39 @@ HTMLResource *FindReplace::GetNextContainingHTMLResource(Searchable::Direction d
         }
     }
 
-    HTMLResource *next_html_resource = starting_html_resource;
+    // Spelling matches depend on the dictionaries as well as the
+    // text so they can not be kept, everything else uses the results of
+    // one scan that only rescans files changed since the last Find.
+    bool use_results = !m_SpellCheck;
+
+    if (use_results && !m_FindAllResults.Update(GetSearchRegex(), resources)) {
+        return NULL;
+    }
+
+    int max_reading_order = resources.count() - 1;
+    int starting_reading_order = qMax(0, resources.indexOf(starting_html_resource));
+    int next_reading_order = starting_reading_order;
     bool passed_starting_html_resource = false;
 
-    while (!passed_starting_html_resource || (next_html_resource != starting_html_resource)) {
-        next_html_resource = GetNextHTMLResource(next_html_resource, direction);
+    while (!passed_starting_html_resource || (next_reading_order != starting_reading_order)) {
+        // We wrap back (if needed)
+        if (direction == Searchable::Direction_Up) {
+            next_reading_order = next_reading_order - 1 >= 0 ? next_reading_order - 1 : max_reading_order;
+        } else {
+            next_reading_order = next_reading_order + 1 <= max_reading_order ? next_reading_order + 1 : 0;
+        }
 
-        if (next_html_resource == starting_html_resource) {
+        if (next_reading_order == starting_reading_order) {
             if (!m_OptionWrap) {
                 return NULL;
             }
             passed_starting_html_resource = true ;
         }
 
+        HTMLResource *next_html_resource = qobject_cast<HTMLResource *>(resources.at(next_reading_order));
+
         if (next_html_resource) {
-            if (ResourceContainsCurrentRegex(next_html_resource)) {
+            if (use_results ? m_FindAllResults.FileHasMatches(next_html_resource) : ResourceContainsCurrentRegex(next_html_resource)) {
                 return next_html_resource;
             }
 
@@ -859,39 +930,6 @@ HTMLResource *FindReplace::GetNextContainingHTMLResource(Searchable::Direction d
 }
 
 
-HTMLResource *FindReplace::GetNextHTMLResource(HTMLResource *current_resource, Searchable::Direction direction)
-{
-    QList <Resource *> resources = GetHTMLFiles();
-    int max_reading_order       = resources.count() - 1;
-    int current_reading_order   = 0;
-    int next_reading_order      = 0;
-    // Find the current resource in the selected/all html entries
-    int i = 0;
-    foreach(Resource * resource, resources) {
-        if (resource->GetRelativePath() == current_resource->GetRelativePath()) {
-            current_reading_order = i;
-            break;
-        }
-
-        i++;
-    }
-
-    // We wrap back (if needed)
-    if (direction == Searchable::Direction_Up) {
-        next_reading_order = current_reading_order - 1 >= 0 ? current_reading_order - 1 : max_reading_order ;
-    } else {
-        next_reading_order = current_reading_order + 1 <= max_reading_order ? current_reading_order + 1 : 0;
-    }
-
-    if (next_reading_order > max_reading_order || next_reading_order < 0) {
-        return NULL;
-    } else {
-        HTMLResource &html_resource = *qobject_cast<HTMLResource *>(resources[ next_reading_order ]);
-        return &html_resource;
-    }
-}
-
-
 Resource *FindReplace::GetCurrentResource()
 {
     return m_MainWindow->GetCurrentContentTab()->GetLoadedResource();
@@ -1242,13 +1280,21 @@ void FindReplace::CountAllSearch(QList<SearchEditorModel::searchEntry *> search_
     SetKeyModifiers();
     m_IsSearchGroupRunning = true;
     int count = 0;
+    bool cancelled = false;
     foreach(SearchEditorModel::searchEntry * search_entry, search_entries) {
         LoadSearch(search_entry);
-        count += Count();
+        int search_count = Count();
+        if (search_count < 0) {
+            cancelled = true;
+            break;
+        }
+        count += search_count;
     }
     m_IsSearchGroupRunning = false;
 
-    if (count == 0) {
+    if (cancelled) {
+        ShowMessage(tr("Search cancelled"));
+    } else if (count == 0) {
         CannotFindSearchTerm();
     } else if (count > 0) {
         QString message = tr("Matches found: %n", "", count);
@@ -1268,13 +1314,22 @@ void FindReplace::ReplaceAllSearch(QList<SearchEditorModel::searchEntry *> searc
     SetKeyModifiers();
     m_IsSearchGroupRunning = true;
     int count = 0;
+    bool cancelled = false;
     foreach(SearchEditorModel::searchEntry * search_entry, search_entries) {
         LoadSearch(search_entry);
-        count += ReplaceAll();
+        int search_count = ReplaceAll();
+        if (search_count < 0) {
+            // replacements made by the earlier searches are kept
+            cancelled = true;
+            break;
+        }
+        count += search_count;
     }
     m_IsSearchGroupRunning = false;
 
-    if (count == 0) {
+    if (cancelled) {
+        ShowMessage(tr("Replace cancelled, replacements made: %n", "", count));
+    } else if (count == 0) {
         ShowMessage(tr("No replacements made"));
     } else {
         QString message = tr("Replacements made: %n", "", count);
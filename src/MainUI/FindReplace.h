@@ -31,6 +31,7 @@
 #include "ui_FindReplace.h"
 #include "BookManipulation/FolderKeeper.h"
 #include "MainUI/MainWindow.h"
+#include "Misc/FindAllResults.h"
 #include "Misc/SearchOperations.h"
 #include "MiscEditors/SearchEditorModel.h"
 #include "ViewEditors/Searchable.h"
@@ -106,6 +107,8 @@ signals:
 
     void ShowMessageRequest(const QString &message);
 
+    void ShowFindAllResultsRequest(const QList<SearchOperations::SearchResult> &results);
+
     /**
      * Emitted when we want to do some operations with the clipboard
      * to paste things, but restoring state afterwards so that the
@@ -139,6 +142,10 @@ private slots:
     // term in the document.
     int Count();
 
+    // Lists every occurrence of the user's term
+    // in the Find All Results pane.
+    void FindAll();
+
     // Uses the find direction to determine if we should replace next
     // or previous.
     bool Replace();
@@ -210,8 +217,6 @@ private:
 
     HTMLResource *GetNextContainingHTMLResource(Searchable::Direction direction);
 
-    HTMLResource *GetNextHTMLResource(HTMLResource *current_resource, Searchable::Direction direction);
-
     Resource *GetCurrentResource();
 
     void SetSearchMode(int search_mode);
@@ -307,6 +312,9 @@ private:
     QString m_LastFindText;
 
     bool m_IsSearchGroupRunning;
+
+    // Matches of the current search, used to step between files
+    FindAllResults m_FindAllResults;
 };
 
 
@@ -90,6 +90,7 @@
 #include "MainUI/PreviewWindow.h"
 #include "MainUI/TableOfContents.h"
 #include "MainUI/ValidationResultsView.h"
+#include "MainUI/FindAllResultsView.h"
 #include "Misc/HTMLSpellCheck.h"
 #include "Misc/HTMLSpellCheckML.h"
 #include "Misc/KeyboardShortcutManager.h"
@@ -142,6 +143,7 @@ static const QString BOOK_BROWSER_NAME            = "bookbrowser";
 static const QString FIND_REPLACE_NAME            = "findreplace";
 static const QString TAB_MANAGER_NAME             = "tabmgr";
 static const QString VALIDATION_RESULTS_VIEW_NAME = "validationresultsname";
+static const QString FIND_ALL_RESULTS_VIEW_NAME = "findallresultsname";
 static const QString TABLE_OF_CONTENTS_NAME       = "tableofcontents";
 static const QString PREVIEW_WINDOW_NAME          = "previewwindow";
 static const QString CLIPS_WINDOW_NAME            = "clipswindow";
@@ -186,6 +188,7 @@ MainWindow::MainWindow(const QString &openfilepath,
     m_FindReplace(new FindReplace(this)),
     m_TableOfContents(NULL),
     m_ValidationResultsView(NULL),
+    m_FindAllResultsView(NULL),
     m_PreviewWindow(NULL),
     m_slZoomSlider(NULL),
     m_lbZoomLabel(NULL),
@@ -270,6 +273,7 @@ MainWindow::~MainWindow()
     if (m_lbZoomLabel) delete m_lbZoomLabel;
     if (m_slZoomSlider) delete m_slZoomSlider;
     if (m_ValidationResultsView) delete m_ValidationResultsView;
+    if (m_FindAllResultsView) delete m_FindAllResultsView;
     if (m_TableOfContents) delete m_TableOfContents;
     if (m_FindReplace) delete m_FindReplace;
     if (m_Clips) delete m_Clips;
@@ -2039,16 +2043,10 @@ void MainWindow::GenerateNCXGuideFromNav()
 
     // find existing nav document if there is one
     HTMLResource * nav_resource = m_Book->GetConstOPF()->GetNavResource();
-    QString navbkpath = "";
-    QString navdata = "";
-    if (nav_resource) {
-        navdata = CleanSource::Mend(nav_resource->GetText(),"3.0");
-        navbkpath = nav_resource->GetRelativePath();
-    }
-
-    if ((!nav_resource) || navdata.isEmpty()) {
+    if (!nav_resource) {
         ShowMessageOnStatusBar(tr("NCX and Guide generation failed."));
         QApplication::restoreOverrideCursor();
+        return;
     }
 
     NCXResource * ncx_resource = m_Book->GetNCX();
@@ -2062,29 +2060,9 @@ void MainWindow::GenerateNCXGuideFromNav()
 	m_Book->GetOPF()->UpdateNCXOnSpine(NCXId);
     }
 
-    QString ncxdir = Utility::startingDir(ncx_resource->GetRelativePath());
-
-    QStringList mvalues = m_Book->GetConstOPF()->GetDCMetadataValues("dc:title");
-    QString doctitle = "UNKNOWN";
-    if (!mvalues.isEmpty()) {
-        doctitle = mvalues.at(0);
-    } 
-    QString mainid = m_Book->GetConstOPF()->GetMainIdentifierValue();
-
-    // Now build the ncx in python in a separate thread since may be an long job
-    PythonRoutines pr;
-    QFuture<QString> future = QtConcurrent::run(&pr, &PythonRoutines::GenerateNcxInPython, navdata, 
-						navbkpath, ncxdir, doctitle, mainid);
-    future.waitForFinished();
-    QString ncxdata = future.result();
-
-    if (ncxdata.isEmpty()) {
-        ShowMessageOnStatusBar(tr("NCX and Guide generation failed."));
-        QApplication::restoreOverrideCursor();
-        return;
-    }
-
-    ncx_resource->SetText(ncxdata);
+    // build the ncx directly from the nav's toc and page-list
+    NavProcessor navproc(nav_resource);
+    ncx_resource->GenerateNCXFromTOCEntries(m_Book.data(), navproc.GetRootTOCEntry(), navproc.GetPageListTOCEntries());
     ncx_resource->SaveToDisk();
 
     // now create the opf guide from the nav
@@ -2092,7 +2070,6 @@ void MainWindow::GenerateNCXGuideFromNav()
     m_Book->GetOPF()->ClearSemanticCodesInGuide();
 
     // collect all of the current nav landmark codes
-    NavProcessor navproc(nav_resource);
     QHash<QString, QString> nav_landmark_codes = navproc.GetLandmarkCodeForPaths();
 
     // Walk through all html resources and if they have a landmark code
@@ -3731,6 +3708,7 @@ void MainWindow::SetStateActionsCodeView()
     ui.actionReplacePrevious->setEnabled(true);
     ui.actionReplaceAll->setEnabled(true);
     ui.actionCount->setEnabled(true);
+    ui.actionFindAll->setEnabled(true);
     ui.actionMarkSelection->setEnabled(true);
     ui.menuSearchCurrentFile->setEnabled(true);
     ui.actionFindNextInFile->setEnabled(true);
@@ -3815,6 +3793,7 @@ void MainWindow::SetStateActionsRawView()
     ui.actionReplacePrevious->setEnabled(true);
     ui.actionReplaceAll->setEnabled(true);
     ui.actionCount->setEnabled(true);
+    ui.actionFindAll->setEnabled(true);
     ui.actionMarkSelection->setEnabled(true);
     ui.menuSearchCurrentFile->setEnabled(true);
     ui.actionFindNextInFile->setEnabled(true);
@@ -3882,6 +3861,7 @@ void MainWindow::SetStateActionsStaticView()
     ui.actionReplacePrevious->setEnabled(false);
     ui.actionReplaceAll->setEnabled(false);
     ui.actionCount->setEnabled(false);
+    ui.actionFindAll->setEnabled(false);
     ui.actionMarkSelection->setEnabled(false);
     ui.menuSearchCurrentFile->setEnabled(false);
     ui.actionFindNextInFile->setEnabled(false);
@@ -4462,6 +4442,7 @@ void MainWindow::SetNewBook(QSharedPointer<Book> new_book)
     m_BookBrowser->SetBook(m_Book);
     m_TableOfContents->SetBook(m_Book);
     m_ValidationResultsView->SetBook(m_Book);
+    m_FindAllResultsView->SetBook(m_Book);
     m_IndexEditor->SetBook(m_Book);
     m_ClipEditor->SetBook(m_Book);
     m_SpellcheckEditor->SetBook(m_Book);
@@ -5193,6 +5174,11 @@ void MainWindow::ExtendUI()
     // then it will be open when he opens Sigil the next time.
     // Basically, restoreGeometry() in ReadSettings() overrules this command.
     m_ValidationResultsView->hide();
+    m_FindAllResultsView = new FindAllResultsView(this);
+    m_FindAllResultsView->setObjectName(FIND_ALL_RESULTS_VIEW_NAME);
+    addDockWidget(Qt::BottomDockWidgetArea, m_FindAllResultsView);
+    tabifyDockWidget(m_ValidationResultsView, m_FindAllResultsView);
+    m_FindAllResultsView->hide();
 
     m_PreviewWindow = new PreviewWindow(this);
     m_PreviewWindow->setObjectName(PREVIEW_WINDOW_NAME);
@@ -5217,6 +5203,7 @@ void MainWindow::ExtendUI()
     m_TableOfContents->toggleViewAction()->setShortcut(QKeySequence(Qt::ALT + Qt::Key_F3));
     ui.menuView->addAction(m_ValidationResultsView->toggleViewAction());
     m_ValidationResultsView->toggleViewAction()->setShortcut(QKeySequence(Qt::ALT + Qt::Key_F2));
+    ui.menuView->addAction(m_FindAllResultsView->toggleViewAction());
 
     // Create the view menu to hide and show toolbars.
     ui.menuToolbars->addAction(ui.toolBarNewActions->toggleViewAction());
@@ -5327,6 +5314,7 @@ void MainWindow::ExtendUI()
     sm->registerAction(this, ui.actionReplacePrevious, "MainWindow.ReplacePrevious");
     sm->registerAction(this, ui.actionReplaceAll, "MainWindow.ReplaceAll");
     sm->registerAction(this, ui.actionCount, "MainWindow.Count");
+    sm->registerAction(this, ui.actionFindAll, "MainWindow.FindAll");
     sm->registerAction(this, ui.actionMarkSelection, "MainWindow.MarkSelection");
     sm->registerAction(this, ui.actionFindNextInFile, "MainWindow.FindNextInFile");
     sm->registerAction(this, ui.actionReplaceNextInFile, "MainWindow.ReplaceNextInFile");
@@ -5664,6 +5652,7 @@ void MainWindow::ConnectSignalsToSlots()
     connect(ui.actionReplacePrevious,  SIGNAL(triggered()), m_FindReplace, SLOT(ReplacePrevious()));
     connect(ui.actionReplaceAll,       SIGNAL(triggered()), m_FindReplace, SLOT(ReplaceAll()));
     connect(ui.actionCount,            SIGNAL(triggered()), m_FindReplace, SLOT(Count()));
+    connect(ui.actionFindAll,          SIGNAL(triggered()), m_FindReplace, SLOT(FindAll()));
     connect(ui.actionFindNextInFile,   SIGNAL(triggered()), m_FindReplace, SLOT(FindNextInFile()));
     connect(ui.actionReplaceNextInFile, SIGNAL(triggered()), m_FindReplace, SLOT(ReplaceNextInFile()));
     connect(ui.actionReplaceAllInFile, SIGNAL(triggered()), m_FindReplace, SLOT(ReplaceAllInFile()));
@@ -5764,6 +5753,10 @@ void MainWindow::ConnectSignalsToSlots()
             this,     SLOT(OpenResource(Resource *, int, int, const QString &, const QUrl &)));
     connect(m_ValidationResultsView, SIGNAL(OpenResourceRequest(Resource *, int, int, const QString &)),
             this,     SLOT(OpenResource(Resource *, int, int, const QString &)));
+    connect(m_FindAllResultsView, SIGNAL(OpenResourceRequest(Resource *, int, int, const QString &)),
+            this,     SLOT(OpenResource(Resource *, int, int, const QString &)));
+    connect(m_FindReplace, SIGNAL(ShowFindAllResultsRequest(const QList<SearchOperations::SearchResult> &)),
+            m_FindAllResultsView, SLOT(LoadResults(const QList<SearchOperations::SearchResult> &)));
     connect(m_TabManager, SIGNAL(OpenUrlRequest(const QUrl &)),
             this, SLOT(OpenUrl(const QUrl &)));
     connect(m_TabManager, SIGNAL(OldTabRequest(QString, HTMLResource *)),
@@ -63,6 +63,7 @@ class TabManager;
 class BookBrowser;
 class TableOfContents;
 class ValidationResultsView;
+class FindAllResultsView;
 class PreviewWindow;
 class SearchEditor;
 class ClipEditor;
@@ -916,6 +917,11 @@ private:
      */
     ValidationResultsView *m_ValidationResultsView;
 
+    /**
+     * The Find All results pane.
+     */
+    FindAllResultsView *m_FindAllResultsView;
+
     PreviewWindow *m_PreviewWindow;
 
     /**
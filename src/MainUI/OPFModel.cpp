@@ -22,6 +22,8 @@
 
 #include <limits>
 
+#include <QtCore/QSet>
+#include <QtCore/QThread>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QFileIconProvider>
 #include <QMessageBox>
@@ -30,6 +32,7 @@
 #include "BookManipulation/FolderKeeper.h"
 #include "MainUI/OPFModel.h"
 #include "MainUI/OPFModelItem.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
 #include "ResourceObjects/Resource.h"
@@ -50,6 +53,7 @@ OPFModel::OPFModel(QObject *parent)
     QStandardItemModel(parent),
     m_RefreshInProgress(false),
     m_Book(NULL),
+    m_ToolTipDataStale(true),
     m_TextFolderItem(new QStandardItem("Text")),
     m_StylesFolderItem(new QStandardItem("Styles")),
     m_ImagesFolderItem(new QStandardItem("Images")),
@@ -86,18 +90,95 @@ OPFModel::OPFModel(QObject *parent)
 
 void OPFModel::SetBook(QSharedPointer<Book> book)
 {
+    if (m_Book) {
+        disconnect(m_Book->GetFolderKeeper(), 0, this, 0);
+    }
+
     m_Book = book;
     connect(this, SIGNAL(BookContentModified()), m_Book.data(), SLOT(SetModified()));
+    connect(m_Book->GetFolderKeeper(), SIGNAL(ResourceAdded(const Resource *)),
+            this, SLOT(ResourceAddedHandler(const Resource *)), Qt::DirectConnection);
+    connect(m_Book->GetFolderKeeper(), SIGNAL(ResourceRemoved(const Resource *)),
+            this, SLOT(ResourceRemovedHandler(const Resource *)), Qt::DirectConnection);
+    m_RefreshInProgress = true;
+    ClearModel();
+    m_RefreshInProgress = false;
     Refresh();
 }
 
 
 void OPFModel::Refresh()
 {
+    Q_ASSERT(m_Book);
     m_RefreshInProgress = true;
-    InitializeModel();
-    SortFilesByFilenames();
-    SortHTMLFilesByReadingOrder();
+    m_ToolTipDataStale = true;
+    FolderKeeper *folder_keeper = m_Book->GetFolderKeeper();
+    bool show_full_path = SettingsSnapshot::current()->showFullPathOn;
+    QList<Resource *> resources = folder_keeper->GetResourceList();
+    QHash <Resource *, int> reading_order_all = m_Book->GetOPF()->GetReadingOrderAll(resources);
+
+    // Drop the items of resources no longer in the book and
+    // index the rest. Item pointers are not kept between
+    // refreshes since a drag and drop replaces the items moved.
+    QList<QStandardItem *> folders;
+    folders << invisibleRootItem() << m_TextFolderItem << m_StylesFolderItem << m_ImagesFolderItem
+            << m_FontsFolderItem << m_AudioFolderItem << m_VideoFolderItem << m_MiscFolderItem;
+    QHash<QString, QStandardItem *> items;
+    foreach(QStandardItem *folder, folders) {
+        for (int i = folder->rowCount() - 1; i >= 0; --i) {
+            const QString &identifier = folder->child(i)->data().toString();
+
+            if (identifier.isEmpty()) {
+                continue;
+            }
+
+            if (folder_keeper->GetResourceByIdentifier(identifier)) {
+                items[identifier] = folder->child(i);
+            } else {
+                folder->removeRow(i);
+            }
+        }
+    }
+
+    QSet<QStandardItem *> unsorted_folders;
+    bool reading_order_changed = false;
+    foreach(Resource * resource, resources) {
+        QStandardItem *folder = GetFolderItem(resource->Type());
+        QStandardItem *item = items.value(resource->GetIdentifier());
+
+        if (!item) {
+            item = CreateItem(resource, show_full_path);
+            folder->appendRow(item);
+            unsorted_folders.insert(folder);
+        } else if (UpdateItemName(item, resource, show_full_path)) {
+            unsorted_folders.insert(folder);
+        }
+
+        if (resource->Type() == Resource::HTMLResourceType) {
+            int reading_order = reading_order_all.value(resource, NO_READING_ORDER);
+
+            if (item->data(READING_ORDER_ROLE).toInt() != reading_order) {
+                item->setData(reading_order, READING_ORDER_ROLE);
+                reading_order_changed = true;
+            }
+        }
+    }
+
+    // The OPF and NCX keep their place after the folders
+    unsorted_folders.remove(invisibleRootItem());
+    foreach(QStandardItem *folder, unsorted_folders) {
+        folder->sortChildren(0);
+    }
+
+    if (reading_order_changed || unsorted_folders.contains(m_TextFolderItem)) {
+        // sorting is stable, so files outside the spine stay in filename order
+        if (!unsorted_folders.contains(m_TextFolderItem)) {
+            m_TextFolderItem->sortChildren(0);
+        }
+
+        SortHTMLFilesByReadingOrder();
+    }
+
     m_RefreshInProgress = false;
 }
 
@@ -278,6 +359,29 @@ Qt::DropActions OPFModel::supportedDropActions() const
 }
 
 
+QVariant OPFModel::data(const QModelIndex &index, int role) const
+{
+    if (role == Qt::ToolTipRole && m_Book) {
+        QStandardItem *item = itemFromIndex(index);
+
+        if (item) {
+            const QString &identifier = item->data().toString();
+            Resource *resource = NULL;
+
+            if (!identifier.isEmpty()) {
+                resource = m_Book->GetFolderKeeper()->GetResourceByIdentifier(identifier);
+            }
+
+            if (resource) {
+                return GetToolTip(resource);
+            }
+        }
+    }
+
+    return QStandardItemModel::data(index, role);
+}
+
+
 //   This function initiates HTML reading order updating when the user
 // moves the HTML files in the Book Browser.
 //   You would expect the use of QAbstractItemModel::rowsMoved, but that
@@ -301,6 +405,12 @@ void OPFModel::RowsRemovedHandler(const QModelIndex &parent, int start, int end)
 void OPFModel::ItemChangedHandler(QStandardItem *item)
 {
     Q_ASSERT(item);
+
+    // names and reading orders set while refreshing are not renames
+    if (m_RefreshInProgress) {
+        return;
+    }
+
     const QString &identifier = item->data().toString();
 
     if (!identifier.isEmpty()) {
@@ -331,6 +441,59 @@ void OPFModel::ItemChangedHandler(QStandardItem *item)
 }
 
 
+void OPFModel::ResourceAddedHandler(const Resource *resource)
+{
+    // Resources added from worker threads while importing
+    // are picked up by the refresh that follows the import.
+    if (QThread::currentThread() != thread()) {
+        return;
+    }
+
+    QStandardItem *folder = GetFolderItem(resource->Type());
+
+    if (GetItemRow(folder, resource->GetIdentifier()) != -1) {
+        return;
+    }
+
+    m_RefreshInProgress = true;
+    m_ToolTipDataStale = true;
+    QStandardItem *item = CreateItem(resource, SettingsSnapshot::current()->showFullPathOn);
+
+    if (folder == m_TextFolderItem) {
+        // new HTML files are added to the end of the spine
+        item->setData(NO_READING_ORDER, READING_ORDER_ROLE);
+        folder->appendRow(item);
+    } else if (folder == invisibleRootItem()) {
+        folder->appendRow(item);
+    } else {
+        InsertItemSorted(folder, item);
+    }
+
+    m_RefreshInProgress = false;
+}
+
+
+void OPFModel::ResourceRemovedHandler(const Resource *resource)
+{
+    if (QThread::currentThread() != thread()) {
+        return;
+    }
+
+    QStandardItem *folder = GetFolderItem(resource->Type());
+    int row = GetItemRow(folder, resource->GetIdentifier());
+
+    if (row == -1) {
+        return;
+    }
+
+    // the OPF has already dropped the file from the spine
+    m_RefreshInProgress = true;
+    m_ToolTipDataStale = true;
+    folder->removeRow(row);
+    m_RefreshInProgress = false;
+}
+
+
 bool OPFModel:: RenameResource(Resource *resource, const QString &new_filename)
 {
     QList<Resource *> resources;
@@ -346,6 +509,12 @@ bool OPFModel:: RenameResourceList(const QList<Resource *> &resources, const QSt
     QStringList not_renamed;
     QHash<QString, QString> update;
     SettingsStore ss;
+    FolderKeeper *folder_keeper = m_Book->GetFolderKeeper();
+    QSet<QString> folded_bookpaths;
+    foreach(QString bookpath, folder_keeper->GetAllBookPaths()) {
+        folded_bookpaths.insert(bookpath.toCaseFolded());
+    }
+    folder_keeper->SuspendPathUpdates();
     int i = 0;
     foreach(Resource * resource, resources) {
         QString old_bookpath = resource->GetRelativePath();
@@ -366,7 +535,7 @@ bool OPFModel:: RenameResourceList(const QList<Resource *> &resources, const QSt
             continue;
         }
 
-        if (!FilenameIsValid(old_bookpath, new_filename_with_extension)) {
+        if (!FilenameIsValid(old_bookpath, new_filename_with_extension, folded_bookpaths)) {
 	    if (ss.showFullPathOn()) {
 	        not_renamed.append(resource->GetRelativePath());
 	    } else {
@@ -400,11 +569,16 @@ bool OPFModel:: RenameResourceList(const QList<Resource *> &resources, const QSt
             continue;
         }
 
+        folded_bookpaths.remove(old_bookpath.toCaseFolded());
+        folded_bookpaths.insert(resource->GetRelativePath().toCaseFolded());
         update[ old_bookpath ] = resource->GetRelativePath();
     }
 
+    folder_keeper->ResumePathUpdates();
+
     if (update.count() > 0) {
-        UniversalUpdates::PerformUniversalUpdates(true, m_Book->GetFolderKeeper()->GetResourceList(), update);
+        UniversalUpdates::PerformUniversalUpdates(true,
+            UniversalUpdates::ResourcesAffectedByUpdates(folder_keeper->GetResourceList(), update), update);
         emit BookContentModified();
     }
 
@@ -423,6 +597,9 @@ bool OPFModel::MoveResourceList(const QList<Resource *> &resources, const QStrin
     QApplication::setOverrideCursor(Qt::WaitCursor);
     QStringList not_moved;
     QHash<QString, QString> update;
+    FolderKeeper *folder_keeper = m_Book->GetFolderKeeper();
+    QSet<QString> bookpaths = folder_keeper->GetAllBookPaths().toSet();
+    folder_keeper->SuspendPathUpdates();
     int i = 0;
     foreach(Resource * resource, resources) {
         const QString &oldbookpath = resource->GetRelativePath();
@@ -432,7 +609,7 @@ bool OPFModel::MoveResourceList(const QList<Resource *> &resources, const QStrin
         // do not move files out of META-INF
 	if (oldbookpath.startsWith("META-INF/")) continue;
 
-        if (!BookPathIsValid(oldbookpath, newbookpath)) {
+        if (!BookPathIsValid(oldbookpath, newbookpath, bookpaths)) {
 	    // qDebug() << "OPFModel: invalid bookpath " << oldbookpath, newbookpath;
             not_moved.append(oldbookpath);
             continue;
@@ -461,11 +638,16 @@ bool OPFModel::MoveResourceList(const QList<Resource *> &resources, const QStrin
         }
 
 	resource->SetCurrentBookRelPath(oldbookpath);
+        bookpaths.remove(oldbookpath);
+        bookpaths.insert(resource->GetRelativePath());
         update[ oldbookpath ] = resource->GetRelativePath();
     }
 
+    folder_keeper->ResumePathUpdates();
+
     if (update.count() > 0) {
-        UniversalUpdates::PerformUniversalUpdates(true, m_Book->GetFolderKeeper()->GetResourceList(), update);
+        UniversalUpdates::PerformUniversalUpdates(true,
+            UniversalUpdates::ResourcesAffectedByUpdates(folder_keeper->GetResourceList(), update), update);
         emit BookContentModified();
     }
 
@@ -479,96 +661,139 @@ bool OPFModel::MoveResourceList(const QList<Resource *> &resources, const QStrin
     return false;
 }
 
-void OPFModel::InitializeModel()
+QStandardItem *OPFModel::GetFolderItem(Resource::ResourceType resource_type)
 {
-    Q_ASSERT(m_Book);
-    ClearModel();
-    QList<Resource *> resources = m_Book->GetFolderKeeper()->GetResourceList();
-    QHash <Resource *, int> reading_order_all = m_Book->GetOPF()->GetReadingOrderAll(resources);
-    QString version = m_Book->GetConstOPF()->GetEpubVersion();
-    QHash <QString, QString> semantic_type_all;
-    QHash <QString, QString> manifest_properties_all;
-    SettingsStore ss;
-    if (version.startsWith('3')) {
-        NavProcessor navproc(m_Book->GetConstOPF()->GetNavResource());
-        semantic_type_all = navproc.GetLandmarkNameForPaths();
-        manifest_properties_all = m_Book->GetOPF()->GetManifestPropertiesForPaths();
-    } else { 
-        semantic_type_all = m_Book->GetOPF()->GetGuideSemanticNameForPaths();
+    if (resource_type == Resource::HTMLResourceType) {
+        return m_TextFolderItem;
+    } else if (resource_type == Resource::CSSResourceType) {
+        return m_StylesFolderItem;
+    } else if (resource_type == Resource::ImageResourceType || resource_type == Resource::SVGResourceType) {
+        return m_ImagesFolderItem;
+    } else if (resource_type == Resource::FontResourceType) {
+        return m_FontsFolderItem;
+    } else if (resource_type == Resource::AudioResourceType) {
+        return m_AudioFolderItem;
+    } else if (resource_type == Resource::VideoResourceType) {
+        return m_VideoFolderItem;
+    } else if (resource_type == Resource::OPFResourceType || resource_type == Resource::NCXResourceType) {
+        return invisibleRootItem();
     }
 
-    foreach(Resource * resource, resources) {
-        AlphanumericItem * item;
-        if (ss.showFullPathOn()) {
-            item = new AlphanumericItem(resource->Icon(), resource->GetRelativePath());
-        } else {
-            item = new AlphanumericItem(resource->Icon(), resource->ShortPathName());
-	}
-        item->setDropEnabled(false);
-        item->setData(resource->GetIdentifier());
-        QString tooltip = resource->GetRelativePath();
-        QString path = resource->GetRelativePath();
-	if (resource->Type() == Resource::FontResourceType) {
-	    FontResource* font_res = qobject_cast<FontResource *>(resource);
-	    if (font_res) {
-	        tooltip = tooltip + " (" + font_res->GetDescription() + ")";
-	    }
-	}
+    return m_MiscFolderItem;
+}
 
-        if (semantic_type_all.contains(path)) {
-            tooltip += " (" + semantic_type_all[path] + ")";
+
+int OPFModel::GetItemRow(const QStandardItem *folder, const QString &identifier) const
+{
+    for (int i = 0; i < folder->rowCount(); ++i) {
+        if (folder->child(i)->data().toString() == identifier) {
+            return i;
         }
-        if (manifest_properties_all.contains(path)) {
-            tooltip += " [" + manifest_properties_all[path] + "]";
+    }
+
+    return -1;
+}
+
+
+QStandardItem *OPFModel::CreateItem(const Resource *resource, bool show_full_path)
+{
+    AlphanumericItem *item = new AlphanumericItem(resource->Icon(), QString());
+    item->setDropEnabled(false);
+    item->setData(resource->GetIdentifier());
+    UpdateItemName(item, resource, show_full_path);
+
+    // only HTML files can be reordered by dragging
+    if (resource->Type() != Resource::HTMLResourceType) {
+        item->setDragEnabled(false);
+    }
+
+    return item;
+}
+
+
+bool OPFModel::UpdateItemName(QStandardItem *item, const Resource *resource, bool show_full_path)
+{
+    QString name = show_full_path ? resource->GetRelativePath() : resource->ShortPathName();
+
+    if (item->text() == name) {
+        return false;
+    }
+
+    item->setText(name);
+
+    if (resource->Type() == Resource::HTMLResourceType) {
+        // Remove the extension for alphanumeric sorting
+        item->setData(name.left(name.lastIndexOf('.')), ALPHANUMERIC_ORDER_ROLE);
+    }
+
+    return true;
+}
+
+
+void OPFModel::InsertItemSorted(QStandardItem *folder, QStandardItem *item)
+{
+    // same order as sortChildren on the default sort role
+    int low = 0;
+    int high = folder->rowCount();
+
+    while (low < high) {
+        int mid = (low + high) / 2;
+
+        if (item->text().compare(folder->child(mid)->text()) < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
         }
-        item->setToolTip(tooltip);
+    }
 
-        if (resource->Type() == Resource::HTMLResourceType) {
-            int reading_order = -1;
-            if (reading_order_all.contains(resource)) {
-                reading_order = reading_order_all[resource];
-            } else {
-                reading_order = NO_READING_ORDER;
-            }
+    folder->insertRow(low, item);
+}
 
-            item->setData(reading_order, READING_ORDER_ROLE);
-            // Remove the extension for alphanumeric sorting
-	    QString name;
-            if (ss.showFullPathOn()) {
-                name = resource->GetRelativePath().left(resource->GetRelativePath().lastIndexOf('.'));
-	    } else {
-                name = resource->ShortPathName().left(resource->ShortPathName().lastIndexOf('.'));
-	    }
-            item->setData(name, ALPHANUMERIC_ORDER_ROLE);
-            m_TextFolderItem->appendRow(item);
-        } else if (resource->Type() == Resource::CSSResourceType) {
-            item->setDragEnabled(false);
-            m_StylesFolderItem->appendRow(item);
-        } else if (resource->Type() == Resource::ImageResourceType ||
-                   resource->Type() == Resource::SVGResourceType
-                  ) {
-            item->setDragEnabled(false);
-            m_ImagesFolderItem->appendRow(item);
-        } else if (resource->Type() == Resource::FontResourceType) {
-            item->setDragEnabled(false);
-            m_FontsFolderItem->appendRow(item);
-        } else if (resource->Type() == Resource::AudioResourceType) {
-            item->setDragEnabled(false);
-            m_AudioFolderItem->appendRow(item);
-        } else if (resource->Type() == Resource::VideoResourceType) {
-            item->setDragEnabled(false);
-            m_VideoFolderItem->appendRow(item);
-        } else if (resource->Type() == Resource::OPFResourceType ||
-                   resource->Type() == Resource::NCXResourceType) {
-            item->setEditable(true);
-            item->setDragEnabled(false);
-	    item->setToolTip(resource->GetRelativePath());
-            appendRow(item);
+
+QString OPFModel::GetToolTip(const Resource *resource) const
+{
+    QString path = resource->GetRelativePath();
+
+    if (resource->Type() == Resource::OPFResourceType ||
+        resource->Type() == Resource::NCXResourceType) {
+        return path;
+    }
+
+    if (m_ToolTipDataStale) {
+        m_SemanticTypes.clear();
+        m_ManifestProperties.clear();
+        QString version = m_Book->GetConstOPF()->GetEpubVersion();
+
+        if (version.startsWith('3')) {
+            NavProcessor navproc(m_Book->GetConstOPF()->GetNavResource());
+            m_SemanticTypes = navproc.GetLandmarkNameForPaths();
+            m_ManifestProperties = m_Book->GetOPF()->GetManifestPropertiesForPaths();
         } else {
-            item->setDragEnabled(false);
-            m_MiscFolderItem->appendRow(item);
+            m_SemanticTypes = m_Book->GetOPF()->GetGuideSemanticNameForPaths();
+        }
+
+        m_ToolTipDataStale = false;
+    }
+
+    QString tooltip = path;
+
+    if (resource->Type() == Resource::FontResourceType) {
+        const FontResource *font_res = qobject_cast<const FontResource *>(resource);
+
+        if (font_res) {
+            tooltip = tooltip + " (" + font_res->GetDescription() + ")";
         }
     }
+
+    if (m_SemanticTypes.contains(path)) {
+        tooltip += " (" + m_SemanticTypes[path] + ")";
+    }
+
+    if (m_ManifestProperties.contains(path)) {
+        tooltip += " [" + m_ManifestProperties[path] + "]";
+    }
+
+    return tooltip;
 }
 
 
@@ -645,14 +870,6 @@ void OPFModel::ClearModel()
 }
 
 
-void OPFModel::SortFilesByFilenames()
-{
-    for (int i = 0; i < invisibleRootItem()->rowCount(); ++i) {
-        invisibleRootItem()->child(i)->sortChildren(0);
-    }
-}
-
-
 void OPFModel::SortHTMLFilesByReadingOrder()
 {
     int old_sort_role = sortRole();
@@ -705,7 +922,8 @@ void OPFModel::SortHTMLFilesByAlphanumeric(QList <QModelIndex> index_list)
 }
 
 
-bool OPFModel::FilenameIsValid(const QString &old_bookpath, const QString &new_filename)
+bool OPFModel::FilenameIsValid(const QString &old_bookpath, const QString &new_filename,
+                               const QSet<QString> &folded_bookpaths)
 {
     foreach(QChar character, new_filename) {
         if (FORBIDDEN_FILENAME_CHARS.contains(character)) {
@@ -730,8 +948,7 @@ bool OPFModel::FilenameIsValid(const QString &old_bookpath, const QString &new_f
     // even on case insensitive filesystem as many e-readers and devices have
     QString sdir = Utility::startingDir(old_bookpath);
     QString proposed_bookpath = sdir.isEmpty() ? new_filename : sdir + "/" + new_filename;
-    const QStringList existing_bookpaths = m_Book->GetFolderKeeper()->GetAllBookPaths();
-    if (existing_bookpaths.contains(proposed_bookpath, Qt::CaseInsensitive)) {
+    if (folded_bookpaths.contains(proposed_bookpath.toCaseFolded())) {
         Utility::DisplayStdErrorDialog(
 	    tr("The filename \"%1\" is already in use.\n").arg(new_filename));
         return false;
@@ -740,9 +957,9 @@ bool OPFModel::FilenameIsValid(const QString &old_bookpath, const QString &new_f
 }
 
 
-bool OPFModel::BookPathIsValid(const QString &old_bookpath, const QString &new_bookpath)
+bool OPFModel::BookPathIsValid(const QString &old_bookpath, const QString &new_bookpath,
+                               const QSet<QString> &existing_bookpaths)
 {
-    QStringList existing_bookpaths = m_Book->GetFolderKeeper()->GetAllBookPaths();
     if (new_bookpath.isEmpty()) {
         Utility::DisplayStdErrorDialog(
             tr("The book path cannot be empty.")
@@ -24,6 +24,8 @@
 #ifndef OPFMODEL_H
 #define OPFMODEL_H
 
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QtCore/QSharedPointer>
 #include <QtGui/QStandardItemModel>
 
@@ -67,8 +69,9 @@ public:
     void SetBook(QSharedPointer<Book> book);
 
     /**
-     * Forces the recreation of the model
-     * from the information in the stored book.
+     * Brings the model up to date with the stored book.
+     * Items are added, removed, renamed and reordered in place;
+     * only the folders whose contents changed are re-sorted.
      */
     void Refresh();
 
@@ -151,6 +154,18 @@ public:
      */
     virtual Qt::DropActions supportedDropActions() const;
 
+    /**
+     * Returns the data stored under the given role for the item.
+     * Resource tooltips are built here on demand rather than
+     * stored in every item, since the semantic information in
+     * them needs the nav or guide to be parsed.
+     *
+     * @param index The index of the item.
+     * @param role The role of the requested data.
+     * @return The requested data.
+     */
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
     /**
      * Renames the selected resource
      *
@@ -205,25 +220,56 @@ private slots:
      */
     void ItemChangedHandler(QStandardItem *item);
 
+    /**
+     * Handlers for resources added to or removed from the book's
+     * FolderKeeper. They insert or remove the single item affected.
+     *
+     * @param resource The added or removed resource.
+     */
+    void ResourceAddedHandler(const Resource *resource);
+    void ResourceRemovedHandler(const Resource *resource);
+
 
 private:
 
     /**
-     * Initializes an empty model with data. It is filled
-     * using information from the stored book.
+     * Returns the item holding the resources of the given type,
+     * the root item for the OPF and NCX.
      */
-    void InitializeModel();
+    QStandardItem *GetFolderItem(Resource::ResourceType resource_type);
 
     /**
-     * Updates the reading orders of the HTMLResources
-     * with their order in the model.
+     * Returns the row of the resource's item in the folder, or -1.
      */
-    void UpdateHTMLReadingOrders();
+    int GetItemRow(const QStandardItem *folder, const QString &identifier) const;
+
+    /**
+     * Creates the item for a resource.
+     */
+    QStandardItem *CreateItem(const Resource *resource, bool show_full_path);
+
+    /**
+     * Sets the item's text (and HTML sort name) from the resource path.
+     *
+     * @return \c true if the text changed.
+     */
+    bool UpdateItemName(QStandardItem *item, const Resource *resource, bool show_full_path);
+
+    /**
+     * Inserts an item into a folder at its filename sorted position.
+     */
+    void InsertItemSorted(QStandardItem *folder, QStandardItem *item);
 
     /**
-     * Sorts \em all files by their filenames, alphabetically.
+     * Builds the tooltip for a resource.
      */
-    void SortFilesByFilenames();
+    QString GetToolTip(const Resource *resource) const;
+
+    /**
+     * Updates the reading orders of the HTMLResources
+     * with their order in the model.
+     */
+    void UpdateHTMLReadingOrders();
 
     /**
      * Sorts the HTML files by their reading orders.
@@ -247,9 +293,11 @@ private:
      *
      * @param old_bookpath The old bookpath of the file.
      * @param new_filename The requested new filename of the file.
+     * @param folded_bookpaths The case folded bookpaths of all files.
      * @return \c true if the filename is valid.
      */
-    bool FilenameIsValid(const QString &old_bookpath, const QString &new_filename);
+    bool FilenameIsValid(const QString &old_bookpath, const QString &new_filename,
+                         const QSet<QString> &folded_bookpaths);
 
     /**
      * Determines if a bookpath is valid. If it is not,
@@ -258,9 +306,11 @@ private:
      *
      * @param old_bookpath The old bookpath of the file.
      * @param new_bookpath The requested new bookpath of the file.
+     * @param existing_bookpaths The bookpaths of all files.
      * @return \c true if the bookpath is valid.
      */
-    bool BookPathIsValid(const QString &old_bookpath, const QString &new_bookpath);
+    bool BookPathIsValid(const QString &old_bookpath, const QString &new_bookpath,
+                         const QSet<QString> &existing_bookpaths);
 
 
 
@@ -280,6 +330,15 @@ private:
      */
     QSharedPointer<Book> m_Book;
 
+    /**
+     * The semantic names and manifest properties shown in
+     * tooltips, keyed by book path. Read from the book the
+     * first time a tooltip is needed after a refresh.
+     */
+    mutable QHash<QString, QString> m_SemanticTypes;
+    mutable QHash<QString, QString> m_ManifestProperties;
+    mutable bool m_ToolTipDataStale;
+
     QStandardItem *m_TextFolderItem;   /**< The Text folder item. */
     QStandardItem *m_StylesFolderItem; /**< The Styles folder item. */
     QStandardItem *m_ImagesFolderItem; /**< The Images folder item. */
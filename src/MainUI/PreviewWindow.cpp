@@ -41,6 +41,7 @@
 #include "Dialogs/Inspector.h"
 #include "Misc/GumboInterface.h"
 #include "Misc/SleepFunctions.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
 #include "ViewEditors/ViewPreview.h"
@@ -228,8 +229,7 @@ bool PreviewWindow::UpdatePage(QString filename_url, QString text, QList<Element
     DBG foreach(ElementIndex ei, location) qDebug()<< "PV name: " << ei.name << " index: " << ei.index;
 
     //if isDarkMode is set, inject a local style in head
-    SettingsStore settings;
-    if (Utility::IsDarkMode() && settings.previewDark()) {
+    if (Utility::IsDarkMode() && SettingsSnapshot::current()->previewDark) {
         text = Utility::AddDarkCSS(text);
         DBG qDebug() << "Preview injecting dark style: ";
     }
@@ -98,7 +98,14 @@ TOCModel::TOCEntry TOCModel::GetRootTOCEntry()
         NavProcessor navproc(m_Book->GetConstOPF()->GetNavResource());
         return navproc.GetRootTOCEntry();
     }
-    return ParseNCX(GetNCXText());
+    QString ncx_source = GetNCXText();
+    bool well_formed = true;
+    TOCModel::TOCEntry root = ParseNCX(ncx_source, well_formed);
+    if (!well_formed) {
+        // only NCX files the reader rejects need the much slower repair
+        root = ParseNCX(CleanSource::ProcessXML(ncx_source, "application/x-dtbncx+xml"), well_formed);
+    }
+    return root;
 }
 
 
@@ -108,11 +115,11 @@ QString TOCModel::GetNCXText()
     NCXResource *ncx = m_Book->GetNCX();
     if (!ncx) return QString();
     QReadLocker locker(&(ncx->GetLock()));
-    return CleanSource::ProcessXML(ncx->GetText(), "application/x-dtbncx+xml");
+    return ncx->GetText();
 }
 
 
-TOCModel::TOCEntry TOCModel::ParseNCX(const QString &ncx_source)
+TOCModel::TOCEntry TOCModel::ParseNCX(const QString &ncx_source, bool &well_formed)
 {
     QXmlStreamReader ncx(ncx_source);
     bool in_navmap = false;
@@ -140,7 +147,8 @@ TOCModel::TOCEntry TOCModel::ParseNCX(const QString &ncx_source)
         }
     }
 
-    if (ncx.hasError()) {
+    well_formed = !ncx.hasError();
+    if (!well_formed) {
         TOCModel::TOCEntry empty;
         empty.is_root = true;
         return empty;
@@ -159,14 +167,10 @@ TOCModel::TOCEntry TOCModel::ParseNavPoint(QXmlStreamReader &ncx)
 
         if (ncx.isStartElement()) {
             if (ncx.name() == "text") {
-                while (!ncx.isCharacters()) {
-                    ncx.readNext();
-                }
-
-                // The string returned from text() is unescaped
+                // The string returned is unescaped
                 // (that is, XML entities have already been converted to text).
                 // Compress whitespace that pretty-print may add.
-                current.text = ncx.text().toString().simplified();
+                current.text = ncx.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
             } else if (ncx.name() == "content") {
                 QString href = ncx.attributes().value("", "src").toString();
                 current.target = ConvertHREFToBookPath(href);
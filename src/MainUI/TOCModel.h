@@ -146,9 +146,10 @@ private:
      * Parses the NCX source and returns the root TOC entry.
      *
      * @param ncx_source The NCX source code.
-     * @return The root TOCEntry.
+     * @param well_formed Set to \c false if the NCX could not be read.
+     * @return The root TOCEntry, empty if the NCX could not be read.
      */
-    TOCEntry ParseNCX(const QString &ncx_source);
+    TOCEntry ParseNCX(const QString &ncx_source, bool &well_formed);
 
     /**
      * Parses an NCX navPoint element. Calls itself recursively
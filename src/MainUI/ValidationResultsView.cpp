@@ -20,9 +20,8 @@
 **
 *************************************************************************/
 
-#include "Misc/EmbeddedPython.h"
-
 #include <QtCore/QFileInfo>
+#include <QtConcurrent/QtConcurrent>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QHeaderView>
 #include <QtWidgets/QTableWidget>
@@ -32,7 +31,9 @@
 #include "BookManipulation/Book.h"
 #include "BookManipulation/FolderKeeper.h"
 #include "MainUI/ValidationResultsView.h"
+#include "Misc/SanityCheck.h"
 #include "Misc/Utility.h"
+#include "ResourceObjects/HTMLResource.h"
 #include "sigil_exception.h"
 
 #if(0)
@@ -41,8 +42,6 @@ static const QBrush WARNING_BRUSH = QBrush(QColor(255, 255, 230));
 static const QBrush ERROR_BRUSH   = QBrush(QColor(255, 230, 230));
 #endif
 
-const QString ValidationResultsView::SEP = QString(QChar(31));
-
 ValidationResultsView::ValidationResultsView(QWidget *parent)
     :
     QDockWidget(tr("Validation Results"), parent),
@@ -62,29 +61,22 @@ void ValidationResultsView::showEvent(QShowEvent *event)
 }
 
 
-QStringList ValidationResultsView::ValidateFile(QString &apath)
+QList<ValidationResult> ValidationResultsView::ValidateFile(HTMLResource *html_resource)
 {
-    int rv = 0;
-    QString error_traceback;
-    QStringList results;
-
-    QList<QVariant> args;
-    args.append(QVariant(apath));
-
-    EmbeddedPython * epython  = EmbeddedPython::instance();
-
-    QVariant res = epython->runInPython( QString("sanitycheck"),
-                                         QString("perform_sanity_check"),
-                                         args,
-                                         &rv,
-                                         error_traceback);    
-    if (rv != 0) {
-        Utility::DisplayStdWarningDialog(QString("error in sanitycheck perform_sanity_check: ") + QString::number(rv), 
-                                         error_traceback);
-        // an error happened - make no changes
-        return results;
+    QString source;
+    {
+        QReadLocker locker(&html_resource->GetLock());
+        source = html_resource->GetText();
+    }
+    QString bookpath = html_resource->GetRelativePath();
+
+    QList<ValidationResult> results;
+    SanityCheck checker(source);
+    foreach(SanityCheck::Error error, checker.Check()) {
+        QString msg = error.message + ".  near column " + QString::number(error.column);
+        results.append(ValidationResult(ValidationResult::ResType_Error, bookpath, error.line, -1, msg));
     }
-    return res.toStringList();
+    return results;
 }
 
 
@@ -93,37 +85,14 @@ void ValidationResultsView::ValidateCurrentBook()
     ClearResults();
     QList<ValidationResult> results;
     QApplication::setOverrideCursor(Qt::WaitCursor);
-    m_Book->SaveAllResourcesToDisk();
-
-    QList<Resource *> resources = m_Book->GetFolderKeeper()->GetResourceList();
-    foreach (Resource * resource, resources) {
-        if (resource->Type() == Resource::HTMLResourceType) {
-            QString apath = resource->GetFullPath();
-	    QString bookpath = resource->GetRelativePath();
-            QStringList reslst = ValidateFile(apath);
-            if (!reslst.isEmpty()) {
-                foreach (QString res, reslst) {
-                    QStringList details = res.split(SEP);
-                    ValidationResult::ResType vtype;
-                    QString etype = details[0];
-                    if (etype == "info") {
-                        vtype = ValidationResult::ResType_Info;
-                    } else if (etype == "warning") {
-                        vtype = ValidationResult::ResType_Warn;
-                    } else if (etype == "error") {
-                        vtype = ValidationResult::ResType_Error;
-                    } else {
-                        continue;
-                    }
-                    QString filename = details[1];
-                    int lineno = details[2].toInt();
-                    int charoffset = details[3].toInt();
-                    QString msg = details[4];
-                    results.append(ValidationResult(vtype,bookpath,lineno,charoffset,msg));
-                }
-            }
-        }
+
+    // check the current text of every file in parallel, no need to save to disk first
+    QList<HTMLResource *> html_resources = m_Book->GetFolderKeeper()->GetResourceTypeList<HTMLResource>(false);
+    const QList<QList<ValidationResult>> &file_results = QtConcurrent::blockingMapped(html_resources, ValidateFile);
+    foreach(const QList<ValidationResult> &file_result, file_results) {
+        results.append(file_result);
     }
+
     QApplication::restoreOverrideCursor();
     DisplayResults(results);
     show();
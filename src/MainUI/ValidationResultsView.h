@@ -36,6 +36,7 @@ class QTableWidget;
 class QTableWidgetItem;
 
 class Book;
+class HTMLResource;
 
 /**
  * Represents the pane in which all the validation results are displayed.
@@ -58,8 +59,6 @@ public:
      */
     void ValidateCurrentBook();
 
-    QStringList ValidateFile(QString &apath);
-
     void LoadResults(const QList<ValidationResult> &results);
 
     /**
@@ -136,6 +135,11 @@ private:
 
     void SetItemPalette(QTableWidgetItem * item, QBrush &row_brush);
 
+    /**
+     * Runs the xhtml sanity check over the current text of one file.
+     */
+    static QList<ValidationResult> ValidateFile(HTMLResource *html_resource);
+
 
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
@@ -150,8 +154,6 @@ private:
      * The book being validated.
      */
     QSharedPointer<Book> m_Book;
-
-    static const QString SEP;
 };
 
 #endif // VALIDATIONRESULTSVIEW_H
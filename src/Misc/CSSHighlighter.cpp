@@ -20,50 +20,28 @@
 *************************************************************************/
 
 #include "Misc/CSSHighlighter.h"
+#include "Misc/CSSParser.h"
 #include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
 
-// TODO: This code was written by Nokia for Qt Designer, and it's horribly ugly.
-// I've tried to clean it up, but it's hopeless. Write a new CSS parser to replace this.
-
-enum State {
+// What the tokens are part of
+enum Context {
     Selector,
     Property,
-    Value,
-    Pseudo,
-    Pseudo1,
-    Pseudo2,
-    Quote,
-    MaybeComment,
-    Comment,
-    MaybeCommentEnd
+    Value
 };
 
-enum Token {
-    ALNUM,
-    LBRACE,
-    RBRACE,
-    COLON,
-    SEMICOLON,
-    COMMA,
-    QUOTE,
-    SLASH,
-    STAR
-};
-
-// Transitions for the DFA
-static const int transitions[ 10 ][ 9 ] = {
-    { Selector, Property, Selector, Pseudo,  Property, Selector, Quote,   MaybeComment, Selector        }, // Selector
-    { Property, Property, Selector, Value,   Property, Property, Quote,   MaybeComment, Property        }, // Property
-    { Value,    Property, Selector, Value,   Property, Value,    Quote,   MaybeComment, Value           }, // Value
-    { Pseudo1,  Property, Selector, Pseudo2, Selector, Selector, Quote,   MaybeComment, Pseudo          }, // Pseudo
-    { Pseudo1,  Property, Selector, Pseudo,  Selector, Selector, Quote,   MaybeComment, Pseudo1         }, // Pseudo1
-    { Pseudo2,  Property, Selector, Pseudo,  Selector, Selector, Quote,   MaybeComment, Pseudo2         }, // Pseudo2
-    { Quote,    Quote,    Quote,    Quote,   Quote,    Quote,    -1,      Quote,        Quote           }, // Quote
-    { -1,       -1,       -1,       -1,     -1,        -1,       -1,      -1,           Comment         }, // MaybeComment
-    { Comment,  Comment,  Comment,  Comment, Comment,  Comment,  Comment, Comment,      MaybeCommentEnd }, // Comment
-    { Comment,  Comment,  Comment,  Comment, Comment,  Comment,  Comment, -1,           MaybeCommentEnd }  // MaybeCommentEnd
-};
+// The block state holds the tokenizer state in its lowest two bits,
+// the context in the next two, then whether an at-rule prelude is
+// open and whether that at-rule's block holds rules, then how many
+// declaration blocks are open, such as @page and a margin box in it.
+static const int TOKENIZER_STATE_MASK = 0x03;
+static const int CONTEXT_SHIFT = 2;
+static const int CONTEXT_MASK = 0x03;
+static const int IN_AT_RULE = 0x10;
+static const int AT_RULE_HOLDS_RULES = 0x20;
+static const int DECLARATION_DEPTH_SHIFT = 6;
+static const int DECLARATION_DEPTH_MASK = 0x03;
 
 
 CSSHighlighter::CSSHighlighter(QObject *parent)
@@ -79,10 +57,12 @@ CSSHighlighter::CSSHighlighter(QObject *parent)
 
 void CSSHighlighter::highlightBlock(const QString &text)
 {
-    int lastIndex = 0;
-    bool lastWasSlash = false;
     int state = previousBlockState();
-    int save_state = 0;
+    CSSTokenizer::State tokenizer_state = CSSTokenizer::NormalState;
+    int context = Selector;
+    bool in_at_rule = false;
+    bool at_rule_holds_rules = false;
+    int declaration_depth = 0;
 
     if (state == -1) {
         // As long as the text is empty, leave the state undetermined
@@ -91,118 +71,119 @@ void CSSHighlighter::highlightBlock(const QString &text)
             return;
         }
 
-        // The initial state is based on the presence of a ":" and the absence of a "{".
+        // The initial context is based on the presence of a ":" and the absence of a "{".
         // This is because Qt style sheets support both a full stylesheet as well as
         // an inline form with just properties.
-        state = save_state = (text.indexOf(QLatin1Char(':')) > -1 &&
-                              text.indexOf(QLatin1Char('{')) == -1) ? Property : Selector;
+        context = (text.indexOf(QLatin1Char(':')) > -1 &&
+                   text.indexOf(QLatin1Char('{')) == -1) ? Property : Selector;
     } else {
-        save_state = state >> 16;
-        state &= 0x00ff;
+        tokenizer_state = static_cast<CSSTokenizer::State>(state & TOKENIZER_STATE_MASK);
+        context = (state >> CONTEXT_SHIFT) & CONTEXT_MASK;
+        in_at_rule = state & IN_AT_RULE;
+        at_rule_holds_rules = state & AT_RULE_HOLDS_RULES;
+        declaration_depth = (state >> DECLARATION_DEPTH_SHIFT) & DECLARATION_DEPTH_MASK;
     }
 
-    if (state == MaybeCommentEnd) {
-        state = Comment;
-    } else if (state == MaybeComment) {
-        state = save_state;
-    }
+    CSSTokenizer tokenizer(text, 0, -1, 1, tokenizer_state);
 
-    for (int i = 0; i < text.length(); i++) {
-        int token = ALNUM;
-        const char character = text.at(i).toLatin1();
+    while (true) {
+        CSSTokenizer::Token token = tokenizer.Next();
 
-        if (state == Quote) {
-            if (character == '\\') {
-                lastWasSlash = true;
-            } else {
-                if (character == '\"' && !lastWasSlash) {
-                    token = QUOTE;
-                }
-
-                lastWasSlash = false;
-            }
-        } else {
-            token = character == '{'  ? LBRACE    :
-                    character == '}'  ? RBRACE    :
-                    character == ':'  ? COLON     :
-                    character == ';'  ? SEMICOLON :
-                    character == ','  ? COMMA     :
-                    character == '\"' ? QUOTE     :
-                    character == '/'  ? SLASH     :
-                    character == '*'  ? STAR      :
-                    ALNUM;
+        if (token.type == CSSTokenizer::EndOfFile) {
+            break;
         }
 
-        int new_state = transitions[ state ][ token ];
+        switch (token.type) {
+            case CSSTokenizer::OpenCurly:
+                if (in_at_rule && at_rule_holds_rules) {
+                    context = Selector;
+                } else {
+                    context = Property;
+                    declaration_depth = qMin(declaration_depth + 1, DECLARATION_DEPTH_MASK);
+                }
+                in_at_rule = false;
+                break;
 
-        if (new_state != state) {
-            bool include_token = new_state == MaybeCommentEnd ||
-                                 (state == MaybeCommentEnd && new_state != Comment) ||
-                                 state == Quote;
-            highlight(text, lastIndex, i - lastIndex + include_token, state);
+            case CSSTokenizer::CloseCurly:
+                // closing a margin box goes back to the declarations of its @page
+                if (declaration_depth > 0) {
+                    declaration_depth--;
+                }
+                context = declaration_depth > 0 ? Property : Selector;
+                in_at_rule = false;
+                break;
 
-            if (new_state == Comment) {
-                lastIndex = i - 1;    // include the slash and star
-            } else {
-                lastIndex = i + ((token == ALNUM || new_state == Quote) ? 0 : 1);
-            }
-        }
+            case CSSTokenizer::Semicolon:
+                if (context == Value) {
+                    context = Property;
+                }
+                in_at_rule = false;
+                break;
+
+            case CSSTokenizer::Colon:
+                if (context == Property) {
+                    context = Value;
+                } else {
+                    highlightToken(token, context);
+                }
+                break;
+
+            case CSSTokenizer::AtKeyword:
+                if (context != Value) {
+                    // also catches at-rules nested in declarations like the margin boxes of @page
+                    context = Selector;
+                    in_at_rule = true;
+                    at_rule_holds_rules = CSSParser::HoldsRules(text.mid(token.start + 1, token.length - 1).toLower());
+                }
+                highlightToken(token, context);
+                break;
 
-        if (new_state == -1) {
-            state = save_state;
-        } else if (state <= Pseudo2) {
-            save_state = state;
-            state = new_state;
-        } else {
-            state = new_state;
+            default:
+                highlightToken(token, context);
+                break;
         }
     }
 
-    highlight(text, lastIndex, text.length() - lastIndex, state);
-    setCurrentBlockState(state + (save_state << 16));
-}
-
+    state = tokenizer.EndState() | (context << CONTEXT_SHIFT) | (declaration_depth << DECLARATION_DEPTH_SHIFT);
 
-void CSSHighlighter::highlight(const QString &text, int start, int length, int state)
-{
-    if (start >= text.length() || length <= 0) {
-        return;
+    if (in_at_rule) {
+        state |= IN_AT_RULE;
     }
 
-    QTextCharFormat format;
+    if (at_rule_holds_rules) {
+        state |= AT_RULE_HOLDS_RULES;
+    }
 
-    switch (state) {
-        case Selector:
-            setFormat(start, length, m_codeViewAppearance.css_selector_color);
-            break;
+    setCurrentBlockState(state);
+}
 
-        case Property:
-            setFormat(start, length, m_codeViewAppearance.css_property_color);
-            break;
 
-        case Value:
-            setFormat(start, length, m_codeViewAppearance.css_value_color);
-            break;
-
-        case Pseudo1:
-            setFormat(start, length, m_codeViewAppearance.css_selector_color);
-            break;
+void CSSHighlighter::highlightToken(const CSSTokenizer::Token &token, int context)
+{
+    QTextCharFormat format;
 
-        case Pseudo2:
-            setFormat(start, length, m_codeViewAppearance.css_selector_color);
+    switch (token.type) {
+        case CSSTokenizer::Whitespace:
             break;
 
-        case Quote:
-            setFormat(start, length, m_codeViewAppearance.css_quote_color);
+        case CSSTokenizer::Comment:
+            format.setForeground(m_codeViewAppearance.css_comment_color);
+            setFormat(token.start, token.length, format);
             break;
 
-        case Comment:
-        case MaybeCommentEnd:
-            format.setForeground(m_codeViewAppearance.css_comment_color);
-            setFormat(start, length, format);
+        case CSSTokenizer::String:
+        case CSSTokenizer::BadString:
+            setFormat(token.start, token.length, m_codeViewAppearance.css_quote_color);
             break;
 
         default:
+            if (context == Selector) {
+                setFormat(token.start, token.length, m_codeViewAppearance.css_selector_color);
+            } else if (context == Property) {
+                setFormat(token.start, token.length, m_codeViewAppearance.css_property_color);
+            } else {
+                setFormat(token.start, token.length, m_codeViewAppearance.css_value_color);
+            }
             break;
     }
 }
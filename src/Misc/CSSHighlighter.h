@@ -24,6 +24,7 @@
 
 #include <QtGui/QSyntaxHighlighter>
 
+#include "Misc/CSSTokenizer.h"
 #include "Misc/SettingsStore.h"
 
 class CSSHighlighter : public QSyntaxHighlighter
@@ -36,10 +37,11 @@ public:
 protected:
 
     void highlightBlock(const QString &text);
-    void highlight(const QString &, int start, int length, int state);
 
 private:
 
+    void highlightToken(const CSSTokenizer::Token &token, int context);
+
     SettingsStore::CodeViewAppearance m_codeViewAppearance;
 };
 
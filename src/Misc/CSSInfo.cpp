@@ -22,15 +22,11 @@
 **
 *************************************************************************/
 
-#include "Misc/EmbeddedPython.h"
-
 #include <QRegularExpression>
-#include "Misc/Utility.h"
+#include "Misc/CSSParser.h"
 #include "Misc/CSSInfo.h"
 
 const int TAB_SPACES_WIDTH = 4;
-const QString LINE_MARKER("[SIGIL_NEWLINE]");
-static const QString DELIMITERS = "}{;";
 
 
 // Note: CSSProperties and CSSSelectors are simple struct that this code
@@ -42,19 +38,32 @@ CSSInfo::CSSInfo(const QString &text, bool isCSSFile)
       m_IsCSSFile(isCSSFile)
 {
     if (isCSSFile) {
-        parseCSSSelectors(text, 0, 0);
+        parseCSSSelectors(text, 0, text.length(), 1);
     } else {
         // This is an HTML file with any number of inline CSS style blocks within it
         int style_start = -1;
         int style_end = -1;
         int offset = 0;
+        int line = 1;
 
         while (findInlineStyleBlock(text, offset, style_start, style_end)) {
-            int line = text.left(style_start).count(QChar('\n'));
-            parseCSSSelectors(text.mid(style_start, style_end - style_start), line, style_start);
+            // only count the lines since the previous block
+            line += text.midRef(offset, style_start - offset).count(QChar('\n'));
+            parseCSSSelectors(text, style_start, style_end, line);
+            line += text.midRef(style_start, style_end - style_start).count(QChar('\n'));
             offset = style_end;
         }
     }
+
+    // Index the class selectors by class name, keeping the file order
+    foreach(CSSSelector * selector, m_CSSSelectors) {
+        foreach(QString class_name, selector->classNames) {
+            QList<CSSSelector *> &selectors = m_ClassSelectors[class_name];
+            if (selectors.isEmpty() || selectors.last() != selector) {
+                selectors.append(selector);
+            }
+        }
+    }
 }
 
 // Need to manually clean up the Selector List
@@ -68,12 +77,14 @@ CSSInfo::~CSSInfo()
 
 QList<CSSInfo::CSSSelector *> CSSInfo::getClassSelectors(const QString filterClassName)
 {
+    if (!filterClassName.isEmpty()) {
+        return m_ClassSelectors.value(filterClassName);
+    }
+
     QList<CSSInfo::CSSSelector *> selectors;
     foreach(CSSInfo::CSSSelector * cssSelector, m_CSSSelectors) {
         if (cssSelector->classNames.count() > 0) {
-            if (filterClassName.isEmpty() || cssSelector->classNames.contains(filterClassName)) {
-                selectors.append(cssSelector);
-            }
+            selectors.append(cssSelector);
         }
     }
     return selectors;
@@ -179,122 +190,8 @@ QStringList CSSInfo::getAllPropertyValues(QString property)
 
 QString CSSInfo::getReformattedCSSText(bool multipleLineFormat)
 {
-    QString csstext(m_OriginalText);
-
-    // Note, the EmbeddedPython interface does not handle bool properly
-    // So convert to int with 0 or 1 value for the time being
-    int useoneline = 1;
-    if (multipleLineFormat) useoneline = 0;
-
-    int rv = 0;
-    QString error_traceback;
-    QList<QVariant> args;
-    args.append(QVariant(csstext));
-    args.append(QVariant(useoneline));
-    EmbeddedPython * epython  = EmbeddedPython::instance();
-
-    QVariant res = epython->runInPython( QString("cssreformatter"),
-                                         QString("reformat_css"),
-                                         args,
-                                         &rv,
-                                         error_traceback);
-    if (rv != 0) {
-        Utility::DisplayStdWarningDialog(QString("Error in cssreformatter: ") + QString::number(rv), 
-				         error_traceback);
-        // an error happened, return unchanged original
-        return QString(csstext);
-    }
-    // QVariant results are a String List (new_css_text, errors, warnings)
-    QStringList results = res.toStringList();
-    QString new_csstext = results[0];
-    QString errors = results[1];
-    QString warnings = results[2];
-
-    if (!errors.isEmpty()) {
-        Utility::DisplayStdWarningDialog(QString("Error in cssreformatter: "), errors);
-        // an error happened, return unchanged original
-        return QString(csstext);
-    }
-
-    if (!warnings.isEmpty()) {
-        Utility::DisplayStdWarningDialog(QString("Warnings from cssreformatter: "), warnings);
-    }
-
-    return new_csstext;
-
-#if 0  // attempt to replace out broken css reformatter with a python one based on css_parser
-    int selector_indent = m_IsCSSFile ? 0 : TAB_SPACES_WIDTH;
-    // Work backwards through our selectors to change the document as will be in line order.
-    // must also cater for fact that a selector group ( e.g. body,p { ) will have multiple
-    // selector entries so skip if the next selector is on the same line.
-    int last_selector_line = -1;
-
-    for (int i = m_CSSSelectors.count() - 1; i >= 0; i--) {
-        CSSInfo::CSSSelector *cssSelector = m_CSSSelectors.at(i);
-
-        if (cssSelector->isGroup && cssSelector->line == last_selector_line) {
-            // Must be a selector group which we have already processed.
-            continue;
-        }
-
-        last_selector_line = cssSelector->line;
-
-        // Will place a blank line after every style if in multi-line mode
-        if (multipleLineFormat) {
-            new_text.insert(cssSelector->closingBracePos + 1, LINE_MARKER);
-        }
-
-        // Now replace the contents inside the braces
-        QList<CSSInfo::CSSProperty *> new_properties = getCSSProperties(m_OriginalText, cssSelector->openingBracePos + 1, cssSelector->closingBracePos);
-        const QString &new_properties_text = formatCSSProperties(new_properties, multipleLineFormat, selector_indent);
-        new_text.replace(cssSelector->openingBracePos + 1, cssSelector->closingBracePos - cssSelector->openingBracePos - 1, new_properties_text);
-	// clear up new_properties as they were created with new
-	foreach(CSSInfo::CSSProperty* p, new_properties) {
-	    if (p) delete p;
-	}
-        // Reformat the selector text itself - whitespace only since incomplete parsing.
-        // Will ensure the braces are placed on the same line as the selector name,
-        // comma separated groups are spaced apart and double spaces are removed.
-        QString selector_text = m_OriginalText.mid(cssSelector->position, cssSelector->openingBracePos - cssSelector->position);
-        selector_text.replace(QRegularExpression(","), ", ");
-        selector_text.replace(QRegularExpression(" {2,}"), QChar(' '));
-        new_text.replace(cssSelector->position, cssSelector->openingBracePos - cssSelector->position, selector_text.trimmed() % QChar(' '));
-
-        // Make sure the selector itself is left-aligned (indented if inline CSS)
-        if (cssSelector->position > 0) {
-            int pos = cssSelector->position;
-
-            while (pos-- > 0 && (new_text.at(pos) == QChar(' ') || new_text.at(pos) == QChar('\t')));
-
-            if (pos <= 0) {
-                new_text.replace(0, cssSelector->position, QString(" ").repeated(selector_indent));
-            } else {
-                new_text.replace(pos + 1, cssSelector->position - pos - 1, QString(" ").repeated(selector_indent));
-                new_text.insert(pos + 1, QChar('\n'));
-            }
-        }
-    }
-
-    // Finally remove extra blank lines so styles are placed consecutively if inline, or one line spacing if CSS.
-    // If we are reformatting an inline CSS, make sure we are doing so only within style blocks
-    if (m_IsCSSFile) {
-        new_text.replace(QRegularExpression("\n{2,}"), "\n");
-    } else {
-        int style_start = -1;
-        int style_end = -1;
-        int offset = 0;
-
-        while (findInlineStyleBlock(new_text, offset, style_start, style_end)) {
-            QString script_text = new_text.mid(style_start, style_end - style_start);
-            script_text.replace(QRegularExpression("\n{2,}"), "\n");
-            new_text.replace(style_start, style_end - style_start, script_text);
-            offset = style_start + script_text.length();
-        }
-    }
-
-    new_text.replace(LINE_MARKER, "\n");
-    return new_text.trimmed();
-#endif
+    CSSParser parser(m_OriginalText);
+    return parser.Reformat(multipleLineFormat);
 }
 
 QString CSSInfo::removeMatchingSelectors(QList<CSSSelector *> cssSelectors)
@@ -378,25 +275,11 @@ QList<CSSInfo::CSSProperty *> CSSInfo::getCSSProperties(const QString &text, con
         return new_properties;
     }
 
-    const QString &style_text = text.mid(styleTextStartPos, styleTextEndPos - styleTextStartPos);
-    QStringList properties = style_text.split(QChar(';'), QString::SkipEmptyParts);
-    foreach(QString property_text, properties) {
-        if (property_text.trimmed().isEmpty()) {
-            continue;
-        }
-
-        QStringList name_values = property_text.split(QChar(':'), QString::SkipEmptyParts);
+    // Comments are kept as a name without a value so they survive a rewrite
+    foreach(const CSSParser::Declaration &declaration, CSSParser::ParseDeclarations(text, styleTextStartPos, styleTextEndPos)) {
         CSSProperty *css_property = new CSSProperty();
-
-        // Any badly formed CSS or stuff we don't "understand" like pre-processing we leave as is
-        if (name_values.count() != 2) {
-            css_property->name = property_text.trimmed();
-            css_property->value = QString();
-        } else {
-            css_property->name = name_values.at(0).trimmed();
-            css_property->value = name_values.at(1).trimmed();
-        }
-
+        css_property->name = declaration.name;
+        css_property->value = declaration.value;
         new_properties.append(css_property);
     }
     return new_properties;
@@ -417,19 +300,23 @@ QString CSSInfo::formatCSSProperties(QList<CSSInfo::CSSProperty *> new_propertie
         QStringList property_values;
         foreach(CSSInfo::CSSProperty * new_property, new_properties) {
             if (new_property->value.isNull()) {
-                property_values.append(new_property->name);
+                if (new_property->name.startsWith("/*")) {
+                    property_values.append(new_property->name);
+                } else {
+                    property_values.append(new_property->name % ";");
+                }
             } else {
-                property_values.append(QString("%1: %2").arg(new_property->name).arg(new_property->value));
+                property_values.append(QString("%1: %2;").arg(new_property->name).arg(new_property->value));
             }
         }
 
         if (multipleLineFormat) {
-            return QString("\n%1%2;\n%3")
+            return QString("\n%1%2\n%3")
                    .arg(tab_spaces)
-                   .arg(property_values.join(";\n" % tab_spaces))
+                   .arg(property_values.join("\n" % tab_spaces))
                    .arg(QString(" ").repeated(selectorIndent));
         } else {
-            return QString(" %1; ").arg(property_values.join("; "));
+            return QString(" %1 ").arg(property_values.join(" "));
         }
     }
 }
@@ -459,78 +346,38 @@ bool CSSInfo::findInlineStyleBlock(const QString &text, const int &offset, int &
     return false;
 }
 
-void CSSInfo::parseCSSSelectors(const QString &text, const int &offsetLines, const int &offsetPos)
+void CSSInfo::parseCSSSelectors(const QString &text, int start, int end, int line)
 {
-    QRegularExpression strip_attributes_regex("\\[[^\\]]*\\]");
-    QRegularExpression strip_ids_regex("#[^\\s\\.]+");
-    // QRegularExpression strip_non_name_chars_regex("[^A-Za-z0-9_\\-\\.:]+");
-    QRegularExpression strip_non_name_chars_regex("[^\\w_\\-\\.:]+", QRegularExpression::UseUnicodePropertiesOption);
-    QString search_text = replaceBlockComments(text);
+    static const QRegularExpression strip_attributes_regex("\\[[^\\]]*\\]");
+    static const QRegularExpression strip_ids_regex("#[^\\s\\.]+");
+    static const QRegularExpression strip_non_name_chars_regex("[^\\w_\\-\\.:]+", QRegularExpression::UseUnicodePropertiesOption);
     // CSS selectors can be in a myriad of formats... the class based selectors could be:
     //    .c1 / e1.c1 / e1.c1.c2 / e1[class~=c1] / e1#id1.c1 / e1.c1#id1 / .c1, .c2 / ...
     // Then the element based selectors could be:
     //    e1 / e1 > e2 / e1 e2 / e1 + e2 / e1[attribs...] / e1#id1 / e1, e2 / ...
-    // Really needs a parser to do this properly, this will only handle the 90% scenarios.
-
-    // Note: selector groups can be sepaparated by line feeds so you can not stop
-    // at the beginning of line when searching for the start of a selector
-
-    int pos = 0;
-    int open_brace_pos = -1;
-    int close_brace_pos = -1;
-
-    while (true) {
-        open_brace_pos = search_text.indexOf(QChar('{'), pos);
-
-        if (open_brace_pos < 0) {
-            break;
-        }
-
-        // Now search backwards until we get a line (or more)  containing text .
-        bool have_text = false;
-        pos = open_brace_pos - 1;
-
-        while ((pos >= 0) && (!DELIMITERS.contains(search_text.at(pos)) || !have_text)) {
-            if (search_text.at(pos).isLetter()) {
-                have_text = true;
-            }
-
-            pos--;
-        }
-
-        pos++;
-
-        if (!have_text) {
-            // Really badly formed CSS document - try to skip ahead
-            pos = open_brace_pos + 1;
+    // The parser finds the rules, the element and class names are still picked
+    // out of each selector by stripping what is not of interest.
+    CSSParser parser(text, start, end, line);
+
+    foreach(const CSSParser::Rule &rule, parser.rules()) {
+        // Rules holding other rules (@media) are not styles themselves, at-rules
+        // with declarations (@font-face, @page) are kept for their property values
+        if (rule.type == CSSParser::CommentRule || rule.openingBracePos < 0 || rule.containsRules) {
             continue;
         }
 
-        close_brace_pos = search_text.indexOf(QChar('}'), open_brace_pos + 1);
-
-        if (close_brace_pos < 0) {
-            // Another badly formed scenario - no point in looking further
-            break;
-        }
-
-        // Skip past leading whitespace/newline.
-        while (search_text.at(pos).isSpace()) {
-            pos++;
-        }
-
-        int line = search_text.left(pos + 1).count(QChar('\n')) + 1;
-        QString selector_text = search_text.mid(pos, open_brace_pos - pos).trimmed();
+        const QString &selector_text = rule.prelude;
         // Handle case of a selector group containing multiple declarations
-        QStringList matches = selector_text.split(QChar(','), QString::SkipEmptyParts);
+        QStringList matches = splitSelectorGroup(selector_text);
         foreach(QString match, matches) {
             CSSSelector *selector = new CSSSelector();
             selector->originalText = selector_text;
             selector->groupText = match.trimmed();
-            selector->position = pos + offsetPos;
-            selector->line = line + offsetLines;
+            selector->position = rule.position;
+            selector->line = rule.line;
             selector->isGroup = matches.length() > 1;
-            selector->openingBracePos = open_brace_pos + offsetPos;
-            selector->closingBracePos = close_brace_pos + offsetPos;
+            selector->openingBracePos = rule.openingBracePos;
+            selector->closingBracePos = rule.closingBracePos;
             // Need to parse our selector text to determine what sort of selector it contains.
             // First strip out any attributes and then identifiers
             match.replace(strip_attributes_regex, "");
@@ -556,44 +403,40 @@ void CSSInfo::parseCSSSelectors(const QString &text, const int &offsetLines, con
             }
             m_CSSSelectors.append(selector);
         }
-        pos = open_brace_pos + 1;
     }
 }
 
-QString CSSInfo::replaceBlockComments(const QString &text)
+QStringList CSSInfo::splitSelectorGroup(const QString &selectorText)
 {
-    // We take a copy of the text and remove all block comments from it.
-    // However we must be careful to replace with spaces/keep line feeds
-    // so that do not corrupt the position information used by the parser.
-    QString new_text(text);
-    QRegularExpression comment_search("/\\*.*\\*/", QRegularExpression::InvertedGreedinessOption|QRegularExpression::DotMatchesEverythingOption);
+    // Only commas outside of brackets, functions and strings separate selectors
+    QStringList selectors;
+    CSSTokenizer tokenizer(selectorText);
+    int nesting = 0;
     int start = 0;
-    int comment_index;
 
     while (true) {
-        int comment_len = 0;
-        comment_index = -1;
-        QRegularExpressionMatch match = comment_search.match(new_text, start);
-        if (match.hasMatch()) {
-            comment_index = match.capturedStart();
-            comment_len = match.capturedLength();
-        }
+        CSSTokenizer::Token token = tokenizer.Next();
 
-        if (comment_index < 0) {
+        if (token.type == CSSTokenizer::EndOfFile) {
             break;
         }
 
-        QString match_text = new_text.mid(comment_index, comment_len);
-        match_text.replace(QRegularExpression("[^\r\n]"), QChar(' '));
-        new_text.remove(comment_index, match_text.length());
-        new_text.insert(comment_index, match_text);
-        // Prepare for the next comment.
-        start = comment_index + comment_len;
-
-        if (start >= new_text.length() - 2) {
-            break;
+        if (token.type == CSSTokenizer::OpenParen || token.type == CSSTokenizer::OpenSquare ||
+            token.type == CSSTokenizer::Function) {
+            nesting++;
+        } else if ((token.type == CSSTokenizer::CloseParen || token.type == CSSTokenizer::CloseSquare) && nesting > 0) {
+            nesting--;
+        } else if (token.type == CSSTokenizer::Comma && nesting == 0) {
+            if (!selectorText.midRef(start, token.start - start).trimmed().isEmpty()) {
+                selectors.append(selectorText.mid(start, token.start - start));
+            }
+            start = token.start + 1;
         }
     }
 
-    return new_text;
+    if (!selectorText.midRef(start).trimmed().isEmpty()) {
+        selectors.append(selectorText.mid(start));
+    }
+
+    return selectors;
 }
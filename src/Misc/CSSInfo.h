@@ -26,6 +26,7 @@
 #ifndef CSSINFO_H
 #define CSSINFO_H
 
+#include <QtCore/QHash>
 #include <QtCore/QObject>
 #include <QtCore/QStringList>
 
@@ -109,10 +110,14 @@ public:
 
 private:
     bool findInlineStyleBlock(const QString &text, const int &offset, int &styleStart, int &styleEnd);
-    void parseCSSSelectors(const QString &text, const int &offsetLines, const int &offsetPos);
-    QString replaceBlockComments(const QString &text);
+    void parseCSSSelectors(const QString &text, int start, int end, int line);
+    static QStringList splitSelectorGroup(const QString &selectorText);
 
     QList<CSSSelector *> m_CSSSelectors;
+
+    // class selectors keyed on each of their class names
+    QHash<QString, QList<CSSSelector *>> m_ClassSelectors;
+
     QString m_OriginalText;
     bool m_IsCSSFile;
 };
@@ -0,0 +1,485 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <QtCore/QStringList>
+
+#include "Misc/CSSParser.h"
+
+const int INDENT_WIDTH = 2;
+
+// at-rules whose block holds rules rather than declarations
+static const QStringList RULE_LIST_AT_RULES = QStringList() << "media" << "supports" << "document"
+                                                           << "-moz-document" << "layer" << "container";
+
+
+CSSParser::CSSParser(const QString &text, int start, int end, int line)
+    :
+    m_Text(text),
+    m_End((end < 0 || end > text.length()) ? text.length() : end)
+{
+    m_Tokens = Tokenize(text, start, m_End, line);
+    ParseRuleList(0, -1, 0, true);
+}
+
+
+const QList<CSSParser::Rule> &CSSParser::rules() const
+{
+    return m_Rules;
+}
+
+
+QList<CSSParser::Declaration> CSSParser::ParseDeclarations(const QString &text, int start, int end)
+{
+    QList<Declaration> declarations;
+    QVector<CSSTokenizer::Token> tokens = Tokenize(text, start, end, 1);
+    int i = 0;
+
+    while (tokens.at(i).type != CSSTokenizer::EndOfFile) {
+        const CSSTokenizer::Token &token = tokens.at(i);
+
+        if (token.type == CSSTokenizer::Comment) {
+            declarations.append(CommentDeclaration(text, token));
+            i++;
+        } else if (IsBlank(token) || token.type == CSSTokenizer::Semicolon || token.type == CSSTokenizer::CloseCurly) {
+            i++;
+        } else {
+            i = ParseDeclaration(text, tokens, i, declarations);
+        }
+    }
+
+    return declarations;
+}
+
+
+bool CSSParser::HoldsRules(const QString &at_keyword)
+{
+    return RULE_LIST_AT_RULES.contains(at_keyword);
+}
+
+
+QString CSSParser::Reformat(bool multipleLineFormat) const
+{
+    // The children of each rule, top level rules at the end
+    QVector<QList<int>> children(m_Rules.count() + 1);
+
+    for (int i = 0; i < m_Rules.count(); ++i) {
+        int parent = m_Rules.at(i).parent;
+        children[parent < 0 ? m_Rules.count() : parent].append(i);
+    }
+
+    QString out;
+    out.reserve(m_End + m_End / 4);
+    const QList<int> &top_level = children.at(m_Rules.count());
+
+    for (int i = 0; i < top_level.count(); ++i) {
+        if (multipleLineFormat && i > 0) {
+            out.append(QChar('\n'));
+        }
+        AppendRule(out, top_level.at(i), children, multipleLineFormat);
+    }
+
+    return out;
+}
+
+
+int CSSParser::ParseRuleList(int index, int parent, int depth, bool top_level)
+{
+    int i = index;
+
+    while (true) {
+        const CSSTokenizer::Token &token = m_Tokens.at(i);
+
+        switch (token.type) {
+            case CSSTokenizer::EndOfFile:
+                return i;
+
+            case CSSTokenizer::CloseCurly:
+                if (!top_level) {
+                    return i;
+                }
+                // a stray closing brace, skip it
+                i++;
+                break;
+
+            case CSSTokenizer::Whitespace:
+            case CSSTokenizer::CDO:
+            case CSSTokenizer::CDC:
+            case CSSTokenizer::Semicolon:
+                i++;
+                break;
+
+            case CSSTokenizer::Comment: {
+                Rule rule;
+                rule.type = CommentRule;
+                rule.prelude = m_Text.mid(token.start, token.length);
+                rule.position = token.start;
+                rule.line = token.line;
+                rule.openingBracePos = -1;
+                rule.closingBracePos = -1;
+                rule.endPos = token.start + token.length;
+                rule.parent = parent;
+                rule.depth = depth;
+                rule.containsRules = false;
+                m_Rules.append(rule);
+                i++;
+                break;
+            }
+
+            default:
+                i = ParseRule(i, parent, depth);
+                break;
+        }
+    }
+}
+
+
+int CSSParser::ParseRule(int index, int parent, int depth)
+{
+    const CSSTokenizer::Token &first = m_Tokens.at(index);
+    Rule rule;
+    rule.type = first.type == CSSTokenizer::AtKeyword ? AtRule : QualifiedRule;
+
+    if (rule.type == AtRule) {
+        rule.atKeyword = m_Text.mid(first.start + 1, first.length - 1).toLower();
+    }
+
+    rule.position = first.start;
+    rule.line = first.line;
+    rule.openingBracePos = -1;
+    rule.closingBracePos = -1;
+    rule.parent = parent;
+    rule.depth = depth;
+    rule.containsRules = false;
+
+    // The prelude runs to the opening brace (or a semicolon for an at-rule),
+    // skipping any of those nested in brackets or functions
+    int nesting = 0;
+    int last = -1;
+    int j = index;
+
+    for (; m_Tokens.at(j).type != CSSTokenizer::EndOfFile; ++j) {
+        const CSSTokenizer::Token &token = m_Tokens.at(j);
+
+        if (nesting == 0) {
+            if (token.type == CSSTokenizer::OpenCurly || token.type == CSSTokenizer::CloseCurly) {
+                break;
+            }
+            if (token.type == CSSTokenizer::Semicolon && rule.type == AtRule) {
+                break;
+            }
+        }
+
+        if (token.type == CSSTokenizer::OpenParen || token.type == CSSTokenizer::OpenSquare ||
+            token.type == CSSTokenizer::Function) {
+            nesting++;
+        } else if ((token.type == CSSTokenizer::CloseParen || token.type == CSSTokenizer::CloseSquare) && nesting > 0) {
+            nesting--;
+        }
+
+        if (!IsBlank(token)) {
+            last = j;
+        }
+    }
+
+    rule.prelude = BlankedText(index, last);
+    const CSSTokenizer::Token &stop = m_Tokens.at(j);
+
+    if (stop.type == CSSTokenizer::OpenCurly) {
+        rule.openingBracePos = stop.start;
+        rule.containsRules = rule.type == AtRule && HoldsRules(rule.atKeyword);
+        m_Rules.append(rule);
+        int rule_index = m_Rules.count() - 1;
+        int k = rule.containsRules ? ParseRuleList(j + 1, rule_index, depth + 1, false)
+                                   : ParseBlockContents(j + 1, rule_index);
+
+        Rule &parsed = m_Rules[rule_index];
+
+        if (m_Tokens.at(k).type == CSSTokenizer::CloseCurly) {
+            parsed.closingBracePos = m_Tokens.at(k).start;
+            parsed.endPos = parsed.closingBracePos + 1;
+            return k + 1;
+        }
+
+        // the block is closed by the end of the text
+        parsed.closingBracePos = m_End;
+        parsed.endPos = m_End;
+        return k;
+    }
+
+    if (rule.type == AtRule) {
+        // a statement at-rule like @import, the semicolon may be missing at the end of a block
+        rule.endPos = stop.type == CSSTokenizer::Semicolon ? stop.start + 1 : m_Tokens.at(last).start + m_Tokens.at(last).length;
+        m_Rules.append(rule);
+        return stop.type == CSSTokenizer::Semicolon ? j + 1 : j;
+    }
+
+    // a selector without a block is dropped
+    return j;
+}
+
+
+int CSSParser::ParseBlockContents(int index, int rule_index)
+{
+    QList<Declaration> declarations;
+    int depth = m_Rules.at(rule_index).depth + 1;
+    int i = index;
+
+    while (true) {
+        const CSSTokenizer::Token &token = m_Tokens.at(i);
+
+        if (token.type == CSSTokenizer::EndOfFile || token.type == CSSTokenizer::CloseCurly) {
+            break;
+        }
+
+        if (token.type == CSSTokenizer::Comment) {
+            declarations.append(CommentDeclaration(m_Text, token));
+            i++;
+        } else if (IsBlank(token) || token.type == CSSTokenizer::Semicolon) {
+            i++;
+        } else if (token.type == CSSTokenizer::AtKeyword) {
+            // a nested at-rule like the margin boxes of @page
+            i = ParseRule(i, rule_index, depth);
+        } else {
+            i = ParseDeclaration(m_Text, m_Tokens, i, declarations);
+        }
+    }
+
+    m_Rules[rule_index].declarations = declarations;
+    return i;
+}
+
+
+int CSSParser::ParseDeclaration(const QString &text, const QVector<CSSTokenizer::Token> &tokens, int index, QList<Declaration> &declarations)
+{
+    const CSSTokenizer::Token &first = tokens.at(index);
+    int nesting = 0;
+    int colon = -1;
+    int last = index;
+    int j = index;
+
+    for (; tokens.at(j).type != CSSTokenizer::EndOfFile; ++j) {
+        const CSSTokenizer::Token &token = tokens.at(j);
+
+        if (nesting == 0 && (token.type == CSSTokenizer::Semicolon || token.type == CSSTokenizer::CloseCurly)) {
+            break;
+        }
+
+        switch (token.type) {
+            case CSSTokenizer::OpenParen:
+            case CSSTokenizer::OpenSquare:
+            case CSSTokenizer::OpenCurly:
+            case CSSTokenizer::Function:
+                nesting++;
+                break;
+
+            case CSSTokenizer::CloseParen:
+            case CSSTokenizer::CloseSquare:
+            case CSSTokenizer::CloseCurly:
+                if (nesting > 0) {
+                    nesting--;
+                }
+                break;
+
+            case CSSTokenizer::Colon:
+                if (nesting == 0 && colon < 0) {
+                    colon = j;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (token.type != CSSTokenizer::Whitespace) {
+            last = j;
+        }
+    }
+
+    Declaration declaration;
+    declaration.isComment = false;
+    declaration.start = first.start;
+    declaration.end = tokens.at(last).start + tokens.at(last).length;
+    declaration.line = first.line;
+
+    const int colon_pos = colon >= 0 ? tokens.at(colon).start : -1;
+    QString value = colon >= 0 ? text.mid(colon_pos + 1, declaration.end - colon_pos - 1).trimmed() : QString();
+
+    // Any badly formed CSS or stuff we don't "understand" we leave as is
+    if (value.isEmpty()) {
+        declaration.name = text.mid(declaration.start, declaration.end - declaration.start);
+    } else {
+        declaration.name = text.mid(declaration.start, colon_pos - declaration.start).trimmed();
+        declaration.value = value;
+    }
+
+    declarations.append(declaration);
+    return j;
+}
+
+
+CSSParser::Declaration CSSParser::CommentDeclaration(const QString &text, const CSSTokenizer::Token &token)
+{
+    Declaration declaration;
+    declaration.name = text.mid(token.start, token.length);
+    declaration.isComment = true;
+    declaration.start = token.start;
+    declaration.end = token.start + token.length;
+    declaration.line = token.line;
+    return declaration;
+}
+
+
+QString CSSParser::BlankedText(int first, int last) const
+{
+    if (last < first) {
+        return QString();
+    }
+
+    const int start = m_Tokens.at(first).start;
+    const int end = m_Tokens.at(last).start + m_Tokens.at(last).length;
+    QString text = m_Text.mid(start, end - start);
+
+    // Comments are blanked rather than removed so positions and lines stay put
+    for (int i = first; i <= last; ++i) {
+        const CSSTokenizer::Token &token = m_Tokens.at(i);
+
+        if (token.type == CSSTokenizer::Comment) {
+            QChar *data = text.data() + token.start - start;
+
+            for (int k = 0; k < token.length; ++k) {
+                if (data[k] != QChar('\n') && data[k] != QChar('\r')) {
+                    data[k] = QChar(' ');
+                }
+            }
+        }
+    }
+
+    return text;
+}
+
+
+QString CSSParser::NormalizedPrelude(const Rule &rule) const
+{
+    // Whitespace runs and comments become a single space, commas are followed by one
+    QVector<CSSTokenizer::Token> tokens = Tokenize(m_Text, rule.position, rule.position + rule.prelude.length(), rule.line);
+    QString prelude;
+    bool pending_space = false;
+
+    foreach(const CSSTokenizer::Token &token, tokens) {
+        if (token.type == CSSTokenizer::EndOfFile) {
+            break;
+        }
+
+        if (IsBlank(token)) {
+            pending_space = !prelude.isEmpty();
+        } else if (token.type == CSSTokenizer::Comma) {
+            prelude.append(QChar(','));
+            pending_space = true;
+        } else {
+            if (pending_space) {
+                prelude.append(QChar(' '));
+                pending_space = false;
+            }
+            prelude.append(m_Text.midRef(token.start, token.length));
+        }
+    }
+
+    return prelude;
+}
+
+
+void CSSParser::AppendRule(QString &out, int rule_index, const QVector<QList<int>> &children, bool multipleLineFormat) const
+{
+    const Rule &rule = m_Rules.at(rule_index);
+    const QString indent = multipleLineFormat ? QString(INDENT_WIDTH * rule.depth, QChar(' ')) : QString();
+    const QString inner_indent = multipleLineFormat ? QString(INDENT_WIDTH * (rule.depth + 1), QChar(' ')) : QString();
+
+    if (rule.type == CommentRule) {
+        out.append(indent % rule.prelude % QChar('\n'));
+        return;
+    }
+
+    const QString prelude = NormalizedPrelude(rule);
+
+    if (rule.openingBracePos < 0) {
+        out.append(indent % prelude % QChar(';') % QChar('\n'));
+        return;
+    }
+
+    out.append(indent % prelude % (prelude.isEmpty() ? QString("{") : QString(" {")));
+
+    QStringList declarations;
+    foreach(const Declaration &declaration, rule.declarations) {
+        if (declaration.isComment) {
+            declarations.append(declaration.name);
+        } else if (declaration.value.isNull()) {
+            declarations.append(declaration.name % QChar(';'));
+        } else {
+            declarations.append(declaration.name % QString(": ") % declaration.value % QChar(';'));
+        }
+    }
+
+    const QList<int> &child_rules = children.at(rule_index);
+
+    if (multipleLineFormat) {
+        out.append(QChar('\n'));
+        foreach(const QString &declaration, declarations) {
+            out.append(inner_indent % declaration % QChar('\n'));
+        }
+    } else {
+        foreach(const QString &declaration, declarations) {
+            out.append(QChar(' ') % declaration);
+        }
+        out.append(child_rules.isEmpty() ? QString(" ") : QString("\n"));
+    }
+
+    foreach(int child, child_rules) {
+        AppendRule(out, child, children, multipleLineFormat);
+    }
+
+    out.append(indent % QString("}\n"));
+}
+
+
+QVector<CSSTokenizer::Token> CSSParser::Tokenize(const QString &text, int start, int end, int line)
+{
+    QVector<CSSTokenizer::Token> tokens;
+    tokens.reserve((end < 0 ? text.length() : end - start) / 4 + 1);
+    CSSTokenizer tokenizer(text, start, end, line);
+
+    while (true) {
+        CSSTokenizer::Token token = tokenizer.Next();
+        tokens.append(token);
+
+        if (token.type == CSSTokenizer::EndOfFile) {
+            break;
+        }
+    }
+
+    return tokens;
+}
+
+
+bool CSSParser::IsBlank(const CSSTokenizer::Token &token)
+{
+    return token.type == CSSTokenizer::Whitespace || token.type == CSSTokenizer::Comment;
+}
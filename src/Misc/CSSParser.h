@@ -0,0 +1,139 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef CSSPARSER_H
+#define CSSPARSER_H
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "Misc/CSSTokenizer.h"
+
+/**
+ * Builds the rules and declarations of a stylesheet (or of one inline
+ * style block) from a single run of the CSSTokenizer, so parsing is
+ * linear in the size of the text and every position and line number
+ * refers to the original text.
+ *
+ * Rules are kept in document order. Rules nested in @media and
+ * similar at-rules, or in the declaration block of an at-rule
+ * like @page, name their enclosing rule as parent.
+ */
+class CSSParser
+{
+
+public:
+
+    enum RuleType {
+        QualifiedRule,
+        AtRule,
+        CommentRule
+    };
+
+    struct Declaration {
+        QString name;     /* The property name, or the whole text if it has no value or is a comment */
+        QString value;    /* The value as written (trimmed), null if there is none                    */
+        bool isComment;   /* Whether this is a comment between declarations                          */
+        int start;        /* Position of the first character of the declaration                      */
+        int end;          /* Position just after the last character (before any semicolon)           */
+        int line;         /* Line of the first character                                             */
+    };
+
+    struct Rule {
+        RuleType type;
+        QString atKeyword;        /* Lower case name without the @ for at-rules                       */
+        QString prelude;          /* The selector(s) or at-rule prelude with comments blanked out     */
+        int position;             /* Position of the prelude (or of the comment) in the text          */
+        int line;                 /* Line of position                                                 */
+        int openingBracePos;      /* -1 for at-rules ending in a semicolon and for comments           */
+        int closingBracePos;      /* The end of the text if the block is never closed                 */
+        int endPos;               /* Position just after the rule                                     */
+        int parent;               /* Index of the enclosing rule or -1                                */
+        int depth;                /* Number of enclosing rules                                        */
+        bool containsRules;       /* Whether the block holds rules (@media) rather than declarations  */
+        QList<Declaration> declarations;
+    };
+
+    /**
+     * Parses text from start to end.
+     *
+     * @param line The line number of start.
+     */
+    CSSParser(const QString &text, int start = 0, int end = -1, int line = 1);
+
+    const QList<Rule> &rules() const;
+
+    /**
+     * Parses the contents of a declaration block (or a style attribute)
+     * from start to end.
+     */
+    static QList<Declaration> ParseDeclarations(const QString &text, int start, int end);
+
+    /**
+     * Whether the block of this at-rule (lower case, no @) holds rules
+     * like @media rather than declarations like @font-face.
+     */
+    static bool HoldsRules(const QString &at_keyword);
+
+    /**
+     * Returns the parsed text laid out either with one declaration
+     * per line or with one rule per line. Comments are kept, the
+     * values of declarations are left as written.
+     */
+    QString Reformat(bool multipleLineFormat) const;
+
+private:
+
+    // Parses rules until the end of text or a closing brace, returns the token index after
+    int ParseRuleList(int index, int parent, int depth, bool top_level);
+
+    // Parses one rule starting at index, returns the token index after
+    int ParseRule(int index, int parent, int depth);
+
+    // Parses declarations and nested at-rules up to the closing brace,
+    // returns the token index after that brace
+    int ParseBlockContents(int index, int rule_index);
+
+    // Adds the declaration starting at index, returns the token index of the ; or } ending it
+    static int ParseDeclaration(const QString &text, const QVector<CSSTokenizer::Token> &tokens, int index, QList<Declaration> &declarations);
+
+    static Declaration CommentDeclaration(const QString &text, const CSSTokenizer::Token &token);
+
+    QString BlankedText(int first, int last) const;
+
+    QString NormalizedPrelude(const Rule &rule) const;
+
+    void AppendRule(QString &out, int rule_index, const QVector<QList<int>> &children, bool multipleLineFormat) const;
+
+    static QVector<CSSTokenizer::Token> Tokenize(const QString &text, int start, int end, int line);
+
+    static bool IsBlank(const CSSTokenizer::Token &token);
+
+    const QString &m_Text;
+    int m_End;
+    QVector<CSSTokenizer::Token> m_Tokens;
+    QList<Rule> m_Rules;
+};
+
+#endif // CSSPARSER_H
@@ -0,0 +1,491 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <cctype>
+
+#include "Misc/CSSTokenizer.h"
+
+
+CSSTokenizer::CSSTokenizer(const QString &text, int start, int end, int line, State state)
+    :
+    m_Text(text),
+    m_Pos(start),
+    m_End((end < 0 || end > text.length()) ? text.length() : end),
+    m_Line(line),
+    m_State(state)
+{
+}
+
+
+CSSTokenizer::State CSSTokenizer::EndState() const
+{
+    return m_State;
+}
+
+
+CSSTokenizer::Token CSSTokenizer::Next()
+{
+    Token token;
+    token.start = m_Pos;
+    token.line = m_Line;
+
+    if (m_Pos >= m_End) {
+        token.type = EndOfFile;
+        token.length = 0;
+        return token;
+    }
+
+    // Pick up a comment or string left open at the end of the previous text
+    if (m_State == CommentState) {
+        ConsumeComment();
+        token.type = Comment;
+        token.length = m_Pos - token.start;
+        return token;
+    }
+
+    if (m_State == DoubleQuoteState || m_State == SingleQuoteState) {
+        token.type = ConsumeString(m_State == DoubleQuoteState ? QChar('"') : QChar('\''));
+        token.length = m_Pos - token.start;
+        return token;
+    }
+
+    QChar c = Peek();
+    ushort u = c.unicode();
+
+    if (u == ' ' || u == '\t' || u == '\n' || u == '\r' || u == '\f') {
+        while (m_Pos < m_End) {
+            u = Peek().unicode();
+            if (u != ' ' && u != '\t' && u != '\n' && u != '\r' && u != '\f') {
+                break;
+            }
+            Advance();
+        }
+        token.type = Whitespace;
+    } else if (u == '"' || u == '\'') {
+        Advance();
+        token.type = ConsumeString(c);
+    } else if (u == '/' && Peek(1) == QChar('*')) {
+        Advance();
+        Advance();
+        m_State = CommentState;
+        ConsumeComment();
+        token.type = Comment;
+    } else if (u == '#') {
+        Advance();
+        if (IsNameChar(Peek()) || IsValidEscape(0)) {
+            ConsumeName();
+            token.type = Hash;
+        } else {
+            token.type = Delim;
+        }
+    } else if (u == '(') {
+        Advance();
+        token.type = OpenParen;
+    } else if (u == ')') {
+        Advance();
+        token.type = CloseParen;
+    } else if (u == '[') {
+        Advance();
+        token.type = OpenSquare;
+    } else if (u == ']') {
+        Advance();
+        token.type = CloseSquare;
+    } else if (u == '{') {
+        Advance();
+        token.type = OpenCurly;
+    } else if (u == '}') {
+        Advance();
+        token.type = CloseCurly;
+    } else if (u == ',') {
+        Advance();
+        token.type = Comma;
+    } else if (u == ':') {
+        Advance();
+        token.type = Colon;
+    } else if (u == ';') {
+        Advance();
+        token.type = Semicolon;
+    } else if ((u == '+' || u == '.') && StartsNumber(0)) {
+        token.type = ConsumeNumeric();
+    } else if (u == '-') {
+        if (StartsNumber(0)) {
+            token.type = ConsumeNumeric();
+        } else if (Peek(1) == QChar('-') && Peek(2) == QChar('>')) {
+            Advance();
+            Advance();
+            Advance();
+            token.type = CDC;
+        } else if (StartsIdentifier(0)) {
+            token.type = ConsumeIdentLike();
+        } else {
+            Advance();
+            token.type = Delim;
+        }
+    } else if (u == '<' && Peek(1) == QChar('!') && Peek(2) == QChar('-') && Peek(3) == QChar('-')) {
+        for (int i = 0; i < 4; ++i) {
+            Advance();
+        }
+        token.type = CDO;
+    } else if (u == '@') {
+        Advance();
+        if (StartsIdentifier(0)) {
+            ConsumeName();
+            token.type = AtKeyword;
+        } else {
+            token.type = Delim;
+        }
+    } else if (u == '\\') {
+        if (IsValidEscape(0)) {
+            token.type = ConsumeIdentLike();
+        } else {
+            Advance();
+            token.type = Delim;
+        }
+    } else if (IsDigit(c)) {
+        token.type = ConsumeNumeric();
+    } else if (IsNameStart(c)) {
+        token.type = ConsumeIdentLike();
+    } else {
+        Advance();
+        token.type = Delim;
+    }
+
+    token.length = m_Pos - token.start;
+    return token;
+}
+
+
+QChar CSSTokenizer::Peek(int offset) const
+{
+    int pos = m_Pos + offset;
+    return pos < m_End ? m_Text.at(pos) : QChar();
+}
+
+
+void CSSTokenizer::Advance()
+{
+    if (m_Text.at(m_Pos) == QChar('\n')) {
+        m_Line++;
+    }
+    m_Pos++;
+}
+
+
+bool CSSTokenizer::IsNameStart(QChar c) const
+{
+    ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || u == '_' || u >= 0x80;
+}
+
+
+bool CSSTokenizer::IsNameChar(QChar c) const
+{
+    ushort u = c.unicode();
+    return IsNameStart(c) || IsDigit(c) || u == '-';
+}
+
+
+// CSS digits are only the ASCII ones, unlike QChar::isDigit
+bool CSSTokenizer::IsDigit(QChar c) const
+{
+    ushort u = c.unicode();
+    return u >= '0' && u <= '9';
+}
+
+
+bool CSSTokenizer::IsValidEscape(int offset) const
+{
+    return m_Pos + offset + 1 < m_End && Peek(offset) == QChar('\\') && Peek(offset + 1) != QChar('\n');
+}
+
+
+bool CSSTokenizer::StartsIdentifier(int offset) const
+{
+    QChar c = Peek(offset);
+
+    if (c == QChar('-')) {
+        QChar next = Peek(offset + 1);
+        return IsNameStart(next) || next == QChar('-') || IsValidEscape(offset + 1);
+    }
+
+    return IsNameStart(c) || IsValidEscape(offset);
+}
+
+
+bool CSSTokenizer::StartsNumber(int offset) const
+{
+    QChar c = Peek(offset);
+
+    if (c == QChar('+') || c == QChar('-')) {
+        QChar next = Peek(offset + 1);
+        return IsDigit(next) || (next == QChar('.') && IsDigit(Peek(offset + 2)));
+    }
+
+    if (c == QChar('.')) {
+        return IsDigit(Peek(offset + 1));
+    }
+
+    return IsDigit(c);
+}
+
+
+void CSSTokenizer::ConsumeEscape()
+{
+    // the backslash
+    Advance();
+
+    if (m_Pos >= m_End) {
+        return;
+    }
+
+    if (isxdigit(Peek().toLatin1())) {
+        for (int i = 0; i < 6 && m_Pos < m_End && isxdigit(Peek().toLatin1()); ++i) {
+            Advance();
+        }
+        // a single whitespace after a hex escape belongs to it
+        ushort u = Peek().unicode();
+        if (m_Pos < m_End && (u == ' ' || u == '\t' || u == '\n' || u == '\r' || u == '\f')) {
+            Advance();
+        }
+    } else {
+        Advance();
+    }
+}
+
+
+void CSSTokenizer::ConsumeName()
+{
+    while (m_Pos < m_End) {
+        if (IsNameChar(Peek())) {
+            Advance();
+        } else if (IsValidEscape(0)) {
+            ConsumeEscape();
+        } else {
+            break;
+        }
+    }
+}
+
+
+void CSSTokenizer::ConsumeNumber()
+{
+    if (Peek() == QChar('+') || Peek() == QChar('-')) {
+        Advance();
+    }
+
+    while (IsDigit(Peek())) {
+        Advance();
+    }
+
+    if (Peek() == QChar('.') && IsDigit(Peek(1))) {
+        Advance();
+        while (IsDigit(Peek())) {
+            Advance();
+        }
+    }
+
+    if (Peek() == QChar('e') || Peek() == QChar('E')) {
+        if (IsDigit(Peek(1))) {
+            Advance();
+        } else if ((Peek(1) == QChar('+') || Peek(1) == QChar('-')) && IsDigit(Peek(2))) {
+            Advance();
+            Advance();
+        } else {
+            return;
+        }
+        while (IsDigit(Peek())) {
+            Advance();
+        }
+    }
+}
+
+
+CSSTokenizer::TokenType CSSTokenizer::ConsumeNumeric()
+{
+    ConsumeNumber();
+
+    if (StartsIdentifier(0)) {
+        ConsumeName();
+        return Dimension;
+    }
+
+    if (Peek() == QChar('%')) {
+        Advance();
+        return Percentage;
+    }
+
+    return Number;
+}
+
+
+CSSTokenizer::TokenType CSSTokenizer::ConsumeIdentLike()
+{
+    int start = m_Pos;
+    ConsumeName();
+
+    if (Peek() != QChar('(')) {
+        return Ident;
+    }
+
+    bool is_url = (m_Pos - start == 3) && m_Text.midRef(start, 3).compare(QLatin1String("url"), Qt::CaseInsensitive) == 0;
+    Advance();
+
+    if (!is_url) {
+        return Function;
+    }
+
+    // url( followed by a quote is a plain function holding a string
+    int offset = 0;
+    ushort u = Peek(offset).unicode();
+    while (u == ' ' || u == '\t' || u == '\n' || u == '\r' || u == '\f') {
+        u = Peek(++offset).unicode();
+    }
+
+    if (u == '"' || u == '\'') {
+        return Function;
+    }
+
+    return ConsumeUrl();
+}
+
+
+CSSTokenizer::TokenType CSSTokenizer::ConsumeUrl()
+{
+    while (m_Pos < m_End) {
+        ushort u = Peek().unicode();
+        if (u != ' ' && u != '\t' && u != '\n' && u != '\r' && u != '\f') {
+            break;
+        }
+        Advance();
+    }
+
+    while (m_Pos < m_End) {
+        ushort u = Peek().unicode();
+
+        if (u == ')') {
+            Advance();
+            return Url;
+        }
+
+        if (u == ' ' || u == '\t' || u == '\n' || u == '\r' || u == '\f') {
+            while (m_Pos < m_End) {
+                u = Peek().unicode();
+                if (u != ' ' && u != '\t' && u != '\n' && u != '\r' && u != '\f') {
+                    break;
+                }
+                Advance();
+            }
+            if (m_Pos >= m_End) {
+                return Url;
+            }
+            if (Peek() == QChar(')')) {
+                Advance();
+                return Url;
+            }
+            ConsumeBadUrlRemnants();
+            return BadUrl;
+        }
+
+        if (u == '"' || u == '\'' || u == '(' || u < 0x09 || u == 0x0B || (u >= 0x0E && u <= 0x1F) || u == 0x7F) {
+            ConsumeBadUrlRemnants();
+            return BadUrl;
+        }
+
+        if (u == '\\') {
+            if (IsValidEscape(0)) {
+                ConsumeEscape();
+            } else {
+                ConsumeBadUrlRemnants();
+                return BadUrl;
+            }
+        } else {
+            Advance();
+        }
+    }
+
+    return Url;
+}
+
+
+void CSSTokenizer::ConsumeBadUrlRemnants()
+{
+    while (m_Pos < m_End) {
+        if (Peek() == QChar(')')) {
+            Advance();
+            return;
+        }
+
+        if (IsValidEscape(0)) {
+            ConsumeEscape();
+        } else {
+            Advance();
+        }
+    }
+}
+
+
+CSSTokenizer::TokenType CSSTokenizer::ConsumeString(QChar quote)
+{
+    m_State = quote == QChar('"') ? DoubleQuoteState : SingleQuoteState;
+
+    while (m_Pos < m_End) {
+        QChar c = Peek();
+
+        if (c == quote) {
+            Advance();
+            m_State = NormalState;
+            return String;
+        }
+
+        if (c == QChar('\n')) {
+            // an unescaped newline ends the string without consuming it
+            m_State = NormalState;
+            return BadString;
+        }
+
+        if (c == QChar('\\')) {
+            Advance();
+            if (m_Pos < m_End) {
+                Advance();
+            }
+        } else {
+            Advance();
+        }
+    }
+
+    // the string runs past the end, it may go on in the next text
+    return String;
+}
+
+
+void CSSTokenizer::ConsumeComment()
+{
+    while (m_Pos < m_End) {
+        if (Peek() == QChar('*') && Peek(1) == QChar('/')) {
+            Advance();
+            Advance();
+            m_State = NormalState;
+            return;
+        }
+        Advance();
+    }
+}
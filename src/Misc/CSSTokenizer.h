@@ -0,0 +1,140 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef CSSTOKENIZER_H
+#define CSSTOKENIZER_H
+
+#include <QtCore/QString>
+
+/**
+ * A single pass tokenizer following the tokenization rules of
+ * CSS Syntax Module Level 3. Every character of the text belongs
+ * to exactly one token and each token knows its line, so the
+ * positions reported by everything built on it are exact.
+ *
+ * The tokenizer can start inside a comment or string and reports
+ * the state it ended in, so the syntax highlighter can tokenize
+ * a document one block at a time.
+ */
+class CSSTokenizer
+{
+
+public:
+
+    enum TokenType {
+        Whitespace,
+        Comment,
+        Ident,
+        Function,
+        AtKeyword,
+        Hash,
+        String,
+        BadString,
+        Url,
+        BadUrl,
+        Delim,
+        Number,
+        Percentage,
+        Dimension,
+        CDO,
+        CDC,
+        Colon,
+        Semicolon,
+        Comma,
+        OpenSquare,
+        CloseSquare,
+        OpenParen,
+        CloseParen,
+        OpenCurly,
+        CloseCurly,
+        EndOfFile
+    };
+
+    // What the text ended inside of, to resume tokenizing after it
+    enum State {
+        NormalState,
+        CommentState,
+        DoubleQuoteState,
+        SingleQuoteState
+    };
+
+    struct Token {
+        TokenType type;
+        int start;
+        int length;
+        int line;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param text The text to tokenize.
+     * @param start Where in text to start.
+     * @param end Where in text to stop, -1 for the end of text.
+     * @param line The line number of start.
+     * @param state What start is inside of.
+     */
+    CSSTokenizer(const QString &text, int start = 0, int end = -1, int line = 1, State state = NormalState);
+
+    /**
+     * Returns the next token, EndOfFile once all the text is consumed.
+     */
+    Token Next();
+
+    /**
+     * The state at the end of the text, only meaningful once EndOfFile is returned.
+     */
+    State EndState() const;
+
+private:
+
+    QChar Peek(int offset = 0) const;
+
+    bool IsNameStart(QChar c) const;
+    bool IsNameChar(QChar c) const;
+    bool IsDigit(QChar c) const;
+    bool IsValidEscape(int offset) const;
+    bool StartsIdentifier(int offset) const;
+    bool StartsNumber(int offset) const;
+
+    void ConsumeEscape();
+    void ConsumeName();
+    void ConsumeNumber();
+    TokenType ConsumeNumeric();
+    TokenType ConsumeIdentLike();
+    TokenType ConsumeUrl();
+    TokenType ConsumeString(QChar quote);
+    void ConsumeComment();
+    void ConsumeBadUrlRemnants();
+
+    // Advances one character keeping the line count
+    void Advance();
+
+    const QString &m_Text;
+    int m_Pos;
+    int m_End;
+    int m_Line;
+    State m_State;
+};
+
+#endif // CSSTOKENIZER_H
@@ -0,0 +1,119 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <QtConcurrent/QtConcurrent>
+
+#include "Misc/FindAllResults.h"
+#include "ResourceObjects/TextResource.h"
+
+bool FindAllResults::Update(const QString &search_regex, const QList<Resource *> &resources)
+{
+    if (search_regex != m_SearchRegex) {
+        Clear();
+        m_SearchRegex = search_regex;
+    }
+
+    QList<Resource *> stale_resources;
+    QStringList order;
+    foreach(Resource * resource, resources) {
+        TextResource *text_resource = qobject_cast<TextResource *>(resource);
+
+        if (!text_resource) {
+            continue;
+        }
+
+        QString identifier = resource->GetIdentifier();
+        order.append(identifier);
+
+        if (!m_Files.contains(identifier) ||
+            (m_Files.value(identifier).revision != text_resource->GetTextRevision()) ||
+            (m_Files.value(identifier).bookpath != resource->GetRelativePath())) {
+            stale_resources.append(resource);
+        }
+    }
+
+    if (!stale_resources.isEmpty()) {
+        QFuture<std::pair<QString, FileResults>> future = QtConcurrent::mapped(stale_resources,
+                                                                               std::bind(ScanOneFile, search_regex, std::placeholders::_1));
+
+        if (!SearchOperations::WaitForFiles(QFuture<void>(future), QObject::tr("Searching..."), stale_resources.count())) {
+            // Whatever was kept still matches its revision so leave it
+            return false;
+        }
+
+        foreach(const std::pair<QString, FileResults> &entry, future.results()) {
+            m_Files.insert(entry.first, entry.second);
+        }
+    }
+
+    // Files outside of this set are kept as Find Next
+    // and Find All may search different sets of files
+    m_Order = order;
+    return true;
+}
+
+
+QList<SearchOperations::SearchResult> FindAllResults::GetResults() const
+{
+    QList<SearchOperations::SearchResult> results;
+    foreach(QString identifier, m_Order) {
+        results.append(m_Files.value(identifier).results);
+    }
+    return results;
+}
+
+
+bool FindAllResults::FileHasMatches(Resource *resource) const
+{
+    return !m_Files.value(resource->GetIdentifier()).results.isEmpty();
+}
+
+
+int FindAllResults::Count() const
+{
+    int count = 0;
+    foreach(QString identifier, m_Order) {
+        count += m_Files.value(identifier).results.count();
+    }
+    return count;
+}
+
+
+void FindAllResults::Clear()
+{
+    m_SearchRegex.clear();
+    m_Files.clear();
+    m_Order.clear();
+}
+
+
+std::pair<QString, FindAllResults::FileResults> FindAllResults::ScanOneFile(const QString &search_regex, Resource *resource)
+{
+    FileResults file_results;
+    TextResource *text_resource = qobject_cast<TextResource *>(resource);
+    // Read the revision before the text so a concurrent
+    // change makes this entry stale rather than wrong
+    file_results.revision = text_resource->GetTextRevision();
+    file_results.bookpath = resource->GetRelativePath();
+    file_results.results = SearchOperations::FindInFile(search_regex, resource, SearchOperations::CodeViewSearch);
+    return std::make_pair(resource->GetIdentifier(), file_results);
+}
@@ -0,0 +1,92 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef FINDALLRESULTS_H
+#define FINDALLRESULTS_H
+
+#include <utility>
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "Misc/SearchOperations.h"
+
+class Resource;
+
+/**
+ * The matches of one search over a set of html files.
+ *
+ * The files are scanned once, in parallel, and the matches kept per file
+ * together with the text revision they were found in. Updating for the
+ * same search only rescans files whose text changed since, so stepping
+ * from match to match across the book does not rerun the search on every
+ * file passed over.
+ */
+class FindAllResults
+{
+
+public:
+
+    /**
+     * Brings the results up to date for search_regex over resources.
+     *
+     * @return False if the user cancelled the scan.
+     */
+    bool Update(const QString &search_regex, const QList<Resource *> &resources);
+
+    /**
+     * All matches in the reading order of the resources
+     * given to the last Update() and text order within a file.
+     */
+    QList<SearchOperations::SearchResult> GetResults() const;
+
+    bool FileHasMatches(Resource *resource) const;
+
+    int Count() const;
+
+    void Clear();
+
+private:
+
+    struct FileResults {
+        int revision;
+        QString bookpath;
+        QList<SearchOperations::SearchResult> results;
+
+        FileResults() : revision(-1) {}
+    };
+
+    static std::pair<QString, FileResults> ScanOneFile(const QString &search_regex, Resource *resource);
+
+    QString m_SearchRegex;
+
+    // FileResults keyed on resource identifier
+    QHash<QString, FileResults> m_Files;
+
+    // resource identifiers in reading order
+    QStringList m_Order;
+};
+
+#endif // FINDALLRESULTS_H
@@ -23,6 +23,7 @@
 #ifndef FONTOBFUSCATION_H
 #define FONTOBFUSCATION_H
 
+class QByteArray;
 class QString;
 
 namespace FontObfuscation
@@ -30,6 +31,11 @@ namespace FontObfuscation
 void ObfuscateFile(const QString &filepath,
                    const QString &algorithm,
                    const QString &identifier);
+
+// Obfuscates (or deobfuscates) font data held in memory
+void ObfuscateData(QByteArray &contents,
+                   const QString &algorithm,
+                   const QString &identifier);
 }
 
 #endif // FONTOBFUSCATION_H
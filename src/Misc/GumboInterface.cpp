@@ -91,6 +91,99 @@ static std::unordered_set<std::string> href_src_tags       = {
 };
 
 
+// the sets above folded into one bit mask per tag so the
+// serializers need a single lookup per node
+enum TagProperty {
+    NONBREAKING_INLINE_TAG  = 1 << 0,
+    PRESERVE_WHITESPACE_TAG = 1 << 1,
+    SPECIAL_HANDLING_TAG    = 1 << 2,
+    NO_ENTITY_SUB_TAG       = 1 << 3,
+    VOID_TAG                = 1 << 4,
+    STRUCTURAL_TAG          = 1 << 5,
+    OTHER_TEXT_HOLDER_TAG   = 1 << 6,
+    HREF_SRC_TAG            = 1 << 7
+};
+
+
+static unsigned int tag_properties_from_name(const std::string &tagname)
+{
+    unsigned int properties = 0;
+    if (nonbreaking_inline.count(tagname))  properties |= NONBREAKING_INLINE_TAG;
+    if (preserve_whitespace.count(tagname)) properties |= PRESERVE_WHITESPACE_TAG;
+    if (special_handling.count(tagname))    properties |= SPECIAL_HANDLING_TAG;
+    if (no_entity_sub.count(tagname))       properties |= NO_ENTITY_SUB_TAG;
+    if (void_tags.count(tagname))           properties |= VOID_TAG;
+    if (structural_tags.count(tagname))     properties |= STRUCTURAL_TAG;
+    if (other_text_holders.count(tagname))  properties |= OTHER_TEXT_HOLDER_TAG;
+    if (href_src_tags.count(tagname))       properties |= HREF_SRC_TAG;
+    return properties;
+}
+
+
+// properties of every tag gumbo knows indexed by GumboTag
+struct TagPropertyTable
+{
+    TagPropertyTable()
+    {
+        for (int tag = 0; tag < GUMBO_TAG_UNKNOWN; tag++) {
+            properties[tag] = tag_properties_from_name(gumbo_normalized_tagname(static_cast<GumboTag>(tag)));
+        }
+    }
+    unsigned int properties[GUMBO_TAG_UNKNOWN];
+};
+
+
+// tagname must be the result of get_tag_name(node)
+static unsigned int tag_properties(GumboNode *node, const std::string &tagname)
+{
+    if ((node->type != GUMBO_NODE_ELEMENT) && (node->type != GUMBO_NODE_TEMPLATE)) {
+        return 0;
+    }
+    static const TagPropertyTable table;
+    GumboTag tag = node->v.element.tag;
+    // svg and unknown tags are named after their original text
+    if ((tag < GUMBO_TAG_UNKNOWN) && (node->v.element.tag_namespace != GUMBO_NAMESPACE_SVG)) {
+        return table.properties[tag];
+    }
+    return tag_properties_from_name(tagname);
+}
+
+
+// replacement text for the characters xml requires be escaped
+struct XMLEntityTable
+{
+    XMLEntityTable()
+    {
+        for (int c = 0; c < 256; c++) entity[c] = NULL;
+        entity[static_cast<unsigned char>('&')]  = "&amp;";
+        entity[static_cast<unsigned char>('<')]  = "&lt;";
+        entity[static_cast<unsigned char>('>')]  = "&gt;";
+        entity[static_cast<unsigned char>('"')]  = "&quot;";
+        entity[static_cast<unsigned char>('\'')] = "&apos;";
+    }
+    const char * entity[256];
+};
+
+
+// append text to out escaping & < and > and any quote
+// characters matching the attribute quote in use
+static void append_xml_escaped(std::string &out, const char * text, size_t len, char quote)
+{
+    static const XMLEntityTable table;
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = text[i];
+        const char * entity = table.entity[static_cast<unsigned char>(c)];
+        if (!entity) continue;
+        if (((c == '"') || (c == '\'')) && (c != quote)) continue;
+        out.append(text + start, i - start);
+        out.append(entity);
+        start = i + 1;
+    }
+    out.append(text + start, len - start);
+}
+
+
 static const QChar POUND_SIGN    = QChar::fromLatin1('#');
 static const QChar FORWARD_SLASH = QChar::fromLatin1('/');
 static const std::string aSRC = std::string("src");
@@ -184,6 +277,17 @@ void GumboInterface::parse()
 }
 
 
+int GumboInterface::get_source_index(unsigned int offset)
+{
+    if (m_output == NULL) {
+        parse();
+    }
+    // the xml header removed before parsing is not counted in the offsets
+    int header_length = m_source.length() - QString::fromStdString(m_utf8src).length();
+    return header_length + QString::fromUtf8(m_utf8src.data(), offset).length();
+}
+
+
 QString GumboInterface::repair()
 {
     QString result = "";
@@ -222,7 +326,9 @@ QString GumboInterface::prettyprint(QString indent_chars)
             parse();
         }
         std::string ind = indent_chars.toStdString();
-        std::string utf8out = prettyprint(m_output->document, 0, ind);
+        std::string utf8out;
+        utf8out.reserve(m_utf8src.length() + m_utf8src.length() / 4);
+        prettyprint(m_output->document, 0, ind, utf8out);
         rtrim(utf8out);
         result =  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" + QString::fromStdString(utf8out);
     }
@@ -770,19 +876,39 @@ void GumboInterface::ltrim(std::string &s)
 }
 
 
-void GumboInterface::ltrimnewlines(std::string &s)
+// the versions taking a position only look at the tail of s
+// starting at pos, so serializers can trim what they just appended
+
+void GumboInterface::rtrim(std::string &s, size_t pos)
 {
-    s.erase(0,s.find_first_not_of("\n\r"));
+    size_t last = s.find_last_not_of(" \n\r\t\v\f");
+    if ((last == std::string::npos) || (last < pos)) {
+        s.resize(pos);
+    } else {
+        s.resize(last+1);
+    }
 }
 
 
-// delete everything up to and including the newline
-void GumboInterface::newlinetrim(std::string &s)
+void GumboInterface::ltrim(std::string &s, size_t pos)
 {
-  size_t pos = s.find("\n");
-  if (pos != std::string::npos) {
-    s.erase(0, pos+1);
-  }
+    size_t first = s.find_first_not_of(" \n\r\t\v\f", pos);
+    if (first == std::string::npos) first = s.length();
+    s.erase(pos, first - pos);
+}
+
+
+void GumboInterface::ltrimnewlines(std::string &s, size_t pos)
+{
+    size_t first = s.find_first_not_of("\n\r", pos);
+    if (first == std::string::npos) first = s.length();
+    s.erase(pos, first - pos);
+}
+
+
+bool GumboInterface::is_blank(const std::string &s, size_t pos)
+{
+    return s.find_first_not_of(" \n\r\t\v\f", pos) == std::string::npos;
 }
 
 
@@ -909,23 +1035,9 @@ std::string GumboInterface::update_style_urls(const std::string &source)
 
 std::string GumboInterface::substitute_xml_entities_into_text(const std::string &text)
 {
-    std::string result = text;
-    // replacing & must come first 
-    replace_all(result, "&", "&amp;");
-    replace_all(result, "<", "&lt;");
-    replace_all(result, ">", "&gt;");
-    return result;
-}
-
-
-std::string GumboInterface::substitute_xml_entities_into_attributes(char quote, const std::string &text)
-{
-    std::string result = substitute_xml_entities_into_text(text);
-    if (quote == '"') {
-        replace_all(result,"\"","&quot;");
-    } else if (quote == '\'') {
-        replace_all(result,"'","&apos;");
-    }
+    std::string result;
+    result.reserve(text.length());
+    append_xml_escaped(result, text.data(), text.length(), 0);
     return result;
 }
 
@@ -1015,66 +1127,86 @@ std::string GumboInterface::get_attribute_name(GumboAttribute * at)
 }
 
 
-std::string GumboInterface::build_attributes(GumboAttribute * at, bool no_entities, 
-                                             bool run_src_updates, bool run_style_updates)
+void GumboInterface::build_attributes(std::string &out, GumboAttribute * at, bool no_entities,
+                                      bool run_src_updates, bool run_style_updates)
 {
-    std::string atts = " ";
-    std::string name = get_attribute_name(at);
+    out.push_back(' ');
+    out.append(get_attribute_name(at));
     std::string local_name = at->name;
-    atts.append(name);
-    std::string attvalue = at->value;
+    const char * attvalue = at->value;
+    size_t attvalue_len = strlen(attvalue);
+    std::string updated_value;
 
-    if (run_src_updates && (local_name == aHREF || local_name == aSRC || 
+    if (run_src_updates && (local_name == aHREF || local_name == aSRC ||
                             local_name == aPOSTER || local_name == aDATA)) {
-        attvalue = update_attribute_value(attvalue);
+        updated_value = update_attribute_value(attvalue);
+        attvalue = updated_value.data();
+        attvalue_len = updated_value.length();
     }
 
     if (run_style_updates && (local_name == "style")) {
-        attvalue = update_style_urls(attvalue);
+        updated_value = update_style_urls(std::string(attvalue, attvalue_len));
+        attvalue = updated_value.data();
+        attvalue_len = updated_value.length();
     }
 
     // we handle empty attribute values like so: alt=""
     char quote = '"';
-    std::string qs="\"";
+    char qs = '"';
 
     // verify an original value existed since we create our own attributes
     // and if so determine the original quote character used if any
 
     if (at->original_value.data) {
-        if ( (!attvalue.empty())   || 
-             (at->original_value.data[0] == '"') || 
+        if ( (attvalue_len > 0)   ||
+             (at->original_value.data[0] == '"') ||
              (at->original_value.data[0] == '\'') ) {
 
           quote = at->original_value.data[0];
-          if (quote == '\'') qs = std::string("'");
-          if (quote == '"') qs = std::string("\"");
+          if (quote == '\'') qs = '\'';
         }
     }
 
-    atts.append("=");
-    atts.append(qs);
+    out.push_back('=');
+    out.push_back(qs);
     if (no_entities) {
-        atts.append(attvalue);
+        out.append(attvalue, attvalue_len);
     } else {
-        atts.append(substitute_xml_entities_into_attributes(quote, attvalue));
+        append_xml_escaped(out, attvalue, attvalue_len, quote);
     }
-    atts.append(qs);
-    return atts;
+    out.push_back(qs);
 }
 
 
-// serialize children of a node
+std::string GumboInterface::serialize_contents(GumboNode* node, enum UpdateTypes doupdates) {
+    std::string contents;
+    contents.reserve(m_utf8src.length());
+    serialize_contents(node, contents, doupdates);
+    return contents;
+}
+
+
+std::string GumboInterface::serialize(GumboNode* node, enum UpdateTypes doupdates) {
+    std::string results;
+    // the output is usually close to the size of the source
+    results.reserve(m_utf8src.length() + m_newbody.length() + m_newcsslinks.length() + 1024);
+    serialize(node, results, doupdates);
+    return results;
+}
+
+
+// serialize children of a node appending them to out
 // may be invoked recursively
 
-std::string GumboInterface::serialize_contents(GumboNode* node, enum UpdateTypes doupdates) {
-    std::string contents        = "";
+void GumboInterface::serialize_contents(GumboNode* node, std::string &out, enum UpdateTypes doupdates) {
     std::string tagname         = get_tag_name(node);
-    bool no_entity_substitution = in_set(no_entity_sub, tagname);
-    bool keep_whitespace        = in_set(preserve_whitespace, tagname);
-    bool is_inline              = in_set(nonbreaking_inline, tagname);
-    bool is_structural          = in_set(structural_tags, tagname);
+    unsigned int properties     = tag_properties(node, tagname);
+    bool no_entity_substitution = properties & NO_ENTITY_SUB_TAG;
+    bool keep_whitespace        = properties & PRESERVE_WHITESPACE_TAG;
+    bool is_inline              = properties & NONBREAKING_INLINE_TAG;
+    bool is_structural          = properties & STRUCTURAL_TAG;
 
-    // build up result for each child, recursively if need be
+    // append the result for each child, recursively if need be
     GumboVector* children = &node->v.element.children;
 
     bool inject_newline = false;
@@ -1084,155 +1216,166 @@ std::string GumboInterface::serialize_contents(GumboNode* node, enum UpdateTypes
         GumboNode* child = static_cast<GumboNode*> (children->data[i]);
 
         if (child->type == GUMBO_NODE_TEXT) {
-            std::string text;
+            const char * text = child->v.text.text;
+            // substituting entities never changes a leading newline
+            if (inject_newline && (text[0] == '\n')) text++;
+            inject_newline = false;
             if (no_entity_substitution) {
-                text = std::string(child->v.text.text);
+                out.append(text);
             } else {
-                text = substitute_xml_entities_into_text(std::string(child->v.text.text));
+                append_xml_escaped(out, text, strlen(text), 0);
             }
-            if (inject_newline && !text.empty() && (text.at(0) == '\n')) text.erase(0,1);
-            inject_newline = false;
-            contents.append(text);
 
         } else if (child->type == GUMBO_NODE_ELEMENT || child->type == GUMBO_NODE_TEMPLATE) {
-            contents.append(serialize(child, doupdates));
+            serialize(child, out, doupdates);
             inject_newline = false;
             std::string childname = get_tag_name(child);
             if (in_head_without_title && (childname == "title")) in_head_without_title = false;
-            if (!is_inline && !keep_whitespace && !in_set(nonbreaking_inline,childname) && is_structural) {
-                contents.append("\n");
+            if (!is_inline && !keep_whitespace &&
+                !(tag_properties(child, childname) & NONBREAKING_INLINE_TAG) && is_structural) {
+                out.push_back('\n');
                 inject_newline = true;
             }
 
         } else if (child->type == GUMBO_NODE_WHITESPACE) {
             // try to keep all whitespace to keep as close to original as possible
-            std::string wspace = std::string(child->v.text.text);
+            const char * wspace = child->v.text.text;
             if (inject_newline) {
-                newlinetrim(wspace);
+                // skip everything up to and including the newline
+                const char * newline = strchr(wspace, '\n');
+                if (newline) wspace = newline + 1;
                 inject_newline = false;
             }
-            contents.append(wspace);
+            out.append(wspace);
             inject_newline = false;
 
         } else if (child->type == GUMBO_NODE_CDATA) {
-            contents.append("<![CDATA[" + std::string(child->v.text.text) + "]]>");
+            out.append("<![CDATA[");
+            out.append(child->v.text.text);
+            out.append("]]>");
             inject_newline = false;
 
         } else if (child->type == GUMBO_NODE_COMMENT) {
-            contents.append("<!--" + std::string(child->v.text.text) + "-->");
- 
+            out.append("<!--");
+            out.append(child->v.text.text);
+            out.append("-->");
+
         } else {
-            fprintf(stderr, "unknown element of type: %d\n", child->type); 
+            fprintf(stderr, "unknown element of type: %d\n", child->type);
             inject_newline = false;
         }
 
     }
-    if (in_head_without_title) contents.append("<title></title>");
-    return contents;
+    if (in_head_without_title) out.append("<title></title>");
 }
 
 
-// serialize a GumboNode back to html/xhtml
+// serialize a GumboNode back to html/xhtml appending it to out
 // may be invoked recursively
 
-std::string GumboInterface::serialize(GumboNode* node, enum UpdateTypes doupdates) {
+void GumboInterface::serialize(GumboNode* node, std::string &out, enum UpdateTypes doupdates) {
     // special case the document node
     if (node->type == GUMBO_NODE_DOCUMENT) {
-        std::string results = build_doctype(node);
-        results.append(serialize_contents(node, doupdates));
-        return results;
+        out.append(build_doctype(node));
+        serialize_contents(node, out, doupdates);
+        return;
     }
 
-    std::string close = "";
-    std::string closeTag = "";
-    std::string atts = "";
     std::string tagname            = get_tag_name(node);
-    bool need_special_handling     = in_set(special_handling, tagname);
-    bool is_void_tag               = in_set(void_tags, tagname);
-    bool no_entity_substitution    = in_set(no_entity_sub, tagname);
-    bool is_href_src_tag           = in_set(href_src_tags, tagname);
+    unsigned int properties        = tag_properties(node, tagname);
+    bool need_special_handling     = properties & SPECIAL_HANDLING_TAG;
+    bool is_void_tag               = properties & VOID_TAG;
+    bool no_entity_substitution    = properties & NO_ENTITY_SUB_TAG;
+    bool is_href_src_tag           = properties & HREF_SRC_TAG;
     bool in_xml_ns                 = node->v.element.tag_namespace != GUMBO_NAMESPACE_HTML;
-    // bool is_inline                 = in_set(nonbreaking_inline, tagname);
 
-    // build attr string  
+    // the links in the head are replaced by the new ones
+    if ((doupdates & LinkUpdates) && (tagname == "link") &&
+        (node->parent->type == GUMBO_NODE_ELEMENT) &&
+        (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
+      return;
+    }
+
+    out.push_back('<');
+    out.append(tagname);
+
+    // build attr string
+    size_t atts_start = out.size();
     const GumboVector * attribs = &node->v.element.attributes;
     for (unsigned int i=0; i< attribs->length; ++i) {
         GumboAttribute* at = static_cast<GumboAttribute*>(attribs->data[i]);
-        atts.append(build_attributes(at, no_entity_substitution, ((doupdates & SourceUpdates) && is_href_src_tag), (doupdates & StyleUpdates)));
+        build_attributes(out, at, no_entity_substitution, ((doupdates & SourceUpdates) && is_href_src_tag), (doupdates & StyleUpdates));
     }
 
     // Make sure that the xmlns attribute exists as an html tag attribute
     if (tagname == "html") {
-      if (atts.find("xmlns=") == std::string::npos) {
-        atts.append(" xmlns=\"http://www.w3.org/1999/xhtml\"");
+      if (out.find("xmlns=", atts_start) == std::string::npos) {
+        out.append(" xmlns=\"http://www.w3.org/1999/xhtml\"");
       }
     }
 
+    size_t close_pos = out.size();
+    out.push_back('>');
+    if (need_special_handling) out.push_back('\n');
+
     // determine contents
-    std::string contents;
+    size_t contents_start = out.size();
 
     if ((tagname == "body") && (doupdates & BodyUpdates)) {
-        contents = m_newbody;
+        out.append(m_newbody);
     } else {
         // serialize your contents
-        contents = serialize_contents(node, doupdates);
+        serialize_contents(node, out, doupdates);
     }
 
-    // determine closing tag type
-    std::string testcontents = contents;
-    ltrim(testcontents);
-    if (is_void_tag || (in_xml_ns && testcontents.empty())) {
-        close = "/";
-    } else {
-        closeTag = "</" + tagname + ">";
+    // determine closing tag type, this only moves contents
+    // that are empty or whitespace
+    bool self_closing = is_void_tag || (in_xml_ns && is_blank(out, contents_start));
+    if (self_closing) {
+        out.insert(close_pos, 1, '/');
+        contents_start++;
     }
 
-    if ((doupdates & StyleUpdates) && (tagname == "style") && 
-        (node->parent->type == GUMBO_NODE_ELEMENT) && 
+    if ((doupdates & StyleUpdates) && (tagname == "style") &&
+        (node->parent->type == GUMBO_NODE_ELEMENT) &&
         (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
-        contents = update_style_urls(contents);
+        std::string contents = out.substr(contents_start);
+        out.resize(contents_start);
+        out.append(update_style_urls(contents));
     }
 
     if (need_special_handling) {
-        ltrimnewlines(contents);
-        rtrim(contents);
-        contents.append("\n");
+        ltrimnewlines(out, contents_start);
+        rtrim(out, contents_start);
+        out.push_back('\n');
     }
 
-    // build results
-    std::string results;
-
-    if ((doupdates & LinkUpdates) && (tagname == "link") && 
-        (node->parent->type == GUMBO_NODE_ELEMENT) && 
-        (node->parent->v.element.tag == GUMBO_TAG_HEAD)) {
-      return "";
-    }
-
-    results.append("<"+tagname+atts+close+">");
-    if (need_special_handling) results.append("\n");
-    results.append(contents);
-
     if ((doupdates & LinkUpdates) && (tagname == "head")) {
-        results.append(m_newcsslinks);
+        out.append(m_newcsslinks);
     }
 
-    results.append(closeTag);
-    if (need_special_handling) results.append("\n");
-    return results;
+    if (!self_closing) {
+        out.append("</");
+        out.append(tagname);
+        out.push_back('>');
+    }
+    if (need_special_handling) out.push_back('\n');
 }
 
 
 
-std::string GumboInterface::prettyprint_contents(GumboNode* node, int lvl, const std::string indent_chars) 
+void GumboInterface::prettyprint_contents(GumboNode* node, int lvl, const std::string &indent_chars, std::string &out)
 {
-    std::string contents        = "";
+    size_t contents_start       = out.size();
     std::string tagname         = get_tag_name(node);
-    bool no_entity_substitution = in_set(no_entity_sub, tagname);
-    bool keep_whitespace        = in_set(preserve_whitespace, tagname);
-    bool is_inline              = in_set(nonbreaking_inline, tagname);
-    bool is_structural          = in_set(structural_tags, tagname);
+    unsigned int properties     = tag_properties(node, tagname);
+    bool no_entity_substitution = properties & NO_ENTITY_SUB_TAG;
+    bool keep_whitespace        = properties & PRESERVE_WHITESPACE_TAG;
+    bool is_inline              = properties & NONBREAKING_INLINE_TAG;
+    bool is_structural          = properties & STRUCTURAL_TAG;
+    bool is_text_holder         = properties & OTHER_TEXT_HOLDER_TAG;
     char c                      = indent_chars.at(0);
-    int  n                      = indent_chars.length(); 
+    int  n                      = indent_chars.length();
     std::string indent_space    = std::string((lvl-1)*n,c);
     char last_char              = 'x';
     bool contains_block_tags    = false;
@@ -1257,177 +1400,187 @@ std::string GumboInterface::prettyprint_contents(GumboNode* node, int lvl, const
 
             // if child of a structual element is text and follows a newline, indent it properly
             if (is_structural && last_char == '\n') {
-                contents.append(indent_space);
+                out.append(indent_space);
                 ltrim(val);
             }
             if (!keep_whitespace && !is_structural) {
                 // okay to condense whitespace
                 condense_whitespace(val);
             }
-            contents.append(val);
+            out.append(val);
 
         } else if (child->type == GUMBO_NODE_ELEMENT || child->type == GUMBO_NODE_TEMPLATE) {
 
-            std::string val = prettyprint(child, lvl, indent_chars);
             std::string childname = get_tag_name(child);
+            bool child_is_inline = tag_properties(child, childname) & NONBREAKING_INLINE_TAG;
             if (in_head_without_title && (childname == "title")) in_head_without_title = false;
-            if (!in_set(nonbreaking_inline, childname)) {
+            if (!child_is_inline) {
                 contains_block_tags = true;
                 if (last_char != '\n') {
-                    contents.append("\n");
-                    if (tagname != "head" && tagname != "html") contents.append("\n");
+                    out.append("\n");
+                    if (tagname != "head" && tagname != "html") out.append("\n");
                     last_char='\n';
                 }
             }
             // if child of a structual element is inline and follows a newline, indent it properly
-            if (is_structural && in_set(nonbreaking_inline, childname) && (last_char == '\n')) {
-                contents.append(indent_space);
-                ltrim(val);
-            }    
-            contents.append(val);
+            bool indent_child = is_structural && child_is_inline && (last_char == '\n');
+            if (indent_child) {
+                out.append(indent_space);
+            }
+            size_t child_start = out.size();
+            prettyprint(child, lvl, indent_chars, out);
+            if (indent_child) {
+                ltrim(out, child_start);
+            }
 
         } else if (child->type == GUMBO_NODE_WHITESPACE) {
 
             if (keep_whitespace) {
-                std::string wspace = std::string(child->v.text.text);
-                contents.append(wspace);
-            } else if (is_inline || in_set(other_text_holders, tagname)) {
+                out.append(child->v.text.text);
+            } else if (is_inline || is_text_holder) {
                 if (std::string(" \t\v\f\r\n").find(last_char) == std::string::npos) {
-                    contents.append(std::string(" "));
+                    out.push_back(' ');
                 }
             }
 
         } else if (child->type == GUMBO_NODE_CDATA) {
-            contents.append("<![CDATA[" + std::string(child->v.text.text) + "]]>");
+            out.append("<![CDATA[");
+            out.append(child->v.text.text);
+            out.append("]]>");
 
         } else if (child->type == GUMBO_NODE_COMMENT) {
-            contents.append("<!--" + std::string(child->v.text.text) + "-->");
- 
+            out.append("<!--");
+            out.append(child->v.text.text);
+            out.append("-->");
+
         } else {
-            fprintf(stderr, "unknown element of type: %d\n", child->type); 
+            fprintf(stderr, "unknown element of type: %d\n", child->type);
         }
 
         // update last character of current contents
-        if (!contents.empty()) {
-            last_char = contents.at(contents.length()-1);
+        if (out.length() > contents_start) {
+            last_char = out.at(out.length()-1);
         }
 
     }
 
     // inject epmpty title into head if one is missing
     if (in_head_without_title) {
-        if (last_char != '\n') contents.append("\n");
-        contents.append(indent_space + "<title></title>\n");
+        if (last_char != '\n') out.append("\n");
+        out.append(indent_space + "<title></title>\n");
         last_char = '\n';
     }
 
     // treat inline tags containing block tags like a block tag
     if (is_inline && contains_block_tags) {
-      if (last_char != '\n') contents.append("\n\n");
-      contents.append(indent_space);
+      if (last_char != '\n') out.append("\n\n");
+      out.append(indent_space);
     }
-
-    return contents;
 }
 
 
-// prettyprint a GumboNode back to html/xhtml
+// prettyprint a GumboNode back to html/xhtml appending it to out
 // may be invoked recursively
 
-std::string GumboInterface::prettyprint(GumboNode* node, int lvl, const std::string indent_chars)
+void GumboInterface::prettyprint(GumboNode* node, int lvl, const std::string &indent_chars, std::string &out)
 {
 
     // special case the document node
     if (node->type == GUMBO_NODE_DOCUMENT) {
-      std::string results = build_doctype(node);
-      results.append(prettyprint_contents(node,lvl+1,indent_chars));
-      return results;
+      out.append(build_doctype(node));
+      prettyprint_contents(node,lvl+1,indent_chars,out);
+      return;
     }
 
     std::string tagname = get_tag_name(node);
     std::string parentname = get_tag_name(node->parent);
     bool in_head = (parentname == "head");
 
-    bool is_structural = in_set(structural_tags, tagname);
-    bool is_inline = in_set(nonbreaking_inline, tagname);
+    unsigned int properties = tag_properties(node, tagname);
+    bool is_structural = properties & STRUCTURAL_TAG;
+    bool is_inline = properties & NONBREAKING_INLINE_TAG;
     bool in_xml_ns = node->v.element.tag_namespace != GUMBO_NAMESPACE_HTML;
+    bool no_entity_substitution = properties & NO_ENTITY_SUB_TAG;
+    bool is_void_tag = properties & VOID_TAG;
+    bool keep_whitespace = properties & PRESERVE_WHITESPACE_TAG;
 
-    // build attr string
-    std::string atts = "";
-    bool no_entity_substitution = in_set(no_entity_sub, tagname);
+    char c = indent_chars.at(0);
+    int  n = indent_chars.length();
+    std::string indent_space = std::string((lvl-1)*n,c);
+
+    // inline tags are never indented
+    if (!is_inline) {
+        out.append(indent_space);
+    }
+
+    // build start tag
+    out.push_back('<');
+    out.append(tagname);
     const GumboVector * attribs = &node->v.element.attributes;
     for (unsigned int i=0; i< attribs->length; ++i) {
         GumboAttribute* at = static_cast<GumboAttribute*>(attribs->data[i]);
-        atts.append(build_attributes(at, no_entity_substitution));
+        build_attributes(out, at, no_entity_substitution);
     }
+    size_t close_pos = out.size();
+    out.push_back('>');
 
-    bool is_void_tag = in_set(void_tags, tagname);
+    // structural tags put their contents on their own lines
+    if (is_structural) {
+        out.push_back('\n');
+    }
 
     // get tag contents
-    std::string contents = "";
+    size_t contents_start = out.size();
     if (!is_void_tag) {
         if (is_structural && tagname != "html") {
-            contents = prettyprint_contents(node, lvl+1, indent_chars);
+            prettyprint_contents(node, lvl+1, indent_chars, out);
         } else {
-            contents = prettyprint_contents(node, lvl, indent_chars);
+            prettyprint_contents(node, lvl, indent_chars, out);
         }
     }
 
-    bool keep_whitespace = in_set(preserve_whitespace, tagname);
     if (!keep_whitespace && !is_inline) {
-        rtrim(contents);
+        rtrim(out, contents_start);
     }
 
-    std::string testcontents = contents;
-    ltrim(testcontents);
-
-    bool single = is_void_tag || (in_xml_ns && testcontents.empty());
-
-    char c = indent_chars.at(0);
-    int  n = indent_chars.length(); 
-    std::string indent_space = std::string((lvl-1)*n,c);
+    bool single = is_void_tag || (in_xml_ns && is_blank(out, contents_start));
 
     // handle self-closed tags with no contents first
     if (single) {
-        std::string selfclosetag = "<" + tagname + atts + "/>";
+        out.resize(close_pos);
+        out.append("/>");
         if (is_inline) {
             // always add newline after br tags when they are children of structural tags
-            if ((tagname == "br") && in_set(structural_tags, parentname)) {
-              selfclosetag.append("\n");
-              if (!in_head && (tagname != "html")) selfclosetag.append("\n");
+            if ((tagname == "br") && (tag_properties(node->parent, parentname) & STRUCTURAL_TAG)) {
+              out.append("\n");
+              if (!in_head && (tagname != "html")) out.append("\n");
             }
-            return selfclosetag;
+            return;
         }
-        if (!in_head && (tagname != "html")) selfclosetag.append("\n");
-        return indent_space + selfclosetag + "\n";
-    } 
+        if (!in_head && (tagname != "html")) out.append("\n");
+        out.append("\n");
+        return;
+    }
 
     // Handle the general case
-    std::string results;
-    std::string starttag = "<" + tagname +  atts + ">";
-    std::string closetag = "</" + tagname + ">";
-
     if (is_structural) {
-        results = indent_space + starttag;
-        if (!contents.empty()) {
-            results.append("\n" + contents + "\n" + indent_space);
-        }  
-        results.append(closetag + "\n");
-        if (!in_head && (tagname != "html")) results.append("\n");
+        if (out.length() == contents_start) {
+            // no contents so no newline after the start tag
+            out.resize(contents_start - 1);
+        } else {
+            out.append("\n" + indent_space);
+        }
+        out.append("</" + tagname + ">\n");
+        if (!in_head && (tagname != "html")) out.append("\n");
     } else if (is_inline) {
-        results = starttag;
-        results.append(contents);
-        results.append(closetag);
+        out.append("</" + tagname + ">");
     } else /** all others */ {
-        results = indent_space + starttag;
         if (!keep_whitespace) {
-            ltrim(contents);
+            ltrim(out, contents_start);
         }
-        results.append(contents);
-        results.append(closetag + "\n");
-        if (!in_head && (tagname != "html")) results.append("\n");
+        out.append("</" + tagname + ">\n");
+        if (!in_head && (tagname != "html")) out.append("\n");
     }
-    return results;
 }
 
 
@@ -87,6 +87,9 @@ public:
 
     // utility routines 
     std::string get_tag_name(GumboNode *node);
+    // maps a byte offset of the parsed source, as in the source positions
+    // of the nodes, to the index of the same character in the source text
+    int get_source_index(unsigned int offset);
     QString get_local_text_of_node(GumboNode* node);
     QString get_body_text();
 
@@ -117,15 +120,20 @@ private:
 
     std::string serialize_contents(GumboNode* node, enum UpdateTypes doupdates = NoUpdates);
 
-    std::string prettyprint(GumboNode* node, int lvl, const std::string indent_chars);
+    // the serializers append to a single output buffer
+    void serialize(GumboNode* node, std::string &out, enum UpdateTypes doupdates);
 
-    std::string prettyprint_contents(GumboNode* node, int lvl, const std::string indent_chars);
+    void serialize_contents(GumboNode* node, std::string &out, enum UpdateTypes doupdates);
+
+    void prettyprint(GumboNode* node, int lvl, const std::string &indent_chars, std::string &out);
+
+    void prettyprint_contents(GumboNode* node, int lvl, const std::string &indent_chars, std::string &out);
 
     std::string build_doctype(GumboNode *node);
 
     std::string get_attribute_name(GumboAttribute * at);
 
-    std::string build_attributes(GumboAttribute * at, bool no_entities, bool run_src_updates = false, bool run_style_updates = false);
+    void build_attributes(std::string &out, GumboAttribute * at, bool no_entities, bool run_src_updates = false, bool run_style_updates = false);
 
     std::string update_attribute_value(const std::string &href);
 
@@ -133,17 +141,19 @@ private:
 
     std::string substitute_xml_entities_into_text(const std::string &text);
 
-    std::string substitute_xml_entities_into_attributes(char quote, const std::string &text);
-
     bool in_set(std::unordered_set<std::string> &s, std::string &key);
 
     void rtrim(std::string &s);
 
     void ltrim(std::string &s);
 
-    void ltrimnewlines(std::string &s);
+    void rtrim(std::string &s, size_t pos);
+
+    void ltrim(std::string &s, size_t pos);
+
+    void ltrimnewlines(std::string &s, size_t pos);
 
-    void newlinetrim(std::string &s);
+    bool is_blank(const std::string &s, size_t pos);
 
     void condense_whitespace(std::string &s);
 
@@ -29,6 +29,7 @@
 #include <QRegularExpression>
 
 #include "Misc/HTMLEncodingResolver.h"
+#include "Misc/Utf8Decoder.h"
 #include "Misc/Utility.h"
 #include "sigil_constants.h"
 #include "sigil_exception.h"
@@ -39,6 +40,11 @@ const QString CHARSET_ATTRIBUTE    = "charset\\s*=\\s*(?:\"|')([^\"']+)(?:\"|')"
 const QString STANDALONE_ATTRIBUTE = "standalone\\s*=\\s*(?:\"|')([^\"']+)(?:\"|')";
 const QString VERSION_ATTRIBUTE    = "<\\?xml[^>]*version\\s*=\\s*(?:\"|')([^\"']+)(?:\"|')[^>]*>";
 
+// How much of the start of a file is searched for an encoding declaration
+static const int ENCODING_PREFIX_SIZE = 1024;
+
+static const int UTF8_MIB = 106;
+
 
 // Accepts a full path to an HTML file.
 // Reads the file, detects the encoding
@@ -53,23 +59,42 @@ QString HTMLEncodingResolver::ReadHTMLFile(const QString &fullfilepath)
         throw (CannotOpenFile(msg));
     }
 
-    QByteArray data = file.readAll();
+    return ReadHTMLData(file.readAll());
+}
+
+
+QString HTMLEncodingResolver::ReadHTMLData(const QByteArray &data)
+{
+    const QTextCodec *codec = GetDeclaredCodec(data);
+    QString text;
+
+    // Text that declares no encoding is taken to be UTF-8 if it is
+    // valid as such, the check and the conversion are one pass.
+    if ((!codec || codec->mibEnum() == UTF8_MIB) && Utf8Decoder::Decode(data, text)) {
+        return Utility::ConvertLineEndings(text);
+    }
 
-    return Utility::ConvertLineEndings(GetCodecForHTML(data)->toUnicode(data));
+    // Finally, let Qt guess and if it doesn't know it will return the codec
+    // for the current locale.
+    if (!codec) {
+        codec = QTextCodec::codecForHtml(data, QTextCodec::codecForLocale());
+    }
+
+    return Utility::ConvertLineEndings(codec->toUnicode(data));
 }
 
 
-// Accepts an HTML stream and tries to determine its encoding;
-// if no encoding is detected, the default codec for this locale is returned.
+// Accepts an HTML stream and tries to determine its encoding from
+// a BOM or an encoding declared in the first ENCODING_PREFIX_SIZE bytes;
+// returns NULL if no encoding is found.
 // We use this function because Qt's QTextCodec::codecForHtml() function
 // leaves a *lot* to be desired.
-const QTextCodec *HTMLEncodingResolver::GetCodecForHTML(const QByteArray &raw_text)
+const QTextCodec *HTMLEncodingResolver::GetDeclaredCodec(const QByteArray &raw_text)
 {
     unsigned char c1;
     unsigned char c2;
     unsigned char c3;
     unsigned char c4;
-    QString text;
     QTextCodec *codec;
 
     if (raw_text.count() < 4) {
@@ -98,11 +123,12 @@ const QTextCodec *HTMLEncodingResolver::GetCodecForHTML(const QByteArray &raw_te
         return QTextCodec::codecForName("UTF-16LE");
     }
 
-    // Try to find an ecoding specified in the file itself.
-    text = Utility::Substring(0, 1024, raw_text);
+    // Try to find an ecoding specified in the file itself,
+    // only the start of the file is converted and searched.
+    QString text = QString::fromUtf8(raw_text.constData(), qMin(raw_text.size(), ENCODING_PREFIX_SIZE));
 
     // Check if the xml encoding attribute is set.
-    QRegularExpression enc_re(ENCODING_ATTRIBUTE);
+    static const QRegularExpression enc_re(ENCODING_ATTRIBUTE);
     QRegularExpressionMatch enc_mo = enc_re.match(text);
     if (enc_mo.hasMatch()) {
         codec = QTextCodec::codecForName(enc_mo.captured(1).toLatin1().toUpper());
@@ -112,7 +138,7 @@ const QTextCodec *HTMLEncodingResolver::GetCodecForHTML(const QByteArray &raw_te
     }
 
     // Check if the charset is set in the head.
-    QRegularExpression char_re(CHARSET_ATTRIBUTE);
+    static const QRegularExpression char_re(CHARSET_ATTRIBUTE);
     QRegularExpressionMatch char_mo = char_re.match(text);
     if (char_mo.hasMatch()) {
         codec = QTextCodec::codecForName(char_mo.captured(1).toLatin1().toUpper());
@@ -121,90 +147,5 @@ const QTextCodec *HTMLEncodingResolver::GetCodecForHTML(const QByteArray &raw_te
         }
     }
 
-    // See if all characters within this document are utf-8.
-    if (IsValidUtf8(raw_text)) {
-        return QTextCodec::codecForName("UTF-8");
-    }
-
-    // Finally, let Qt guess and if it doesn't know it will return the codec
-    // for the current locale.
-    text = raw_text;
-    return QTextCodec::codecForHtml(raw_text, QTextCodec::codecForLocale());
-}
-
-
-// This function goes through the entire byte array
-// and tries to see whether this is a valid UTF-8 sequence.
-// If it's valid, this is probably a UTF-8 string.
-bool HTMLEncodingResolver::IsValidUtf8(const QByteArray &string)
-{
-    // This is an implementation of the Perl code written here:
-    //   http://www.w3.org/International/questions/qa-forms-utf-8
-    //
-    // Basically, UTF-8 has a very specific byte-pattern. This function
-    // checks if the sent byte-sequence conforms to this pattern.
-    // If it does, chances are *very* high that this is UTF-8.
-    //
-    // This function is written to be fast, not pretty.
-    if (string.isNull()) {
-        return false;
-    }
-
-    int index = 0;
-
-    while (index < string.size()) {
-        QByteArray dword = string.mid(index, 4);
-
-        if (dword.size() < 4) {
-            dword = dword.leftJustified(4, '\0');
-        }
-
-        const unsigned char *bytes = (const unsigned char *) dword.constData();
-
-        // ASCII
-        if (bytes[0] == 0x09 ||
-            bytes[0] == 0x0A ||
-            bytes[0] == 0x0D ||
-            (0x20 <= bytes[0] && bytes[0] <= 0x7E)
-           ) {
-            index += 1;
-        }
-        // non-overlong 2-byte
-        else if ((0xC2 <= bytes[0] && bytes[0] <= 0xDF) &&
-                 (0x80 <= bytes[1] && bytes[1] <= 0xBF)
-                ) {
-            index += 2;
-        } else if ((bytes[0] == 0xE0                         &&              // excluding overlongs
-                    (0xA0 <= bytes[1] && bytes[1] <= 0xBF) &&
-                    (0x80 <= bytes[2] && bytes[2] <= 0xBF)) ||
-                   (((0xE1 <= bytes[0] && bytes[0] <= 0xEC) ||               // straight 3-byte
-                     bytes[0] == 0xEE                         ||
-                     bytes[0] == 0xEF) &&
-                    (0x80 <= bytes[1] && bytes[1] <= 0xBF)   &&
-                    (0x80 <= bytes[2] && bytes[2] <= 0xBF)) ||
-                   (bytes[0] == 0xED                         &&              // excluding surrogates
-                    (0x80 <= bytes[1] && bytes[1] <= 0x9F) &&
-                    (0x80 <= bytes[2] && bytes[2] <= 0xBF))
-                  ) {
-            index += 3;
-        } else if ((bytes[0] == 0xF0                         &&              // planes 1-3
-                    (0x90 <= bytes[1] && bytes[1] <= 0xBF) &&
-                    (0x80 <= bytes[2] && bytes[2] <= 0xBF) &&
-                    (0x80 <= bytes[3] && bytes[3] <= 0xBF)) ||
-                   ((0xF1 <= bytes[0] && bytes[0] <= 0xF3) &&              // planes 4-15
-                    (0x80 <= bytes[1] && bytes[1] <= 0xBF) &&
-                    (0x80 <= bytes[2] && bytes[2] <= 0xBF) &&
-                    (0x80 <= bytes[3] && bytes[3] <= 0xBF)) ||
-                   (bytes[0] == 0xF4                         &&            // plane 16
-                    (0x80 <= bytes[1] && bytes[1] <= 0x8F) &&
-                    (0x80 <= bytes[2] && bytes[2] <= 0xBF) &&
-                    (0x80 <= bytes[3] && bytes[3] <= 0xBF))
-                  ) {
-            index += 4;
-        } else {
-            return false;
-        }
-    }
-
-    return true;
+    return NULL;
 }
@@ -24,6 +24,7 @@
 #ifndef HTMLEncodingResolver_H
 #define HTMLEncodingResolver_H
 
+class QByteArray;
 class QString;
 
 class HTMLEncodingResolver
@@ -36,18 +37,17 @@ public:
     // and returns the text converted to Unicode.
     static QString ReadHTMLFile(const QString &fullfilepath);
 
+    // Accepts the raw bytes of an HTML file, detects
+    // the encoding and returns the text converted to Unicode.
+    static QString ReadHTMLData(const QByteArray &data);
+
 private:
 
-    // Accepts an HTML stream and tries to determine its encoding;
-    // if no encoding is detected, the default codec for this locale is returned.
+    // Accepts an HTML stream and returns the codec for the encoding given
+    // by its BOM or declared near its start, or NULL if there is none.
     // We use this function because Qt's QTextCodec::codecForHtml() function
     // leaves a *lot* to be desired.
-    static const QTextCodec *GetCodecForHTML(const QByteArray &raw_text);
-
-    // This function goes through the entire byte array
-    // and tries to see whether this is a valid UTF-8 sequence.
-    // If it's valid, this is probably a UTF-8 string.
-    static bool IsValidUtf8(const QByteArray &string);
+    static const QTextCodec *GetDeclaredCodec(const QByteArray &raw_text);
 };
 
 
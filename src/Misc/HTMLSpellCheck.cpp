@@ -25,7 +25,7 @@
 
 #include "Misc/HTMLEncodingResolver.h"
 #include "Misc/Utility.h"
-#include "Misc/SettingsStore.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/SpellCheck.h"
 #include "Misc/HTMLSpellCheck.h"
 #include "sigil_constants.h"
@@ -51,14 +51,16 @@ QList<HTMLSpellCheck::MisspelledWord> HTMLSpellCheck::GetMisspelledWords(const Q
     bool in_invalid_word = false;
     bool in_entity = false;
     int word_start = 0;
-    SettingsStore ss;
-    bool use_nums = ss.spellCheckNumbers();
-    QRegularExpression search(search_regex);
+    bool use_nums = SettingsSnapshot::current()->spellCheckNumbers;
+    QRegularExpression search;
+    if (!search_regex.isEmpty()) {
+        search.setPattern(search_regex);
+    }
     QList<HTMLSpellCheck::MisspelledWord> misspellings;
     // Make sure text has beginning/end boundary markers for easier parsing
     QString text = QChar(' ') + orig_text + QChar(' ');
     // Ignore <style...</style> wherever it appears - change to spaces to keep text positions
-    QRegularExpression style_re("<style[^<]*</style>");
+    static const QRegularExpression style_re("<style[^<]*</style>");
 
     QRegularExpressionMatchIterator i = style_re.globalMatch(text);
     while (i.hasNext()) {
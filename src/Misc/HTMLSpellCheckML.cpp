@@ -21,7 +21,7 @@
 
 #include <QString>
 #include "Misc/Utility.h"
-#include "Misc/SettingsStore.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/SpellCheck.h"
 #include "Misc/QuickParser.h"
 #include "Misc/HTMLSpellCheckML.h"
@@ -34,8 +34,7 @@ QList<HTMLSpellCheckML::AWord> HTMLSpellCheckML::GetWordList(const QString &sour
     QList<HTMLSpellCheckML::AWord> wordlist;
     SpellCheck *sc = SpellCheck::instance();
     QString wc = sc->getWordChars() + QChar(0x00ad); // add in soft hyphen
-    SettingsStore ss;
-    bool use_nums = ss.spellCheckNumbers();
+    bool use_nums = SettingsSnapshot::current()->spellCheckNumbers;
     QuickParser qp(source, default_lang);
     while(true) {
         QuickParser::MarkupInfo mi = qp.parse_next();
@@ -120,8 +119,7 @@ bool HTMLSpellCheckML::IsBoundary(QChar prev_c, QChar c, QChar next_c, const QSt
 QList<HTMLSpellCheckML::AWord> HTMLSpellCheckML::GetWords(const QString &text, const QString &default_lang)
 {
     if (default_lang.isEmpty()) {
-        SettingsStore ss;
-        return GetWordList(text, ss.defaultMetadataLang().replace("_","-"));
+        return GetWordList(text, QString(SettingsSnapshot::current()->defaultMetadataLang).replace("_","-"));
     }
     return GetWordList(text, default_lang);
 }
@@ -132,8 +130,7 @@ QStringList HTMLSpellCheckML::GetAllWords(const QString &text, const QString& de
     QList<HTMLSpellCheckML::AWord> words;
 
     if (default_lang.isEmpty()) {
-        SettingsStore ss;
-        words = GetWordList(text, ss.defaultMetadataLang().replace("_","-"));
+        words = GetWordList(text, QString(SettingsSnapshot::current()->defaultMetadataLang).replace("_","-"));
     } else {
         words = GetWordList(text, default_lang);
     }
@@ -157,15 +154,13 @@ QString HTMLSpellCheckML::langOf(const QString& word)
 {
     int p = word.indexOf(":",0);
     if (p != -1) return word.mid(0,p);
-    SettingsStore ss;
-    return ss.defaultMetadataLang().replace("_","-");
+    return QString(SettingsSnapshot::current()->defaultMetadataLang).replace("_","-");
 }
 
 
 int HTMLSpellCheckML::WordPosition(QString text, QString word, int start_pos)
 {
-    SettingsStore ss;
-    QList<HTMLSpellCheckML::AWord> words = GetWordList(text, ss.defaultMetadataLang().replace("_","-"));
+    QList<HTMLSpellCheckML::AWord> words = GetWordList(text, QString(SettingsSnapshot::current()->defaultMetadataLang).replace("_","-"));
     foreach (HTMLSpellCheckML::AWord w, words) {
         if (w.offset < start_pos) {
             continue;
@@ -27,34 +27,6 @@
 #include "Misc/PythonRoutines.h"
 
 
-QString PythonRoutines::GenerateNcxInPython(const QString &navdata, const QString &navbkpath, 
-                                            const QString &ncxdir, const QString &doctitle, 
-					    const QString &mainid)
-{
-    QString results;
-    int rv = -1;
-    QString error_traceback;
-    QList<QVariant> args;
-    args.append(QVariant(navdata));
-    args.append(QVariant(navbkpath));
-    args.append(QVariant(ncxdir));
-    args.append(QVariant(doctitle));
-    args.append(QVariant(mainid));
-
-    EmbeddedPython * epython  = EmbeddedPython::instance();
-
-    QVariant res = epython->runInPython( QString("ncxgenerator"),
-                                         QString("generateNCX"),
-                                         args,
-                                         &rv,
-                                         error_traceback);
-    if (rv == 0) {
-        results = res.toString();
-    }
-    return results;
-}
-
-
 MetadataPieces PythonRoutines::GetMetadataInPython(const QString& opfdata, const QString& version) 
 {
     int rv = 0;
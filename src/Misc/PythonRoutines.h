@@ -42,9 +42,6 @@ public:
 
     PythonRoutines() {};
 
-    QString GenerateNcxInPython(const QString &navdata, const QString &navbkpath,
-                                const QString &ncx_dir, const QString &doctitle, const QString &mainid);
-
     MetadataPieces GetMetadataInPython(const QString& opfdata, const QString& version);
 
     QString SetNewMetadataInPython(const MetadataPieces& mdp, const QString& opfdata, const QString& version);
@@ -0,0 +1,413 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <QtCore/QSet>
+
+#include "Misc/SanityCheck.h"
+
+static const int MAX_TAG_LEN = 20;
+
+static const QSet<QString> VOID_TAGS = QSet<QString>()
+    << "area" << "base" << "basefont" << "bgsound" << "br" << "col" << "command"
+    << "embed" << "event-source" << "frame" << "hr" << "img" << "input" << "keygen"
+    << "link" << "menuitem" << "meta" << "param" << "source" << "spacer" << "track" << "wbr"
+    << "mbp:pagebreak";
+
+static const QSet<QString> XML_ENTITIES = QSet<QString>()
+    << "amp" << "lt" << "gt" << "quot" << "apos";
+
+// the character at p or -1 past the end of s
+static int CharAt(const QString &s, int p)
+{
+    return p < s.length() ? s.at(p).unicode() : -1;
+}
+
+static bool IsNameDelimiter(int c)
+{
+    return c == '>' || c == '/' || c == ' ' || c == '\f' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool IsEntityNameStartChar(int c)
+{
+    // characters outside the BMP are let through as surrogate pairs
+    return c != -1 && (c == '_' || c == ':' || QChar(c).isLetter() || QChar(c).isSurrogate());
+}
+
+static bool IsEntityNameChar(int c)
+{
+    return IsEntityNameStartChar(c) || (c != -1 && (c == '-' || c == '.' || QChar(c).isDigit()));
+}
+
+static bool IsDigitChar(int c, bool hex)
+{
+    if (c >= '0' && c <= '9') return true;
+    return hex && ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'));
+}
+
+// the Char production of the xml spec
+static bool IsXMLChar(uint code)
+{
+    return code == 0x9 || code == 0xA || code == 0xD ||
+           (code >= 0x20 && code <= 0xD7FF) ||
+           (code >= 0xE000 && code <= 0xFFFD) ||
+           (code >= 0x10000 && code <= 0x10FFFF);
+}
+
+
+SanityCheck::SanityCheck(const QString &source)
+    :
+    m_Source(source),
+    m_Pos(0),
+    m_Line(1),
+    m_Col(0),
+    m_TagLine(-1),
+    m_TagCol(-1),
+    m_HtmlCount(0),
+    m_BodyCount(0),
+    m_HeadCount(0),
+    m_XMLDeclarations(0),
+    m_Doctypes(0),
+    m_HasDTD(false)
+{
+}
+
+
+QList<SanityCheck::Error> SanityCheck::Check()
+{
+    int length = m_Source.length();
+
+    // only the doctype ahead of the html tag can bring in a DTD
+    int html_start = m_Source.indexOf("<html", 0, Qt::CaseInsensitive);
+    QStringRef prolog = m_Source.midRef(0, html_start == -1 ? length : html_start);
+    int doctype_start = prolog.indexOf(QLatin1String("<!DOCTYPE"), 0, Qt::CaseInsensitive);
+    if (doctype_start != -1) {
+        QStringRef doctype = prolog.mid(doctype_start);
+        m_HasDTD = doctype.contains(QLatin1String("PUBLIC"), Qt::CaseInsensitive) ||
+                   doctype.contains(QLatin1String("SYSTEM"), Qt::CaseInsensitive) ||
+                   doctype.contains('[');
+    }
+
+    while (m_Pos < length) {
+        int start = m_Pos;
+
+        // text up to the next tag
+        if (m_Source.at(start) != '<') {
+            int next = m_Source.indexOf('<', start);
+            m_Pos = next == -1 ? length : next;
+            if (!CheckEntities(start, m_Pos)) {
+                return m_Errors;
+            }
+            continue;
+        }
+
+        // comments may contain < and > and span many lines
+        int tag_end;
+        if (m_Source.midRef(start, 4) == "<!--") {
+            tag_end = m_Source.indexOf("-->", start + 1);
+            if (tag_end != -1) {
+                tag_end += 2;
+            }
+        } else {
+            tag_end = m_Source.indexOf('>', start + 1);
+            int next = m_Source.indexOf('<', start + 1);
+            if (next != -1 && next < tag_end) {
+                // a stray < is just text
+                m_Pos = next;
+                if (!CheckEntities(start, m_Pos)) {
+                    return m_Errors;
+                }
+                continue;
+            }
+        }
+
+        // an unterminated tag leaves the tag empty and is
+        // reported as a badly delimited tag name
+        QString tag;
+        if (tag_end != -1) {
+            tag = m_Source.mid(start, tag_end + 1 - start);
+            m_Pos = tag_end + 1;
+        }
+
+        m_TagLine = m_Line;
+        m_TagCol = m_Col;
+        Advance(start, start + tag.length());
+
+        QString tname;
+        TagType ttype;
+        if (!ParseTag(tag, tname, ttype) || !CheckTag(tname, ttype)) {
+            return m_Errors;
+        }
+
+        if (ttype == TagType_Begin) {
+            m_TagPath.append(tname);
+            m_TagPositions.append(std::make_pair(m_TagLine, m_TagCol));
+        } else if (ttype == TagType_End) {
+            m_TagPath.removeLast();
+            m_TagPositions.removeLast();
+        }
+    }
+
+    if (m_HtmlCount != 1) {
+        AddError(1, 0, "Missing or multiple \"html\" tags");
+    }
+    if (m_BodyCount != 1) {
+        AddError(1, 0, "Missing or multiple \"body\" tags");
+    }
+    if (m_HeadCount != 1) {
+        AddError(1, 0, "Missing or multiple \"head\" tags");
+    }
+    return m_Errors;
+}
+
+
+bool SanityCheck::ParseTag(const QString &s, QString &tname, TagType &ttype)
+{
+    int taglen = s.length();
+    int p = 1;
+    bool is_end = false;
+
+    while (CharAt(s, p) == ' ') p++;
+    if (CharAt(s, p) == '/') {
+        is_end = true;
+        p++;
+        while (CharAt(s, p) == ' ') p++;
+    }
+    int b = p;
+
+    // comments may have no spaces to delimit the name
+    if (s.midRef(b, 3) == "!--") {
+        tname = "!--";
+        ttype = TagType_Comment;
+        return true;
+    }
+
+    if (CharAt(s, b) == '?') {
+        if ((s.midRef(b, 4).compare(QLatin1String("?xml"), Qt::CaseInsensitive) == 0) &&
+            IsNameDelimiter(CharAt(s, b + 4))) {
+            tname = "?xml";
+            ttype = TagType_XMLHeader;
+        } else {
+            tname = "?";
+            ttype = TagType_PI;
+        }
+        return true;
+    }
+
+    while (!IsNameDelimiter(CharAt(s, p))) {
+        p++;
+        if ((p - b) > MAX_TAG_LEN || p >= taglen) {
+            AddError(m_TagLine, m_TagCol, "Tag name not properly delimited: \"" + s.mid(b, p - b) + "\"");
+            return false;
+        }
+    }
+    tname = s.mid(b, p - b).toLower();
+    if (tname.contains('\'') || tname.contains('"')) {
+        AddError(m_TagLine, m_TagCol, "Tag attribute not properly space delimited: \"" + s.mid(b, p - b) + "\"");
+        return false;
+    }
+
+    if (tname == "!doctype") {
+        tname = "!DOCTYPE";
+        ttype = TagType_Doctype;
+        return true;
+    }
+
+    if (is_end) {
+        ttype = TagType_End;
+        return true;
+    }
+
+    // make sure any attributes are properly delimited
+    while (s.indexOf('=', p) != -1) {
+        while (CharAt(s, p) == ' ') p++;
+        b = p;
+        while (CharAt(s, p) != '=') p++;
+        QString aname = s.mid(b, p - b).toLower();
+        while (aname.endsWith(' ')) aname.chop(1);
+        p++;
+        while (CharAt(s, p) == ' ') p++;
+        int quote = CharAt(s, p);
+        if (quote == '"' || quote == '\'') {
+            p++;
+            while (CharAt(s, p) != quote) {
+                p++;
+                if (p >= taglen) {
+                    AddError(m_TagLine, m_TagCol, "Attribute \"" + aname + "\" has unmatched quotes on attribute value");
+                    return false;
+                }
+            }
+            p++;
+        } else {
+            int c = CharAt(s, p);
+            while (c != '>' && c != '/' && c != ' ') {
+                p++;
+                if (p >= taglen) {
+                    AddError(m_TagLine, m_TagCol, "Attribute \"" + aname + "\" has unterminated attribute value");
+                    return false;
+                }
+                c = CharAt(s, p);
+            }
+        }
+    }
+
+    ttype = s.indexOf('/', p) != -1 ? TagType_Single : TagType_Begin;
+    return true;
+}
+
+
+bool SanityCheck::CheckTag(const QString &tname, TagType ttype)
+{
+    // basic structure sanity check
+    if (tname == "html" && ttype == TagType_Begin) {
+        m_HtmlCount++;
+        if (m_BodyCount > 0) {
+            AddError(m_TagLine, m_TagCol, "Tag \"html\" found after \"body\"");
+            return false;
+        }
+    }
+    if (tname == "body" && ttype == TagType_Begin) {
+        m_BodyCount++;
+        if (m_HtmlCount == 0) {
+            AddError(m_TagLine, m_TagCol, "Tag \"body\" found before \"html\"");
+            return false;
+        }
+    }
+    if (tname == "head" && ttype == TagType_Begin) {
+        m_HeadCount++;
+        if (m_BodyCount > 0) {
+            AddError(m_TagLine, m_TagCol, "Tag \"head\" found after \"body\"");
+            return false;
+        }
+    }
+    if (tname == "p" && ttype == TagType_Begin) {
+        if (m_TagPath.contains("p")) {
+            AddError(m_TagLine, m_TagCol, "Can not nest a \"p\" tag inside another \"p\" tag");
+            return false;
+        }
+    }
+    if (ttype == TagType_XMLHeader) {
+        m_XMLDeclarations++;
+        if (m_HtmlCount > 0 || m_Doctypes > 0) {
+            AddError(m_TagLine, m_TagCol, "An xml declaration must come before the \"html\" tag and DOCTYPE");
+            return false;
+        }
+    }
+    if (ttype == TagType_Doctype) {
+        m_Doctypes++;
+        if (m_HtmlCount > 0) {
+            AddError(m_TagLine, m_TagCol, "A DOCTYPE must come before the \"html\" tag");
+            return false;
+        }
+    }
+
+    // validate tag nesting
+    if (ttype == TagType_End) {
+        if (m_TagPath.isEmpty()) {
+            AddError(m_TagLine, m_TagCol, "Improperly nested tags: parsing end tag \"" + tname + "\" but no tags are open");
+            return false;
+        }
+        if (m_TagPath.last() != tname) {
+            AddError(m_TagLine, m_TagCol, "Improperly nested tags: parsing end tag \"" + tname +
+                                          "\" but current parse path is \"" + m_TagPath.join(".") +
+                                          "\". See line " + QString::number(m_TagPositions.last().first) +
+                                          " col " + QString::number(m_TagPositions.last().second));
+            return false;
+        }
+    }
+
+    // validate void tags are self-closed
+    if (ttype == TagType_End && VOID_TAGS.contains(tname)) {
+        AddError(m_TagLine, m_TagCol, "Void tag: " + tname + " has an illegal ending tag");
+        return false;
+    }
+    return true;
+}
+
+
+bool SanityCheck::CheckEntities(int start, int end)
+{
+    int amp = m_Source.indexOf('&', start);
+    while (amp != -1 && amp < end) {
+        Advance(start, amp);
+        start = amp;
+        int p = amp + 1;
+        if (CharAt(m_Source, p) == '#') {
+            p++;
+            bool hex = CharAt(m_Source, p) == 'x';
+            if (hex) p++;
+            int b = p;
+            while (p < end && IsDigitChar(CharAt(m_Source, p), hex)) p++;
+            if (p == b || CharAt(m_Source, p) != ';') {
+                AddError(m_Line, m_Col, "Character reference not properly formed: \"" + m_Source.mid(amp, p - amp) + "\"");
+                return false;
+            }
+            bool ok;
+            uint code = m_Source.mid(b, p - b).toUInt(&ok, hex ? 16 : 10);
+            if (!ok || !IsXMLChar(code)) {
+                AddError(m_Line, m_Col, "Character reference \"" + m_Source.mid(amp, p + 1 - amp) + "\" is not a valid xml character");
+                return false;
+            }
+        } else {
+            int b = p;
+            if (IsEntityNameStartChar(CharAt(m_Source, p))) {
+                p++;
+                while (p < end && IsEntityNameChar(CharAt(m_Source, p))) p++;
+            }
+            if (p == b || CharAt(m_Source, p) != ';') {
+                AddError(m_Line, m_Col, "Unescaped \"&\" does not start an entity or character reference: \"" + m_Source.mid(amp, p - amp) + "\"");
+                return false;
+            }
+            if (!m_HasDTD && !XML_ENTITIES.contains(m_Source.mid(b, p - b))) {
+                AddError(m_Line, m_Col, "Entity \"" + m_Source.mid(amp, p + 1 - amp) + "\" is not defined");
+                return false;
+            }
+        }
+        amp = m_Source.indexOf('&', p);
+    }
+    Advance(start, end);
+    return true;
+}
+
+
+void SanityCheck::AddError(int line, int column, const QString &message)
+{
+    Error error;
+    error.line = line;
+    error.column = column;
+    error.message = message;
+    m_Errors.append(error);
+}
+
+
+void SanityCheck::Advance(int start, int end)
+{
+    for (int i = start; i < end; i++) {
+        QChar c = m_Source.at(i);
+        if (c == '\n') {
+            m_Line++;
+            m_Col = 0;
+        } else if (!c.isLowSurrogate()) {
+            // characters outside the BMP count once
+            m_Col++;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef SANITYCHECK_H
+#define SANITYCHECK_H
+
+#include <utility>
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+/**
+ * A quick structural sanity check of xhtml source text.
+ *
+ * The source is scanned tag by tag, without building a tree, for
+ * problems that would make it impossible to parse as xhtml: tag names
+ * and attributes that are not properly delimited, unmatched quotes,
+ * improperly nested or unclosed void tags, misplaced xml declarations
+ * and doctypes, missing or repeated html, head and body tags and
+ * malformed, out of range or undefined entity and character references.
+ *
+ * Scanning stops at the first problem found inside the document.
+ */
+class SanityCheck
+{
+
+public:
+
+    struct Error {
+        int line;
+        int column;
+        QString message;
+    };
+
+    SanityCheck(const QString &source);
+
+    /**
+     * Checks the source.
+     *
+     * @return The problems found, empty if none.
+     */
+    QList<Error> Check();
+
+private:
+
+    enum TagType {
+        TagType_Begin,
+        TagType_End,
+        TagType_Single,
+        TagType_XMLHeader,
+        TagType_Comment,
+        TagType_Doctype,
+        TagType_PI
+    };
+
+    /**
+     * Finds the name and type of a tag.
+     *
+     * @return False if the tag is malformed.
+     */
+    bool ParseTag(const QString &tag, QString &tname, TagType &ttype);
+
+    /**
+     * Checks a tag against the tags seen before it.
+     *
+     * @return False if the tag is out of place.
+     */
+    bool CheckTag(const QString &tname, TagType ttype);
+
+    /**
+     * Checks the entity and character references in a run of text
+     * and moves the line and column past it.
+     *
+     * @return False if a reference is malformed or undefined.
+     */
+    bool CheckEntities(int start, int end);
+
+    void AddError(int line, int column, const QString &message);
+
+    /**
+     * Moves the line and column past the source from start up to end.
+     */
+    void Advance(int start, int end);
+
+    const QString m_Source;
+
+    int m_Pos;
+
+    int m_Line;
+
+    int m_Col;
+
+    int m_TagLine;
+
+    int m_TagCol;
+
+    int m_HtmlCount;
+
+    int m_BodyCount;
+
+    int m_HeadCount;
+
+    int m_XMLDeclarations;
+
+    int m_Doctypes;
+
+    // a DTD may define named entities beyond the five xml ones
+    bool m_HasDTD;
+
+    // names and positions of the open tags
+    QStringList m_TagPath;
+
+    QList<std::pair<int, int>> m_TagPositions;
+
+    QList<Error> m_Errors;
+};
+
+#endif // SANITYCHECK_H
@@ -22,6 +22,7 @@
 #include <signal.h>
 
 #include <QtCore/QtCore>
+#include <QtConcurrent/QtConcurrent>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QProgressDialog>
 
@@ -36,23 +37,41 @@
 #include "ViewEditors/Searchable.h"
 #include "sigil_constants.h"
 
+// Characters of text shown on each side of a match in search results
+static const int CONTEXT_LENGTH = 40;
+
 int SearchOperations::CountInFiles(const QString &search_regex,
                                    QList<Resource *> resources,
                                    SearchType search_type,
                                    bool check_spelling)
 {
-    QProgressDialog progress(QObject::tr("Counting occurrences.."), 0, 0, resources.count(), Utility::GetMainWindow());
-    progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
-    int progress_value = 0;
-    progress.setValue(progress_value);
-    // Count sequentially in order to see if occassional crashes are due to threading
-    int count = 0;
-    foreach(Resource * resource, resources) {
-        progress.setValue(progress_value++);
-        qApp->processEvents();
-        count += CountInFile(search_regex, resource, search_type, check_spelling);
+    // The spellchecker is not thread safe so spelling searches stay on this thread
+    if (check_spelling) {
+        QProgressDialog progress(QObject::tr("Counting occurrences.."), QObject::tr("Cancel"), 0, resources.count(), Utility::GetMainWindow());
+        progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
+        int progress_value = 0;
+        progress.setValue(progress_value);
+        int count = 0;
+        foreach(Resource * resource, resources) {
+            progress.setValue(progress_value++);
+            qApp->processEvents();
+            if (progress.wasCanceled()) {
+                return -1;
+            }
+            count += CountInFile(search_regex, resource, search_type, check_spelling);
+        }
+        return count;
     }
-    return count;
+
+    QFuture<int> future = QtConcurrent::mappedReduced(resources,
+                                                      std::bind(CountInFile, search_regex, std::placeholders::_1, search_type, check_spelling),
+                                                      Accumulate);
+
+    if (!WaitForFiles(QFuture<void>(future), QObject::tr("Counting occurrences.."), resources.count())) {
+        return -1;
+    }
+
+    return future.result();
 }
 
 
@@ -61,21 +80,113 @@ int SearchOperations::ReplaceInAllFIles(const QString &search_regex,
                                         QList<Resource *> resources,
                                         SearchType search_type)
 {
-    QProgressDialog progress(QObject::tr("Replacing search term..."), 0, 0, resources.count(), Utility::GetMainWindow());
-    progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
-    int progress_value = 0;
-    progress.setValue(progress_value);
-    // Replace sequentially in order to see if occassional crashes are due to threading
-    int count = 0;
+    // Remember which text each file had so edits made while
+    // the workers run are not overwritten with stale results.
+    QList<int> revisions;
     foreach(Resource * resource, resources) {
-        progress.setValue(progress_value++);
-        qApp->processEvents();
-        count += ReplaceInFile(search_regex, replacement, resource, search_type);
+        TextResource *text_resource = qobject_cast<TextResource *>(resource);
+        revisions.append(text_resource ? text_resource->GetTextRevision() : -1);
+    }
+
+    // Build the new text of every file on the thread pool
+    // and only touch the resources once all of them are done.
+    QFuture<std::tuple<QString, int>> future = QtConcurrent::mapped(resources,
+                                                                    std::bind(ReplaceInFile, search_regex, replacement, std::placeholders::_1, search_type));
+
+    if (!WaitForFiles(QFuture<void>(future), QObject::tr("Replacing search term..."), resources.count())) {
+        // Nothing has been changed yet
+        return -1;
+    }
+
+    // Results are in the same order as the resources so
+    // files are updated in reading order, all in one go.
+    int count = 0;
+    for (int i = 0; i < resources.count(); ++i) {
+        TextResource *text_resource = qobject_cast<TextResource *>(resources.at(i));
+        if (!text_resource) {
+            continue;
+        }
+        QString new_text;
+        int file_count;
+        std::tie(new_text, file_count) = future.resultAt(i);
+
+        // only this thread edits text, so nothing can change it between here and the write
+        if (text_resource->GetTextRevision() != revisions.at(i)) {
+            // changed since the workers read it so redo this file from its current text
+            std::tie(new_text, file_count) = ReplaceInFile(search_regex, replacement, text_resource, search_type);
+        }
+        if (file_count > 0) {
+            QWriteLocker locker(&text_resource->GetLock());
+            text_resource->SetTextAsEdit(new_text);
+            count += file_count;
+        }
     }
     return count;
 }
 
 
+bool SearchOperations::WaitForFiles(QFuture<void> future, const QString &label, int file_count)
+{
+    QProgressDialog progress(label, QObject::tr("Cancel"), 0, file_count, Utility::GetMainWindow());
+    // the event loop below must not let the user edit or start another operation
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(PROGRESS_BAR_MINIMUM_DURATION);
+    progress.setValue(0);
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    QObject::connect(&watcher, SIGNAL(progressValueChanged(int)), &progress, SLOT(setValue(int)));
+    QObject::connect(&progress, SIGNAL(canceled()), &watcher, SLOT(cancel()));
+    QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(future);
+
+    // finished() is delivered by the event loop even if
+    // the work completed before the watcher was set up
+    if (!future.isFinished()) {
+        loop.exec();
+    }
+
+    future.waitForFinished();
+    return !future.isCanceled();
+}
+
+
+QList<SearchOperations::SearchResult> SearchOperations::FindInFile(const QString &search_regex,
+        Resource *resource,
+        SearchType search_type)
+{
+    QList<SearchResult> results;
+
+    if (search_type != SearchOperations::CodeViewSearch) {
+        //TODO: BookViewSearch
+        return results;
+    }
+
+    QReadLocker locker(&resource->GetLock());
+    TextResource *text_resource = qobject_cast<TextResource *>(resource);
+
+    if (!text_resource) {
+        return results;
+    }
+
+    int revision = text_resource->GetTextRevision();
+    const QString text = text_resource->GetText();
+    QString bookpath = resource->GetRelativePath();
+    QList<SPCRE::MatchInfo> match_info = PCRECache::instance()->getObject(search_regex)->getEveryMatchInfo(text);
+    foreach(SPCRE::MatchInfo match, match_info) {
+        SearchResult result;
+        result.bookpath = bookpath;
+        result.revision = revision;
+        result.offset = match.offset.first;
+        result.length = match.offset.second - match.offset.first;
+        int start = qMax(0, result.offset - CONTEXT_LENGTH);
+        int end = qMin(text.length(), match.offset.second + CONTEXT_LENGTH);
+        result.context = Utility::Substring(start, end, text).simplified();
+        results.append(result);
+    }
+    return results;
+}
+
+
 int SearchOperations::CountInFile(const QString &search_regex,
                                   Resource *resource,
                                   SearchType search_type,
@@ -126,12 +237,12 @@ int SearchOperations::CountInTextFile(const QString &search_regex, TextResource
 }
 
 
-int SearchOperations::ReplaceInFile(const QString &search_regex,
-                                    const QString &replacement,
-                                    Resource *resource,
-                                    SearchType search_type)
+std::tuple<QString, int> SearchOperations::ReplaceInFile(const QString &search_regex,
+        const QString &replacement,
+        Resource *resource,
+        SearchType search_type)
 {
-    QWriteLocker locker(&resource->GetLock());
+    QReadLocker locker(&resource->GetLock());
     HTMLResource *html_resource = qobject_cast<HTMLResource *>(resource);
 
     if (html_resource) {
@@ -145,37 +256,30 @@ int SearchOperations::ReplaceInFile(const QString &search_regex,
     }
 
     // We should never get here.
-    return 0;
+    return std::make_tuple(QString(), 0);
 }
 
 
-int SearchOperations::ReplaceHTMLInFile(const QString &search_regex,
-                                        const QString &replacement,
-                                        HTMLResource *html_resource,
-                                        SearchType search_type)
+std::tuple<QString, int> SearchOperations::ReplaceHTMLInFile(const QString &search_regex,
+        const QString &replacement,
+        HTMLResource *html_resource,
+        SearchType search_type)
 {
-    SettingsStore ss;
-
     if (search_type == SearchOperations::CodeViewSearch) {
-        int count;
-        QString new_text;
-        QString text = html_resource->GetText();
-        std::tie(new_text, count) = PerformGlobalReplace(text, search_regex, replacement);
-        html_resource->SetText(new_text);
-        return count;
+        return PerformGlobalReplace(html_resource->GetText(), search_regex, replacement);
     }
 
     //TODO: BookViewSearch
-    return 0;
+    return std::make_tuple(QString(), 0);
 }
 
 
-int SearchOperations::ReplaceTextInFile(const QString &search_regex,
-                                        const QString &replacement,
-                                        TextResource *text_resource)
+std::tuple<QString, int> SearchOperations::ReplaceTextInFile(const QString &search_regex,
+        const QString &replacement,
+        TextResource *text_resource)
 {
     // TODO
-    return 0;
+    return std::make_tuple(QString(), 0);
 }
 
 
@@ -185,7 +289,7 @@ std::tuple<QString, int> SearchOperations::PerformGlobalReplace(const QString &t
 {
     QString new_text = text;
     int count = 0;
-    SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
+    std::shared_ptr<SPCRE> spcre = PCRECache::instance()->getObject(search_regex);
     QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo(text);
 
     for (int i =  match_info.count() - 1; i >= 0; i--) {
@@ -209,7 +313,7 @@ std::tuple<QString, int> SearchOperations::PerformHTMLSpellCheckReplace(const QS
     QString new_text = text;
     int count = 0;
     int offset = 0;
-    SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
+    std::shared_ptr<SPCRE> spcre = PCRECache::instance()->getObject(search_regex);
     QList<HTMLSpellCheck::MisspelledWord> check_spelling = HTMLSpellCheck::GetMisspelledWords(text, 0, text.count(), search_regex);
     foreach(HTMLSpellCheck::MisspelledWord misspelled_word, check_spelling) {
         SPCRE::MatchInfo match_info = spcre->getFirstMatchInfo(misspelled_word.text);
@@ -23,6 +23,8 @@
 #ifndef SEARCHOPERATIONS_H
 #define SEARCHOPERATIONS_H
 
+#include <QtCore/QFuture>
+
 class Resource;
 class TextResource;
 class HTMLResource;
@@ -37,11 +39,26 @@ public:
         CodeViewSearch
     };
 
+    /**
+     * One match found by FindInFile().
+     */
+    struct SearchResult {
+        QString bookpath;
+        // the text revision of the file the offsets refer to
+        int revision;
+        // position and length of the match in the file text
+        int offset;
+        int length;
+        // the match with a little of the text around it, on one line
+        QString context;
+    };
+
     /**
      * Returns the number of matching occurrences.
+     * The files are searched in parallel.
      *
      * @param search_regex The regex to match with.
-     * @return The number of matching occurrences.
+     * @return The number of matching occurrences, or -1 if the user cancelled.
      */
     static int CountInFiles(const QString &search_regex,
                             QList<Resource *> resources,
@@ -49,11 +66,35 @@ public:
                             bool check_spelling = false);
 
 
+    /**
+     * Replaces all matches in the files. The replacements are worked out
+     * in parallel and applied together once all files are done, so a
+     * cancelled replace leaves every file untouched. Files open in a tab
+     * are changed with one undoable edit each, and files edited while the
+     * workers ran are redone against their current text.
+     *
+     * @return The number of replacements made, or -1 if the user cancelled.
+     */
     static int ReplaceInAllFIles(const QString &search_regex,
                                  const QString &replacement,
                                  QList<Resource *> resources,
                                  SearchType search_type);
 
+    /**
+     * Returns every match in the file in text order.
+     * Safe to run on a worker thread.
+     */
+    static QList<SearchResult> FindInFile(const QString &search_regex,
+                                          Resource *resource,
+                                          SearchType search_type);
+
+    /**
+     * Shows a cancellable, window modal progress dialog until the per file work finishes.
+     *
+     * @return False if the user cancelled.
+     */
+    static bool WaitForFiles(QFuture<void> future, const QString &label, int file_count);
+
 private:
 
     static int CountInFile(const QString &search_regex,
@@ -71,19 +112,20 @@ private:
     static int CountInTextFile(const QString &search_regex,
                                TextResource *text_resource);
 
-    static int ReplaceInFile(const QString &search_regex,
-                             const QString &replacement,
-                             Resource *resource,
-                             SearchType search_type);
+    // These only work out the new text, they do not change the resource
+    static std::tuple<QString, int> ReplaceInFile(const QString &search_regex,
+            const QString &replacement,
+            Resource *resource,
+            SearchType search_type);
 
-    static int ReplaceHTMLInFile(const QString &search_regex,
-                                 const QString &replacement,
-                                 HTMLResource *html_resource,
-                                 SearchType search_type);
+    static std::tuple<QString, int> ReplaceHTMLInFile(const QString &search_regex,
+            const QString &replacement,
+            HTMLResource *html_resource,
+            SearchType search_type);
 
-    static int ReplaceTextInFile(const QString &search_regex,
-                                 const QString &replacement,
-                                 TextResource *text_resource);
+    static std::tuple<QString, int> ReplaceTextInFile(const QString &search_regex,
+            const QString &replacement,
+            TextResource *text_resource);
 
     static std::tuple<QString, int> PerformGlobalReplace(const QString &text,
             const QString &search_regex,
@@ -0,0 +1,69 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#include <atomic>
+
+#include "Misc/SettingsSnapshot.h"
+#include "Misc/SettingsStore.h"
+
+
+SettingsSnapshot *SettingsSnapshot::instance()
+{
+    // initialized once even when first used from a worker thread
+    static SettingsSnapshot *snapshot = new SettingsSnapshot();
+    return snapshot;
+}
+
+
+std::shared_ptr<const SettingsSnapshot::Values> SettingsSnapshot::current()
+{
+    return std::atomic_load(&instance()->m_Values);
+}
+
+
+SettingsSnapshot::SettingsSnapshot()
+    : m_Values(ReadValues())
+{
+}
+
+
+void SettingsSnapshot::Refresh()
+{
+    std::atomic_store(&m_Values, ReadValues());
+}
+
+
+std::shared_ptr<const SettingsSnapshot::Values> SettingsSnapshot::ReadValues()
+{
+    SettingsStore settings;
+    std::shared_ptr<Values> values = std::make_shared<Values>();
+    values->defaultMetadataLang = settings.defaultMetadataLang();
+    values->dictionary = settings.dictionary();
+    values->secondaryDictionary = settings.secondary_dictionary();
+    values->spellCheck = settings.spellCheck();
+    values->spellCheckNumbers = settings.spellCheckNumbers();
+    values->previewDark = settings.previewDark();
+    values->cleanOn = settings.cleanOn();
+    values->showFullPathOn = settings.showFullPathOn();
+    values->preserveEntityCodeNames = settings.preserveEntityCodeNames();
+    return values;
+}
@@ -0,0 +1,81 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef SETTINGSSNAPSHOT_H
+#define SETTINGSSNAPSHOT_H
+
+#include <memory>
+#include <utility>
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+/**
+ * Singleton.
+ *
+ * An in-memory copy of the settings read on hot paths (per text block,
+ * per word, per file) so those no longer construct a SettingsStore.
+ * The values are immutable; SettingsStore swaps in a new copy whenever
+ * one of them is changed, and readers see it on their next current().
+ *
+ * Hold on to the pointer from current() for a consistent view of
+ * several values. Safe to use from any thread.
+ */
+class SettingsSnapshot
+{
+
+public:
+    struct Values {
+        QString defaultMetadataLang;
+        QString dictionary;
+        QString secondaryDictionary;
+        bool spellCheck;
+        bool spellCheckNumbers;
+        int previewDark;
+        int cleanOn;
+        int showFullPathOn;
+        QList<std::pair<ushort, QString>> preserveEntityCodeNames;
+    };
+
+    static SettingsSnapshot *instance();
+
+    /**
+     * The current values, never null.
+     */
+    static std::shared_ptr<const Values> current();
+
+    /**
+     * Re-reads the values from the settings file.
+     * Called by SettingsStore after it changes any of them.
+     */
+    void Refresh();
+
+private:
+    SettingsSnapshot();
+
+    static std::shared_ptr<const Values> ReadValues();
+
+    std::shared_ptr<const Values> m_Values;
+};
+
+#endif // SETTINGSSNAPSHOT_H
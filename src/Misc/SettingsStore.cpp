@@ -29,6 +29,7 @@
 #include <QDir>
 
 #include "Misc/SettingsStore.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/PluginDB.h"
 #include "Misc/Utility.h"
 
@@ -129,14 +130,16 @@ static QString KEY_MAIN_MENU_ICON_SIZE = SETTINGS_GROUP + "/" + "main_menu_icon_
 static QString KEY_CLIPBOARD_HISTORY_LIMIT = SETTINGS_GROUP + "/" + "clipboard_history_limit";
 
 SettingsStore::SettingsStore()
-    : QSettings(Utility::DefinePrefsDir() + "/sigil.ini", QSettings::IniFormat)
+    : QSettings(Utility::DefinePrefsDir() + "/sigil.ini", QSettings::IniFormat),
+      m_IsPrefsFile(true)
 {  
     // See QTBUG-40796 and QTBUG-54510 as using UTF-8 as a codec for ini files is very broken
     // setIniCodec("UTF-8");
 }
 
 SettingsStore::SettingsStore(QString filename)
-    : QSettings(filename, QSettings::IniFormat)
+    : QSettings(filename, QSettings::IniFormat),
+      m_IsPrefsFile(false)
 {
     // See QTBUG-40796 and QTBUG-54510 as using UTF-8 as a codec for ini files is very broken
     // setIniCodec("UTF-8");
@@ -474,6 +477,7 @@ void SettingsStore::setDefaultMetadataLang(const QString &lang)
 {
     clearSettingsGroup();
     setValue(KEY_DEFAULT_METADATA_LANGUAGE, lang);
+    updateSnapshot();
 }
 
 void SettingsStore::setUILanguage(const QString &language_code)
@@ -546,12 +550,14 @@ void SettingsStore::setDictionary(const QString &name)
 {
     clearSettingsGroup();
     setValue(KEY_DICTIONARY_NAME, name);
+    updateSnapshot();
 }
 
 void SettingsStore::setSecondaryDictionary(const QString &name)
 {
     clearSettingsGroup();
     setValue(KEY_SECONDARY_DICTIONARY_NAME, name);
+    updateSnapshot();
 }
 
 void SettingsStore::setEnabledUserDictionaries(const QStringList names)
@@ -564,12 +570,14 @@ void SettingsStore::setSpellCheck(bool enabled)
 {
     clearSettingsGroup();
     setValue(KEY_SPELL_CHECK, enabled);
+    updateSnapshot();
 }
 
 void SettingsStore::setSpellCheckNumbers(bool enabled)
 {
     clearSettingsGroup();
     setValue(KEY_SPELL_CHECK_NUMBERS, enabled);
+    updateSnapshot();
 }
 
 void SettingsStore::setDefaultUserDictionary(const QString &name)
@@ -600,6 +608,7 @@ void SettingsStore::setShowFullPathOn(int on)
 {
     clearSettingsGroup();
     setValue(KEY_SHOWFULLPATH_ON, on);
+    updateSnapshot();
 }
 
 void SettingsStore::setHighDPI(int value)
@@ -612,6 +621,7 @@ void SettingsStore::setPreviewDark(int enabled)
 {
     clearSettingsGroup();
     setValue(KEY_PREVIEW_DARK_IN_DM, enabled);
+    updateSnapshot();
 }
 
 
@@ -619,6 +629,7 @@ void SettingsStore::setCleanOn(int on)
 {
     clearSettingsGroup();
     setValue(KEY_CLEAN_ON, on);
+    updateSnapshot();
 }
 
 void SettingsStore::setPluginMap(const QStringList &map)
@@ -645,6 +656,7 @@ void SettingsStore::setPreserveEntityCodeNames(const QList<std::pair <ushort, QS
     }
     setValue(KEY_PRESERVE_ENTITY_NAMES, names);
     setValue(KEY_PRESERVE_ENTITY_CODES, codes);
+    updateSnapshot();
 }
 
 void SettingsStore::setPluginEnginePaths(const QHash <QString, QString> &enginepaths)
@@ -833,6 +845,7 @@ void SettingsStore::clearAppearanceSettings()
     remove(KEY_DRAG_DISTANCE_TWEAK);
     remove(KEY_PREVIEW_DARK_IN_DM);
     ;
+    updateSnapshot();
 }
 
 void SettingsStore::clearSettingsGroup()
@@ -841,3 +854,11 @@ void SettingsStore::clearSettingsGroup()
         endGroup();
     }
 }
+
+void SettingsStore::updateSnapshot()
+{
+    // Only the user's preferences back the snapshot, not other ini files
+    if (m_IsPrefsFile) {
+        SettingsSnapshot::instance()->Refresh();
+    }
+}
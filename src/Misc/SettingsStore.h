@@ -398,6 +398,13 @@ private:
      * this class implements to be set in the wrong place.
      */
     void clearSettingsGroup();
+
+    /**
+     * Refreshes the SettingsSnapshot after one of its values was changed.
+     */
+    void updateSnapshot();
+
+    bool m_IsPrefsFile;
 };
 
 #endif // SETTINGSSTORE_H
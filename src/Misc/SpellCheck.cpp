@@ -37,6 +37,7 @@
 
 #include "Misc/HTMLSpellCheckML.h"
 #include "Misc/SpellCheck.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/SettingsStore.h"
 #include "Misc/Utility.h"
 #include "sigil_constants.h"
@@ -45,6 +46,9 @@
 # include <stdlib.h>
 #endif
 
+// A shard is simply emptied once it holds this many words
+static const int SPELL_CACHE_SHARD_LIMIT = 65536;
+
 SpellCheck *SpellCheck::m_instance = 0;
 
 SpellCheck *SpellCheck::instance()
@@ -80,6 +84,8 @@ SpellCheck::SpellCheck()
 
     // Load the dictionary the user has selected if one was saved.
     SettingsStore settings;
+    m_primaryDictionary = settings.dictionary();
+    m_secondaryDictionary = settings.secondary_dictionary();
 
     qDebug() << "settings primary dictionary: " << settings.dictionary();
     qDebug() << "settings secondary dictionary: " << settings.secondary_dictionary();
@@ -136,6 +142,7 @@ void SpellCheck::UnloadDictionary(const QString &dname)
         }
         m_opendicts.remove(dname);
     }
+    invalidateCache();
 }
 
 void SpellCheck::UnloadAllDictionaries()
@@ -187,14 +194,20 @@ bool SpellCheck::spell(const QString &word)
     if (dname.isEmpty()) return true;
 
     // if a dictionary exists but is not open yet, open it first
-    if (!m_opendicts.contains(dname)) {
+    if (!isDictionaryOpen(dname)) {
         loadDictionary(dname);
     }
-    HDictionary hdic = m_opendicts[dname];
-    Q_ASSERT(hdic.codec != nullptr);
-    Q_ASSERT(hdic.handle != nullptr);
-    bool res = hdic.handle->spell(hdic.codec->fromUnicode(Utility::getSpellingSafeText(HTMLSpellCheckML::textOf(word))).constData()) != 0;
-    res = res || isIgnored(HTMLSpellCheckML::textOf(word));
+    const QString text = HTMLSpellCheckML::textOf(word);
+    const QString key = dname % QChar('\t') % text;
+    bool res;
+    int generation;
+    if (!lookupCache(key, res, generation)) {
+        QMutexLocker locker(&mutex);
+        res = spellInDictionary(dname, text);
+        storeInCache(key, res, generation);
+    }
+    // ignored words are not part of the cached result
+    res = res || isIgnored(text);
     return res;
 }
 
@@ -202,18 +215,83 @@ bool SpellCheck::spell(const QString &word)
 // spell check word without langcode info in Primary and Secondary Dictionaries
 bool SpellCheck::spellPS(const QString &word)
 {
-    SettingsStore settings;
-    QString dname = settings.dictionary();
-    HDictionary hdic = m_opendicts[dname];
-    bool res = hdic.handle->spell(hdic.codec->fromUnicode(Utility::getSpellingSafeText(word)).constData()) != 0;
+    const QString key = QChar('\t') % word;
+    bool res;
+    int generation;
+    if (!lookupCache(key, res, generation)) {
+        QMutexLocker locker(&mutex);
+        res = spellInDictionary(m_primaryDictionary, word);
+        if (!res && !m_secondaryDictionary.isEmpty()) {
+            res = spellInDictionary(m_secondaryDictionary, word);
+        }
+        storeInCache(key, res, generation);
+    }
     res = res || isIgnored(word);
-    if (res) return res;
-    dname = settings.secondary_dictionary();
-    if (dname.isEmpty()) return res;
-    hdic = m_opendicts[dname];
-    Q_ASSERT(hdic.codec != nullptr);
-    Q_ASSERT(hdic.handle != nullptr);
-    return hdic.handle->spell(hdic.codec->fromUnicode(Utility::getSpellingSafeText(word)).constData()) != 0;
+    return res;
+}
+
+
+bool SpellCheck::isDictionaryOpen(const QString &dname)
+{
+    QMutexLocker locker(&mutex);
+    return m_opendicts.contains(dname);
+}
+
+
+bool SpellCheck::spellInDictionary(const QString &dname, const QString &text)
+{
+    // the dictionary may have been unloaded or failed to load since it was
+    // asked for, treat the word as correct as when there is no dictionary
+    QHash<QString, HDictionary>::const_iterator it = m_opendicts.constFind(dname);
+    if (it == m_opendicts.constEnd() || !it->handle || !it->codec) {
+        return true;
+    }
+    const HDictionary &hdic = it.value();
+    return hdic.handle->spell(hdic.codec->fromUnicode(Utility::getSpellingSafeText(text)).constData()) != 0;
+}
+
+
+bool SpellCheck::lookupCache(const QString &key, bool &result, int &generation)
+{
+    // The generation is taken before the lookup so a result computed
+    // from dictionaries that change meanwhile is never stored
+    generation = m_cacheGeneration.loadAcquire();
+    SpellCacheShard &shard = m_spellCache[qHash(key) % SPELL_CACHE_SHARDS];
+    QMutexLocker locker(&shard.mutex);
+    QHash<QString, bool>::const_iterator it = shard.results.constFind(key);
+    if (it == shard.results.constEnd()) {
+        return false;
+    }
+    result = it.value();
+    return true;
+}
+
+
+void SpellCheck::storeInCache(const QString &key, bool result, int generation)
+{
+    SpellCacheShard &shard = m_spellCache[qHash(key) % SPELL_CACHE_SHARDS];
+    QMutexLocker locker(&shard.mutex);
+    if (m_cacheGeneration.loadAcquire() != generation) {
+        return;
+    }
+    if (shard.results.size() >= SPELL_CACHE_SHARD_LIMIT) {
+        shard.results.clear();
+    }
+    shard.results.insert(key, result);
+}
+
+
+void SpellCheck::invalidateCache()
+{
+    m_cacheGeneration.ref();
+    for (int i = 0; i < SPELL_CACHE_SHARDS; ++i) {
+        QMutexLocker locker(&m_spellCache[i].mutex);
+        m_spellCache[i].results.clear();
+    }
+    // spellPS follows the dictionaries chosen in the preferences
+    std::shared_ptr<const SettingsSnapshot::Values> settings = SettingsSnapshot::current();
+    m_primaryDictionary = settings->dictionary;
+    m_secondaryDictionary = settings->secondaryDictionary;
 }
 
 
@@ -246,7 +324,9 @@ QStringList SpellCheck::suggestPS(const QString &word)
     char **suggestedWords;
     char **suggestedWords2;
     QString dname = settings.dictionary();
-    HDictionary hdic = m_opendicts[dname];
+    QMutexLocker locker(&mutex);
+    if (!m_opendicts.contains(dname)) return suggestions;
+    HDictionary hdic = m_opendicts.value(dname);
     Q_ASSERT(hdic.codec != nullptr);
     Q_ASSERT(hdic.handle != nullptr);
     int count = hdic.handle->suggest(&suggestedWords, hdic.codec->fromUnicode(Utility::getSpellingSafeText(word)).constData());
@@ -257,8 +337,8 @@ QStringList SpellCheck::suggestPS(const QString &word)
     }
     hdic.handle->free_list(&suggestedWords, count);
     dname = settings.secondary_dictionary();
-    if (dname.isEmpty()) return suggestions;
-    hdic = m_opendicts[dname];
+    if (dname.isEmpty() || !m_opendicts.contains(dname)) return suggestions;
+    hdic = m_opendicts.value(dname);
     Q_ASSERT(hdic.codec != nullptr);
     Q_ASSERT(hdic.handle != nullptr);
     count = hdic.handle->suggest(&suggestedWords2, hdic.codec->fromUnicode(Utility::getSpellingSafeText(word)).constData());
@@ -274,17 +354,20 @@ QStringList SpellCheck::suggestPS(const QString &word)
 
 void SpellCheck::clearIgnoredWords()
 {
+    QMutexLocker locker(&mutex);
     m_ignoredWords.clear();
 }
 
 
 void SpellCheck::ignoreWord(const QString &word)
 {
+    QMutexLocker locker(&mutex);
     m_ignoredWords[word] = 1;
 }
 
 
 bool SpellCheck::isIgnored(const QString &word) {
+    QMutexLocker locker(&mutex);
     return m_ignoredWords.value(word, 0);
 }
 
@@ -308,6 +391,11 @@ void SpellCheck::loadDictionary(const QString &dname)
         return;
     }
 
+    // Another thread may have opened it while we waited for the lock
+    if (m_opendicts.contains(dname)) {
+        return;
+    }
+
     // Dictionary files to use.
     QString aff = QString("%1%2.aff").arg(m_dictionaries.value(dname)).arg(dname);
     QString dic = QString("%1%2.dic").arg(m_dictionaries.value(dname)).arg(dname);
@@ -360,6 +448,7 @@ void SpellCheck::loadDictionary(const QString &dname)
             addWordToDictionary(word, dname);
         }
     }
+    invalidateCache();
     return;
 }
 
@@ -380,9 +469,11 @@ void SpellCheck::setDictionary(const QString &dname, bool forceReplace)
 
 QString SpellCheck::getWordChars(const QString &lang)
 {
+    // This is called from the background spellchecks so it reads the
+    // settings snapshot rather than building a SettingsStore
     QString dname;
     if (lang.isEmpty()) { 
-        dname = currentPrimaryDictionary();
+        dname = SettingsSnapshot::current()->dictionary;
     } else {
         dname = m_langcode2dict.value(lang, "");
     }
@@ -390,13 +481,12 @@ QString SpellCheck::getWordChars(const QString &lang)
     if (dname.isEmpty()) return "";
 
     // if a dictionary exists but is not open yet, open it first
-    if (!m_opendicts.contains(dname)) {
+    if (!isDictionaryOpen(dname)) {
         loadDictionary(dname);
     }
-    HDictionary hdic = m_opendicts[dname];
-    Q_ASSERT(hdic.codec != nullptr);
-    Q_ASSERT(hdic.handle != nullptr);
-    return hdic.wordchars;
+    QMutexLocker locker(&mutex);
+    if (!m_opendicts.contains(dname)) return "";
+    return m_opendicts.value(dname).wordchars;
 }
 
 
@@ -414,7 +504,9 @@ void SpellCheck::addToUserDictionary(const QString &word, QString dict_name)
 
     // Add the word only if the dictionary is enabled
     if (settings.enabledUserDictionaries().contains(dict_name)) {
-        addWordToDictionary(word, currentPrimaryDictionary());
+        QMutexLocker locker(&mutex);
+        addWordToDictionary(word, settings.dictionary());
+        invalidateCache();
     }
 
     if (!userDictionaryWords(dict_name).contains(word)) {
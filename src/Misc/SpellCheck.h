@@ -28,6 +28,7 @@
 #include <QString>
 #include <QStringList>
 #include <QMutex>
+#include <QAtomicInt>
 
 class Hunspell;
 class QStringList;
@@ -90,12 +91,45 @@ public:
 
 private:
     SpellCheck();
+
+    // Results are memoized per dictionary and word in shards, each with its
+    // own lock, so concurrent spellchecks rarely wait on each other.
+    // Hunspell is only consulted on a miss.
+    static const int SPELL_CACHE_SHARDS = 16;
+
+    struct SpellCacheShard {
+        QMutex mutex;
+        QHash<QString, bool> results;
+    };
+
+    bool lookupCache(const QString &key, bool &result, int &generation);
+    void storeInCache(const QString &key, bool result, int generation);
+
+    // Must be called with mutex held whenever the loaded dictionaries
+    // or their word lists change.
+    void invalidateCache();
+
+    bool isDictionaryOpen(const QString &dname);
+
+    // Must be called with mutex held. Words are correct when the
+    // dictionary is not open.
+    bool spellInDictionary(const QString &dname, const QString &text);
+
     QHash<QString, QString> m_dictionaries;
     QHash<QString, QString> m_langcode2dict;
+    // guards m_opendicts and m_ignoredWords, which the background
+    // spellchecks read while the GUI thread changes them
     mutable QMutex mutex;
     QHash<QString, struct HDictionary> m_opendicts;
     QHash<QString, int> m_ignoredWords;
 
+    SpellCacheShard m_spellCache[SPELL_CACHE_SHARDS];
+    QAtomicInt m_cacheGeneration;
+
+    // the dictionaries used by spellPS, guarded by mutex
+    QString m_primaryDictionary;
+    QString m_secondaryDictionary;
+
     static SpellCheck *m_instance;
 };
 
@@ -62,8 +62,27 @@ QString TextDocument::toText()
     txt = cursor.selectedText();
 #endif
 
-    QChar *uc = txt.data();
-    QChar *e = uc + txt.size();
+    NormalizeLineBreaks(txt);
+    return txt;
+}
+
+
+void TextDocument::NormalizeLineBreaks(QString &text)
+{
+    const QChar *begin = text.constData();
+    const QChar *end = begin + text.size();
+    const QChar *c = begin;
+    // only detach the string when something actually needs replacing
+    for (; c != end; ++c) {
+        ushort u = c->unicode();
+        if ((u == 0xfdd0) || (u == 0xfdd1) || (u == QChar::ParagraphSeparator) || (u == QChar::LineSeparator)) {
+            break;
+        }
+    }
+    if (c == end) return;
+
+    QChar *uc = text.data() + (c - begin);
+    QChar *e = text.data() + text.size();
 
     for (; uc != e; ++uc) {
         switch (uc->unicode()) {
@@ -77,6 +96,4 @@ QString TextDocument::toText()
 	    ;
         }
     }
-
-    return txt;
 }
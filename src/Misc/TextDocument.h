@@ -50,6 +50,10 @@ class TextDocument : public QTextDocument
 
   QString toText();
 
+  // The line and paragraph separators (and the frame markers) a
+  // QTextDocument keeps internally all become plain newlines
+  static void NormalizeLineBreaks(QString &text);
+
 };
 
 #endif
@@ -0,0 +1,157 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF8DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+#include "Misc/Utf8Decoder.h"
+
+
+// Printable ASCII plus tab, line feed and carriage return
+static inline bool IsTextAscii(uchar c)
+{
+    return (c >= 0x20 && c <= 0x7E) || c == 0x09 || c == 0x0A || c == 0x0D;
+}
+
+
+static inline bool IsContinuation(uchar c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+
+#ifdef UTF8DECODER_SSE2
+static inline bool IsTextAscii16(__m128i bytes)
+{
+    // any byte with the high bit set is not ASCII
+    if (_mm_movemask_epi8(bytes) != 0) {
+        return false;
+    }
+
+    __m128i controls = _mm_or_si128(_mm_cmplt_epi8(bytes, _mm_set1_epi8(0x20)),
+                                    _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7F)));
+    __m128i allowed = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x09)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x0A)),
+                                                _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x0D))));
+    return _mm_movemask_epi8(_mm_andnot_si128(allowed, controls)) == 0;
+}
+#endif
+
+
+bool Utf8Decoder::Decode(const QByteArray &data, QString &text)
+{
+    const uchar *src = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *end = src + data.size();
+
+    if (data.size() >= 3 && src[0] == 0xEF && src[1] == 0xBB && src[2] == 0xBF) {
+        src += 3;
+    }
+
+    // UTF-16 never needs more code units than UTF-8 needs bytes
+    QString result(int(end - src), Qt::Uninitialized);
+    ushort *out = reinterpret_cast<ushort *>(result.data());
+    ushort *start = out;
+
+    while (src < end) {
+#ifdef UTF8DECODER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+
+        while (end - src >= 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+
+            if (!IsTextAscii16(bytes)) {
+                break;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), _mm_unpackhi_epi8(bytes, zero));
+            src += 16;
+            out += 16;
+        }
+
+        if (src == end) {
+            break;
+        }
+#endif
+        uchar c = *src;
+        qptrdiff remaining = end - src;
+
+        if (IsTextAscii(c)) {
+            *out++ = c;
+            src += 1;
+        }
+        // non-overlong 2-byte
+        else if (c >= 0xC2 && c <= 0xDF) {
+            if (remaining < 2 || !IsContinuation(src[1])) {
+                return false;
+            }
+
+            *out++ = ((c & 0x1F) << 6) | (src[1] & 0x3F);
+            src += 2;
+        }
+        // 3-byte excluding overlongs and surrogates
+        else if (c >= 0xE0 && c <= 0xEF) {
+            if (remaining < 3) {
+                return false;
+            }
+
+            uchar low = c == 0xE0 ? 0xA0 : 0x80;
+            uchar high = c == 0xED ? 0x9F : 0xBF;
+
+            if (src[1] < low || src[1] > high || !IsContinuation(src[2])) {
+                return false;
+            }
+
+            *out++ = ((c & 0x0F) << 12) | ((src[1] & 0x3F) << 6) | (src[2] & 0x3F);
+            src += 3;
+        }
+        // 4-byte planes 1-16 as a surrogate pair
+        else if (c >= 0xF0 && c <= 0xF4) {
+            if (remaining < 4) {
+                return false;
+            }
+
+            uchar low = c == 0xF0 ? 0x90 : 0x80;
+            uchar high = c == 0xF4 ? 0x8F : 0xBF;
+
+            if (src[1] < low || src[1] > high || !IsContinuation(src[2]) || !IsContinuation(src[3])) {
+                return false;
+            }
+
+            uint code_point = ((c & 0x07) << 18) | ((src[1] & 0x3F) << 12) | ((src[2] & 0x3F) << 6) | (src[3] & 0x3F);
+            *out++ = QChar::highSurrogate(code_point);
+            *out++ = QChar::lowSurrogate(code_point);
+            src += 4;
+        } else {
+            return false;
+        }
+    }
+
+    result.truncate(int(out - start));
+    text = result;
+    return true;
+}
@@ -0,0 +1,56 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef UTF8DECODER_H
+#define UTF8DECODER_H
+
+class QByteArray;
+class QString;
+
+/**
+ * Validates and decodes UTF-8 to UTF-16 in a single pass.
+ *
+ * The bytes must be strictly well formed UTF-8 (no overlongs, surrogates
+ * or code points past U+10FFFF) and may contain no control characters
+ * besides tab, line feed and carriage return, which is what makes a
+ * document without a declared encoding recognizable as UTF-8.
+ * Runs of ASCII are checked and widened 16 bytes at a time where SSE2
+ * is available.
+ */
+class Utf8Decoder
+{
+
+public:
+
+    /**
+     * Decodes data into text, skipping a leading byte order mark.
+     *
+     * @param data The raw bytes.
+     * @param text Set to the decoded text on success.
+     * @return False if data is not valid as described above,
+     *         text is then left untouched.
+     */
+    static bool Decode(const QByteArray &data, QString &text);
+};
+
+#endif // UTF8DECODER_H
@@ -35,6 +35,7 @@
 #include <time.h>
 #include <string>
 
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -42,14 +43,19 @@
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QHash>
 #include <QtCore/QProcess>
+#include <QtCore/QSet>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QStringList>
 #include <QtCore/QStringRef>
 #include <QtCore/QTextStream>
+#include <QtCore/QThread>
 #include <QtCore/QtGlobal>
 #include <QtCore/QUrl>
 #include <QtCore/QUuid>
+#include <QtCore/QVector>
+#include <QtConcurrent/QtConcurrent>
 #include <QtWidgets/QMainWindow>
 #include <QTextEdit>
 #include <QMessageBox>
@@ -471,6 +477,23 @@ bool Utility::RenameFile(const QString &oldfilepath, const QString &newfilepath)
 }
 
 
+bool Utility::AtomicReplaceFile(const QString &newfilepath, const QString &targetfilepath)
+{
+    if (!QFileInfo(newfilepath).exists()) {
+        return false;
+    }
+
+#if defined(Q_OS_WIN32)
+    return MoveFileExW(Utility::QStringToStdWString(QDir::toNativeSeparators(newfilepath)).c_str(),
+                       Utility::QStringToStdWString(QDir::toNativeSeparators(targetfilepath)).c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    // rename() replaces an existing target atomically
+    return rename(newfilepath.toUtf8().data(), targetfilepath.toUtf8().data()) == 0;
+#endif
+}
+
+
 QString Utility::GetTemporaryFileNameWithExtension(const QString &extension)
 {
     SettingsStore ss;
@@ -777,6 +800,7 @@ bool Utility::UnZip(const QString &zippath, const QString &destpath)
 {
     int res = 0;
     QDir dir(destpath);
+    QList<ZipExtraction> extractions;
     if (!cp437) {
         cp437 = new QCodePage437Codec();
     }
@@ -863,63 +887,242 @@ bool Utility::UnZip(const QString &zippath, const QString &destpath)
                     if (!qfile_info.path().isEmpty()) dir.mkpath(qfile_info.path());
                 }
 
-                // Open the file entry in the archive for reading.
-                if (unzOpenCurrentFile(zfile) != UNZ_OK) {
-                    unzClose(zfile);
-                    return false;
+                // The entries are inflated once the whole directory is checked
+                ZipExtraction extraction;
+                extraction.offset = unzGetOffset64(zfile);
+                extraction.filepath = file_path;
+
+                if (!cp437_file_name.isEmpty() && cp437_file_name != qfile_name) {
+                    extraction.copypath = destpath + "/" + cp437_file_name;
                 }
 
-                // Open the file on disk to write the entry in the archive to.
-                QFile entry(file_path);
+                extractions.append(extraction);
+            }
+        } while ((res = unzGoToNextFile(zfile)) == UNZ_OK);
+    }
 
-                if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    return false;
-                }
+    if (res != UNZ_END_OF_LIST_OF_FILE) {
+        unzClose(zfile);
+        return false;
+    }
 
-                // Buffered reading and writing.
-                char buff[BUFF_SIZE] = {0};
-                int read = 0;
+    unzClose(zfile);
+    return UnZipEntries(zippath, extractions);
+}
 
-                while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
-                    entry.write(buff, read);
-                }
 
-                entry.close();
+// A run of neighbouring entries extracted by one worker
+struct ZipExtractionRun {
+    QString zippath;
+    QList<Utility::ZipExtraction> extractions;
+};
 
-                // Read errors are marked by a negative read amount.
-                if (read < 0) {
-                    unzCloseCurrentFile(zfile);
-                    unzClose(zfile);
-                    return false;
-                }
 
-                // The file was read but the CRC did not match.
-                // We don't check the read file size vs the uncompressed file size
-                // because if they're different there should be a CRC error.
-                if (unzCloseCurrentFile(zfile) == UNZ_CRCERROR) {
-                    unzClose(zfile);
-                    return false;
-                }
+static unzFile OpenZipForReading(const QString &zippath)
+{
+#ifdef Q_OS_WIN32
+    zlib_filefunc64_def ffunc;
+    fill_win32_filefunc64W(&ffunc);
+    return unzOpen2_64(Utility::QStringToStdWString(QDir::toNativeSeparators(zippath)).c_str(), &ffunc);
+#else
+    return unzOpen64(QDir::toNativeSeparators(zippath).toUtf8().constData());
+#endif
+}
 
-                if (!cp437_file_name.isEmpty() && cp437_file_name != qfile_name) {
-                    QString cp437_file_path = destpath + "/" + cp437_file_name;
-                    QFile::copy(file_path, cp437_file_path);
-                }
-            }
-        } while ((res = unzGoToNextFile(zfile)) == UNZ_OK);
+
+static bool ExtractOneEntry(unzFile zfile, Utility::ZipExtraction &extraction)
+{
+    unz_file_info64 file_info;
+
+    if ((unzSetOffset64(zfile, extraction.offset) != UNZ_OK) ||
+        (unzGetCurrentFileInfo64(zfile, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)) {
+        return false;
     }
 
-    if (res != UNZ_END_OF_LIST_OF_FILE) {
-        unzClose(zfile);
+    // Open the file entry in the archive for reading.
+    if (unzOpenCurrentFile(zfile) != UNZ_OK) {
         return false;
     }
 
-    unzClose(zfile);
+    // Open the file on disk to write the entry in the archive to.
+    QFile entry(extraction.filepath);
+
+    if (!entry.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        unzCloseCurrentFile(zfile);
+        return false;
+    }
+
+    if (extraction.keep_data && file_info.uncompressed_size < (quint64)std::numeric_limits<int>::max()) {
+        extraction.data.reserve((int)file_info.uncompressed_size);
+    }
+
+    // Buffered reading and writing.
+    char buff[BUFF_SIZE] = {0};
+    int read = 0;
+
+    while ((read = unzReadCurrentFile(zfile, buff, BUFF_SIZE)) > 0) {
+        entry.write(buff, read);
+
+        if (extraction.keep_data) {
+            extraction.data.append(buff, read);
+        }
+    }
+
+    entry.close();
+
+    // Read errors are marked by a negative read amount.
+    if (read < 0) {
+        unzCloseCurrentFile(zfile);
+        return false;
+    }
+
+    // The file was read but the CRC did not match.
+    // We don't check the read file size vs the uncompressed file size
+    // because if they're different there should be a CRC error.
+    if (unzCloseCurrentFile(zfile) == UNZ_CRCERROR) {
+        return false;
+    }
+
+    if (!extraction.copypath.isEmpty()) {
+        QFile::copy(extraction.filepath, extraction.copypath);
+    }
+
     return true;
 }
 
+
+static void ExtractRun(ZipExtractionRun &run)
+{
+    unzFile zfile = OpenZipForReading(run.zippath);
+
+    if (zfile == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < run.extractions.count(); ++i) {
+        Utility::ZipExtraction &extraction = run.extractions[i];
+        extraction.ok = ExtractOneEntry(zfile, extraction);
+
+        if (!extraction.ok) {
+            break;
+        }
+    }
+
+    unzClose(zfile);
+}
+
+
+// The first entry of the group holding entry i, see UnZipEntries
+static int FindZipGroup(QVector<int> &groups, int i)
+{
+    while (groups.at(i) != i) {
+        groups[i] = groups.at(groups.at(i));
+        i = groups.at(i);
+    }
+
+    return i;
+}
+
+
+bool Utility::UnZipEntries(const QString &zippath, QList<ZipExtraction> &entries)
+{
+    if (entries.isEmpty()) {
+        return true;
+    }
+
+    // An archive can hold the same name twice, only the last one
+    // is kept as it would have overwritten the earlier ones
+    QSet<QString> seen;
+
+    for (int i = entries.count() - 1; i >= 0; --i) {
+        if (seen.contains(entries.at(i).filepath)) {
+            entries.removeAt(i);
+        } else {
+            seen.insert(entries.at(i).filepath);
+        }
+    }
+
+    // Names that differ only in case are the same file on case insensitive
+    // file systems, and the cp437 copy of one entry can land on another entry.
+    // Entries that may write the same file are grouped so that one worker
+    // writes them all in archive order and the last one still wins.
+    QVector<int> groups(entries.count());
+    QHash<QString, int> first_writer;
+
+    for (int i = 0; i < entries.count(); ++i) {
+        groups[i] = i;
+        QStringList paths = QStringList() << entries.at(i).filepath;
+
+        if (!entries.at(i).copypath.isEmpty()) {
+            paths << entries.at(i).copypath;
+        }
+
+        foreach(QString path, paths) {
+            QString key = path.toCaseFolded();
+
+            if (!first_writer.contains(key)) {
+                first_writer.insert(key, i);
+                continue;
+            }
+
+            // the group is always named after its first entry
+            int a = FindZipGroup(groups, first_writer.value(key));
+            int b = FindZipGroup(groups, i);
+            groups[qMax(a, b)] = qMin(a, b);
+        }
+    }
+
+    QList<QList<int>> units;
+    QHash<int, int> unit_of_group;
+
+    for (int i = 0; i < entries.count(); ++i) {
+        int group = FindZipGroup(groups, i);
+
+        if (group == i) {
+            unit_of_group.insert(group, units.count());
+            units.append(QList<int>());
+        }
+
+        units[unit_of_group.value(group)].append(i);
+    }
+
+    // Runs of neighbouring entries keep the reads of each worker mostly
+    // sequential, several runs per thread even out the differing sizes
+    int num_runs = qMin(entries.count(), qMax(1, QThread::idealThreadCount() * 4));
+    int run_length = (entries.count() + num_runs - 1) / num_runs;
+    QList<ZipExtractionRun> runs;
+    ZipExtractionRun run;
+    run.zippath = zippath;
+
+    foreach(QList<int> unit, units) {
+        foreach(int i, unit) {
+            run.extractions.append(entries.at(i));
+        }
+
+        if (run.extractions.count() >= run_length) {
+            runs.append(run);
+            run.extractions.clear();
+        }
+    }
+
+    if (!run.extractions.isEmpty()) {
+        runs.append(run);
+    }
+
+    QtConcurrent::blockingMap(runs, ExtractRun);
+
+    bool success = true;
+    entries.clear();
+    foreach(ZipExtractionRun run, runs) {
+        foreach(ZipExtraction extraction, run.extractions) {
+            success = success && extraction.ok;
+            entries.append(extraction);
+        }
+    }
+
+    return success;
+}
+
 QStringList Utility::ZipInspect(const QString &zippath)
 {
     QStringList filelist;
@@ -27,6 +27,8 @@
 
 
 #include <QCoreApplication>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
 #include <QtCore/QString>
 #include <QColor>
 
@@ -56,6 +58,24 @@ public:
         ERROR_BRUSH,
     };
 
+    // One file to extract from a zip archive, found by the
+    // position of its entry in the archive's central directory
+    struct ZipExtraction {
+        quint64 offset;
+
+        // where to write the file and an optional second copy
+        QString filepath;
+        QString copypath;
+
+        // keep the inflated content in data as well
+        bool keep_data;
+        QByteArray data;
+
+        bool ok;
+
+        ZipExtraction() : offset(0), keep_data(false), ok(false) {}
+    };
+
     static QString ChangeCase(const QString &text, const Casing &casing);
 
     // Define the user preferences location to be used
@@ -119,6 +139,10 @@ public:
 
     static bool RenameFile(const QString &oldfilepath, const QString &newfilepath);
 
+    // Moves newfilepath over targetfilepath in one step so the target is
+    // never left half written. Both must be on the same file system.
+    static bool AtomicReplaceFile(const QString &newfilepath, const QString &targetfilepath);
+
     // Returns path to a random filename with the specified extension in
     // the systems TEMP directory. The caller has responsibility for
     // creating a file at this location and removing it afterwards.
@@ -194,6 +218,10 @@ public:
 #endif
 
     static bool UnZip(const QString &zippath, const QString &destdir);
+
+    // Inflates the entries on worker threads, each with its own handle
+    // on the archive. Returns false if any entry could not be extracted.
+    static bool UnZipEntries(const QString &zippath, QList<ZipExtraction> &entries);
     static QStringList ZipInspect(const QString &zippath);
 
     // Generate relative path to destination from starting directory path
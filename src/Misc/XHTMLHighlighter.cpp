@@ -20,9 +20,9 @@
 **
 *************************************************************************/
 
+#include <QtConcurrent/QtConcurrent>
 #include <QSyntaxHighlighter>
 #include <QTextDocument>
-#include <QRegularExpressionMatch>
 #include <QBrush>
 #include <QColor>
 #include <QDebug>
@@ -31,46 +31,277 @@
 #include "Misc/Utility.h"
 #include "Misc/XHTMLHighlighter.h"
 #include "Misc/HTMLSpellCheck.h"
+#include "Misc/SettingsSnapshot.h"
 #include "Misc/SettingsStore.h"
 
-// All of our regular expressions
-static const QString DOCTYPE_BEGIN          = "<!(?!--)";
-static const QString HTML_ELEMENT_BEGIN     = "<(/\\?|/|\\?)?(?!!)";
+// How many blocks are spellchecked on a worker thread at a time,
+// about a screenful
+static const int SPELLING_BATCH_BLOCKS = 64;
 
-// "(?=[^\\w:-])" emulates a boundary ("\\b") that counts ":" and "-" as word characters
-static const QString HTML_ELEMENT_NAME      = "\\s*[\\w:-]+(?=[^\\w:-])\\s*(?!=)";
-static const QString HTML_ELEMENT_END       = "(\\?|/)?>";
+// Edits in quick succession are collected before checking starts
+static const int SPELLING_DELAY_MS = 50;
 
-static const QString HTML_COMMENT_BEGIN     = "<!--";
-static const QString HTML_COMMENT_END       = "-->";
 
-static const QString CSS_BEGIN              = "<\\s*style[^>]*>";
-static const QString CSS_END                = "</\\s*style[^>]*>";
+static inline ushort CharAt(const ushort *text, int length, int pos)
+{
+    return pos < length ? text[pos] : 0;
+}
+
+
+static inline bool IsSpace(ushort c)
+{
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+}
+
+
+static inline bool IsNameChar(ushort c)
+{
+    return ((c >= 'a') && (c <= 'z')) ||
+           ((c >= 'A') && (c <= 'Z')) ||
+           ((c >= '0') && (c <= '9')) ||
+           (c == '_') || (c == ':') || (c == '-');
+}
+
+
+static inline bool IsSpecialSpace(ushort c)
+{
+    return (c == 0x00A0) || ((c >= 0x2000) && (c <= 0x200A)) || (c == 0x202F) || (c == 0x3000);
+}
+
+
+static int MatchLiteral(const ushort *text, int length, int pos, const char *literal)
+{
+    int i = pos;
+
+    for (; *literal; ++literal, ++i) {
+        if (CharAt(text, length, i) != static_cast<ushort>(*literal)) {
+            return -1;
+        }
+    }
+
+    return i - pos;
+}
+
+
+// The matchers below return the length of the match
+// starting at pos or -1 if there is none
+
+static int MatchDoctypeBegin(const ushort *text, int length, int pos)
+{
+    if ((text[pos] != '<') || (CharAt(text, length, pos + 1) != '!')) {
+        return -1;
+    }
+
+    if ((CharAt(text, length, pos + 2) == '-') && (CharAt(text, length, pos + 3) == '-')) {
+        return -1;
+    }
+
+    return 2;
+}
+
+
+static int MatchElementBegin(const ushort *text, int length, int pos)
+{
+    if (text[pos] != '<') {
+        return -1;
+    }
+
+    ushort c1 = CharAt(text, length, pos + 1);
+    ushort c2 = CharAt(text, length, pos + 2);
+
+    if ((c1 == '/') && (c2 == '?') && (CharAt(text, length, pos + 3) != '!')) {
+        return 3;
+    }
+
+    if (((c1 == '/') || (c1 == '?')) && (c2 != '!')) {
+        return 2;
+    }
+
+    return c1 != '!' ? 1 : -1;
+}
+
+
+static int MatchElementName(const ushort *text, int length, int pos)
+{
+    int i = pos;
+
+    while ((i < length) && IsSpace(text[i])) {
+        i++;
+    }
+
+    int name_start = i;
+
+    while ((i < length) && IsNameChar(text[i])) {
+        i++;
+    }
+
+    // The name must be followed by something
+    if ((i == name_start) || (i == length)) {
+        return -1;
+    }
+
+    int name_end = i;
+
+    while ((i < length) && IsSpace(text[i])) {
+        i++;
+    }
+
+    // Stop short of an "=" as the name is then really an attribute,
+    // unless there is a space to give back before it
+    if (CharAt(text, length, i) == '=') {
+        if (i == name_end) {
+            return -1;
+        }
+        i--;
+    }
+
+    return i - pos;
+}
+
+
+static int MatchElementEnd(const ushort *text, int length, int pos)
+{
+    if (text[pos] == '>') {
+        return 1;
+    }
+
+    if (((text[pos] == '?') || (text[pos] == '/')) && (CharAt(text, length, pos + 1) == '>')) {
+        return 2;
+    }
+
+    return -1;
+}
+
+
+static int MatchHTMLCommentBegin(const ushort *text, int length, int pos)
+{
+    return MatchLiteral(text, length, pos, "<!--");
+}
+
+
+static int MatchHTMLCommentEnd(const ushort *text, int length, int pos)
+{
+    return MatchLiteral(text, length, pos, "-->");
+}
+
+
+// Matches the bracket and element name that start a tag at pos;
+// is_style tells whether the element is a style element
+static int MatchTagStart(const ushort *text, int length, int pos, bool &is_style)
+{
+    is_style = false;
+    int bracket_len = MatchElementBegin(text, length, pos);
+
+    if (bracket_len == -1) {
+        return -1;
+    }
+
+    int i = pos + bracket_len;
+    int name_len = MatchElementName(text, length, i);
+
+    if (name_len != -1) {
+        int name_start = i;
+
+        while (IsSpace(text[name_start])) {
+            name_start++;
+        }
+
+        is_style = (MatchLiteral(text, length, name_start, "style") != -1) &&
+                   !IsNameChar(CharAt(text, length, name_start + 5));
+        i += name_len;
+    }
+
+    return i - pos;
+}
+
+
+static int MatchAttributeName(const ushort *text, int length, int pos)
+{
+    int i = pos;
+
+    while ((i < length) && IsNameChar(text[i])) {
+        i++;
+    }
+
+    return i > pos ? i - pos : -1;
+}
+
+
+static int MatchAttributeValue(const ushort *text, int length, int pos)
+{
+    ushort quote = text[pos];
+
+    if ((quote != '"') && (quote != '\'')) {
+        return -1;
+    }
+
+    for (int i = pos + 1; i < length; ++i) {
+        if (text[i] == quote) {
+            return i + 1 - pos;
+        }
+
+        if (text[i] == '<') {
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+
+static int MatchEntity(const ushort *text, int length, int pos)
+{
+    if (text[pos] != '&') {
+        return -1;
+    }
 
-static const QString CSS_COMMENT_BEGIN      = "/\\*";
-static const QString CSS_COMMENT_END        = "\\*/";
+    int i = pos + 1;
 
-static const QString ATTRIBUTE_VALUE        = "\"[^<\"]*\"|'[^<']*'";
-static const QString ATTRIBUTE_NAME         = "[\\w:-]+";
+    while ((i < length) && (text[i] != ';') && !IsSpace(text[i])) {
+        i++;
+    }
+
+    return ((i > pos + 1) && (i < length) && (text[i] == ';')) ? i + 1 - pos : -1;
+}
 
-static const QString ENTITY_BEGIN           = "&(?=[^\\s;]+;)";
-static const QString ENTITY_END             = ";";
 
-static const QString SPECIAL_SPACE_BEGIN    = "[\\x{00A0}\\x{2000}-\\x{200A}\\x{202F}\\x{3000}]+";
+static int MatchSpecialSpaces(const ushort *text, int length, int pos)
+{
+    int i = pos;
+
+    while ((i < length) && IsSpecialSpace(text[i])) {
+        i++;
+    }
+
+    return i > pos ? i - pos : -1;
+}
+
 
 // Constructor
 XHTMLHighlighter::XHTMLHighlighter(bool checkSpelling, QObject *parent)
     : QSyntaxHighlighter(parent),
-      m_checkSpelling(checkSpelling)
-
+      m_checkSpelling(checkSpelling),
+      m_SpellingWatcher(new QFutureWatcher<QList<QList<HTMLSpellCheck::MisspelledWord>>>(this)),
+      m_SpellingGeneration(0),
+      m_FirstVisibleBlock(0)
 {
     SetRules();
+
+    if (m_checkSpelling) {
+        // The SpellCheck singleton sets the wait cursor so it must be created
+        // on the gui thread, the background checks load any further
+        // dictionaries they need under its mutex
+        SpellCheck::instance();
+    }
+
+    m_SpellingTimer.setSingleShot(true);
+    m_SpellingTimer.setInterval(SPELLING_DELAY_MS);
+    connect(&m_SpellingTimer, SIGNAL(timeout()), this, SLOT(StartSpellingBatch()));
+    connect(m_SpellingWatcher, SIGNAL(finished()), this, SLOT(SpellingBatchFinished()));
 }
 
 void XHTMLHighlighter::SetRules()
 {
-    m_Rules.clear();
-
     SettingsStore settings;
     if (Utility::IsDarkMode()) {
         m_codeViewAppearance = settings.codeViewDarkAppearance();
@@ -78,70 +309,21 @@ void XHTMLHighlighter::SetRules()
         m_codeViewAppearance = settings.codeViewAppearance();
     }
 
-    QTextCharFormat html_format;
-    QTextCharFormat doctype_format;
-    QTextCharFormat html_comment_format;
-    QTextCharFormat css_format;
-    QTextCharFormat css_comment_format;
-    QTextCharFormat attribute_name_format;
-    QTextCharFormat attribute_value_format;
-    QTextCharFormat entity_format;
-    QTextCharFormat special_space_format;
-
-    doctype_format        .setForeground(m_codeViewAppearance.xhtml_doctype_color);
-    html_format           .setForeground(m_codeViewAppearance.xhtml_html_color);
-    html_comment_format   .setForeground(m_codeViewAppearance.xhtml_html_comment_color);
-    css_format            .setForeground(m_codeViewAppearance.xhtml_css_color);
-    css_comment_format    .setForeground(m_codeViewAppearance.xhtml_css_comment_color);
-    attribute_name_format .setForeground(m_codeViewAppearance.xhtml_attribute_name_color);
-    attribute_value_format.setForeground(m_codeViewAppearance.xhtml_attribute_value_color);
-    entity_format         .setForeground(m_codeViewAppearance.xhtml_entity_color);
+    for (int i = 0; i < Format_Count; ++i) {
+        m_Formats[ i ] = QTextCharFormat();
+    }
+
+    m_Formats[ Format_DOCTYPE        ].setForeground(m_codeViewAppearance.xhtml_doctype_color);
+    m_Formats[ Format_HTML           ].setForeground(m_codeViewAppearance.xhtml_html_color);
+    m_Formats[ Format_HTMLComment    ].setForeground(m_codeViewAppearance.xhtml_html_comment_color);
+    m_Formats[ Format_CSS            ].setForeground(m_codeViewAppearance.xhtml_css_color);
+    m_Formats[ Format_CSSComment     ].setForeground(m_codeViewAppearance.xhtml_css_comment_color);
+    m_Formats[ Format_AttributeName  ].setForeground(m_codeViewAppearance.xhtml_attribute_name_color);
+    m_Formats[ Format_AttributeValue ].setForeground(m_codeViewAppearance.xhtml_attribute_value_color);
+    m_Formats[ Format_Entity         ].setForeground(m_codeViewAppearance.xhtml_entity_color);
     // use the same color as for entities but as an underline since they are "spaces"
-    special_space_format  .setUnderlineColor(m_codeViewAppearance.xhtml_entity_color);
-    special_space_format  .setUnderlineStyle(QTextCharFormat::DashUnderline);
-    HighlightingRule rule;
-    rule.pattern = QRegularExpression(DOCTYPE_BEGIN);
-    rule.format  = doctype_format;
-    m_Rules[ "DOCTYPE_BEGIN" ] = rule;
-    rule.pattern = QRegularExpression(HTML_ELEMENT_BEGIN);
-    rule.format  = html_format;
-    m_Rules[ "HTML_ELEMENT_BEGIN" ] = rule;
-    rule.pattern = QRegularExpression(HTML_ELEMENT_END);
-    rule.format  = html_format;
-    m_Rules[ "HTML_ELEMENT_END" ] = rule;
-    rule.pattern = QRegularExpression(HTML_COMMENT_BEGIN);
-    rule.format  = html_comment_format;
-    m_Rules[ "HTML_COMMENT_BEGIN" ] = rule;
-    rule.pattern = QRegularExpression(HTML_COMMENT_END);
-    rule.format  = html_comment_format;
-    m_Rules[ "HTML_COMMENT_END" ] = rule;
-    rule.pattern = QRegularExpression(CSS_BEGIN);
-    rule.format  = css_format;
-    m_Rules[ "CSS_BEGIN" ] = rule;
-    rule.pattern = QRegularExpression(CSS_END);
-    rule.format  = css_format;
-    m_Rules[ "CSS_END" ] = rule;
-    rule.pattern = QRegularExpression(CSS_COMMENT_BEGIN);
-    rule.format  = css_comment_format;
-    m_Rules[ "CSS_COMMENT_BEGIN" ] = rule;
-    rule.pattern = QRegularExpression(CSS_COMMENT_END);
-    rule.format  = css_comment_format;
-    m_Rules[ "CSS_COMMENT_END" ] = rule;
-    rule.pattern = QRegularExpression(ATTRIBUTE_NAME);
-    rule.format  = attribute_name_format;
-    m_Rules[ "ATTRIBUTE_NAME" ] = rule;
-    rule.pattern = QRegularExpression(ATTRIBUTE_VALUE);
-    rule.format  = attribute_value_format;
-    m_Rules[ "ATTRIBUTE_VALUE" ] = rule;
-    rule.pattern = QRegularExpression(ENTITY_BEGIN);
-    rule.format  = entity_format;
-    m_Rules[ "ENTITY_BEGIN" ] = rule;
-    rule.pattern = QRegularExpression(ENTITY_END);
-    rule.format  = entity_format;
-    m_Rules[ "ENTITY_END" ] = rule;
-    rule.pattern = QRegularExpression(SPECIAL_SPACE_BEGIN);
-    rule.format  = special_space_format;
-    m_Rules[ "SPECIAL_SPACE_BEGIN" ] = rule;
+    m_Formats[ Format_SpSpace        ].setUnderlineColor(m_codeViewAppearance.xhtml_entity_color);
+    m_Formats[ Format_SpSpace        ].setUnderlineStyle(QTextCharFormat::DashUnderline);
 }
 
 // Overrides the function from QSyntaxHighlighter;
@@ -150,327 +332,342 @@ void XHTMLHighlighter::SetRules()
 void XHTMLHighlighter::highlightBlock(const QString &text)
 {
     // By default, all block states are -1;
-    // in our implementation regular text is state == 1
-    if (previousBlockState() == -1) {
-        setCurrentBlockState(State_Text);
-    }
-    // Propagate previous state; needed for state tracking
-    else {
-        setCurrentBlockState(previousBlockState());
-    }
+    // in our implementation regular text is State_Text
+    int state = previousBlockState() == -1 ? State_Text : previousBlockState();
 
     if (text.isEmpty()) {
+        // Propagate previous state; needed for state tracking
+        setCurrentBlockState(state);
         return;
     }
 
-    SettingsStore settings;
-    m_enableSpellCheck = settings.spellCheck();
+    m_enableSpellCheck = SettingsSnapshot::current()->spellCheck;
 
     // Run spell check over the text.
     if (m_enableSpellCheck && m_checkSpelling) {
         CheckSpelling(text);
     }
 
-    // The order of these operations is important
-    // because some states format text over previous states!
-    HighlightLine(text, State_SpSpace);
-    HighlightLine(text, State_Entity);
-    HighlightLine(text, State_CSS);
-    HighlightLine(text, State_HTML);
-    HighlightLine(text, State_CSSComment);
-    HighlightLine(text, State_HTMLComment);
-    HighlightLine(text, State_DOCTYPE);
+    m_LineFormats.fill(Format_None, text.length());
+    int new_state = LexLine(text, state & ~State_CSSComment);
+
+    if (MarkCSSComments(text, state & State_CSSComment)) {
+        new_state |= State_CSSComment;
+    }
+
+    setCurrentBlockState(new_state);
+
+    // Apply the formats a run at a time
+    int index = 0;
+
+    while (index < text.length()) {
+        uchar format = m_LineFormats.at(index);
+        int end = index + 1;
+
+        while ((end < text.length()) && (m_LineFormats.at(end) == format)) {
+            end++;
+        }
+
+        if (format != Format_None) {
+            setFormat(index, end - index, m_Formats[ format ]);
+        }
+
+        index = end;
+    }
 }
 
 
 void XHTMLHighlighter::rehighlight()
 {
     SetRules();
+    // The dictionaries or the ignored words may have changed
+    m_SpellingGeneration++;
+    m_PendingSpelling.clear();
     QSyntaxHighlighter::rehighlight();
 }
 
 
-// Returns the regex that matches the left bracket of a state
-QRegularExpression XHTMLHighlighter::GetLeftBracketRegEx(int state) const
+void XHTMLHighlighter::SetFirstVisibleBlock(int block_number)
+{
+    m_FirstVisibleBlock = block_number;
+}
+
+
+// Gives the characters in the range the format, with
+// the same clipping as QSyntaxHighlighter::setFormat
+void XHTMLHighlighter::MarkFormat(int index, int length, Format format)
 {
-    QRegularExpression empty;
+    if ((index < 0) || (index >= m_LineFormats.size())) {
+        return;
+    }
 
-    switch (state) {
-        case State_Entity:
-            return m_Rules.value("ENTITY_BEGIN").pattern;
+    int end = qMin(index + length, m_LineFormats.size());
 
-        case State_HTML:
-            return m_Rules.value("HTML_ELEMENT_BEGIN").pattern;
+    for (int i = index; i < end; ++i) {
+        m_LineFormats[ i ] = format;
+    }
+}
 
-        case State_HTMLComment:
-            return m_Rules.value("HTML_COMMENT_BEGIN").pattern;
 
-        case State_CSS:
-            return m_Rules.value("CSS_BEGIN").pattern;
+// Walks the line once, giving each character the format of the node
+// it is in and moving between states as the node delimiters are found.
+// "state" is the state the previous line ended in;
+// returns the state this line ends in.
+int XHTMLHighlighter::LexLine(const QString &text, int state)
+{
+    const ushort *chars = text.utf16();
+    int length = text.length();
+    int i = 0;
+
+    while (i < length) {
+        int match_len = -1;
+        bool is_style = false;
+
+        switch (state) {
+            case State_Text:
+                if ((match_len = MatchHTMLCommentBegin(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_HTMLComment);
+                    state = State_HTMLComment;
+                } else if ((match_len = MatchDoctypeBegin(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_DOCTYPE);
+                    state = State_DOCTYPE;
+                } else if ((match_len = MatchTagStart(chars, length, i, is_style)) != -1) {
+                    MarkFormat(i, match_len, Format_HTML);
+                    state = is_style ? State_StyleTag : State_Tag;
+                } else if ((match_len = MatchEntity(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_Entity);
+                } else if ((match_len = MatchSpecialSpaces(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_SpSpace);
+                } else {
+                    match_len = 1;
+                }
+                break;
 
-        case State_CSSComment:
-            return m_Rules.value("CSS_COMMENT_BEGIN").pattern;
+            case State_Tag:
+            case State_StyleTag:
+                // The element name was taken with the bracket, so
+                // a name found now belongs to an attribute
+                if ((match_len = MatchElementEnd(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_HTML);
+                    state = state == State_StyleTag ? State_CSS : State_Text;
+                } else if ((match_len = MatchAttributeValue(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_AttributeValue);
+
+                    // A ">" ends the tag even inside a quoted value;
+                    // the value keeps its format up to its closing quote
+                    for (int j = i + 1; j < i + match_len - 1; ++j) {
+                        if (chars[ j ] == '>') {
+                            state = state == State_StyleTag ? State_CSS : State_Text;
+                            break;
+                        }
+                    }
+                } else if ((match_len = MatchAttributeName(chars, length, i)) != -1) {
+                    MarkFormat(i, match_len, Format_AttributeName);
+                } else {
+                    match_len = 1;
+                    MarkFormat(i, match_len, Format_HTML);
+                }
+                break;
+
+            case State_HTMLComment:
+                if ((match_len = MatchHTMLCommentEnd(chars, length, i)) != -1) {
+                    state = State_Text;
+                } else {
+                    match_len = 1;
+                }
+                MarkFormat(i, match_len, Format_HTMLComment);
+                break;
 
-        case State_DOCTYPE:
-            return m_Rules.value("DOCTYPE_BEGIN").pattern;
+            case State_DOCTYPE:
+                if ((match_len = MatchElementEnd(chars, length, i)) != -1) {
+                    state = State_Text;
+                } else {
+                    match_len = 1;
+                }
+                MarkFormat(i, match_len, Format_DOCTYPE);
+                break;
 
-        case State_SpSpace:
-            return m_Rules.value("SPECIAL_SPACE_BEGIN").pattern;
+            case State_CSS:
+                if ((CharAt(chars, length, i + 1) == '/') &&
+                    ((match_len = MatchTagStart(chars, length, i, is_style)) != -1) && is_style) {
+                    // only the closing style tag ends the style sheet
+                    MarkFormat(i, match_len, Format_HTML);
+                    state = State_Tag;
+                } else {
+                    match_len = 1;
+                    MarkFormat(i, match_len, Format_CSS);
+                }
+                break;
 
-        default:
-            return empty;
+            default:
+                // An unknown state can only come from a stale block; start over
+                state = State_Text;
+                match_len = 0;
+                break;
+        }
+
+        i += match_len;
     }
+
+    return state;
 }
 
 
-// Returns the regex that matches the right bracket of a state
-QRegularExpression XHTMLHighlighter::GetRightBracketRegEx(int state) const
+// Follows the "/*" and "*/" delimiters across the whole line, in and out
+// of tags and text alike, the way the CSS comment highlighting always has.
+bool XHTMLHighlighter::MarkCSSComments(const QString &text, bool in_comment)
 {
-    QRegularExpression empty;
-
-    switch (state) {
-        case State_Entity:
-            return m_Rules.value("ENTITY_END").pattern;
+    int length = text.length();
+    int index = 0;
 
-        case State_DOCTYPE:
-        case State_HTML:
-            return m_Rules.value("HTML_ELEMENT_END").pattern;
+    while (index < length) {
+        int begin = text.indexOf("/*", index);
+        int end = text.indexOf("*/", index);
 
-        case State_HTMLComment:
-            return m_Rules.value("HTML_COMMENT_END").pattern;
+        if (!in_comment) {
+            if (begin == -1) {
+                break;
+            }
 
-        case State_CSS:
-            return m_Rules.value("CSS_END").pattern;
+            if (end == -1) {
+                MarkCSSComment(begin, length - begin);
+                in_comment = true;
+                break;
+            }
 
-        case State_CSSComment:
-            return m_Rules.value("CSS_COMMENT_END").pattern;
+            // an end found ahead of the begin marks nothing
+            MarkCSSComment(begin, end + 2 - begin);
+            index = end + 2;
+        } else {
+            if (end == -1) {
+                MarkCSSComment(0, length);
+                break;
+            }
 
-        default:
-            return empty;
+            MarkCSSComment(0, end + 2);
+            in_comment = false;
+            index = end + 2;
+        }
     }
+
+    return in_comment;
 }
 
 
-// Sets the requested state for the current text block
-void XHTMLHighlighter::SetState(int state)
+void XHTMLHighlighter::MarkCSSComment(int index, int length)
 {
-    int current_state = currentBlockState();
-    // Add the current state to the list
-    current_state = current_state | state;
-    setCurrentBlockState(current_state);
+    int end = qMin(index + length, m_LineFormats.size());
+
+    for (int i = qMax(index, 0); i < end; ++i) {
+        if ((m_LineFormats.at(i) != Format_HTMLComment) && (m_LineFormats.at(i) != Format_DOCTYPE)) {
+            m_LineFormats[ i ] = Format_CSSComment;
+        }
+    }
 }
 
 
-// Clears the requested state for the current text block
-void XHTMLHighlighter::ClearState(int state)
+void XHTMLHighlighter::CheckSpelling(const QString &text)
 {
-    int current_state = currentBlockState();
-    // Remove the current state from the list
-    current_state = current_state & ~state;
-    setCurrentBlockState(current_state);
+    QTextBlock block = currentBlock();
+    SpellingBlockData *data = static_cast<SpellingBlockData *>(currentBlockUserData());
+
+    if (data && data->checked && (data->generation == m_SpellingGeneration) &&
+        (data->revision == block.revision()) && (data->text == text)) {
+        QTextCharFormat format;
+        format.setUnderlineColor(m_codeViewAppearance.spelling_underline_color);
+        // QTextCharFormat::SpellCheckUnderline has issues with Qt 5. It only displays
+        // at some zoom levels and often doesn't display at all. So we're using wave
+        // underline since it's good enough for most people.
+        format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+        foreach(HTMLSpellCheck::MisspelledWord misspelled_word, data->words) {
+            setFormat(misspelled_word.offset, misspelled_word.length, format);
+        }
+        return;
+    }
+
+    if (!data) {
+        data = new SpellingBlockData();
+        setCurrentBlockUserData(data);
+    }
+    data->checked = false;
+
+    SpellingJob job;
+    job.data = data;
+    job.block = block;
+    job.text = text;
+    job.revision = block.revision();
+    job.generation = m_SpellingGeneration;
+    m_PendingSpelling.insert(block.blockNumber(), job);
+
+    if (!m_SpellingWatcher->isRunning()) {
+        m_SpellingTimer.start();
+    }
 }
 
 
-// Checks if the requested state is set
-// for the current text block
-bool XHTMLHighlighter::StateChecked(int state) const
+QList<QList<HTMLSpellCheck::MisspelledWord>> XHTMLHighlighter::CheckSpellingOfTexts(const QStringList &texts)
 {
-    int current_state = currentBlockState();
-    // Check if our state is in the list
-    if ((current_state & state) != 0) {
-        return true;
-    } else {
-        return false;
+    QList<QList<HTMLSpellCheck::MisspelledWord>> results;
+    foreach(const QString &text, texts) {
+        results.append(HTMLSpellCheck::GetMisspelledWords(text));
     }
+    return results;
 }
 
-// Formats the inside of a node;
-// "text" is the textblock/line of text;
-// "state" describes the node;
-// "index" is the index to start formatting from;
-// "length" is the length of chars to format.
-void XHTMLHighlighter::FormatBody(const QString &text, int state, int index, int length)
-{
-    if (state == State_HTML) {
-        // First paint everything the color of the brackets
-        setFormat(index, length, m_Rules.value("HTML_ELEMENT_BEGIN").format);
-        QRegularExpression name  = m_Rules.value("ATTRIBUTE_NAME").pattern;
-        QRegularExpression value = m_Rules.value("ATTRIBUTE_VALUE").pattern;
-        // Used to move over the line
-        int main_index = index;
-
-        // We skip over the left bracket (if it's present)
-        QRegularExpression bracket(HTML_ELEMENT_BEGIN);
-        QRegularExpressionMatch bracket_match = bracket.match(text, main_index);
-        if (bracket_match.hasMatch() && bracket_match.capturedStart() == main_index) {
-            main_index += bracket_match.capturedLength();
-        }
-
-        // We skip over the element name (if it's present)
-        // because we want it to be the same color as the brackets
-        QRegularExpression elem_name(HTML_ELEMENT_NAME);
-        QRegularExpressionMatch elem_name_match = elem_name.match(text, main_index);
-        if (elem_name_match.hasMatch() && elem_name_match.capturedStart() == main_index) {
-            main_index += elem_name_match.capturedLength();
-        }
-
-        while (true) {
-            // Get the indexes of the attribute names and values
-            int name_index = -1;
-            int name_len = 0;
-            QRegularExpressionMatch name_match = name.match(text, main_index);
-            if (name_match.hasMatch()) {
-                name_index = name_match.capturedStart();
-                name_len = name_match.capturedLength();
-            }
 
-            int value_index = -1;
-            int value_len = 0;
-            QRegularExpressionMatch value_match = value.match(text, main_index);
-            if (value_match.hasMatch()) {
-                value_index = value_match.capturedStart();
-                value_len = value_match.capturedLength();
-            }
+void XHTMLHighlighter::StartSpellingBatch()
+{
+    if (m_PendingSpelling.isEmpty() || m_SpellingWatcher->isRunning()) {
+        return;
+    }
 
-            // If we can't find the names and values or we found them
-            // outside of the area we are formatting, we exit
-            if (((name_index  != -1) && (name_index  < index + length)) ||
-                ((value_index != -1) && (value_index < index + length))) {
-                // ... otherwise format the found sections
-                setFormat(name_index,  name_len,  m_Rules.value("ATTRIBUTE_NAME").format);
-                setFormat(value_index, value_len, m_Rules.value("ATTRIBUTE_VALUE").format);
-            } else {
-                break;
-            }
+    // Take the blocks from the top of the view down, wrapping around
+    QMap<int, SpellingJob>::iterator it = m_PendingSpelling.lowerBound(m_FirstVisibleBlock);
+    QStringList texts;
+    m_RunningSpelling.clear();
 
-            // Update the main index with the regex that matched "further down the line"
-            if (name_index + name_len > value_index + value_len) {
-                main_index = name_index + name_len;
-            } else {
-                main_index = value_index + value_len;
-            }
+    while (!m_PendingSpelling.isEmpty() && (m_RunningSpelling.count() < SPELLING_BATCH_BLOCKS)) {
+        if (it == m_PendingSpelling.end()) {
+            it = m_PendingSpelling.begin();
         }
-    } else if (state == State_HTMLComment) {
-        setFormat(index, length, m_Rules.value("HTML_COMMENT_BEGIN").format);
-    } else if (state == State_CSS) {
-        setFormat(index, length, m_Rules.value("CSS_BEGIN").format);
-    } else if (state == State_CSSComment) {
-        setFormat(index, length, m_Rules.value("CSS_COMMENT_BEGIN").format);
-    } else if (state == State_Entity) {
-        setFormat(index, length, m_Rules.value("ENTITY_BEGIN").format);
-    } else if (state == State_SpSpace) {
-        setFormat(index, length, m_Rules.value("SPECIAL_SPACE_BEGIN").format);
-    } else if (state == State_DOCTYPE) {
-        setFormat(index, length, m_Rules.value("DOCTYPE_BEGIN").format);
+        m_RunningSpelling.append(it.value());
+        texts.append(it.value().text);
+        it = m_PendingSpelling.erase(it);
     }
+
+    m_SpellingWatcher->setFuture(QtConcurrent::run(&XHTMLHighlighter::CheckSpellingOfTexts, texts));
 }
 
 
-// Highlights the current line according to the state requested;
-// check to see if the node of type "state" is present;
-// if it is, the node is formatted
-void XHTMLHighlighter::HighlightLine(const QString &text, int state)
+void XHTMLHighlighter::SpellingBatchFinished()
 {
-    QRegularExpression left_bracket_regex  = GetLeftBracketRegEx(state);
-    QRegularExpression right_bracket_regex = GetRightBracketRegEx(state);
-    int main_index = 0;
-
-    // We loop over the line several times
-    // because we could have several nodes on it
-    while (main_index < text.length()) {
-        int left_bracket_index  = -1;
-        int left_bracket_len = 0;
-        int right_bracket_index = -1;
-        int right_bracket_len = 0;
-
-        if (!left_bracket_regex.pattern().isEmpty()) {
-            QRegularExpressionMatch left_bracket_match = left_bracket_regex.match(text, main_index);
-            if (left_bracket_match.hasMatch()) {
-                left_bracket_index = left_bracket_match.capturedStart();
-                left_bracket_len = left_bracket_match.capturedLength();
-            }
-        }
+    QList<QList<HTMLSpellCheck::MisspelledWord>> results = m_SpellingWatcher->result();
+    QTextDocument *doc = document();
 
-        if (!right_bracket_regex.pattern().isEmpty()) {
-            QRegularExpressionMatch right_bracket_match = right_bracket_regex.match(text, main_index);
-            if (right_bracket_match.hasMatch()) {
-                right_bracket_index = right_bracket_match.capturedStart();
-                right_bracket_len = right_bracket_match.capturedLength();
-            }
-        }
+    for (int i = 0; i < m_RunningSpelling.count() && i < results.count(); ++i) {
+        const SpellingJob &job = m_RunningSpelling.at(i);
 
-        // If we are not starting our state and our state is
-        // not already set, we don't format; see the four cases explanation below
-        if (left_bracket_index == -1 && !StateChecked(state)) {
-            return;
+        // The block is still in the document as long as its user data is.
+        // If it was edited meanwhile it has been queued again.
+        if (!doc || !job.data || (job.generation != m_SpellingGeneration) ||
+            (job.block.revision() != job.revision) || (job.block.text() != job.text)) {
+            continue;
         }
 
-        // Special Spaces State should always be case (1) but has no ending regex
-        if (state == State_SpSpace) {
-  	    right_bracket_index = left_bracket_index + left_bracket_len;
-	    right_bracket_len = 0;
-	}
-
-        // Every node/state has a left "bracket", a right "bracket" and the inside body.
-        // This example uses HTML tags, but the principle is the same for every node/state.
-        // There are four possible cases:
-        // (1)  <......>    (both brackets on the same line; state starts and stops here)
-        // (2)  <.......    (only the left bracket; next line continues state)
-        // (3)  .......>    (only the right bracket; current line ends state)
-        // (4)  ........    (no brackets; a line between (2) and (3))
-
-        // We also check the state because we don't want to start a new node
-        // if the current node of the same type hasn't finished
-        if (left_bracket_index != -1 && !StateChecked(state)) {
-            main_index = left_bracket_index + left_bracket_len;
-
-            // (1)
-            if (right_bracket_index != -1) {
-                main_index = right_bracket_index + right_bracket_len;
-                int length = right_bracket_index - left_bracket_index + right_bracket_len;
-                FormatBody(text, state, left_bracket_index, length);
-                // There's no point in setting the state here because the state
-                // starts and ends on this line.
-            }
-            // (2)
-            else {
-                int length = text.length() - left_bracket_index;
-                FormatBody(text, state, left_bracket_index, length);
-                main_index += length;
-                // Set the current state so the next line can continue
-                // with the formatting.
-                SetState(state);
-            }
-        } else {
-            // (3)
-            if (right_bracket_index != -1) {
-                main_index = right_bracket_index + right_bracket_len;
-                int length = right_bracket_index + right_bracket_len;
-                FormatBody(text, state, 0, length);
-                // Clear the current state because our state has just ended.
-                ClearState(state);
-            }
-            // (4)
-            else {
-                int length = text.length();
-                FormatBody(text, state, 0, length);
-                main_index += length;
-            }
+        job.data->checked = true;
+        job.data->revision = job.revision;
+        job.data->generation = job.generation;
+        job.data->text = job.text;
+        job.data->words = results.at(i);
+
+        if (!job.data->words.isEmpty()) {
+            // Keep the reformatting from being taken as a change to the text
+            bool signals_blocked = doc->blockSignals(true);
+            rehighlightBlock(job.block);
+            doc->blockSignals(signals_blocked);
         }
     }
-}
-
 
-void XHTMLHighlighter::CheckSpelling(const QString &text)
-{
-    QTextCharFormat format;
-    format.setUnderlineColor(m_codeViewAppearance.spelling_underline_color);
-    // QTextCharFormat::SpellCheckUnderline has issues with Qt 5. It only displays
-    // at some zoom levels and often doesn't display at all. So we're using wave
-    // underline since it's good enough for most people.
-    format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
-    QList<HTMLSpellCheck::MisspelledWord> misspelled_words = HTMLSpellCheck::GetMisspelledWords(text);
-    foreach(HTMLSpellCheck::MisspelledWord misspelled_word, misspelled_words) {
-        setFormat(misspelled_word.offset, misspelled_word.length, format);
-    }
+    m_RunningSpelling.clear();
+    StartSpellingBatch();
 }
@@ -23,15 +23,38 @@
 #ifndef XHTMLHIGHLIGHTER_H
 #define XHTMLHIGHLIGHTER_H
 
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QMap>
+#include <QtCore/QPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
 #include <QtGui/QSyntaxHighlighter>
-#include <QRegularExpression>
+#include <QtGui/QTextBlock>
+#include <QtGui/QTextBlockUserData>
 
+#include "Misc/HTMLSpellCheck.h"
 #include "Misc/SettingsStore.h"
 
 class QTextDocument;
 
+// The misspelled words found in a block, stored as the block's user data.
+// They are valid as long as the block's revision and text are unchanged.
+class SpellingBlockData : public QObject, public QTextBlockUserData
+{
+public:
+    SpellingBlockData() : checked(false), revision(-1), generation(-1) {}
+
+    bool checked;
+    int revision;
+    int generation;
+    QString text;
+    QList<HTMLSpellCheck::MisspelledWord> words;
+};
+
 class XHTMLHighlighter : public QSyntaxHighlighter
 {
+    Q_OBJECT
 
 public:
 
@@ -39,8 +62,14 @@ public:
     XHTMLHighlighter(bool checkSpelling, QObject *parent = 0);
 
     void SetRules();
+
+    // Also drops all spelling results so every block is checked again
     void rehighlight();
 
+    // Spelling is checked starting from this block, so the
+    // visible blocks get their underlines first
+    void SetFirstVisibleBlock(int block_number);
+
 protected:
 
     // Overrides the function from QSyntaxHighlighter;
@@ -50,61 +79,85 @@ protected:
 
 private:
 
-    // Returns the regex that matches the left bracket of a state
-    QRegularExpression GetLeftBracketRegEx(int state) const;
+    // The formats a character of a line can be given
+    enum Format {
+        Format_None = 0,
+        Format_DOCTYPE,
+        Format_HTML,
+        Format_HTMLComment,
+        Format_CSS,
+        Format_CSSComment,
+        Format_AttributeName,
+        Format_AttributeValue,
+        Format_Entity,
+        Format_SpSpace,
+        Format_Count
+    };
+
+    // Records the format for a range of the current line;
+    // they are all applied at once when the line is done
+    void MarkFormat(int index, int length, Format format);
 
-    // Returns the regex that matches the right bracket of a state
-    QRegularExpression GetRightBracketRegEx(int state) const;
+    // Records the format of every character of the line in one pass;
+    // "state" is the state the previous line ended in,
+    // the state the line ends in is returned
+    int LexLine(const QString &text, int state);
 
-    // Sets the requested state for the current text block
-    void SetState(int state);
+    // Marks the CSS comments of the line over the formats LexLine found,
+    // except inside HTML comments and DOCTYPEs which take precedence;
+    // returns whether the line ends inside a comment
+    bool MarkCSSComments(const QString &text, bool in_comment);
 
-    // Clears the requested state for the current text block
-    void ClearState(int state);
+    void MarkCSSComment(int index, int length);
 
-    // Checks if the requested state is set
-    // for the current text block
-    bool StateChecked(int state) const;
+    // Underlines the misspelled words of the current block if they are
+    // known, otherwise queues the block to be checked in the background
+    void CheckSpelling(const QString &text);
 
-    // Formats the inside of a node;
-    // "text" is the textblock/line;
-    // "state" describes the node;
-    // "index" is the index to start formatting from
-    // "length" is the length of chars to format
-    void FormatBody(const QString &text, int state, int index, int length);
+    // Runs on a worker thread
+    static QList<QList<HTMLSpellCheck::MisspelledWord>> CheckSpellingOfTexts(const QStringList &texts);
 
-    // Highlights the current line according to the state requested;
-    // check to see if the node of type "state" is present;
-    // if it is, the node is formatted
-    void HighlightLine(const QString &text, int state);
+private slots:
 
-    void CheckSpelling(const QString &text);
+    // Starts checking the next batch of queued blocks
+    void StartSpellingBatch();
+
+    // Stores the results of a batch and rehighlights its blocks
+    void SpellingBatchFinished();
+
+private:
+
+    struct SpellingJob {
+        QPointer<SpellingBlockData> data;
+        QTextBlock block;
+        QString text;
+        int revision;
+        int generation;
+    };
 
 
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
 
-    // Al the possible nodes/states
+    // The nodes a line can end inside of, kept as the block state.
+    // CSS comments are found anywhere on a line, whatever node they
+    // are in, so whether a line ends inside one is kept as a separate bit.
     enum BlockState {
-        State_Text          = 1 << 0,
-        State_SpSpace       = 1 << 1,
-        State_Entity        = 1 << 2,
-        State_HTML          = 1 << 3,
-        State_CSS           = 1 << 4,
-        State_CSSComment    = 1 << 5,
-        State_HTMLComment   = 1 << 6,
-        State_DOCTYPE       = 1 << 7
+        State_Text = 0,
+        State_Tag,
+        State_StyleTag,
+        State_HTMLComment,
+        State_DOCTYPE,
+        State_CSS,
+        State_CSSComment = 0x100
     };
 
-    struct HighlightingRule {
-        QRegularExpression pattern;
-        QTextCharFormat format;
-    };
+    // The text formats used
+    QTextCharFormat m_Formats[ Format_Count ];
 
-    // Stores all of our highlighting rules
-    // and the text formats used
-    QHash<QString, HighlightingRule> m_Rules;
+    // The Format of each character of the line being highlighted
+    QVector<uchar> m_LineFormats;
 
     // Determine if spell check should be used on the document.
     bool m_checkSpelling;
@@ -113,6 +166,20 @@ private:
     bool m_enableSpellCheck;
 
     SettingsStore::CodeViewAppearance m_codeViewAppearance;
+
+    // Blocks waiting to be spellchecked keyed on their block number
+    QMap<int, SpellingJob> m_PendingSpelling;
+
+    // Blocks being spellchecked on a worker thread
+    QList<SpellingJob> m_RunningSpelling;
+
+    QFutureWatcher<QList<QList<HTMLSpellCheck::MisspelledWord>>> *m_SpellingWatcher;
+
+    QTimer m_SpellingTimer;
+
+    int m_SpellingGeneration;
+
+    int m_FirstVisibleBlock;
 };
 
 #endif // XHTMLHIGHLIGHTER_H
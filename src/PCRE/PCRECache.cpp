@@ -20,40 +20,96 @@
 **
 *************************************************************************/
 
+#include <limits>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutexLocker>
+
 #include "PCRE/PCRECache.h"
 
-PCRECache *PCRECache::m_instance = 0;
+// The default memory limit for the cached patterns. JIT compiled
+// patterns take a few KB each so this holds several hundred of them.
+static const int DEFAULT_MAX_CACHE_SIZE = 16 * 1024 * 1024;
 
 PCRECache *PCRECache::instance()
 {
-    if (m_instance == 0) {
-        m_instance = new PCRECache();
+    // search workers ask for the cache too, so rely on the
+    // thread safe initialization of function local statics
+    static PCRECache *cache = new PCRECache();
+    return cache;
+}
+
+PCRECache::PCRECache()
+    : m_cache(DEFAULT_MAX_CACHE_SIZE)
+{
+    // allow the limit to be raised for very large saved search groups
+    bool ok = false;
+    int megabytes = qgetenv("SIGIL_PCRE_CACHE_SIZE").toInt(&ok);
+
+    if (ok && (megabytes > 0) && (megabytes < 2048)) {
+        m_cache.setMaxCost(megabytes * 1024 * 1024);
     }
+}
 
-    return m_instance;
+PCRECache::~PCRECache()
+{
 }
 
-PCRECache::PCRECache()
+static int CostOf(SPCRE *spcre)
 {
-  // defaults to maxCacheCost of 100
+    size_t size = spcre->getMemorySize();
+
+    if (size > (size_t) std::numeric_limits<int>::max()) {
+        return std::numeric_limits<int>::max();
+    }
+
+    return (int) size;
 }
 
 bool PCRECache::insert(const QString &key, SPCRE *object)
 {
-    // raise cost of each entry to 5 to reduce memory footprint
-    return m_cache.insert(key, object, 5);
+    QMutexLocker locker(&m_mutex);
+    int cost = CostOf(object);
+    return m_cache.insert(key, new std::shared_ptr<SPCRE>(object), cost);
 }
 
-SPCRE *PCRECache::getObject(const QString &key)
+std::shared_ptr<SPCRE> PCRECache::getObject(const QString &key)
 {
+    {
+        QMutexLocker locker(&m_mutex);
+        std::shared_ptr<SPCRE> *cached = m_cache.object(key);
+
+        if (cached) {
+            return *cached;
+        }
+    }
+
     // Create a new SPCRE if it doesn't already exist.
     // The key is the pattern for initializing the SPCRE.
-    if (!m_cache.contains(key)) {
-        SPCRE *spcre = new SPCRE(key);
-        // raise cost of each entry to 5 to reduce memory footprint
-        m_cache.insert(key, spcre, 5);
-        return spcre;
-    }
+    // Compile outside of the lock so other threads are not held up,
+    // if two threads race on the same pattern the last insert wins.
+    std::shared_ptr<SPCRE> spcre = std::make_shared<SPCRE>(key);
+    int cost = CostOf(spcre.get());
+    QMutexLocker locker(&m_mutex);
+    // a pattern bigger than the whole cache is simply not cached
+    m_cache.insert(key, new std::shared_ptr<SPCRE>(spcre), cost);
+    return spcre;
+}
+
+void PCRECache::setMaxSize(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(bytes);
+}
+
+int PCRECache::maxSize()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
 
-    return m_cache.object(key);
+int PCRECache::size()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.totalCost();
 }
@@ -25,7 +25,10 @@
 #ifndef PCRECACHE_H
 #define PCRECACHE_H
 
+#include <memory>
+
 #include <QtCore/QCache>
+#include <QtCore/QMutex>
 #include <QtCore/QString>
 
 #include "PCRE/SPCRE.h"
@@ -33,7 +36,12 @@
 /**
  * Singleton. A cache of SPCRE regular expression objects.
  *
- * The SPCRE's are cached to improve performance.
+ * The SPCRE's are cached to improve performance. The cache is limited by
+ * the memory used by the compiled patterns (including their JIT code)
+ * rather than by their number, so large groups of saved searches can
+ * stay compiled. It is safe to use from multiple threads, objects handed
+ * out stay valid for as long as the caller holds on to them even if
+ * they are evicted from the cache in the meantime.
  */
 class PCRECache
 {
@@ -49,7 +57,7 @@ public:
      * pattern by the SPCRE as a string.
      *
      * @param key The key associated with the SPCRE.
-     * @param object The SPCRE to store.
+     * @param object The SPCRE to store. The cache takes ownership.
      *
      * @return True if the object was successfully inserted.
      */
@@ -62,7 +70,19 @@ public:
      *
      * @param key The key associated with the SPCRE.
      */
-    SPCRE *getObject(const QString &key);
+    std::shared_ptr<SPCRE> getObject(const QString &key);
+
+    /**
+     * Set the maximum memory in bytes the cached patterns may use.
+     * Least recently used patterns are dropped to stay below it.
+     */
+    void setMaxSize(int bytes);
+    int maxSize();
+
+    /**
+     * The memory in bytes used by the cached patterns.
+     */
+    int size();
 
 private:
     /**
@@ -70,10 +90,9 @@ private:
      */
     PCRECache();
 
-    // The cache that we store the SPCRE's.
-    QCache<QString, SPCRE> m_cache;
-    // The single instance of the cache.
-    static PCRECache *m_instance;
+    // The cache that we store the SPCRE's, the cost of each is its size in bytes.
+    QCache<QString, std::shared_ptr<SPCRE>> m_cache;
+    QMutex m_mutex;
 };
 
 #endif // PCRECACHE_H
@@ -19,6 +19,8 @@
 **
 *************************************************************************/
 
+#include <QtCore/QThreadStorage>
+
 #include "PCRE/SPCRE.h"
 #include "PCRE/PCREReplaceTextBuilder.h"
 #include "sigil_constants.h"
@@ -26,11 +28,46 @@
 // The maximum number of catpures that we will allow.
 const int PCRE_MAX_CAPTURE_GROUPS = 30;
 
+// The initial and maximum size of the per thread JIT stacks.
+// The default 32K stack pcre uses when none is assigned is too
+// small for many of the backtracking heavy saved searches.
+const int PCRE_JIT_STACK_START_SIZE = 32 * 1024;
+const int PCRE_JIT_STACK_MAX_SIZE = 1024 * 1024;
+
+// Owns the JIT stack of one thread. JIT stacks
+// can not be shared by threads running at the same time.
+struct JitStackHolder {
+    pcre16_jit_stack *stack;
+
+    JitStackHolder()
+        : stack(pcre16_jit_stack_alloc(PCRE_JIT_STACK_START_SIZE, PCRE_JIT_STACK_MAX_SIZE)) {}
+
+    ~JitStackHolder() {
+        if (stack != NULL) {
+            pcre16_jit_stack_free(stack);
+        }
+    }
+};
+
+static QThreadStorage<JitStackHolder *> jit_stacks;
+
+// Called by pcre16_exec to get the JIT stack of the calling thread.
+// Returning NULL makes pcre fall back to its small default stack.
+static pcre16_jit_stack *GetThreadJitStack(void *)
+{
+    if (!jit_stacks.hasLocalData()) {
+        jit_stacks.setLocalData(new JitStackHolder());
+    }
+
+    return jit_stacks.localData()->stack;
+}
+
 SPCRE::SPCRE(const QString &patten)
 {
     m_pattern = patten;
     m_re = NULL;
     m_study = NULL;
+    m_jit = false;
     m_captureSubpatternCount = 0;
     const char *error;
     int erroroffset;
@@ -39,8 +76,21 @@ SPCRE::SPCRE(const QString &patten)
     // Pattern is valid.
     if (m_re != NULL) {
         m_valid = true;
-        // Study the pattern and save the results of the study.
-        m_study = pcre16_study(m_re, 0, &error);
+        // Study the pattern and save the results of the study. Ask for
+        // JIT compilation as well, if pcre was built without JIT support or
+        // the pattern can not be JIT compiled the interpreter is used.
+        m_study = pcre16_study(m_re, PCRE_STUDY_JIT_COMPILE, &error);
+
+        if (m_study != NULL) {
+            int jit = 0;
+            pcre16_fullinfo(m_re, m_study, PCRE_INFO_JIT, &jit);
+            m_jit = (jit == 1);
+
+            if (m_jit) {
+                pcre16_assign_jit_stack(m_study, GetThreadJitStack, NULL);
+            }
+        }
+
         // Store the number of capture subpatterns.
         pcre16_fullinfo(m_re, m_study, PCRE_INFO_CAPTURECOUNT, &m_captureSubpatternCount);
     }
@@ -58,7 +108,8 @@ SPCRE::~SPCRE()
     }
 
     if (m_study != NULL) {
-        pcre16_free(m_study);
+        // also releases the JIT compiled code
+        pcre16_free_study(m_study);
         m_study = NULL;
     }
 }
@@ -83,6 +134,36 @@ pcre16_extra *SPCRE::getStudy()
     return m_study;
 }
 
+bool SPCRE::isJitCompiled()
+{
+    return m_jit;
+}
+
+size_t SPCRE::getMemorySize()
+{
+    size_t total = sizeof(SPCRE) + m_pattern.capacity() * sizeof(QChar);
+
+    if (m_re != NULL) {
+        size_t size = 0;
+        pcre16_fullinfo(m_re, NULL, PCRE_INFO_SIZE, &size);
+        total += size;
+    }
+
+    if (m_study != NULL) {
+        size_t size = 0;
+        pcre16_fullinfo(m_re, m_study, PCRE_INFO_STUDYSIZE, &size);
+        total += size;
+
+        if (m_jit) {
+            size = 0;
+            pcre16_fullinfo(m_re, m_study, PCRE_INFO_JITSIZE, &size);
+            total += size;
+        }
+    }
+
+    return total;
+}
+
 int SPCRE::getCaptureSubpatternCount()
 {
     return m_captureSubpatternCount;
@@ -150,7 +231,7 @@ QList<SPCRE::MatchInfo> SPCRE::getEveryMatchInfo(const QString &text)
             info.append(generateMatchInfo(ovector, ovector_count));
         }
 
-        rc = pcre16_exec(m_re, m_study, text.utf16(), text.length(), last_offset[1], 0, ovector, ovector_size);
+        rc = execute(text, last_offset[1], ovector, ovector_size);
     } while (rc >= 0 && ovector[0] != ovector[1] && ovector[1] != last_offset[1] && ovector[0] < ovector[1]);
 
     delete[] ovector;
@@ -183,7 +264,7 @@ SPCRE::MatchInfo SPCRE::getFirstMatchInfo(const QString &text)
     // MSVC doesn't support it.
     int *ovector = new int[ovector_size];
     memset(ovector, 0, sizeof(int)*ovector_size);
-    rc = pcre16_exec(m_re, m_study, text.utf16(), text.length(), 0, 0, ovector, ovector_size);
+    rc = execute(text, 0, ovector, ovector_size);
 
     if (rc >= 0 && ovector[0] != ovector[1]) {
         match_info = generateMatchInfo(ovector, ovector_count);
@@ -211,6 +292,21 @@ bool SPCRE::replaceText(const QString &text, const QList<std::pair<int, int>> &c
     return builder.BuildReplacementText(*this, text, capture_groups_offsets, replacement_pattern, out);
 }
 
+int SPCRE::execute(const QString &text, int start_offset, int ovector[], int ovector_size)
+{
+    int rc = pcre16_exec(m_re, m_study, text.utf16(), text.length(), start_offset, 0, ovector, ovector_size);
+
+    if (rc == PCRE_ERROR_JIT_STACKLIMIT) {
+        // Even the largest JIT stack was not enough for this text so
+        // retry with the interpreter which is only bound by the match limits.
+        pcre16_extra extra = *m_study;
+        extra.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+        rc = pcre16_exec(m_re, &extra, text.utf16(), text.length(), start_offset, 0, ovector, ovector_size);
+    }
+
+    return rc;
+}
+
 SPCRE::MatchInfo SPCRE::generateMatchInfo(int ovector[], int ovector_count)
 {
     MatchInfo match_info;
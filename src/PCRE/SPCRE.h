@@ -98,6 +98,19 @@ public:
      * @return The study result.
      */
     pcre16_extra *getStudy();
+    /**
+     * Is the pattern matched by JIT compiled code.
+     *
+     * @return True if the study produced JIT code for the pattern.
+     */
+    bool isJitCompiled();
+    /**
+     * The approximate memory used by the compiled pattern, its study
+     * data and JIT code.
+     *
+     * @return The size in bytes.
+     */
+    size_t getMemorySize();
     /**
      * The total number of capture subpatterns within the pattern.
      *
@@ -143,6 +156,12 @@ public:
     bool replaceText(const QString &text, const QList<std::pair<int, int>> &capture_groups_offsets, const QString &replacement_pattern, QString &out);
 
 private:
+    /**
+     * Runs the pattern over text. Uses the JIT code when available and
+     * falls back to the interpreter if the JIT stack is exhausted.
+     */
+    int execute(const QString &text, int start_offset, int ovector[], int ovector_size);
+
     MatchInfo generateMatchInfo(int ovector[], int ovector_count);
 
     // Store if the pattern is valid.
@@ -153,6 +172,8 @@ private:
     pcre16 *m_re;
     // The result of a study of the pcre.
     pcre16_extra *m_study;
+    // Whether the study includes JIT compiled code.
+    bool m_jit;
     // The number of capture subpatterns with the expression.
     int m_captureSubpatternCount;
 };
@@ -61,6 +61,18 @@ CSSResource::~CSSResource()
     }
 }
 
+std::shared_ptr<CSSInfo> CSSResource::GetCSSInfo() const
+{
+    return m_CSSInfo.Get(this, std::bind(&CSSResource::ParseCSSInfo, this));
+}
+
+
+std::shared_ptr<CSSInfo> CSSResource::ParseCSSInfo() const
+{
+    return std::make_shared<CSSInfo>(GetText(), true);
+}
+
+
 bool CSSResource::DeleteCSStyles(QList<CSSInfo::CSSSelector *> css_selectors)
 {
     CSSInfo css_info(GetText());
@@ -26,7 +26,10 @@
 #ifndef CSSRESOURCE_H
 #define CSSRESOURCE_H
 
+#include <memory>
+
 #include "Misc/CSSInfo.h"
+#include "ResourceObjects/RevisionCache.h"
 #include "ResourceObjects/TextResource.h"
 
 /**
@@ -51,6 +54,18 @@ public:
 
     bool DeleteCSStyles(QList<CSSInfo::CSSSelector *> css_selectors);
 
+    /**
+     * Returns the parsed selectors of the current text.
+     * The stylesheet is parsed on first request and the result shared
+     * by all callers until the text revision changes, so reports can
+     * query it from many threads without parsing it again.
+     *
+     * @warning The returned CSSInfo is shared and must be treated as read-only.
+     *
+     * @return The shared parsed stylesheet.
+     */
+    std::shared_ptr<CSSInfo> GetCSSInfo() const;
+
     // inherited
     virtual ResourceType Type() const;
 
@@ -58,7 +73,17 @@ public:
 
 private:
 
+    /**
+     * Builds a new parse of the current text.
+     */
+    std::shared_ptr<CSSInfo> ParseCSSInfo() const;
+
     QList<QString> m_TemporaryValidationFiles;
+
+    /**
+     * The shared parse of the text.
+     */
+    mutable RevisionCache<std::shared_ptr<CSSInfo>> m_CSSInfo;
 };
 
 #endif // CSSRESOURCE_H
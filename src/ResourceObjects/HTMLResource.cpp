@@ -71,10 +71,18 @@ bool HTMLResource::LoadFromDisk()
 
 void HTMLResource::SetText(const QString &text)
 {
-    emit TextChanging();
-
+    BeforeTextSet();
     XMLResource::SetText(text);
+    AfterTextSet();
+}
+
+void HTMLResource::BeforeTextSet()
+{
+    emit TextChanging();
+}
 
+void HTMLResource::AfterTextSet()
+{
     // Track resources whose change will necessitate an update of the BV and PV.
     // At present this only applies to css files and images.
     TrackNewResources(GetPathsToLinkedResources());
@@ -102,7 +110,7 @@ void HTMLResource::SaveToDisk(bool book_wide_save)
 
 QStringList HTMLResource::GetLinkedStylesheets()
 {
-    QStringList hreflist = XhtmlDoc::GetLinkedStylesheets(GetText());
+    QStringList hreflist = XhtmlDoc::GetLinkedStylesheets(*GetParsedDocument());
     QString startdir = GetFolder();
     QStringList stylesheet_bookpaths;
     foreach(QString ahref, hreflist) {
@@ -115,13 +123,27 @@ QStringList HTMLResource::GetLinkedStylesheets()
 }
 
 
+std::shared_ptr<GumboInterface> HTMLResource::GetParsedDocument() const
+{
+    return m_ParsedDocument.Get(this, std::bind(&HTMLResource::ParseDocument, this));
+}
+
+
+std::shared_ptr<GumboInterface> HTMLResource::ParseDocument() const
+{
+    std::shared_ptr<GumboInterface> gi = std::make_shared<GumboInterface>(GetText(), GetEpubVersion());
+    // parse now so that the shared tree is never lazily built by concurrent readers
+    gi->parse();
+    return gi;
+}
+
+
 QStringList HTMLResource::GetManifestProperties() const
 {
     QStringList properties;
     QReadLocker locker(&GetLock());
-    GumboInterface gi = GumboInterface(GetText(), GetEpubVersion());
-    gi.parse();
-    QStringList props = gi.get_all_properties();
+    std::shared_ptr<GumboInterface> gi = GetParsedDocument();
+    QStringList props = gi->get_all_properties();
     props.removeDuplicates();
     if (props.contains("math")) properties.append("mathml");
     if (props.contains("svg")) properties.append("svg");
@@ -149,11 +171,10 @@ QStringList HTMLResource::GetPathsToLinkedResources()
     // Can NOT grab Read Lock here as this is also invoked in SetText which has write lock!
     // leading to instant lockup when renaming any resource
     // QReadLocker locker(&GetLock());
-    GumboInterface gi = GumboInterface(GetText(),GetEpubVersion());
-    gi.parse();
+    std::shared_ptr<GumboInterface> gi = GetParsedDocument();
     QList<GumboTag> tags;
     tags << GUMBO_TAG_IMG << GUMBO_TAG_LINK << GUMBO_TAG_AUDIO << GUMBO_TAG_VIDEO;
-    const QList<GumboNode*> linked_rsc_nodes = gi.get_all_nodes_with_tags(tags);
+    const QList<GumboNode*> linked_rsc_nodes = gi->get_all_nodes_with_tags(tags);
     for (int i = 0; i < linked_rsc_nodes.count(); ++i) {
         GumboNode* node = linked_rsc_nodes.at(i);
 
@@ -24,12 +24,16 @@
 #ifndef HTMLRESOURCE_H
 #define HTMLRESOURCE_H
 
+#include <memory>
+
 #include <QtCore/QHash>
 
 #include "Misc/CSSInfo.h"
+#include "ResourceObjects/RevisionCache.h"
 #include "ResourceObjects/XMLResource.h"
 
 class QString;
+class GumboInterface;
 
 
 /**
@@ -97,8 +101,27 @@ public:
 
     QStringList GetManifestProperties() const;
 
+    /**
+     * Returns the parsed gumbo tree of the current text.
+     * The tree is built on first request and then shared by all
+     * callers until the text revision changes, so each file
+     * is parsed only once per edit. The tree (and the utf-8 buffer
+     * backing it) stays alive for as long as a caller holds on to it.
+     *
+     * @warning The returned tree is shared and must be treated as
+     *          read-only. Anyone needing to modify nodes or serialize
+     *          with updates must build their own GumboInterface.
+     *
+     * @return The shared parsed document.
+     */
+    std::shared_ptr<GumboInterface> GetParsedDocument() const;
+
     bool DeleteCSStyles(QList<CSSInfo::CSSSelector *> css_selectors);
 
+protected:
+    virtual void BeforeTextSet();
+    virtual void AfterTextSet();
+
 signals:
     void LinkedResourceUpdated();
     void TextChanging();
@@ -112,6 +135,11 @@ private:
      */
     void TrackNewResources(const QStringList &filepaths);
 
+    /**
+     * Builds a new parse of the current text.
+     */
+    std::shared_ptr<GumboInterface> ParseDocument() const;
+
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
@@ -122,6 +150,11 @@ private:
      */
     const QHash<QString, Resource *> &m_Resources;
     QString m_TOCCache;
+
+    /**
+     * The shared parse of the text.
+     */
+    mutable RevisionCache<std::shared_ptr<GumboInterface>> m_ParsedDocument;
 };
 
 #endif // HTMLRESOURCE_H
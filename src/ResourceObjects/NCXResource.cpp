@@ -25,7 +25,6 @@
 #include <QtCore/QFileInfo>
 #include <QtCore/QObject>
 
-#include "BookManipulation/CleanSource.h"
 #include "Exporters/NCXWriter.h"
 #include "ResourceObjects/NCXResource.h"
 #include "Misc/SettingsStore.h"
@@ -129,7 +128,8 @@ bool NCXResource::GenerateNCXFromBookContents(const Book *book)
     NCXWriter ncx(book, buffer);
     ncx.WriteXMLFromHeadings();
     buffer.close();
-    QString new_text = CleanSource::ProcessXML(QString::fromUtf8(raw_ncx.constData(), raw_ncx.size()),"application/x-dtbncx+xml");
+    // the writer output is already well-formed so it needs no further cleaning
+    QString new_text = QString::fromUtf8(raw_ncx.constData(), raw_ncx.size());
     QString existing_text = GetText();
 
     // Only update the resource if have changed. Note that this is_changed trick will not
@@ -149,15 +149,16 @@ void NCXResource::GenerateNCXFromTOCContents(const Book *book, TOCModel *toc_mod
     GenerateNCXFromTOCEntries(book, toc_model->GetRootTOCEntry());
 }
 
-void NCXResource::GenerateNCXFromTOCEntries(const Book *book, TOCModel::TOCEntry toc_root_entry)
+void NCXResource::GenerateNCXFromTOCEntries(const Book *book, TOCModel::TOCEntry toc_root_entry,
+                                            const QList<TOCModel::TOCEntry> &page_list)
 {
     QByteArray raw_ncx;
     QBuffer buffer(&raw_ncx);
     buffer.open(QIODevice::WriteOnly);
-    NCXWriter ncx(book, buffer, toc_root_entry);
+    NCXWriter ncx(book, buffer, toc_root_entry, page_list);
     ncx.WriteXML();
     buffer.close();
-    SetText(CleanSource::ProcessXML(QString::fromUtf8(raw_ncx.constData(), raw_ncx.size()), "application/x-dtbncx+xml"));
+    SetText(QString::fromUtf8(raw_ncx.constData(), raw_ncx.size()));
 }
 
 
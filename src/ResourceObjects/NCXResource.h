@@ -59,7 +59,8 @@ public:
 
     bool GenerateNCXFromBookContents(const Book *book);
     void GenerateNCXFromTOCContents(const Book *book, TOCModel *toc_model);
-    void GenerateNCXFromTOCEntries(const Book *book, TOCModel::TOCEntry toc_root_entry);
+    void GenerateNCXFromTOCEntries(const Book *book, TOCModel::TOCEntry toc_root_entry,
+                                   const QList<TOCModel::TOCEntry> &page_list = QList<TOCModel::TOCEntry>());
     void FillWithDefaultText(const QString &version, const QString &default_text_folder);
     void FillWithDefaultTextToBookPath(const QString &version, const QString &start_bookpath);
 };
@@ -19,8 +19,13 @@
 **
 *************************************************************************/
 
+#include <memory>
+
 #include <QString>
 #include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegularExpression>
 #include <QRegularExpressionMatch>
 #include <QDir>
@@ -34,10 +39,22 @@
 #include "BookManipulation/FolderKeeper.h"
 #include "ResourceObjects/Resource.h"
 #include "ResourceObjects/NavProcessor.h"
+#include "ResourceObjects/RevisionCache.h"
+
+static const QString NAV_SECTION_PATTERN = "\\s*<!--\\s*SIGIL_REPLACE_NAV_HERE\\s*-->\\s*";
+
+// Nav models keyed by resource identifier, shared by all NavProcessors
+static QHash<QString, std::shared_ptr<RevisionCache<NavModel>>> s_NavModels;
+static QMutex s_NavModelsMutex;
 
-static const QString NAV_PAGELIST_PATTERN = "\\s*<!--\\s*SIGIL_REPLACE_PAGELIST_HERE\\s*-->\\s*";
-static const QString NAV_LANDMARKS_PATTERN = "\\s*<!--\\s*SIGIL_REPLACE_LANDMARKS_HERE\\s*-->\\s*";
-static const QString NAV_TOC_PATTERN = "\\s*<!--\\s*SIGIL_REPLACE_TOC_HERE\\s*-->\\s*";
+// Takes the offsets of a <nav> element in the source text from its parsed node
+static void LocateNavSection(GumboInterface & gi, GumboNode * node, NavSection & section)
+{
+    // a nav whose end tag was added by the parser has no text to replace
+    if ((node->v.element.original_tag.length == 0) || (node->v.element.original_end_tag.length == 0)) return;
+    section.start = gi.get_source_index(node->v.element.start_pos.offset);
+    section.end = gi.get_source_index(node->v.element.end_pos.offset + node->v.element.original_end_tag.length);
+}
 
 NavProcessor::NavProcessor(HTMLResource * nav_resource)
   : m_NavResource(nav_resource)
@@ -73,18 +90,9 @@ NavProcessor::NavProcessor(HTMLResource * nav_resource)
           return;
     }
     // determine the language used by the nav
-    GumboInterface gi = GumboInterface(source, "3.0");
-    gi.parse();
-    const QList<GumboNode*> html_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_HTML);
-    if (!html_nodes.isEmpty()) {
-        GumboNode* node = html_nodes.at(0);
-        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "lang");
-        if (attr) {
-            lang = QString::fromUtf8(attr->value);
-	} else {
-            attr = gumbo_get_attribute(&node->v.element.attributes, "xml:lang");
-            if (attr) lang = QString::fromUtf8(attr->value);
-	}
+    QString nav_lang = GetNavModel().language;
+    if (!nav_lang.isEmpty()) {
+        lang = nav_lang;
     }
     m_language = lang;
 }
@@ -95,35 +103,75 @@ NavProcessor::~NavProcessor()
 }
 
 
-QList<NavLandmarkEntry> NavProcessor::GetLandmarks()
+NavModel NavProcessor::GetNavModel()
 {
-    QList<NavLandmarkEntry> landlist;
-    if (!m_NavResource) return landlist; 
-
-    QReadLocker locker(&m_NavResource->GetLock());
-    QString source = m_NavResource->GetText();
+    QString key = m_NavResource->GetIdentifier();
+    std::shared_ptr<RevisionCache<NavModel>> cache;
+    {
+        QMutexLocker locker(&s_NavModelsMutex);
+        cache = s_NavModels.value(key);
+        if (!cache) {
+            // one entry per nav of every book opened in this session, so keep it small
+            if (s_NavModels.size() > 16) {
+                s_NavModels.clear();
+            }
+            cache = std::make_shared<RevisionCache<NavModel>>();
+            s_NavModels.insert(key, cache);
+        }
+    }
+    return cache->Get(m_NavResource, std::bind(&NavProcessor::BuildNavModel, this));
+}
 
-    // user may leave nav in unparseable state so use
-    // regular expressions to try and extract just the landmarks code only from main nav
 
-    QRegularExpression landmarks_start("(<\\s*nav\\s[^>]*epub:type[^>]*[\"']landmarks[\"'][^>]*>)",QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatch mo = landmarks_start.match(source, 0);
-    if (mo.hasMatch()) {
-        int end = source.indexOf("</nav>", mo.capturedStart());
-        if (end > 0) {
-            source = source.mid(mo.capturedStart(), end - mo.capturedStart()+ 6);
+// One walk over the shared parse of the nav fills in all three navs
+NavModel NavProcessor::BuildNavModel()
+{
+    NavModel model;
+    NavSection empty_section;
+    empty_section.found = false;
+    empty_section.hidden = false;
+    empty_section.start = -1;
+    empty_section.end = -1;
+    model.toc_section = empty_section;
+    // sigil writes landmarks and page-list hidden unless the user says otherwise
+    empty_section.hidden = true;
+    model.landmarks_section = empty_section;
+    model.pagelist_section = empty_section;
+
+    std::shared_ptr<GumboInterface> gi = m_NavResource->GetParsedDocument();
+    const QList<GumboNode*> html_nodes = gi->get_all_nodes_with_tag(GUMBO_TAG_HTML);
+    if (!html_nodes.isEmpty()) {
+        GumboNode* node = html_nodes.at(0);
+        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "lang");
+        if (!attr) {
+            attr = gumbo_get_attribute(&node->v.element.attributes, "xml:lang");
         }
+        if (attr) model.language = QString::fromUtf8(attr->value);
     }
 
-    GumboInterface gi = GumboInterface(source, "3.0");
-    gi.parse();
-    const QList<GumboNode*> nav_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_NAV);
+    const QList<GumboTag> anchor_tags = QList<GumboTag>() << GUMBO_TAG_A;
+    const QList<GumboNode*> nav_nodes = gi->get_all_nodes_with_tag(GUMBO_TAG_NAV);
     for (int i = 0; i < nav_nodes.length(); ++i) {
         GumboNode* node = nav_nodes.at(i);
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "epub:type");
-        if (attr && (QString::fromUtf8(attr->value) == "landmarks")) {
-            const QList<GumboTag> tags = QList<GumboTag>() << GUMBO_TAG_A;;
-            const QList<GumboNode*> anchor_nodes = gi.get_nodes_with_tags(node, tags);
+        if (!attr) continue;
+        QString etype = QString::fromUtf8(attr->value);
+        bool hidden = gumbo_get_attribute(&node->v.element.attributes, "hidden") != NULL;
+
+        if ((etype == "toc") && !model.toc_section.found) {
+            model.toc_section.found = true;
+            model.toc_section.hidden = hidden;
+            LocateNavSection(*gi, node, model.toc_section);
+            QList<GumboTag> tags = QList<GumboTag>() << GUMBO_TAG_OL;
+            const QList<GumboNode*> ol_nodes = gi->get_nodes_with_tags(node, tags);
+            if (!ol_nodes.isEmpty()) {
+                model.toc = GetNodeTOC(*gi, ol_nodes.at(0), 1);
+            }
+        } else if ((etype == "landmarks") && !model.landmarks_section.found) {
+            model.landmarks_section.found = true;
+            model.landmarks_section.hidden = hidden;
+            LocateNavSection(*gi, node, model.landmarks_section);
+            const QList<GumboNode*> anchor_nodes = gi->get_nodes_with_tags(node, anchor_tags);
             for (int j = 0; j < anchor_nodes.length(); ++j) {
                 NavLandmarkEntry le;
                 GumboNode* ancnode = anchor_nodes.at(j);
@@ -131,98 +179,52 @@ QList<NavLandmarkEntry> NavProcessor::GetLandmarks()
                 GumboAttribute* hrefattr = gumbo_get_attribute(&ancnode->v.element.attributes, "href");
                 if (typeattr) le.etype = QString::fromUtf8(typeattr->value);
                 if (hrefattr) le.href = QString::fromUtf8(hrefattr->value);
-                le.title = Utility::DecodeXML(gi.get_local_text_of_node(ancnode));
-                landlist.append(le);
+                le.title = Utility::DecodeXML(gi->get_local_text_of_node(ancnode));
+                model.landmarks.append(le);
             }
-            break;
-        }
-    }
-    return landlist;
-}
-
-
-QList<NavPageListEntry> NavProcessor::GetPageList()
-{
-    QList<NavPageListEntry> pagelist;
-    if (!m_NavResource) return pagelist; 
-        
-    QReadLocker locker(&m_NavResource->GetLock());
-    QString source = m_NavResource->GetText();
-
-    // user may leave nav in unparseable state so use
-    // regular expressions to try and extract just the page-list code only from main nav
-
-    QRegularExpression pagelist_start("(<\\s*nav\\s[^>]*epub:type[^>]*[\"']page-list[\"'][^>]*>)",QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatch mo = pagelist_start.match(source, 0);
-    if (mo.hasMatch()) {
-        int end = source.indexOf("</nav>", mo.capturedStart());
-        if (end > 0) {
-            source = source.mid(mo.capturedStart(), end - mo.capturedStart()+ 6);
-        }
-    }
-
-    GumboInterface gi = GumboInterface(source, "3.0");
-    gi.parse();
-    const QList<GumboNode*> nav_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_NAV);
-    for (int i = 0; i < nav_nodes.length(); ++i) {
-        GumboNode* node = nav_nodes.at(i);
-        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "epub:type");
-        if (attr && (QString::fromUtf8(attr->value) == "page-list")) {
-            QList<GumboTag> tags = QList<GumboTag>() << GUMBO_TAG_A;
-            const QList<GumboNode*> anchor_nodes = gi.get_nodes_with_tags(node, tags);
+        } else if ((etype == "page-list") && !model.pagelist_section.found) {
+            model.pagelist_section.found = true;
+            model.pagelist_section.hidden = hidden;
+            LocateNavSection(*gi, node, model.pagelist_section);
+            const QList<GumboNode*> anchor_nodes = gi->get_nodes_with_tags(node, anchor_tags);
             for (int j = 0; j < anchor_nodes.length(); ++j) {
                 NavPageListEntry pe;
                 GumboNode* ancnode = anchor_nodes.at(j);
                 GumboAttribute* hrefattr = gumbo_get_attribute(&ancnode->v.element.attributes, "href");
                 if (hrefattr) pe.href = QString::fromUtf8(hrefattr->value);
-                pe.pagename = Utility::DecodeXML(gi.get_local_text_of_node(ancnode));
-                pagelist.append(pe);
+                pe.pagename = Utility::DecodeXML(gi->get_local_text_of_node(ancnode));
+                model.pagelist.append(pe);
             }
-            break;
         }
     }
-    return pagelist;
+    return model;
 }
 
 
-QList<NavTOCEntry> NavProcessor::GetTOC()
+QList<NavLandmarkEntry> NavProcessor::GetLandmarks()
 {
-    QList<NavTOCEntry> toclist;
-    if (!m_NavResource) return toclist; 
-        
+    if (!m_NavResource) return QList<NavLandmarkEntry>();
+
     QReadLocker locker(&m_NavResource->GetLock());
-    QString source = m_NavResource->GetText();
+    return GetNavModel().landmarks;
+}
 
-    // user may leave nav in unparseable state so use
-    // regular expressions to try and extract just the toc code only from main nav
 
-    QRegularExpression toc_start("(<\\s*nav\\s[^>]*epub:type[^>]*[\"']toc[\"'][^>]*>)",QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatch mo = toc_start.match(source, 0);
-    if (mo.hasMatch()) {
-        int end = source.indexOf("</nav>", mo.capturedStart());
-        if (end > 0) {
-            source = source.mid(mo.capturedStart(), end - mo.capturedStart()+ 6);
-        }
-    }
+QList<NavPageListEntry> NavProcessor::GetPageList()
+{
+    if (!m_NavResource) return QList<NavPageListEntry>();
 
-    GumboInterface gi = GumboInterface(source, "3.0");
-    gi.parse();
-    const QList<GumboNode*> nav_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_NAV);
-    for (int i = 0; i < nav_nodes.length(); ++i) {
-        GumboNode* node = nav_nodes.at(i);
-        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "epub:type");
-        if (attr && (QString::fromUtf8(attr->value) == "toc")) {
-            QList<GumboTag> tags = QList<GumboTag>() << GUMBO_TAG_OL;
-            const QList<GumboNode*> ol_nodes = gi.get_nodes_with_tags(node, tags);
-            for (int j = 0; j < ol_nodes.length(); ++j) {
-                GumboNode * olnode = ol_nodes.at(j);
-                toclist.append(GetNodeTOC(gi, olnode, 1));
-                break;
-            }
-            break;              
-        }
-    }
-    return toclist;
+    QReadLocker locker(&m_NavResource->GetLock());
+    return GetNavModel().pagelist;
+}
+
+
+QList<NavTOCEntry> NavProcessor::GetTOC()
+{
+    if (!m_NavResource) return QList<NavTOCEntry>();
+
+    QReadLocker locker(&m_NavResource->GetLock());
+    return GetNavModel().toc;
 }
 
 
@@ -264,14 +266,14 @@ QList<NavTOCEntry> NavProcessor::GetNodeTOC(GumboInterface & gi, const GumboNode
 }
 
 
-QString NavProcessor::BuildTOC(const QList<NavTOCEntry> & toclist)
+QString NavProcessor::BuildTOC(const QList<NavTOCEntry> & toclist, bool hidden)
 {
     QStringList res;
     int curlvl = 1;
     bool initial = true;
     QString step = "  ";
     QString base = step.repeated(2);
-    res << "\n" + step + "<nav epub:type=\"toc\" id=\"toc\">\n";
+    res << "\n" + step + "<nav epub:type=\"toc\" id=\"toc\"" + (hidden ? " hidden=\"\"" : "") + ">\n";
     res << base + "<h1>" + Landmarks::instance()->GetTitle("toc", m_language) + "</h1>\n";
     res << base + "<ol>\n";
     foreach(NavTOCEntry te, toclist) {
@@ -319,12 +321,12 @@ QString NavProcessor::BuildTOC(const QList<NavTOCEntry> & toclist)
 }
 
 
-QString NavProcessor::BuildLandmarks(const QList<NavLandmarkEntry> & landlist)
+QString NavProcessor::BuildLandmarks(const QList<NavLandmarkEntry> & landlist, bool hidden)
 {
     QStringList res;
     QString step = "  ";
     QString base = step.repeated(2);
-    res << "\n" + step + "<nav epub:type=\"landmarks\" id=\"landmarks\" hidden=\"\">\n";
+    res << "\n" + step + "<nav epub:type=\"landmarks\" id=\"landmarks\"" + (hidden ? " hidden=\"\"" : "") + ">\n";
     res << base + "<h1>" + Landmarks::instance()->GetTitle("landmarks", m_language) + "</h1>\n";
     res << base + "<ol>\n";
     foreach(NavLandmarkEntry le, landlist) {
@@ -341,12 +343,12 @@ QString NavProcessor::BuildLandmarks(const QList<NavLandmarkEntry> & landlist)
 }
 
 
-QString NavProcessor::BuildPageList(const QList<NavPageListEntry> & pagelist)
+QString NavProcessor::BuildPageList(const QList<NavPageListEntry> & pagelist, bool hidden)
 {
     QStringList res;
     QString step = "  ";
     QString base = step.repeated(3);
-    res << "\n" + step + "<nav epub:type=\"page-list\" id=\"page-list\" hidden=\"\">\n";
+    res << "\n" + step + "<nav epub:type=\"page-list\" id=\"page-list\"" + (hidden ? " hidden=\"\"" : "") + ">\n";
     res << base + "<h1>" + Landmarks::instance()->GetTitle("page-list", m_language) + "</h1>\n";
     res << "\n" + base + "<ol>\n";
     foreach(NavPageListEntry pe, pagelist) {
@@ -363,43 +365,10 @@ QString NavProcessor::BuildPageList(const QList<NavPageListEntry> & pagelist)
 void NavProcessor::SetPageList(const QList<NavPageListEntry> & pagelist)
 {
     if (!m_NavResource) return; 
-        
-    bool found_pagelist = false;
+
     // QWriteLocker locker(&m_NavResource->GetLock());
-    GumboInterface gi = GumboInterface(m_NavResource->GetText(), "3.0");
-    gi.parse();
-    QList<GumboNode*> nav_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_NAV);
-    for (int i = 0; i < nav_nodes.length(); ++i) {
-        GumboNode* node = nav_nodes.at(i);
-        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "epub:type");
-        if (attr && (QString::fromUtf8(attr->value) == "page-list")) {
-            found_pagelist = true;
-            GumboNode* parent = node->parent;
-            unsigned int index_within_parent = node->index_within_parent;
-            gumbo_remove_from_parent(node);
-            gumbo_destroy_node(node);
-            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_PAGELIST_HERE");
-            gumbo_insert_node(placeholder, parent, index_within_parent);
-            break;
-        }
-    }
-    if (!found_pagelist) {
-        QList<GumboNode*> body_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_BODY);
-        if (body_nodes.length() == 1) {
-            GumboNode* body = body_nodes.at(0);
-            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_PAGELIST_HERE");
-            gumbo_append_node(body, placeholder);
-        }
-    }
-    QString nav_data = gi.getxhtml();
-    QString page_xml = BuildPageList(pagelist);
-    QRegularExpression pagelist_placeholder(NAV_PAGELIST_PATTERN, 
-                       QRegularExpression::MultilineOption | QRegularExpression::DotMatchesEverythingOption);
-    QRegularExpressionMatch mo = pagelist_placeholder.match(nav_data);
-    if (mo.hasMatch()) {
-        nav_data.replace(mo.capturedStart(), mo.capturedLength(), page_xml);
-    }
-    m_NavResource->SetText(nav_data);
+    NavModel model = GetNavModel();
+    ReplaceNavSection("page-list", model.pagelist_section, BuildPageList(pagelist, model.pagelist_section.hidden));
 }
 
 
@@ -407,84 +376,74 @@ void NavProcessor::SetLandmarks(const QList<NavLandmarkEntry> & landlist)
 {
     if (!m_NavResource) return; 
 
-    bool found_landmarks = false;
     // QWriteLocker locker(&m_NavResource->GetLock());
-    GumboInterface gi = GumboInterface(m_NavResource->GetText(), "3.0");
-    gi.parse();
-    const QList<GumboNode*> nav_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_NAV);
-    for (int i = 0; i < nav_nodes.length(); ++i) {
-        GumboNode* node = nav_nodes.at(i);
-        GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "epub:type");
-        if (attr && (QString::fromUtf8(attr->value) == "landmarks")) {
-            found_landmarks = true;
-            GumboNode * parent = node->parent;
-            unsigned int index_within_parent = node->index_within_parent;
-            gumbo_remove_from_parent(node);
-            gumbo_destroy_node(node);
-            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_LANDMARKS_HERE");
-            gumbo_insert_node(placeholder, parent, index_within_parent);
-            break;
-        }
-    }
-    if (!found_landmarks) {
-        QList<GumboNode*> body_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_BODY);
-        if (body_nodes.length() == 1) {
-            GumboNode* body = body_nodes.at(0);
-            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_LANDMARKS_HERE");
-            gumbo_append_node(body, placeholder);
-        }
-    }
-    QString nav_data = gi.getxhtml();
-    QString land_xml = BuildLandmarks(landlist);
-    QRegularExpression landmarks_placeholder(NAV_LANDMARKS_PATTERN,
-                       QRegularExpression::MultilineOption | QRegularExpression::DotMatchesEverythingOption);
-    QRegularExpressionMatch mo = landmarks_placeholder.match(nav_data);
-    if (mo.hasMatch()) {
-        nav_data.replace(mo.capturedStart(), mo.capturedLength(), land_xml);
-    }
-    m_NavResource->SetText(nav_data);
+    NavModel model = GetNavModel();
+    ReplaceNavSection("landmarks", model.landmarks_section, BuildLandmarks(landlist, model.landmarks_section.hidden));
 }
 
 
-
 void NavProcessor::SetTOC(const QList<NavTOCEntry> & toclist)
 {
     if (!m_NavResource) return; 
 
-    bool found_toc = false;
     // QWriteLocker locker(&m_NavResource->GetLock());
-    GumboInterface gi = GumboInterface(m_NavResource->GetText(), "3.0");
+    NavModel model = GetNavModel();
+    ReplaceNavSection("toc", model.toc_section, BuildTOC(toclist, model.toc_section.hidden));
+}
+
+
+// Only the text of the one <nav> is replaced, the rest of the
+// document is left exactly as the user wrote it
+void NavProcessor::ReplaceNavSection(const QString & etype, const NavSection & section, const QString & new_xml)
+{
+    QString nav_data = m_NavResource->GetText();
+    if (section.found && (section.start > -1)) {
+        nav_data.replace(section.start, section.end - section.start, new_xml.trimmed());
+        m_NavResource->SetText(nav_data);
+        return;
+    }
+    if (!section.found) {
+        int body_end = nav_data.lastIndexOf("</body>");
+        if (body_end > -1) {
+            nav_data.insert(body_end, "  " + new_xml.trimmed() + "\n");
+            m_NavResource->SetText(nav_data);
+            return;
+        }
+    }
+
+    // the nav can not be found in the text itself so rewrite the whole document
+    bool found_nav = false;
+    GumboInterface gi = GumboInterface(nav_data, "3.0");
     gi.parse();
     const QList<GumboNode*> nav_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_NAV);
     for (int i = 0; i < nav_nodes.length(); ++i) {
         GumboNode* node = nav_nodes.at(i);
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, "epub:type");
-        if (attr && (QString::fromUtf8(attr->value) == "toc")) {
-            found_toc = true;
+        if (attr && (QString::fromUtf8(attr->value) == etype)) {
+            found_nav = true;
             GumboNode * parent = node->parent;
             unsigned int index_within_parent = node->index_within_parent;
             gumbo_remove_from_parent(node);
             gumbo_destroy_node(node);
-            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_TOC_HERE");
+            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_NAV_HERE");
             gumbo_insert_node(placeholder, parent, index_within_parent);
             break;
         }
     }
-    if (!found_toc) {
+    if (!found_nav) {
         QList<GumboNode*> body_nodes = gi.get_all_nodes_with_tag(GUMBO_TAG_BODY);
         if (body_nodes.length() == 1) {
             GumboNode* body = body_nodes.at(0);
-            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_TOC_HERE");
+            GumboNode * placeholder = gumbo_create_text_node(GUMBO_NODE_COMMENT,"SIGIL_REPLACE_NAV_HERE");
             gumbo_append_node(body, placeholder);
         }
     }
-    QString nav_data = gi.getxhtml();
-    QString toc_xml = BuildTOC(toclist);
-    QRegularExpression toc_placeholder(NAV_TOC_PATTERN, 
+    nav_data = gi.getxhtml();
+    QRegularExpression nav_placeholder(NAV_SECTION_PATTERN,
                        QRegularExpression::MultilineOption | QRegularExpression::DotMatchesEverythingOption);
-    QRegularExpressionMatch mo = toc_placeholder.match(nav_data);
+    QRegularExpressionMatch mo = nav_placeholder.match(nav_data);
     if (mo.hasMatch()) {
-        nav_data.replace(mo.capturedStart(), mo.capturedLength(), toc_xml);
+        nav_data.replace(mo.capturedStart(), mo.capturedLength(), new_xml);
     }
     m_NavResource->SetText(nav_data);
 }
@@ -608,7 +567,7 @@ QHash <QString, QString> NavProcessor::GetLandmarkCodeForPaths()
 // That tree of headings to our flat NavTOCEntry list
 bool NavProcessor::GenerateTOCFromBookContents(const Book* book)
 {
-    QString prev_xml = BuildTOC(GetTOC());
+    QString prev_xml = BuildTOC(GetTOC(), false);
     QWriteLocker locker(&m_NavResource->GetLock());
     bool is_changed = false;
 
@@ -623,7 +582,7 @@ bool NavProcessor::GenerateTOCFromBookContents(const Book* book)
     foreach(const Headings::Heading & heading, headings) {
         toclist.append(HeadingWalker(heading, 1));
     }
-    QString new_xml = BuildTOC(toclist);
+    QString new_xml = BuildTOC(toclist, false);
     is_changed = new_xml != prev_xml;
     SetTOC(toclist);
     return is_changed;
@@ -675,6 +634,18 @@ TOCModel::TOCEntry NavProcessor::GetRootTOCEntry()
     return root;
 }
 
+QList<TOCModel::TOCEntry> NavProcessor::GetPageListTOCEntries()
+{
+    QList<TOCModel::TOCEntry> pages;
+    foreach(NavPageListEntry pe, GetPageList()) {
+        TOCModel::TOCEntry page;
+        page.text = pe.pagename;
+        page.target = ConvertHREFToBookPath(pe.href);
+        pages.append(page);
+    }
+    return pages;
+}
+
 void NavProcessor::AddTOCEntry(const NavTOCEntry & nav_entry, TOCModel::TOCEntry & parent) 
 {
     TOCModel::TOCEntry toc_entry;
@@ -48,6 +48,25 @@ struct NavLandmarkEntry {
     QString href; // hrefs must be stored in URLEncoded form since fragments may be present
 };
 
+// Where one of the <nav> elements lives in the nav source
+struct NavSection {
+    bool found;   // present in the parsed document
+    bool hidden;  // carries the hidden attribute
+    int start;    // offset of the <nav> start tag in the source text or -1 if not located
+    int end;      // offset just past its </nav>
+};
+
+// Everything read from one revision of the nav document
+struct NavModel {
+    QString language;
+    QList<NavTOCEntry> toc;
+    QList<NavLandmarkEntry> landmarks;
+    QList<NavPageListEntry> pagelist;
+    NavSection toc_section;
+    NavSection landmarks_section;
+    NavSection pagelist_section;
+};
+
 class NavProcessor
 {
 public:
@@ -67,6 +86,9 @@ public:
     // Get current Nav as TOCEntry Tree
     TOCModel::TOCEntry GetRootTOCEntry();
 
+    // Get current Nav page-list as TOCEntries with book path targets
+    QList<TOCModel::TOCEntry> GetPageListTOCEntries();
+
     // For Working with Landmarks
     void AddLandmarkCode(const Resource * resource, QString new_code, bool toggle = true);
     void RemoveLandmarkForResource(const Resource * resource);
@@ -77,13 +99,21 @@ public:
 
 
 private:    
-    QString BuildTOC(const QList<NavTOCEntry> & toclist);
-    QString BuildLandmarks(const QList<NavLandmarkEntry> & landlist);
-    QString BuildPageList(const QList<NavPageListEntry> & pagelist);
+    // The model of the current nav text, built once per text revision
+    // and shared by every NavProcessor. Callers must hold the nav lock.
+    NavModel GetNavModel();
+    NavModel BuildNavModel();
+
+    QString BuildTOC(const QList<NavTOCEntry> & toclist, bool hidden);
+    QString BuildLandmarks(const QList<NavLandmarkEntry> & landlist, bool hidden);
+    QString BuildPageList(const QList<NavPageListEntry> & pagelist, bool hidden);
     
     void SetTOC(const QList<NavTOCEntry> & toclist);
     void SetLandmarks(const QList<NavLandmarkEntry> & landlist);
     void SetPageList(const QList<NavPageListEntry> & pagelist);
+
+    // Replaces just the text of one <nav> element with new_xml
+    void ReplaceNavSection(const QString & etype, const NavSection & section, const QString & new_xml);
 	
     int GetResourceLandmarkPos(const Resource * resource, const QList<NavLandmarkEntry> & landlist);
     QList<NavTOCEntry> GetNodeTOC(GumboInterface & gi, const GumboNode* node, int lvl);
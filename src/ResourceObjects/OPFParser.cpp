@@ -450,6 +450,18 @@ void OPFParser::parse(const QString& source)
 }
 
 
+void OPFParser::rebuild_index_maps()
+{
+    m_idpos.clear();
+    m_hrefpos.clear();
+    for (int i = 0; i < m_manifest.count(); i++) {
+        const ManifestEntry &me = m_manifest.at(i);
+        m_idpos[me.m_id] = i;
+        m_hrefpos[me.m_href] = i;
+    }
+}
+
+
 QString OPFParser::convert_to_xml() const
 {
     QStringList xmlres;
@@ -485,6 +497,6 @@ QString OPFParser::convert_to_xml() const
         xmlres << "  </bindings>\n";
     }
     xmlres << "</package>\n";
-    qDebug() << "new_opf" << xmlres;
+    // qDebug() << "new_opf" << xmlres;
     return xmlres.join("");
 }
@@ -165,6 +165,9 @@ struct OPFParser
     OPFParser(): m_idpos(QHash<QString,int>()), m_hrefpos(QHash<QString,int>()) {};
     void parse(const QString & source);
 
+    // rebuilds m_idpos and m_hrefpos after the manifest was changed directly
+    void rebuild_index_maps();
+
     QString convert_to_xml() const;
 };
 
@@ -127,7 +127,8 @@ OPFResource::OPFResource(const QString &mainfolder,
 			 QObject *parent)
   : XMLResource(mainfolder, fullfilepath, parent),
     m_NavResource(NULL),
-    m_WarnedAboutVersion(false)
+    m_WarnedAboutVersion(false),
+    m_OPFModelRevision(-1)
 {
     FillWithDefaultText(version);
     // Make sure the file exists on disk.
@@ -176,13 +177,19 @@ QString OPFResource::GetText() const
 
 void OPFResource::SetText(const QString &text)
 {
-    emit TextChanging();
+    BeforeTextSet();
     QWriteLocker locker(&GetLock());
     QString source = ValidatePackageVersion(text);
     TextResource::SetText(source);
 }
 
 
+void OPFResource::BeforeTextSet()
+{
+    emit TextChanging();
+}
+
+
 bool OPFResource::LoadFromDisk()
 {
     try {
@@ -200,9 +207,7 @@ QList<Resource*> OPFResource::GetSpineOrderResources( const QList<Resource *> &r
 {
     QReadLocker locker(&GetLock());
     qDebug() << "GetSpineOrderResources";
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     const QHash<QString, Resource*> id_mapping = GetManifestIDResourceMapping(resources, p);
     QList<Resource *> spine_order;
     for (int i = 0; i < p.m_spine.count(); ++i) {
@@ -218,9 +223,7 @@ QHash <Resource *, int>  OPFResource::GetReadingOrderAll( const QList <Resource
 {
     QReadLocker locker(&GetLock());
     qDebug() << "GetReadingOrderAll";
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QHash <Resource *, int> reading_order;
     QHash<QString, int> id_order;
     for (int i = 0; i < p.m_spine.count(); ++i) {
@@ -240,9 +243,7 @@ int OPFResource::GetReadingOrder(const HTMLResource *html_resource) const
 {
     QReadLocker locker(&GetLock());
     qDebug() << "GetReadingOrder";
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     const Resource *resource = static_cast<const Resource *>(html_resource);
     QString resource_id = GetResourceManifestID(resource, p);
     qDebug() << "   " << "looking for " << resource_id;
@@ -258,9 +259,7 @@ int OPFResource::GetReadingOrder(const HTMLResource *html_resource) const
 QString OPFResource::GetMainIdentifierValue() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     int i = GetMainIdentifier(p);
     if (i > -1) {
         return QString(p.m_metadata.at(i).m_content);
@@ -270,10 +269,24 @@ QString OPFResource::GetMainIdentifierValue() const
 
 void OPFResource::SaveToDisk(bool book_wide_save)
 {
-    QString source = ValidatePackageVersion(CleanSource::ProcessXML(GetText(),"application/oebps-package+xml"));
+    QMutexLocker locker(&m_OPFModelMutex);
+    // text we generated from the cached model is already clean so only
+    // text set from outside (tabs, plugins, disk) needs the xml repair
+    bool model_is_current = (m_OPFModelRevision == GetTextRevision());
+    QString source;
+    if (model_is_current) {
+        source = ValidatePackageVersion(GetText());
+    } else {
+        source = ValidatePackageVersion(CleanSource::ProcessXML(GetText(),"application/oebps-package+xml"));
+    }
     // Work around for covers appearing on the Nook. Issue 942.
     source = source.replace(QRegularExpression("<meta content=\"([^\"]+)\" name=\"cover\""), "<meta name=\"cover\" content=\"\\1\"");
     TextResource::SetText(source);
+    if (model_is_current) {
+        // only attribute order of the cover meta may have changed
+        m_OPFModelRevision = GetTextRevision();
+    }
+    locker.unlock();
     TextResource::SaveToDisk(book_wide_save);
 }
 
@@ -306,9 +319,7 @@ QString OPFResource::GetUUIDIdentifierValue()
 {
     EnsureUUIDIdentifierPresent();
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     for (int i=0; i < p.m_metadata.count(); ++i) {
         MetaEntry me = p.m_metadata.at(i);
         if(me.m_name.startsWith("dc:identifier")) {
@@ -328,9 +339,7 @@ QString OPFResource::GetUUIDIdentifierValue()
 void OPFResource::EnsureUUIDIdentifierPresent()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     for (int i=0; i < p.m_metadata.count(); ++i) {
         MetaEntry me = p.m_metadata.at(i);
         if(me.m_name.startsWith("dc:identifier")) {
@@ -354,9 +363,7 @@ void OPFResource::EnsureUUIDIdentifierPresent()
 QString OPFResource::AddNCXItem(const QString &ncx_path, QString id)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString ncx_bkpath = ncx_path.right(ncx_path.length() - GetFullPathToBookFolder().length() - 1);
     QString ncx_rel_path = Utility::buildRelativePath(GetRelativePath(), ncx_bkpath);
     int n = p.m_manifest.count();
@@ -375,9 +382,7 @@ QString OPFResource::AddNCXItem(const QString &ncx_path, QString id)
 void OPFResource::UpdateNCXOnSpine(const QString &new_ncx_id)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString ncx_id = p.m_spineattr.m_atts.value(QString("toc"),"");
     if (new_ncx_id != ncx_id) {
         p.m_spineattr.m_atts[QString("toc")] = new_ncx_id;
@@ -388,9 +393,7 @@ void OPFResource::UpdateNCXOnSpine(const QString &new_ncx_id)
 void OPFResource::RemoveNCXOnSpine()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     p.m_spineattr.m_atts.remove("toc");
     UpdateText(p);
 }
@@ -399,9 +402,7 @@ void OPFResource::RemoveNCXOnSpine()
 void OPFResource::UpdateNCXLocationInManifest(const NCXResource *ncx)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString ncx_id = p.m_spineattr.m_atts.value(QString("toc"), "");
     int pos = p.m_idpos.value(ncx_id, -1);
     if (pos > -1) {
@@ -420,9 +421,7 @@ void OPFResource::UpdateNCXLocationInManifest(const NCXResource *ncx)
 void OPFResource::AddSigilVersionMeta()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     for (int i=0; i < p.m_metadata.count(); ++i) {
         MetaEntry me = p.m_metadata.at(i);
         if ((me.m_name == "meta") && (me.m_atts.contains("name"))) {  
@@ -447,9 +446,7 @@ void OPFResource::AddSigilVersionMeta()
 bool OPFResource::IsCoverImage(const ImageResource *image_resource) const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString resource_id = GetResourceManifestID(image_resource, p);
     return IsCoverImageCheck(resource_id, p);
 }
@@ -469,9 +466,7 @@ bool OPFResource::IsCoverImageCheck(QString resource_id, const OPFParser & p) co
 bool OPFResource::CoverImageExists() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     return GetCoverMeta(p) > -1;
 }
 
@@ -488,9 +483,7 @@ QStringList OPFResource::GetSpineOrderBookPaths() const
 {
     qDebug() << "GetSpineOrderBookPaths";
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QStringList book_paths_in_reading_order;
     for (int i=0; i < p.m_spine.count(); ++i) {
         SpineEntry sp = p.m_spine.at(i);
@@ -528,9 +521,7 @@ QString OPFResource::GetPrimaryBookLanguage() const
 QList<MetaEntry> OPFResource::GetDCMetadata() const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QList<MetaEntry> metadata;
     for (int i=0; i < p.m_metadata.count(); ++i) {
         if (p.m_metadata.at(i).m_name.startsWith("dc:")) {
@@ -557,9 +548,7 @@ QStringList OPFResource::GetDCMetadataValues(QString text) const
 void OPFResource::SetDCMetadata(const QList<MetaEntry> &metadata)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     // this will not work with refines so it needs to be fixed
     RemoveDCElements(p);
     foreach(MetaEntry book_meta, metadata) {
@@ -574,9 +563,7 @@ void OPFResource::SetDCMetadata(const QList<MetaEntry> &metadata)
 void OPFResource::AddResource(const Resource *resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     ManifestEntry me;
     me.m_id = GetUniqueID(GetValidID(resource->Filename()),p);
     me.m_href = Utility::URLEncodePath(GetRelativePathToResource(resource));
@@ -681,9 +668,7 @@ void OPFResource::AddCoverMetaForImage(const Resource *resource, OPFParser &p)
 void OPFResource::RemoveResource(const Resource *resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     if (p.m_manifest.isEmpty()) return;
     QString href = Utility::URLEncodePath(GetRelativePathToResource(resource));
     int pos = p.m_hrefpos.value(href, -1);
@@ -728,9 +713,7 @@ void OPFResource::RemoveResource(const Resource *resource)
 void OPFResource::ClearSemanticCodesInGuide()
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     foreach(GuideEntry ge, p.m_guide) {
         p.m_guide.removeAt(0);
     }
@@ -743,9 +726,7 @@ void OPFResource::AddGuideSemanticCode(HTMLResource *html_resource, QString new_
     //first get primary book language
     QString lang = GetPrimaryBookLanguage();
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString current_code = GetGuideSemanticCodeForResource(html_resource, p);
 
     if ((current_code != new_code) || !toggle) {
@@ -840,9 +821,7 @@ void OPFResource::SetGuideSemanticCodeForResource(QString code, const Resource *
 QString OPFResource::GetGuideSemanticCodeForResource(const Resource *resource) const
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     return GetGuideSemanticCodeForResource(resource, p);
 }
 
@@ -856,9 +835,7 @@ QString OPFResource::GetGuideSemanticNameForResource(Resource *resource)
 QHash <QString, QString>  OPFResource::GetSemanticCodeForPaths()
 {
   QReadLocker locker(&GetLock());
-  QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-  OPFParser p;
-  p.parse(source);
+  OPFParser p = GetParsedOPF();
 
   QHash <QString, QString> semantic_types;
   foreach(GuideEntry ge, p.m_guide) {
@@ -876,9 +853,7 @@ QHash <QString, QString>  OPFResource::GetSemanticCodeForPaths()
 QHash <QString, QString>  OPFResource::GetGuideSemanticNameForPaths()
 {
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
 
     QHash <QString, QString> semantic_types;
     foreach(GuideEntry ge, p.m_guide) {
@@ -907,9 +882,7 @@ QHash <QString, QString>  OPFResource::GetGuideSemanticNameForPaths()
 void OPFResource::SetResourceAsCoverImage(ImageResource *image_resource)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString resource_id = GetResourceManifestID(image_resource, p);
 
     // First deal with any previous covers by removing 
@@ -945,9 +918,7 @@ void OPFResource::UpdateSpineOrder(const QList<::HTMLResource *> html_files)
 {
     qDebug() << "UpdateSpineOrder";
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QList<SpineEntry> new_spine;
     foreach(HTMLResource * html_resource, html_files) {
         const Resource *resource = static_cast<const Resource *>(html_resource);
@@ -977,31 +948,67 @@ void OPFResource::UpdateSpineOrder(const QList<::HTMLResource *> html_files)
 void OPFResource::ResourceRenamed(const Resource *resource, QString old_full_path)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
+    RenameManifestEntry(resource, old_full_path, GetRelativePath(), p);
+    UpdateText(p);
+}
+
+
+void OPFResource::ResourceMoved(const Resource *resource, QString old_full_path)
+{
+    QWriteLocker locker(&GetLock());
+    OPFParser p = GetParsedOPF();
+    MoveManifestEntry(resource, old_full_path, GetRelativePath(), p);
+    UpdateText(p);
+}
+
+
+void OPFResource::ResourcePathsChanged(const QList<PathChange> &changes, const QString &opf_bookpath)
+{
+    QWriteLocker locker(&GetLock());
+    OPFParser p = GetParsedOPF();
+    foreach(const PathChange &change, changes) {
+        if (change.moved) {
+            MoveManifestEntry(change.resource, change.old_full_path, opf_bookpath, p);
+        } else {
+            RenameManifestEntry(change.resource, change.old_full_path, opf_bookpath, p);
+        }
+    }
+    UpdateText(p);
+}
+
+
+QString OPFResource::GetManifestHref(const Resource *resource, const QString &opf_bookpath) const
+{
+    if (opf_bookpath == GetRelativePath()) {
+        return Utility::URLEncodePath(GetRelativePathToResource(resource));
+    }
+    return Utility::URLEncodePath(Utility::buildRelativePath(opf_bookpath, resource->GetRelativePath()));
+}
+
+
+void OPFResource::RenameManifestEntry(const Resource *resource, const QString &old_full_path,
+                                      const QString &opf_bookpath, OPFParser &p)
+{
     // first convert old_full_path to old_bkpath
     QString old_bkpath = old_full_path.right(old_full_path.length() - GetFullPathToBookFolder().length() - 1);
-    QString old_href = Utility::URLEncodePath(Utility::buildRelativePath(GetRelativePath(), old_bkpath));
+    QString old_href = Utility::URLEncodePath(Utility::buildRelativePath(opf_bookpath, old_bkpath));
     QString old_id;
     QString new_id;
-    for (int i=0; i < p.m_manifest.count(); ++i) {
-        QString href = p.m_manifest.at(i).m_href;
-        if (href == old_href) {
-            ManifestEntry me = p.m_manifest.at(i);
-            QString old_me_href = me.m_href;
-            me.m_href = Utility::URLEncodePath(GetRelativePathToResource(resource));
-            qDebug() << "renaming resource to" << me.m_href;
-            old_id = me.m_id;
-            p.m_idpos.remove(old_id);
-            new_id = GetUniqueID(GetValidID(resource->Filename()),p);
-            me.m_id = new_id;
-            p.m_idpos[new_id] = i;
-            p.m_hrefpos.remove(old_me_href);
-            p.m_hrefpos[me.m_href] = i;
-            p.m_manifest.replace(i, me);
-            break;
-        }
+    int pos = p.m_hrefpos.value(old_href, -1);
+    if (pos > -1) {
+        ManifestEntry me = p.m_manifest.at(pos);
+        QString old_me_href = me.m_href;
+        me.m_href = GetManifestHref(resource, opf_bookpath);
+        qDebug() << "renaming resource to" << me.m_href;
+        old_id = me.m_id;
+        p.m_idpos.remove(old_id);
+        new_id = GetUniqueID(GetValidID(resource->Filename()),p);
+        me.m_id = new_id;
+        p.m_idpos[new_id] = pos;
+        p.m_hrefpos.remove(old_me_href);
+        p.m_hrefpos[me.m_href] = pos;
+        p.m_manifest.replace(pos, me);
     }
     for (int i=0; i < p.m_spine.count(); ++i) {
         QString idref = p.m_spine.at(i).m_idref;
@@ -1029,34 +1036,26 @@ void OPFResource::ResourceRenamed(const Resource *resource, QString old_full_pat
             AddCoverMetaForImage(resource, p);
         }
     }
-    UpdateText(p);
 }
 
 
-void OPFResource::ResourceMoved(const Resource *resource, QString old_full_path)
+void OPFResource::MoveManifestEntry(const Resource *resource, const QString &old_full_path,
+                                    const QString &opf_bookpath, OPFParser &p)
 {
-    QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
     // first convert old_full_path to old_bkpath
     QString old_bkpath = old_full_path.right(old_full_path.length() - GetFullPathToBookFolder().length() - 1);
-    QString old_href = Utility::URLEncodePath(Utility::buildRelativePath(GetRelativePath(), old_bkpath));
+    QString old_href = Utility::URLEncodePath(Utility::buildRelativePath(opf_bookpath, old_bkpath));
     // a move should not impact the id so leave the old unique manifest id unchanged
-    for (int i=0; i < p.m_manifest.count(); ++i) {
-        QString href = p.m_manifest.at(i).m_href;
-        if (href == old_href) {
-            ManifestEntry me = p.m_manifest.at(i);
-            QString old_me_href = me.m_href;
-            me.m_href = Utility::URLEncodePath(GetRelativePathToResource(resource));
-            p.m_idpos[me.m_id] = i;
-            p.m_hrefpos.remove(old_me_href);
-            p.m_hrefpos[me.m_href] = i;
-            p.m_manifest.replace(i, me);
-            break;
-        }
+    int pos = p.m_hrefpos.value(old_href, -1);
+    if (pos > -1) {
+        ManifestEntry me = p.m_manifest.at(pos);
+        QString old_me_href = me.m_href;
+        me.m_href = GetManifestHref(resource, opf_bookpath);
+        p.m_idpos[me.m_id] = pos;
+        p.m_hrefpos.remove(old_me_href);
+        p.m_hrefpos[me.m_href] = pos;
+        p.m_manifest.replace(pos, me);
     }
-    UpdateText(p);
 }
 
 
@@ -1204,9 +1203,7 @@ QString OPFResource::AddModificationDateMeta()
     datetime = local.toString(Qt::ISODate);
 
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
 
     QString epubversion = GetEpubVersion();
     if (epubversion.startsWith('3')) {
@@ -1321,9 +1318,35 @@ QString OPFResource::GetFileMimetype(const QString &filepath) const
 }
 
 
+// Returns a copy of the cached parsed opf. Only when the text was changed
+// by someone other than UpdateText() (tab edits, SetText, loads from disk)
+// do we need to go through the python xml repair and parse again.
+// Copies are cheap as the entry lists are implicitly shared.
+OPFParser OPFResource::GetParsedOPF() const
+{
+    QMutexLocker locker(&m_OPFModelMutex);
+    int revision = GetTextRevision();
+    if (m_OPFModelRevision != revision) {
+        QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
+        OPFParser p;
+        p.parse(source);
+        m_OPFModel = p;
+        m_OPFModelRevision = revision;
+    }
+    return m_OPFModel;
+}
+
+
+// The modified model becomes the authoritative one, its
+// serialization is known good so no repair is ever needed
 void OPFResource::UpdateText(const OPFParser &p)
 {
-    TextResource::SetText(p.convert_to_xml());
+    QMutexLocker locker(&m_OPFModelMutex);
+    m_OPFModel = p;
+    // callers add and remove manifest entries directly so the lookup maps may be stale
+    m_OPFModel.rebuild_index_maps();
+    TextResource::SetText(m_OPFModel.convert_to_xml());
+    m_OPFModelRevision = GetTextRevision();
 }
 
 
@@ -1351,9 +1374,7 @@ QString OPFResource::ValidatePackageVersion(const QString& source)
 void OPFResource::UpdateManifestProperties(const QList<Resource*> resources)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     if (p.m_package.m_version != "3.0") {
         return;
     }
@@ -1398,9 +1419,7 @@ QString OPFResource::GetManifestPropertiesForResource(const Resource * resource)
     QString properties;
     if (!resource) return properties;
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     if (!p.m_package.m_version.startsWith("3")) {
         return properties;
     }
@@ -1422,9 +1441,7 @@ QHash <QString, QString>  OPFResource::GetManifestPropertiesForPaths()
         return manifest_properties_all;
     }
     QReadLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     foreach(ManifestEntry me, p.m_manifest) {
         QString apath = Utility::URLDecodePath(me.m_href);
         if (me.m_atts.contains("properties")){
@@ -1449,9 +1466,7 @@ void OPFResource::SetNavResource(HTMLResource * nav_resource)
     // Make sure the proper nav property is set in the opf manifest
     if (m_NavResource) { 
         QWriteLocker locker(&GetLock());
-        QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-        OPFParser p;
-        p.parse(source);
+        OPFParser p = GetParsedOPF();
         QString href = Utility::URLEncodePath(GetRelativePathToResource(m_NavResource));
         int pos = p.m_hrefpos.value(href, -1);
         if ((pos >= 0) && (pos < p.m_manifest.count())) {
@@ -1467,9 +1482,7 @@ void OPFResource::SetNavResource(HTMLResource * nav_resource)
 void OPFResource::SetItemRefLinear(Resource * resource, bool linear)
 {
     QWriteLocker locker(&GetLock());
-    QString source = CleanSource::ProcessXML(GetText(),"application/oebps-package+xml");
-    OPFParser p;
-    p.parse(source);
+    OPFParser p = GetParsedOPF();
     QString resource_href_path = Utility::URLEncodePath(GetRelativePathToResource(resource));
     int pos = p.m_hrefpos.value(resource_href_path, -1);
     QString item_id = "";
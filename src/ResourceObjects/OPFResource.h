@@ -26,6 +26,7 @@
 #define OPFRESOURCE_H
 
 #include <memory>
+#include <QtCore/QMutex>
 #include "Misc/GuideItems.h"
 #include "ResourceObjects/XMLResource.h"
 #include "ResourceObjects/OPFParser.h"
@@ -41,6 +42,15 @@ class OPFResource : public XMLResource
 
 public:
 
+    /**
+     * A renamed or moved resource and where it used to be.
+     */
+    struct PathChange {
+        const Resource *resource;
+        QString old_full_path;
+        bool moved;
+    };
+
     /**
      * Constructor.
      *
@@ -139,6 +149,9 @@ public:
     void SetNavResource(HTMLResource* nav);
     HTMLResource* GetNavResource() const;
 
+protected:
+    virtual void BeforeTextSet();
+
  signals:
     void TextChanging();
     void LoadedFromDisk();
@@ -167,6 +180,17 @@ public slots:
 
     void ResourceMoved(const Resource *resource, QString old_full_path);
 
+    /**
+     * Applies several renames and moves to the manifest in the
+     * order given and rewrites the OPF a single time.
+     *
+     * @param changes The resources with their full paths before
+     *                the change, and whether they were moved.
+     * @param opf_bookpath The book path the manifest hrefs are relative to,
+     *                     the OPF's old one if it moved after the changes.
+     */
+    void ResourcePathsChanged(const QList<PathChange> &changes, const QString &opf_bookpath);
+
     void UpdateManifestProperties(const QList<Resource *> resources);
 
     QString GetManifestPropertiesForResource(const Resource * resource);
@@ -192,6 +216,15 @@ private:
 
     void RemoveCoverMetaForImage(const Resource *resource, OPFParser &p);
 
+    void RenameManifestEntry(const Resource *resource, const QString &old_full_path,
+                             const QString &opf_bookpath, OPFParser &p);
+
+    void MoveManifestEntry(const Resource *resource, const QString &old_full_path,
+                           const QString &opf_bookpath, OPFParser &p);
+
+    // The manifest href of the resource as seen from an OPF at opf_bookpath
+    QString GetManifestHref(const Resource *resource, const QString &opf_bookpath) const;
+
 
     // static void AppendToSpine(const QString &id);
 
@@ -252,6 +285,8 @@ private:
 
     QString GetFileMimetype(const QString &filepath) const;
 
+    OPFParser GetParsedOPF() const;
+
     void UpdateText(const OPFParser &p);
 
     QString ValidatePackageVersion(const QString &source);
@@ -262,6 +297,15 @@ private:
 
     HTMLResource * m_NavResource;
     bool m_WarnedAboutVersion;
+
+    /**
+     * The parsed opf and the text revision it matches.
+     * All manifest/spine/metadata changes are made to a copy
+     * of this model which then replaces it in UpdateText().
+     */
+    mutable OPFParser m_OPFModel;
+    mutable int m_OPFModelRevision;
+    mutable QMutex m_OPFModelMutex;
 };
 
 #endif // OPFRESOURCE_H
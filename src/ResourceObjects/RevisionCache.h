@@ -0,0 +1,79 @@
+/************************************************************************
+**
+**  Copyright (C) 2020 Kevin B. Hendricks Stratford, ON, Canada
+**
+**  This file is part of Sigil.
+**
+**  Sigil is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  Sigil is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with Sigil.  If not, see <http://www.gnu.org/licenses/>.
+**
+*************************************************************************/
+
+
+#pragma once
+#ifndef REVISIONCACHE_H
+#define REVISIONCACHE_H
+
+#include <functional>
+
+#include <QtCore/QMutex>
+
+#include "ResourceObjects/TextResource.h"
+
+/**
+ * Holds a value built from the text of a resource, such as
+ * a parse of it, until the text revision of the resource changes.
+ *
+ * The cache has its own lock rather than using the resource
+ * ReadWriteLock so it can be used by callers that already
+ * hold either a read or a write lock on the resource.
+ */
+template <typename T>
+class RevisionCache
+{
+public:
+    RevisionCache() : m_Revision(-1), m_HasValue(false) {}
+
+    /**
+     * Returns the value for the current text of the resource,
+     * calling build to make it if there is none for this revision.
+     *
+     * @param resource The resource the value is built from.
+     * @param build Builds the value from the current text.
+     */
+    T Get(const TextResource *resource, std::function<T()> build)
+    {
+        QMutexLocker locker(&m_Mutex);
+        // grab the revision before the text, if the text changes in between
+        // the value is simply stored against an old revision and rebuilt next time
+        int revision = resource->GetTextRevision();
+
+        if (!m_HasValue || (m_Revision != revision)) {
+            m_Value = build();
+            m_Revision = revision;
+            m_HasValue = true;
+        }
+
+        return m_Value;
+    }
+
+private:
+    Q_DISABLE_COPY(RevisionCache)
+
+    QMutex m_Mutex;
+    T m_Value;
+    int m_Revision;
+    bool m_HasValue;
+};
+
+#endif // REVISIONCACHE_H
@@ -25,6 +25,7 @@
 #include <QtCore/QThread>
 #include <QtCore/QTimer>
 #include <QtWidgets/QApplication>
+#include <QtGui/QTextCursor>
 #include <QtWidgets/QPlainTextDocumentLayout>
 
 #include "Misc/Utility.h"
@@ -34,57 +35,103 @@
 TextResource::TextResource(const QString &mainfolder, const QString &fullfilepath, QObject *parent)
     :
     Resource(mainfolder, fullfilepath, parent),
-    m_CacheInUse(false),
-    m_TextDocument(new TextDocument(this)),
-    m_IsLoaded(false)
+    m_TextDocumentDirty(false),
+    m_DocumentUpdatePending(false),
+    m_UpdatingDocument(false),
+    m_TextDocument(NULL),
+    m_IsLoaded(false),
+    m_TextRevision(0)
 {
-    m_TextDocument->setDocumentLayout(new QPlainTextDocumentLayout(m_TextDocument));
-    connect(m_TextDocument, SIGNAL(contentsChanged()), this, SIGNAL(Modified()));
 }
 
 
 QString TextResource::GetText() const
 {
-    QMutexLocker locker(&m_CacheAccessMutex);
+    QMutexLocker locker(&m_TextAccessMutex);
 
-    if (m_CacheInUse) {
-        return m_Cache;
+    if (m_TextDocumentDirty) {
+        m_Text = m_TextDocument->toText();
+        m_TextDocumentDirty = false;
     }
 
-    return m_TextDocument->toText();
+    return m_Text;
 }
 
 
 void TextResource::SetText(const QString &text)
 {
-    //   We need to delay updating the QTextDocument if SetText has
-    // been called from something other than the main GUI thread. Why?
-    // Because a CodeView is probably connected to the text document,
-    // and if we update it from a non-GUI thread, it will notify the
-    // CodeView base class to update as well and that will crash us since
-    // the base class derives from QWidget (and those can only be updated
-    // in the GUI thread).
-    //   So we cache the text update into m_Cache and update the QTextDocument
-    // when we return to the GUI thread. The single-shot timer makes sure
-    // of that.
-    if (QThread::currentThread() == QApplication::instance()->thread()) {
-        SetTextInternal(text);
-    } else {
-        QMutexLocker locker(&m_CacheAccessMutex);
-        m_Cache = text;
+    SetTextInternal(text);
+    // bump only after the new text is visible to GetText() so that
+    // anything caching against the old revision is seen as stale
+    BumpTextRevision();
+}
+
+
+void TextResource::SetTextAsEdit(const QString &text)
+{
+    if (!m_TextDocument) {
+        SetText(text);
+        return;
+    }
+
+    BeforeTextSet();
+    // TextDocumentChanged() takes care of marking the text dirty and bumping the revision
+    QTextCursor cursor(m_TextDocument);
+    cursor.beginEditBlock();
+    cursor.select(QTextCursor::Document);
+    cursor.insertText(text);
+    cursor.endEditBlock();
+    AfterTextSet();
+}
+
+
+int TextResource::GetTextRevision() const
+{
+    return m_TextRevision.loadAcquire();
+}
+
 
-        // We want to make sure we schedule only one delayed update
-        if (!m_CacheInUse) {
-            m_CacheInUse = true;
-            QTimer::singleShot(0, this, SLOT(DelayedUpdateToTextDocument()));
+void TextResource::BumpTextRevision()
+{
+    m_TextRevision.fetchAndAddOrdered(1);
+}
+
+
+void TextResource::TextDocumentChanged()
+{
+    // our own setPlainText() calls change nothing m_Text does not already hold
+    if (m_UpdatingDocument) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
+
+        // A pending update from SetText() will replace this edit anyway
+        if (!m_DocumentUpdatePending) {
+            m_TextDocumentDirty = true;
         }
     }
+    BumpTextRevision();
 }
 
 
 TextDocument& TextResource::GetTextDocumentForWriting()
 {
-    Q_ASSERT(m_TextDocument);
+    if (!m_TextDocument) {
+        TextDocument *document = new TextDocument(this);
+        document->setDocumentLayout(new QPlainTextDocumentLayout(document));
+        {
+            QMutexLocker locker(&m_TextAccessMutex);
+            m_TextDocument = document;
+        }
+        UpdateTextDocument();
+        // Connect only after the initial fill so that opening
+        // a tab does not mark the resource as modified
+        connect(m_TextDocument, SIGNAL(contentsChanged()), this, SIGNAL(Modified()));
+        connect(m_TextDocument, SIGNAL(contentsChanged()), this, SLOT(TextDocumentChanged()));
+    }
+
     return *m_TextDocument;
 }
 
@@ -94,7 +141,7 @@ void TextResource::SaveToDisk(bool book_wide_save)
     {
         QWriteLocker locker(&GetLock());
 
-        if (!m_CacheInUse && !m_IsLoaded) {
+        if (!m_IsLoaded) {
             return;
         }
 
@@ -104,19 +151,17 @@ void TextResource::SaveToDisk(bool book_wide_save)
         // (some text files have placeholder text on disk)
 
         // But we always want to save the most up to date version
-
-        if (m_CacheInUse) {
-            Utility::WriteUnicodeTextFile(m_Cache, GetFullPath());
-        } else {
-            Utility::WriteUnicodeTextFile(GetText(), GetFullPath());
-        }
+        Utility::WriteUnicodeTextFile(GetText(), GetFullPath());
     }
 
     if (!book_wide_save) {
         emit ResourceUpdatedOnDisk();
     }
 
-    m_TextDocument->setModified(false);
+    if (m_TextDocument) {
+        m_TextDocument->setModified(false);
+    }
+
     Resource::SaveToDisk(book_wide_save);
 }
 
@@ -144,9 +189,8 @@ void TextResource::InitialLoad()
       * it had been opened in a tab first.
       */
     QWriteLocker locker(&GetLock());
-    Q_ASSERT(m_TextDocument);
 
-    if (m_TextDocument->isEmpty() && QFile::exists(GetFullPath())) {
+    if (GetText().isEmpty() && QFile::exists(GetFullPath())) {
         SetText(Utility::ReadUnicodeTextFile(GetFullPath()));
     }
 }
@@ -161,15 +205,7 @@ bool TextResource::LoadFromDisk()
 {
     try {
         const QString &text = Utility::ReadUnicodeTextFile(GetFullPath());
-        QMutexLocker locker(&m_CacheAccessMutex);
-        m_Cache = text;
-
-        // We want to make sure we schedule only one delayed update
-        if (!m_CacheInUse) {
-            m_CacheInUse = true;
-            QTimer::singleShot(0, this, SLOT(DelayedUpdateToTextDocument()));
-        }
-
+        TextResource::SetText(text);
         return true;
     } catch (CannotOpenFile&) {
         // ?
@@ -181,25 +217,72 @@ bool TextResource::LoadFromDisk()
 
 void TextResource::DelayedUpdateToTextDocument()
 {
-    QMutexLocker locker(&m_CacheAccessMutex);
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
 
-    if (!m_CacheInUse) {
-        return;
+        if (!m_DocumentUpdatePending) {
+            return;
+        }
     }
-
-    SetTextInternal(m_Cache);
+    UpdateTextDocument();
 }
 
 
 void TextResource::SetTextInternal(const QString &text)
 {
+    // store exactly what a round trip through the text document would give
+    // back, so readers see the same text whether or not a tab was ever opened
+    QString normalized_text = text;
+    TextDocument::NormalizeLineBreaks(normalized_text);
+    bool has_document;
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
+        m_Text = normalized_text;
+        m_TextDocumentDirty = false;
+        // Our resource has now been loaded with some text
+        m_IsLoaded = true;
+        has_document = m_TextDocument != NULL;
+
+        //   We need to delay updating the QTextDocument if SetText has
+        // been called from something other than the main GUI thread. Why?
+        // Because a CodeView is connected to the text document, and if we
+        // update it from a non-GUI thread, it will notify the CodeView base
+        // class to update as well and that will crash us since the base class
+        // derives from QWidget (and those can only be updated in the GUI thread).
+        //   GetText() already returns the new text, the single-shot timer
+        // brings the document in line when we return to the GUI thread.
+        if (has_document && (QThread::currentThread() != QApplication::instance()->thread())) {
+            // We want to make sure we schedule only one delayed update
+            if (!m_DocumentUpdatePending) {
+                m_DocumentUpdatePending = true;
+                QTimer::singleShot(0, this, SLOT(DelayedUpdateToTextDocument()));
+            }
+            return;
+        }
+        m_DocumentUpdatePending = false;
+    }
+
+    if (has_document) {
+        UpdateTextDocument();
+    } else {
+        // nobody is showing the text so there is no document to signal for us
+        emit Modified();
+    }
+}
+
+
+void TextResource::UpdateTextDocument()
+{
+    QString text;
+    {
+        QMutexLocker locker(&m_TextAccessMutex);
+        m_DocumentUpdatePending = false;
+        text = m_Text;
+    }
+    m_UpdatingDocument = true;
     m_TextDocument->setPlainText(text);
     m_TextDocument->setModified(false);
-    // Our resource has now been loaded with some text
-    m_IsLoaded = true;
-    m_CacheInUse = false;
-    // Clear anything left in the cache
-    // m_Cache = "";
+    m_UpdatingDocument = false;
 }
 
 bool TextResource::IsLoaded()
@@ -24,6 +24,7 @@
 #ifndef TEXTRESOURCE_H
 #define TEXTRESOURCE_H
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
 #include "Misc/TextDocument.h"
 #include "ResourceObjects/Resource.h"
@@ -34,6 +35,10 @@ class TextDocument;
 /**
  * A parent class for textual resources like CSS and SVG images.
  * Takes care of loading and caching content etc.
+ *
+ * The text is kept in a plain implicitly shared QString. The QTextDocument
+ * used by the editors is only created once a tab asks for it, and from
+ * then on edits made in it are synced back into the string on demand.
  */
 class TextResource : public Resource
 {
@@ -52,6 +57,8 @@ public:
 
     /**
      * Returns the text stored in the resource.
+     * This is a cheap implicitly shared copy unless the
+     * text document has been edited since the last call.
      *
      * @return The resource text.
      */
@@ -62,11 +69,33 @@ public:
      */
     virtual void SetText(const QString &text);
 
+    /**
+     * Replaces the text the way an edit in a tab would. If the text is open
+     * in an editor the change is made to its document as a single edit block,
+     * so one Undo in that tab reverts it; otherwise this is just SetText().
+     *
+     * @warning Must only be called from the main GUI thread.
+     */
+    void SetTextAsEdit(const QString &text);
+
+    /**
+     * Returns the revision number of the resource text.
+     * The revision is bumped every time the text changes,
+     * either through SetText() or through edits of the
+     * underlying QTextDocument, so it can be used to
+     * validate caches derived from the text.
+     *
+     * @return The current text revision.
+     */
+    int GetTextRevision() const;
+
     /**
      * Returns a reference to the QTextDocument that can be read and written to
-     * in consumers. If you need just read access, use GetTextDocumentForReading().
+     * in consumers. If you need just read access, use GetText().
+     * The document is created from the current text on first use.
      *
      * @warning Make sure to get a write lock externally before calling this function!
+     * @warning Must only be called from the main GUI thread.
      *
      * @return A reference to the QTextDocument cache.
      */
@@ -90,49 +119,87 @@ public:
 protected:
     virtual bool LoadFromDisk();
 
+    /**
+     * Called before and after SetTextAsEdit() edits the open document, so
+     * subclasses can run the same hooks their SetText() runs around the change.
+     */
+    virtual void BeforeTextSet() {}
+    virtual void AfterTextSet() {}
+
 private slots:
 
     /**
      * Performs the delayed update of m_TextDocument with the text
-     * stored in m_Cache.
+     * stored in m_Text.
      */
     void DelayedUpdateToTextDocument();
 
+    /**
+     * Marks m_Text as out of date and bumps the text revision
+     * whenever the QTextDocument is edited.
+     */
+    void TextDocumentChanged();
+
 private:
 
     /**
-     * Actually sets the text to m_TextDocument.
+     * Stores the new text and pushes it to m_TextDocument if one exists.
      *
      * @param text The text to set.
      */
     void SetTextInternal(const QString &text);
 
+    /**
+     * Replaces the contents of m_TextDocument with m_Text.
+     * Must be called from the main GUI thread.
+     */
+    void UpdateTextDocument();
+
+    void BumpTextRevision();
+
 
     ///////////////////////////////
     // PRIVATE MEMBER VARIABLES
     ///////////////////////////////
 
     /**
-     * If \c true, then the m_Cache var is holding cached text.
+     * The text of the resource.
+     * Out of date while m_TextDocumentDirty is set.
+     */
+    mutable QString m_Text;
+
+    /**
+     * If \c true, m_TextDocument has been edited since m_Text was last synced.
      */
-    bool m_CacheInUse;
+    mutable bool m_TextDocumentDirty;
 
     /**
-     * The cached text used when threads are in use. @see SetText() internals.
+     * If \c true, a delayed update of m_TextDocument from m_Text is scheduled.
+     * @see SetText() internals.
      */
-    QString m_Cache;
+    bool m_DocumentUpdatePending;
 
     /**
-     * The access mutex for the cache.
+     * If \c true, we are replacing the contents of m_TextDocument ourselves.
      */
-    mutable QMutex m_CacheAccessMutex;
+    bool m_UpdatingDocument;
 
     /**
-     * The syntax colored cache of the TextResource text content.
+     * The access mutex for the text.
+     */
+    mutable QMutex m_TextAccessMutex;
+
+    /**
+     * The document used by the editors, NULL until a tab opens the resource.
      */
     TextDocument *m_TextDocument;
 
     bool m_IsLoaded;
+
+    /**
+     * The revision of the text. @see GetTextRevision().
+     */
+    QAtomicInt m_TextRevision;
 };
 
 #endif // TEXTRESOURCE_H
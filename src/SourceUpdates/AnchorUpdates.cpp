@@ -30,6 +30,7 @@
 #include <QtConcurrent/QtConcurrent>
 #include <QDebug>
 
+#include "BookManipulation/BookIndex.h"
 #include "Misc/Utility.h"
 #include "Misc/GumboInterface.h"
 #include "BookManipulation/CleanSource.h"
@@ -38,33 +39,36 @@
 #include "sigil_constants.h"
 #include "SourceUpdates/AnchorUpdates.h"
 
-void AnchorUpdates::UpdateAllAnchorsWithIDs(const QList<HTMLResource *> &html_resources)
+void AnchorUpdates::UpdateAllAnchorsWithIDs(const QList<HTMLResource *> &html_resources, BookIndex *index)
 {
-    const QHash<QString, QString> &ID_locations = GetIDLocations(html_resources);
+    const QHash<QString, QString> &ID_locations = GetIDLocations(html_resources, index);
     QtConcurrent::blockingMap(html_resources, std::bind(UpdateAnchorsInOneFile, std::placeholders::_1, ID_locations));
 }
 
 
-void AnchorUpdates::UpdateExternalAnchors(const QList<HTMLResource *> &html_resources, const QString &originating_bookpath, const QList<HTMLResource *> new_files)
+void AnchorUpdates::UpdateExternalAnchors(const QList<HTMLResource *> &html_resources, const QString &originating_bookpath, const QList<HTMLResource *> new_files, BookIndex *index)
 {
-    const QHash<QString, QString> &ID_locations = GetIDLocations(new_files);
+    const QHash<QString, QString> &ID_locations = GetIDLocations(new_files, index);
     QtConcurrent::blockingMap(html_resources, std::bind(UpdateExternalAnchorsInOneFile, std::placeholders::_1, originating_bookpath, ID_locations));
 }
 
 
 // used to update after merge of html_resources into new_file
-void AnchorUpdates::UpdateAllAnchors(const QList<HTMLResource *> &html_resources, const QStringList &originating_bookpaths, HTMLResource *sink_res)
+void AnchorUpdates::UpdateAllAnchors(const QList<HTMLResource *> &html_resources, const QStringList &originating_bookpaths, HTMLResource *sink_res, BookIndex *index)
 {
     QList<HTMLResource *> new_files;
     new_files.append(sink_res);
-    const QHash<QString, QString> &ID_locations = GetIDLocations(new_files);
+    const QHash<QString, QString> &ID_locations = GetIDLocations(new_files, index);
     QString sink_bookpath = sink_res->GetRelativePath();
     QtConcurrent::blockingMap(html_resources, std::bind(UpdateAllAnchorsInOneFile, std::placeholders::_1, originating_bookpaths, ID_locations, sink_bookpath));
 }
 
 
-QHash<QString, QString> AnchorUpdates::GetIDLocations(const QList<HTMLResource *> &html_resources)
+QHash<QString, QString> AnchorUpdates::GetIDLocations(const QList<HTMLResource *> &html_resources, BookIndex *index)
 {
+    if (index) {
+        return index->GetIDLocations(html_resources);
+    }
     const QList<std::tuple<QString, QList<QString>>> &IDs_in_files = QtConcurrent::blockingMapped(html_resources, GetOneFileIDs);
     QHash<QString, QString> ID_locations;
 
@@ -86,11 +90,8 @@ std::tuple<QString, QList<QString>> AnchorUpdates::GetOneFileIDs(HTMLResource *h
 {
     Q_ASSERT(html_resource);
     QReadLocker locker(&html_resource->GetLock());
-    QString newsource = html_resource->GetText();
-    QString version = html_resource->GetEpubVersion();
-    GumboInterface gi = GumboInterface(newsource, version);
-    gi.parse();
-    QList<QString> ids = gi.get_all_values_for_attribute(QString("id"));
+    std::shared_ptr<GumboInterface> gi = html_resource->GetParsedDocument();
+    QList<QString> ids = gi->get_all_values_for_attribute(QString("id"));
     return std::make_tuple(html_resource->GetRelativePath(), ids);
 }
 
@@ -251,12 +252,12 @@ void AnchorUpdates::UpdateAllAnchorsInOneFile(HTMLResource *html_resource,
 
 
 // use this after a split to update changed links in the NCX
-void AnchorUpdates::UpdateTOCEntries(NCXResource *ncx_resource, const QString &originating_bookpath, const QList<HTMLResource *> new_files)
+void AnchorUpdates::UpdateTOCEntries(NCXResource *ncx_resource, const QString &originating_bookpath, const QList<HTMLResource *> new_files, BookIndex *index)
 {
     
     // this routine should only be run on epub2
     Q_ASSERT(ncx_resource);
-    const QHash<QString, QString> &ID_locations = GetIDLocations(new_files);
+    const QHash<QString, QString> &ID_locations = GetIDLocations(new_files, index);
     // serialize the hash for passing to python
     QStringList dictkeys = ID_locations.keys();
     QStringList dictvals;
@@ -23,6 +23,7 @@
 #ifndef ANCHORUPDATES_H
 #define ANCHORUPDATES_H
 
+class BookIndex;
 class HTMLResource;
 class NCXResource;
 
@@ -31,7 +32,13 @@ class AnchorUpdates
 
 public:
 
-    static void UpdateAllAnchorsWithIDs(const QList<HTMLResource *> &html_resources);
+    /**
+     * All of the routines below take an optional BookIndex. When given,
+     * the id locations are looked up in the index (which only rescans
+     * files changed since they were last indexed) instead of reparsing
+     * every file passed in.
+     */
+    static void UpdateAllAnchorsWithIDs(const QList<HTMLResource *> &html_resources, BookIndex *index = NULL);
 
     /**
      * Updates the anchors in html_resources that point to ids that were originally located in originating_filename
@@ -41,7 +48,7 @@ public:
      * @param originating_filename The name of the original file for which references need to be reconciled.
      * @param new_files A list of the new files created by splitting the originating_filename.
      */
-    static void UpdateExternalAnchors(const QList<HTMLResource *> &html_resources, const QString &originating_filename, const QList<HTMLResource *> new_files);
+    static void UpdateExternalAnchors(const QList<HTMLResource *> &html_resources, const QString &originating_filename, const QList<HTMLResource *> new_files, BookIndex *index = NULL);
 
     /**
      * Updates the anchors in html_resources that point to ids that were originally located in originating_filenames
@@ -51,7 +58,7 @@ public:
      * @param originating_filenames The names of the original files for which references need to be reconciled.
      * @param new_file The new file created by merging the original files.
      */
-    static void UpdateAllAnchors(const QList<HTMLResource *> &html_resources, const QStringList &originating_filenames, HTMLResource *new_file);
+    static void UpdateAllAnchors(const QList<HTMLResource *> &html_resources, const QStringList &originating_filenames, HTMLResource *new_file, BookIndex *index = NULL);
 
     /**
      * Updates the src attributes of the content tags in the toc.ncx file that point to
@@ -62,13 +69,13 @@ public:
      * @param originating_filename The name of the original file for which references need to be reconciled.
      * @param new_files A list of the new files created by splitting the originating_filename.
      */
-    static void UpdateTOCEntries(NCXResource *ncx_resource, const QString &originating_filename, const QList<HTMLResource *> new_files);
+    static void UpdateTOCEntries(NCXResource *ncx_resource, const QString &originating_filename, const QList<HTMLResource *> new_files, BookIndex *index = NULL);
 
     static void UpdateTOCEntriesAfterMerge(NCXResource *ncx_resource, const QString &sink_filename, const QStringList &merged_filenames);
 
 private:
 
-    static QHash<QString, QString> GetIDLocations(const QList<HTMLResource *> &html_resources);
+    static QHash<QString, QString> GetIDLocations(const QList<HTMLResource *> &html_resources, BookIndex *index);
 
     static std::tuple<QString, QList<QString>> GetOneFileIDs(HTMLResource *html_resource);
 
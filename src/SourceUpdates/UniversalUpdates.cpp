@@ -146,6 +146,94 @@ QStringList UniversalUpdates::PerformUniversalUpdates(bool resources_already_loa
 }
 
 
+// The characters URLEncodePath leaves alone and that need no escaping in
+// XML, so they appear as is in any link to a file name containing them
+static bool IsPlainPathChar(ushort c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '.' || c == '-' || c == '_' || c == '~';
+}
+
+
+static bool IsHexDigit(ushort c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+
+QList<Resource *> UniversalUpdates::ResourcesAffectedByUpdates(const QList<Resource *> &resources,
+        const QHash<QString, QString> &updates)
+{
+    // A link to a file always ends with its file name, however the
+    // rest of it is encoded. So the run of plain characters that ends
+    // a file name also ends a run of plain characters in the link.
+    QSet<QString> names;
+    foreach(QString bookpath, updates.keys()) {
+        int start = bookpath.length();
+        while (start > 0 && IsPlainPathChar(bookpath.at(start - 1).unicode())) {
+            start--;
+        }
+        if (start == bookpath.length()) {
+            // nothing plain to look for, so any file could link to it
+            return resources;
+        }
+        names.insert(bookpath.mid(start));
+    }
+
+    QList<Resource *> candidates;
+    QList<Resource *> affected;
+    foreach(Resource *resource, resources) {
+        Resource::ResourceType type = resource->Type();
+        if (type != Resource::HTMLResourceType && type != Resource::CSSResourceType) {
+            affected.append(resource);
+        } else if (resource->GetCurrentBookRelPath() != resource->GetRelativePath()) {
+            // all relative links in a moved file change
+            affected.append(resource);
+        } else {
+            candidates.append(resource);
+        }
+    }
+
+    affected.append(QtConcurrent::blockingFiltered(candidates, std::bind(MentionsFileNames, std::placeholders::_1, names)));
+    return affected;
+}
+
+
+bool UniversalUpdates::MentionsFileNames(Resource *resource, const QSet<QString> &names)
+{
+    TextResource *text_resource = qobject_cast<TextResource *>(resource);
+    if (!text_resource) {
+        return true;
+    }
+
+    QReadLocker locker(&resource->GetLock());
+    const QString text = text_resource->GetText();
+    const QChar *data = text.constData();
+    int length = text.length();
+    int start = -1;
+    for (int i = 0; i <= length; ++i) {
+        ushort c = (i < length) ? data[i].unicode() : 0;
+        if (i < length && IsPlainPathChar(c)) {
+            if (start == -1) {
+                start = i;
+            }
+            continue;
+        }
+        if (start != -1) {
+            if (names.contains(QString::fromRawData(data + start, i - start))) {
+                return true;
+            }
+            start = -1;
+        }
+        // the digits of a percent escape are not part of a name
+        if ((c == '%') && (i + 2 < length) && IsHexDigit(data[i + 1].unicode()) && IsHexDigit(data[i + 2].unicode())) {
+            i += 2;
+        }
+    }
+    return false;
+}
+
+
 std::tuple <QHash<QString, QString>,
       QHash<QString, QString>,
       QHash<QString, QString>>
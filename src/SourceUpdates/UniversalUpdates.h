@@ -42,6 +42,12 @@ public:
             const QHash<QString, QString> &updates,
             const QList<XMLResource *> &non_well_formed=QList<XMLResource *>());
 
+    // Narrows the already loaded resources down to the ones the updates can
+    // change: the HTML and CSS files that were moved or that mention the file
+    // name of an updated path, along with all resources of other types.
+    static QList<Resource *> ResourcesAffectedByUpdates(const QList<Resource *> &resources,
+            const QHash<QString, QString> &updates);
+
     static std::tuple <QHash<QString, QString>,
            QHash<QString, QString>,
            QHash<QString, QString>> SeparateHtmlCssXmlUpdates(const QHash<QString, QString> &updates);
@@ -52,6 +58,8 @@ public:
 
 private:
 
+    static bool MentionsFileNames(Resource *resource, const QSet<QString> &names);
+
     static QString UpdateOneHTMLFile(HTMLResource *html_resource,
                                      const QHash<QString, QString> &html_updates,
                                      const QHash<QString, QString> &css_updates);
@@ -783,7 +783,7 @@ bool CodeViewEditor::FindNext(const QString &search_regex,
                               bool wrap,
                               bool marked_text)
 {
-    SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
+    std::shared_ptr<SPCRE> spcre = PCRECache::instance()->getObject(search_regex);
     SPCRE::MatchInfo match_info;
     QString txt = toPlainText();
     int start_offset = 0;
@@ -847,7 +847,7 @@ bool CodeViewEditor::FindNext(const QString &search_regex,
 
 int CodeViewEditor::Count(const QString &search_regex, Searchable::Direction direction, bool wrap, bool marked_text)
 {
-    SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
+    std::shared_ptr<SPCRE> spcre = PCRECache::instance()->getObject(search_regex);
     QString text= toPlainText();
     int start = 0;
     int end = text.length();
@@ -874,7 +874,7 @@ int CodeViewEditor::Count(const QString &search_regex, Searchable::Direction dir
 
 bool CodeViewEditor::ReplaceSelected(const QString &search_regex, const QString &replacement, Searchable::Direction direction, bool replace_current)
 {
-    SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
+    std::shared_ptr<SPCRE> spcre = PCRECache::instance()->getObject(search_regex);
     int selection_start = textCursor().selectionStart();
     int selection_end = textCursor().selectionEnd();
 
@@ -964,7 +964,7 @@ int CodeViewEditor::ReplaceAll(const QString &search_regex,
     }
     int marked_text_length = text.length();
 
-    SPCRE *spcre = PCRECache::instance()->getObject(search_regex);
+    std::shared_ptr<SPCRE> spcre = PCRECache::instance()->getObject(search_regex);
     QList<SPCRE::MatchInfo> match_info = spcre->getEveryMatchInfo(text);
 
     // Run though all match offsets making the replacement in reverse order.
@@ -1933,7 +1933,13 @@ void CodeViewEditor::RehighlightDocument()
         // because we do not want the contentsChanged() signal to be fired
         // which would mark the underlying resource as needing saving.
         document()->blockSignals(true);
-        m_Highlighter->rehighlight();
+        XHTMLHighlighter *xhtml_highlighter = qobject_cast<XHTMLHighlighter *>(m_Highlighter);
+        if (xhtml_highlighter) {
+            // also has the spelling checked again
+            xhtml_highlighter->rehighlight();
+        } else {
+            m_Highlighter->rehighlight();
+        }
         document()->blockSignals(false);
     }
 }
@@ -1964,6 +1970,11 @@ void CodeViewEditor::UpdateLineNumberArea(const QRect &area_to_update, int verti
     if (area_to_update.contains(viewport()->rect())) {
         UpdateLineNumberAreaMargin();
     }
+
+    XHTMLHighlighter *xhtml_highlighter = qobject_cast<XHTMLHighlighter *>(m_Highlighter);
+    if (xhtml_highlighter) {
+        xhtml_highlighter->SetFirstVisibleBlock(firstVisibleBlock().blockNumber());
+    }
 }
 
 